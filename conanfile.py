@@ -15,6 +15,7 @@ class MTConnectAgentConan(ConanFile):
     settings = "os", "compiler", "arch", "build_type"
     options = { "without_ipv6": [True, False],
                 "with_ruby": [True, False], 
+                "with_http2": [True, False],
                  "development" : [True, False],
                  "shared": [True, False],
                  "winver": [None, "ANY"],
@@ -33,6 +34,7 @@ class MTConnectAgentConan(ConanFile):
     default_options = {
         "without_ipv6": False,
         "with_ruby": True,
+        "with_http2": False,
         "development": False,
         "shared": False,
         "winver": "0x600",
@@ -130,6 +132,9 @@ class MTConnectAgentConan(ConanFile):
         if self.options.with_ruby:
             self.requires("mruby/3.2.0", headers=True, libs=True, transitive_headers=True, transitive_libs=True)
 
+        if self.options.with_http2:
+            self.requires("libnghttp2/1.57.0", headers=True, libs=True, transitive_headers=True, transitive_libs=True)
+
         self.requires("gtest/1.10.0", headers=True, libs=True, transitive_headers=True, transitive_libs=True, test=True)
         
     def configure(self):
@@ -174,6 +179,7 @@ class MTConnectAgentConan(ConanFile):
         tc = CMakeToolchain(self)
         tc.cache_variables['SHARED_AGENT_LIB'] = self.options.shared.__bool__()
         tc.cache_variables['WITH_RUBY'] = self.options.with_ruby.__bool__()
+        tc.cache_variables['WITH_HTTP2'] = self.options.with_http2.__bool__()
         tc.cache_variables['AGENT_WITH_DOCS'] = self.options.with_docs.__bool__()
         tc.cache_variables['AGENT_WITHOUT_IPV6'] = self.options.without_ipv6.__bool__()
         tc.cache_variables['DEVELOPMENT'] = self.options.development.__bool__()
@@ -217,6 +223,8 @@ class MTConnectAgentConan(ConanFile):
                                  'BOOST_FILESYSTEM_VERSION=3']
         if self.options.with_ruby:
             self.cpp_info.defines.append("WITH_RUBY=1")
+        if self.options.with_http2:
+            self.cpp_info.defines.append("WITH_HTTP2=1")
         if self.options.without_ipv6:
             self.cpp_info.defines.append("AGENT_WITHOUT_IPV6=1")
         if self.options.shared:
@@ -41,6 +41,7 @@
 #include <thread>
 
 #include "mtconnect/asset/asset.hpp"
+#include "mtconnect/asset/asset_file_storage.hpp"
 #include "mtconnect/asset/component_configuration_parameters.hpp"
 #include "mtconnect/asset/cutting_tool.hpp"
 #include "mtconnect/asset/file_asset.hpp"
@@ -79,6 +80,7 @@ namespace mtconnect {
       m_context(context),
       m_strand(m_context),
       m_xmlParser(make_unique<parser::XmlParser>()),
+      m_pathCache(GetOption<int>(options, config::PathCacheSize).value_or(256)),
       m_schemaVersion(GetOption<string>(options, config::SchemaVersion)),
       m_deviceXmlPath(deviceXmlPath),
       m_circularBuffer(GetOption<int>(options, config::BufferSize).value_or(17),
@@ -95,8 +97,19 @@ namespace mtconnect {
     QIFDocumentWrapper::registerAsset();
     ComponentConfigurationParameters::registerAsset();
 
-    m_assetStorage = make_unique<AssetBuffer>(
-        GetOption<int>(options, mtconnect::configuration::MaxAssets).value_or(1024));
+    auto maxAssets = GetOption<int>(options, mtconnect::configuration::MaxAssets).value_or(1024);
+    if (auto assetFile = GetOption<string>(options, mtconnect::configuration::AssetFile))
+      m_assetStorage = make_unique<AssetFileStorage>(
+          maxAssets, *assetFile,
+          GetOption<int>(options, mtconnect::configuration::AssetCacheSize).value_or(1024));
+    else
+      m_assetStorage = make_unique<AssetBuffer>(maxAssets);
+    m_xmlParser->setSnapshotFile(
+        GetOption<string>(options, mtconnect::configuration::DeviceSnapshot));
+    m_xmlParser->setThreads(
+        GetOption<int>(options, mtconnect::configuration::DeviceParseThreads).value_or(1));
+    m_circularBuffer.setScanThreads(
+        GetOption<int>(options, mtconnect::configuration::SampleScanThreads).value_or(0));
     m_versionDeviceXml = IsOptionSet(options, mtconnect::configuration::VersionDeviceXml);
     m_createUniqueIds = IsOptionSet(options, config::CreateUniqueIds);
 
@@ -106,6 +119,10 @@ namespace mtconnect {
     // Create the Printers
     m_printers["xml"] = make_unique<printer::XmlPrinter>(m_pretty);
     m_printers["json"] = make_unique<printer::JsonPrinter>(jsonVersion, m_pretty);
+    m_printers["cbor"] = make_unique<printer::JsonPrinter>(jsonVersion, false,
+                                                           printer::BinaryEncoding::CBOR);
+    m_printers["msgpack"] = make_unique<printer::JsonPrinter>(jsonVersion, false,
+                                                              printer::BinaryEncoding::MSGPACK);
 
     if (m_schemaVersion)
     {
@@ -323,6 +340,8 @@ namespace mtconnect {
       asset->addHash();
 
     m_assetStorage->addAsset(asset);
+    for (auto &printer : m_printers)
+      printer.second->invalidateAsset(asset->getAssetId());
 
     for (auto &sink : m_sinks)
       sink->publish(asset);
@@ -539,17 +558,46 @@ namespace mtconnect {
       {
         LOG(info) << "Device " << *uuid << " changed, updating model";
 
+        // Diff the data items. The data items that remain take over the handles of the old data
+        // items so the observations in the buffer refer to the new data items. The handles of
+        // removed data items expire and their observations become orphans.
+        size_t added = 0, changed = 0, removed = 0;
+        for (auto &wdi : device->getDeviceDataItems())
+        {
+          auto di = wdi.lock();
+          if (!di)
+            continue;
+
+          auto it = m_dataItemMap.find(di->getId());
+          if (auto old = it != m_dataItemMap.end() ? it->second.lock() : nullptr)
+          {
+            if (old->Entity::operator!=(*di))
+              changed++;
+            di->replace(*old);
+          }
+          else
+          {
+            added++;
+          }
+        }
+
         // Remove the old data items
         set<string> skip;
         for (auto &di : oldDev->getDeviceDataItems())
         {
           if (!di.expired())
           {
-            m_dataItemMap.erase(di.lock()->getId());
-            skip.insert(di.lock()->getId());
+            auto id = di.lock()->getId();
+            if (device->getDeviceDataItems().count(id) == 0)
+              removed++;
+            m_dataItemMap.erase(id);
+            skip.insert(id);
           }
         }
 
+        LOG(info) << "Device " << *uuid << " data items: " << added << " added, " << changed
+                  << " changed, " << removed << " removed";
+
         // Replace device in device maps
         auto it = find(m_deviceIndex.begin(), m_deviceIndex.end(), oldDev);
         if (it != m_deviceIndex.end())
@@ -561,9 +609,7 @@ namespace mtconnect {
         }
 
         initializeDataItems(device, skip);
-
-        LOG(info) << "Device " << *uuid << " updating circular buffer";
-        m_circularBuffer.updateDataItems(m_dataItemMap);
+        m_deviceModelGeneration++;
 
         if (m_intSchemaVersion > SCHEMA_VERSION(2, 2))
           device->addHash();
@@ -692,6 +738,9 @@ namespace mtconnect {
 
   void Agent::notifyAssetRemoved(DevicePtr device, const asset::AssetPtr &asset)
   {
+    for (auto &printer : m_printers)
+      printer.second->invalidateAsset(asset->getAssetId());
+
     if (device || asset->getDeviceUuid())
     {
       auto dev = device;
@@ -952,6 +1001,7 @@ namespace mtconnect {
     if (m_intSchemaVersion >= SCHEMA_VERSION(2, 2))
       device->addHash();
 
+    m_deviceModelGeneration++;
     for (auto &printer : m_printers)
       printer.second->setModelChangeTime(getCurrentTime(GMT_UV_SEC));
   }
@@ -984,6 +1034,7 @@ namespace mtconnect {
       createUniqueIds(device);
       if (m_intSchemaVersion >= SCHEMA_VERSION(2, 2))
         device->addHash();
+      m_deviceModelGeneration++;
 
       versionDeviceXml();
       loadCachedProbe();
@@ -1043,14 +1094,29 @@ namespace mtconnect {
   {
     NAMED_SCOPE("Agent::loadCachedProbe");
 
-    // Reload the document for path resolution
-    auto xmlPrinter = dynamic_cast<printer::XmlPrinter *>(m_printers["xml"].get());
-    m_xmlParser->loadDocument(xmlPrinter->printProbe(0, 0, 0, 0, 0, getDevices()));
+    // Reindex the device model for path resolution. The libxml2 document is only
+    // recreated if a path needs the full XPath implementation.
+    m_pathResolver.load(getDevices());
+    m_xmlParser->unloadDocument();
+
+    // Clear after reloading so paths resolved against the old model are not cached
+    m_pathCache.clear();
 
     for (auto &printer : m_printers)
       printer.second->setModelChangeTime(getCurrentTime(GMT_UV_SEC));
   }
 
+  void Agent::loadProbeDocument() const
+  {
+    std::lock_guard<std::mutex> lock(m_probeDocumentMutex);
+
+    if (!m_xmlParser->hasDocument())
+    {
+      auto xmlPrinter = dynamic_cast<printer::XmlPrinter *>(m_printers.at("xml").get());
+      m_xmlParser->loadDocument(xmlPrinter->printProbe(0, 0, 0, 0, 0, getDevices()));
+    }
+  }
+
   // ----------------------------------------------------
   // Helper Methods
   // ----------------------------------------------------
@@ -1348,6 +1414,30 @@ namespace mtconnect {
     return dataPath;
   }
 
+  void Agent::getDataItemsForPath(const DevicePtr device, const std::optional<std::string> &path,
+                                  FilterSet &filter,
+                                  const std::optional<std::string> &deviceType) const
+  {
+    auto key = parser::PathCache::makeKey(device, path, deviceType);
+    if (m_pathCache.find(key, filter))
+      return;
+
+    auto generation = m_pathCache.getGeneration();
+    FilterSet resolved;
+    auto dataPath = devicesAndPath(path, device, deviceType);
+    if (!m_pathResolver.getDataItems(resolved, dataPath))
+    {
+      LOG(debug) << "Path is not supported by the path resolver, using libxml2: " << dataPath;
+      loadProbeDocument();
+      m_xmlParser->getDataItems(resolved, dataPath);
+    }
+
+    // Only cache successful resolutions so bad paths cannot evict good ones
+    if (!resolved.empty())
+      m_pathCache.insert(key, resolved, generation);
+    filter.insert(resolved.begin(), resolved.end());
+  }
+
   void AgentPipelineContract::deliverAssetCommand(entity::EntityPtr command)
   {
     const std::string &cmd = command->getValue<string>();
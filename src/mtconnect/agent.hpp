@@ -26,10 +26,12 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index_container.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <string>
@@ -45,6 +47,8 @@
 #include "mtconnect/configuration/service.hpp"
 #include "mtconnect/device_model/agent_device.hpp"
 #include "mtconnect/device_model/device.hpp"
+#include "mtconnect/parser/path_cache.hpp"
+#include "mtconnect/parser/path_resolver.hpp"
 #include "mtconnect/parser/xml_parser.hpp"
 #include "mtconnect/pipeline/pipeline.hpp"
 #include "mtconnect/pipeline/pipeline_contract.hpp"
@@ -214,6 +218,10 @@ namespace mtconnect {
     /// @returns the schema version as an integer [major * 100 + minor] as a 32bit integer.
     const auto getIntSchemaVersion() const { return m_intSchemaVersion; }
 
+    /// @brief get a number that changes when the devices or data items change
+    /// @return the device model generation
+    uint64_t getDeviceModelGeneration() const { return m_deviceModelGeneration; }
+
     /// @brief Find a device by name
     /// @param[in] name The name of the device to find
     /// @return A shared pointer to the device
@@ -372,7 +380,8 @@ namespace mtconnect {
                          asset::AssetList &list);
     /// @brief Send asset removed observation when an asset is removed.
     ///
-    /// Also sets asset changed to `UNAVAILABLE` if the asset removed asset was the last changed.
+    /// Also sets asset changed to `UNAVAILABLE` if the asset removed asset was the last changed
+    /// and drops the serialized asset from the printers' asset caches.
     ///
     /// @param device The device related to the asset
     /// @param asset The asset
@@ -430,6 +439,24 @@ namespace mtconnect {
     std::string devicesAndPath(const std::optional<std::string> &path, const DevicePtr device,
                                const std::optional<std::string> &deviceType = std::nullopt) const;
 
+    /// @brief Find all the data items for a path, using the path cache if the path has been
+    ///        resolved since the device model last changed.
+    ///
+    /// Paths are resolved against the device model by the `PathResolver`. Paths using XPath
+    /// outside of its subset fall back to libxml2 using a probe document that is only created
+    /// when needed.
+    /// @param[in] device optional device to search
+    /// @param[in] path optional xpath to search
+    /// @param[out] filter the set of all data items matching path
+    /// @param[in] deviceType optional Agent or Device selector
+    void getDataItemsForPath(const DevicePtr device, const std::optional<std::string> &path,
+                             FilterSet &filter,
+                             const std::optional<std::string> &deviceType = std::nullopt) const;
+
+    /// @brief Get the cache of resolved paths
+    /// @return a const reference to the path cache
+    const auto &getPathCache() const { return m_pathCache; }
+
     /// @brief Creates unique ids for the device model and maps to the originals
     ///
     /// Also updates the agents data item map by adding the new ids. Duplicate original
@@ -452,6 +479,7 @@ namespace mtconnect {
     void initializeDataItems(DevicePtr device,
                              std::optional<std::set<std::string>> skip = std::nullopt);
     void loadCachedProbe();
+    void loadProbeDocument() const;
     void versionDeviceXml();
 
     // Asset count management
@@ -489,6 +517,9 @@ namespace mtconnect {
 
     // Pointer to the configuration file for node access
     std::unique_ptr<parser::XmlParser> m_xmlParser;
+    mutable parser::PathCache m_pathCache;
+    parser::PathResolver m_pathResolver;
+    mutable std::mutex m_probeDocumentMutex;
     PrinterMap m_printers;
 
     // Agent Device
@@ -528,6 +559,7 @@ namespace mtconnect {
 
     DeviceIndex m_deviceIndex;
     std::unordered_map<std::string, WeakDataItemPtr> m_dataItemMap;
+    std::atomic<uint64_t> m_deviceModelGeneration {0};
 
     // Xml Config
     std::optional<std::string> m_schemaVersion;
@@ -581,6 +613,10 @@ namespace mtconnect {
       }
     }
     int32_t getSchemaVersion() const override { return m_agent->getIntSchemaVersion(); }
+    uint64_t getDeviceModelGeneration() const override
+    {
+      return m_agent->getDeviceModelGeneration();
+    }
     void deliverObservation(observation::ObservationPtr obs) override
     {
       m_agent->receiveObservation(obs);
@@ -645,9 +681,7 @@ namespace mtconnect {
                              FilterSet &filter,
                              const std::optional<std::string> &deviceType) const override
     {
-      std::string dataPath = m_agent->devicesAndPath(path, device, deviceType);
-      const auto &parser = m_agent->getXmlParser();
-      parser->getDataItems(filter, dataPath);
+      m_agent->getDataItemsForPath(device, path, filter, deviceType);
     }
 
     buffer::CircularBuffer &getCircularBuffer() override { return m_agent->getCircularBuffer(); }
@@ -48,44 +48,88 @@
 namespace mtconnect::asset {
   namespace mic = boost::multi_index;
 
+  /// @brief In memory asset storage
+  ///
+  /// Assets are indexed so filtered queries only visit the matching assets. The indexes on
+  /// device and type include the removed state and the order the assets were added, so active
+  /// assets of a type are found in FIFO order without skipping removed assets. The total and
+  /// removed counts are maintained by device and type as assets change.
+  ///
+  /// Subclasses that persist assets can keep only some of the assets in memory. They override
+  /// `load()` to page assets in and `store()` and `erase()` to write the changes.
   class AGENT_LIB_API AssetBuffer : public AssetStorage
   {
   public:
     /// @brief Structure to store asset for boost multi index container
+    ///
+    /// The keys are copied from the asset so the indexes only change when the node is modified.
     struct AssetNode
     {
-      AssetNode(AssetPtr &asset) : m_asset(asset), m_identity(asset->getAssetId()) {}
+      AssetNode(AssetPtr &asset, uint64_t sequence) : m_identity(asset->getAssetId())
+      {
+        update(asset, sequence);
+      }
+      /// @brief create a node from the keys of an asset that has not been loaded
+      AssetNode(const std::string &id, const std::string &type, const std::string &device,
+                bool removed, const Timestamp &timestamp, uint64_t sequence)
+        : m_identity(id),
+          m_type(type),
+          m_deviceUuid(device),
+          m_removed(removed),
+          m_timestamp(timestamp),
+          m_sequence(sequence)
+      {}
       ~AssetNode() = default;
 
       using element_type = AssetPtr;
 
-      const std::string &getAssetId() const { return m_identity; }
-      const std::string &getType() const { return m_asset->getType(); }
-      const std::string &getDeviceUuid() const
+      /// @brief copy the keys from the asset
+      void update(const AssetPtr &asset, uint64_t sequence)
       {
-        static const std::string unknown {"UNKNOWN"};
-        const auto &dev = m_asset->getProperty("deviceUuid");
-        if (std::holds_alternative<std::string>(dev))
-          return std::get<std::string>(dev);
-        else
-          return unknown;
+        m_asset = asset;
+        m_type = asset->getType();
+        m_deviceUuid = asset->getDeviceUuid().value_or("UNKNOWN");
+        m_removed = asset->isRemoved();
+        m_timestamp = asset->getTimestamp().value_or(Timestamp());
+        m_sequence = sequence;
       }
-      bool isRemoved() const { return m_asset->isRemoved(); }
+
+      const std::string &getAssetId() const { return m_identity; }
+      const std::string &getType() const { return m_type; }
+      const std::string &getDeviceUuid() const { return m_deviceUuid; }
+      bool isRemoved() const { return m_removed; }
 
       bool operator<(const AssetNode &o) const { return m_identity < o.m_identity; }
 
       AssetPtr operator*() const { return m_asset; }
 
-      AssetPtr m_asset;
+      /// The asset, may be `nullptr` if the storage has paged it out
+      mutable AssetPtr m_asset;
+      /// The position of the asset in persistent storage, `0` if not stored
+      mutable uint64_t m_location {0};
       std::string m_identity;
+      std::string m_type;
+      std::string m_deviceUuid;
+      bool m_removed {false};
+      Timestamp m_timestamp;
+      uint64_t m_sequence {0};
     };
 
   public:
     using AssetId = std::string;
     using AssetType = std::string;
     using DeviceUuid = std::string;
-    using RemoveCountByType = std::unordered_map<AssetType, size_t>;
-    using RemoveCountByDeviceAndType = std::unordered_map<DeviceUuid, RemoveCountByType>;
+
+    /// @brief Total and removed asset counts
+    struct Count
+    {
+      size_t get(bool active) const { return active ? m_total - m_removed : m_total; }
+
+      size_t m_total {0};
+      size_t m_removed {0};
+    };
+    using CountByType = std::map<AssetType, Count>;
+    using CountByDeviceAndType = std::unordered_map<DeviceUuid, CountByType>;
 
     /// @brief Index by first in/first out sequence
     struct ByFifo
@@ -93,12 +137,23 @@ namespace mtconnect::asset {
     /// @brief Index by assetId
     struct ByAssetId
     {};
-    /// @brief Index by Device and Type
+    /// @brief Index by Device, Type, and removed, most recent first
     struct ByDeviceAndType
     {};
-    /// @brief Index by type
+    /// @brief Index by Device and removed, most recent first
+    struct ByDevice
+    {};
+    /// @brief Index by type and removed, most recent first
     struct ByType
     {};
+    /// @brief Index by removed, most recent first
+    struct ByRemoved
+    {};
+    /// @brief Index by timestamp
+    struct ByTimestamp
+    {};
+
+    using Newest = std::greater<uint64_t>;
 
     /// @brief The Multi-Index Container type
     using AssetIndex = mic::multi_index_container<
@@ -106,9 +161,24 @@ namespace mtconnect::asset {
         mic::indexed_by<
             mic::sequenced<mic::tag<ByFifo>>,
             mic::hashed_unique<mic::tag<ByAssetId>, mic::key<&AssetNode::m_identity>>,
-            mic::ordered_non_unique<mic::tag<ByDeviceAndType>,
-                                    mic::key<&AssetNode::getDeviceUuid, &AssetNode::getType>>,
-            mic::hashed_non_unique<mic::tag<ByType>, mic::key<&AssetNode::getType>>>>;
+            mic::ordered_non_unique<
+                mic::tag<ByDeviceAndType>,
+                mic::key<&AssetNode::m_deviceUuid, &AssetNode::m_type, &AssetNode::m_removed,
+                         &AssetNode::m_sequence>,
+                mic::composite_key_compare<std::less<std::string>, std::less<std::string>,
+                                           std::less<bool>, Newest>>,
+            mic::ordered_non_unique<
+                mic::tag<ByDevice>,
+                mic::key<&AssetNode::m_deviceUuid, &AssetNode::m_removed, &AssetNode::m_sequence>,
+                mic::composite_key_compare<std::less<std::string>, std::less<bool>, Newest>>,
+            mic::ordered_non_unique<
+                mic::tag<ByType>,
+                mic::key<&AssetNode::m_type, &AssetNode::m_removed, &AssetNode::m_sequence>,
+                mic::composite_key_compare<std::less<std::string>, std::less<bool>, Newest>>,
+            mic::ordered_non_unique<
+                mic::tag<ByRemoved>, mic::key<&AssetNode::m_removed, &AssetNode::m_sequence>,
+                mic::composite_key_compare<std::less<bool>, Newest>>,
+            mic::ordered_non_unique<mic::tag<ByTimestamp>, mic::key<&AssetNode::m_timestamp>>>>;
 
     /// @brief Create an asset buffer with a maximum size
     /// @param max the maximum size
@@ -117,6 +187,7 @@ namespace mtconnect::asset {
 
     size_t getCount(bool active = true) const override
     {
+      std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
       if (active)
         return m_index.size() - m_removedAssets;
       else
@@ -138,27 +209,31 @@ namespace mtconnect::asset {
         throw entity::PropertyError("Asset does not have an asset id");
       }
 
-      auto added = m_index.emplace_front(asset);
+      auto sequence = ++m_sequence;
+      auto added = m_index.emplace_front(asset, sequence);
 
       // Is duplicate
       if (!added.second)
       {
-        old = added.first->m_asset;
-        m_index.modify(added.first, [&asset](AssetNode &n) { n.m_asset = asset; });
+        old = load(*added.first);
+        adjustCount(*added.first, -1);
+        m_index.modify(added.first,
+                       [&asset, sequence](AssetNode &n) { n.update(asset, sequence); });
+        adjustCount(*added.first, 1);
         m_index.relocate(m_index.begin(), added.first);
-        if (asset->isRemoved() && !old->isRemoved())
-          adjustCount(asset, 1);
-        else if (!asset->isRemoved() && old->isRemoved())
-          adjustCount(old, -1);
+        store(*added.first);
       }
-      else if (m_index.size() > m_maxAssets)
+      else
       {
-        // Remove old asset from the end
-        old = m_index.back().m_asset;
-        m_index.pop_back();
-        if (old->isRemoved())
+        adjustCount(*added.first, 1);
+        store(*added.first);
+        if (m_index.size() > m_maxAssets)
         {
-          adjustCount(old, -1);
+          // Remove old asset from the end
+          old = load(m_index.back());
+          adjustCount(m_index.back(), -1);
+          erase(m_index.back());
+          m_index.pop_back();
         }
       }
 
@@ -175,13 +250,20 @@ namespace mtconnect::asset {
       auto it = idx.find(id);
       if (it != idx.end())
       {
-        asset = it->m_asset;
-        if (!asset->isRemoved())
+        asset = load(*it);
+        if (asset && !it->isRemoved())
         {
           asset->setProperty("removed", true);
           Timestamp ts = time ? *time : std::chrono::system_clock::now();
           asset->setProperty("timestamp", ts);
-          adjustCount(asset, 1);
+
+          adjustCount(*it, -1);
+          idx.modify(it, [ts](AssetNode &n) {
+            n.m_removed = true;
+            n.m_timestamp = ts;
+          });
+          adjustCount(*it, 1);
+          store(*it);
         }
       }
 
@@ -194,7 +276,7 @@ namespace mtconnect::asset {
       const auto &idx = m_index.get<ByAssetId>();
       auto it = idx.find(id);
       if (it != idx.end())
-        return it->m_asset;
+        return load(*it);
       else
         return nullptr;
     }
@@ -204,42 +286,72 @@ namespace mtconnect::asset {
                              const std::optional<std::string> type = std::nullopt) const override
     {
       std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
-      boost::any_range<AssetNode, boost::forward_traversal_tag> range;
 
-      if (device)
+      // Assets are returned in FIFO order, the most recent first. Each index has the active
+      // assets before the removed assets, so the two ranges are merged to include removed assets.
+      if (device && type)
+      {
+        auto &idx = m_index.get<ByDeviceAndType>();
+        if (active)
+          return collect(list, max, idx.equal_range(std::make_tuple(*device, *type, false)));
+        else
+          return merge(list, max, idx.equal_range(std::make_tuple(*device, *type, false)),
+                       idx.equal_range(std::make_tuple(*device, *type, true)));
+      }
+      else if (device)
       {
-        if (type)
-          range = m_index.get<ByDeviceAndType>().equal_range(std::make_tuple(*device, *type));
+        auto &idx = m_index.get<ByDevice>();
+        if (active)
+          return collect(list, max, idx.equal_range(std::make_tuple(*device, false)));
         else
-          range = m_index.get<ByDeviceAndType>().equal_range(std::make_tuple(*device));
+          return merge(list, max, idx.equal_range(std::make_tuple(*device, false)),
+                       idx.equal_range(std::make_tuple(*device, true)));
       }
       else if (type)
       {
-        range = m_index.get<ByType>().equal_range(*type);
+        auto &idx = m_index.get<ByType>();
+        if (active)
+          return collect(list, max, idx.equal_range(std::make_tuple(*type, false)));
+        else
+          return merge(list, max, idx.equal_range(std::make_tuple(*type, false)),
+                       idx.equal_range(std::make_tuple(*type, true)));
+      }
+      else if (active)
+      {
+        return collect(list, max, m_index.get<ByRemoved>().equal_range(std::make_tuple(false)));
       }
       else
       {
         auto &idx = m_index.get<ByFifo>();
-        range = std::make_pair(idx.begin(), idx.end());
+        return collect(list, max, std::make_pair(idx.begin(), idx.end()));
       }
+    }
 
-      for (auto &a : range)
+    virtual size_t getAssets(AssetList &list, const std::list<std::string> &ids) const override
+    {
+      for (auto id : ids)
       {
-        if (!active || !a.isRemoved())
-          list.push_back(a.m_asset);
-        if (list.size() >= max)
-          break;
+        if (auto asset = AssetBuffer::getAsset(id); asset)
+          list.emplace_back(asset);
       }
 
       return list.size();
     }
 
-    virtual size_t getAssets(AssetList &list, const std::list<std::string> &ids) const override
+    size_t getAssetsByTime(AssetList &list, size_t max, const Timestamp &from, const Timestamp &to,
+                           const bool active = true) const override
     {
-      for (auto id : ids)
+      std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
+
+      auto &idx = m_index.get<ByTimestamp>();
+      auto first = std::make_reverse_iterator(idx.upper_bound(to));
+      auto last = std::make_reverse_iterator(idx.lower_bound(from));
+      for (auto it = first; it != last && list.size() < max; it++)
       {
-        if (auto asset = AssetBuffer::getAsset(id); asset)
-          list.emplace_back(asset);
+        if (active && it->isRemoved())
+          continue;
+        if (auto asset = load(*it))
+          list.push_back(asset);
       }
 
       return list.size();
@@ -248,84 +360,54 @@ namespace mtconnect::asset {
     size_t getCountForDeviceAndType(const std::string &device, const std::string &type,
                                     bool active = true) const override
     {
-      using namespace boost::adaptors;
-
       std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
 
-      return boost::count_if(
-          m_index.get<ByDeviceAndType>().equal_range(std::make_tuple(device, type)),
-          activePredicate(active));
+      if (auto dit = m_deviceCounts.find(device); dit != m_deviceCounts.end())
+      {
+        if (auto tit = dit->second.find(type); tit != dit->second.end())
+          return tit->second.get(active);
+      }
+
+      return 0;
     }
 
     size_t getCountForType(const std::string &type, bool active = true) const override
     {
-      using namespace boost::adaptors;
-
       std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
 
-      return boost::count_if(m_index.get<ByType>().equal_range(type), activePredicate(active));
+      if (auto it = m_typeCounts.find(type); it != m_typeCounts.end())
+        return it->second.get(active);
+      else
+        return 0;
     }
 
     size_t getCountForDevice(const std::string &device, bool active = true) const override
     {
       std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
 
-      return boost::count_if(m_index.get<ByDeviceAndType>().equal_range(std::make_tuple(device)),
-                             activePredicate(active));
+      size_t count = 0;
+      if (auto it = m_deviceCounts.find(device); it != m_deviceCounts.end())
+      {
+        for (const auto &[type, c] : it->second)
+          count += c.get(active);
+      }
+
+      return count;
     }
 
     TypeCount getCountsByType(bool active = true) const override
     {
       std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
-      TypeCount res;
-      auto &idx = m_index.get<ByType>();
-      auto it = idx.begin();
-      while (it != idx.end())
-      {
-        int delta = 0;
-        auto &type = it->getType();
-        auto rng = idx.equal_range(type);
-        if (active)
-        {
-          auto cit = m_typeRemoveCount.find(type);
-          delta = cit != m_typeRemoveCount.end() ? (int32_t)cit->second : 0;
-        }
-        auto count = distance(rng.first, rng.second) - delta;
-        if (count > 0)
-          res[type] = count;
-        it = rng.second;
-      }
-
-      return res;
+      return typeCounts(m_typeCounts, active);
     }
 
     TypeCount getCountsByTypeForDevice(const std::string &device, bool active = true) const override
     {
       std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
-      TypeCount res;
-      auto &idx = m_index.get<ByDeviceAndType>();
-      auto removes = m_deviceRemoveCount.find(device);
-      const auto *ridx {removes == m_deviceRemoveCount.end() ? nullptr : &removes->second};
-
-      auto range = idx.equal_range(std::make_tuple(device));
-      auto it = range.first;
-      while (it != range.second)
-      {
-        int delta = 0;
-        auto &type = it->getType();
-        auto rng = idx.equal_range(std::make_tuple(device, type));
-        if (ridx != nullptr && active)
-        {
-          auto cit = ridx->find(type);
-          delta = cit != ridx->end() ? int32_t(cit->second) : 0;
-        }
-        auto count = distance(rng.first, rng.second) - delta;
-        if (count > 0)
-          res[type] = count;
-        it = rng.second;
-      }
-
-      return res;
+      if (auto it = m_deviceCounts.find(device); it != m_deviceCounts.end())
+        return typeCounts(it->second, active);
+      else
+        return TypeCount();
     }
 
     size_t removeAll(AssetList &list, const std::optional<std::string> device = std::nullopt,
@@ -355,56 +437,95 @@ namespace mtconnect::asset {
     }
 
   protected:
-    void adjustCount(AssetPtr asset, int delta)
+    /// @name Storage hooks
+    ///@{
+
+    /// @brief get the asset for a node, loading it if it is not in memory
+    /// @param[in] node the node
+    /// @return the asset or `nullptr` if it cannot be loaded
+    virtual AssetPtr load(const AssetNode &node) const { return node.m_asset; }
+    /// @brief called after a node is added or changed
+    /// @param[in] node the node with the current asset
+    virtual void store(const AssetNode &node) {}
+    /// @brief called before a node is removed from the buffer
+    /// @param[in] node the node
+    virtual void erase(const AssetNode &node) {}
+    ///@}
+
+    template <typename R>
+    size_t collect(AssetList &list, size_t max, const R &range) const
     {
-      const auto &type = asset->getType();
-      const auto &dev = asset->getDeviceUuid();
-      bool found = false;
-
-      if (dev)
+      for (auto it = range.first; it != range.second && list.size() < max; it++)
       {
-        auto it = m_deviceRemoveCount.find(*dev);
-        if (it != m_deviceRemoveCount.end())
-        {
-          auto ti = it->second.find(type);
-          if (ti != it->second.end())
-          {
-            ti->second += delta;
-            found = true;
-          }
-        }
-
-        if (!found && delta > 0)
-        {
-          m_deviceRemoveCount[*dev][type] = delta;
-        }
-
-        m_removedAssets += delta;
+        if (auto asset = load(*it))
+          list.push_back(asset);
       }
 
-      if (auto it = m_typeRemoveCount.find(type); it != m_typeRemoveCount.end())
+      return list.size();
+    }
+
+    // Collect from two ranges ordered most recent first, keeping the FIFO order of the buffer
+    template <typename R>
+    size_t merge(AssetList &list, size_t max, const R &first, const R &second) const
+    {
+      auto a = first.first, b = second.first;
+      while (list.size() < max && (a != first.second || b != second.second))
       {
-        it->second += delta;
+        bool fromFirst =
+            b == second.second || (a != first.second && a->m_sequence > b->m_sequence);
+        auto &node = fromFirst ? *a++ : *b++;
+        if (auto asset = load(node))
+          list.push_back(asset);
       }
-      else
+
+      return list.size();
+    }
+
+    static TypeCount typeCounts(const CountByType &counts, bool active)
+    {
+      TypeCount res;
+      for (const auto &[type, c] : counts)
       {
-        m_typeRemoveCount[type] += delta;
+        if (auto count = c.get(active); count > 0)
+          res[type] = count;
       }
+
+      return res;
     }
 
-    std::function<bool(const AssetNode &)> activePredicate(bool active) const
+    // Add or subtract the node from the counts for its device and type
+    void adjustCount(const AssetNode &node, int delta)
     {
-      if (active)
-        return [](const AssetNode &a) -> bool { return !a.isRemoved(); };
-      else
-        return [](const AssetNode &a) -> bool { return true; };
+      auto adjust = [&node, delta](Count &count) {
+        count.m_total += delta;
+        if (node.isRemoved())
+          count.m_removed += delta;
+      };
+
+      auto &device = m_deviceCounts[node.getDeviceUuid()];
+      adjust(device[node.getType()]);
+      if (device[node.getType()].m_total == 0)
+      {
+        device.erase(node.getType());
+        if (device.empty())
+          m_deviceCounts.erase(node.getDeviceUuid());
+      }
+
+      auto &type = m_typeCounts[node.getType()];
+      adjust(type);
+      if (type.m_total == 0)
+        m_typeCounts.erase(node.getType());
+
+      if (node.isRemoved())
+        m_removedAssets += delta;
     }
 
   protected:
     size_t m_removedAssets {0};
+    uint64_t m_sequence {0};
     AssetIndex m_index;
 
-    RemoveCountByDeviceAndType m_deviceRemoveCount;
-    RemoveCountByType m_typeRemoveCount;
+    CountByDeviceAndType m_deviceCounts;
+    CountByType m_typeCounts;
   };
 }  // namespace mtconnect::asset
@@ -0,0 +1,518 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#include "asset_file_storage.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "mtconnect/entity/xml_parser.hpp"
+#include "mtconnect/entity/xml_printer.hpp"
+#include "mtconnect/logging.hpp"
+#include "mtconnect/printer/xml_printer_helper.hpp"
+
+namespace mtconnect::asset {
+  using namespace std;
+  namespace bip = boost::interprocess;
+  namespace fs = std::filesystem;
+
+  static constexpr char LogMagic[8] = {'M', 'T', 'C', 'A', 'S', 'S', 'E', 'T'};
+
+  /// The header at the start of the log file. The end is the position after the last record.
+  struct AssetFileStorage::LogHeader
+  {
+    char m_magic[8];
+    uint64_t m_end;
+  };
+
+  // The records start on a cache line after the header
+  static constexpr uint64_t LogDataOffset {64};
+  static constexpr uint64_t MinLogSize {64 * 1024};
+
+  enum RecordFlags : uint8_t
+  {
+    REMOVED = 0x1,  ///< The asset is marked as removed
+    DELETED = 0x2   ///< The asset was deleted from storage, the record has no document
+  };
+
+  /// Each record is a fixed header followed by the assetId, type, device uuid, and XML document.
+  /// Records are padded to 8 bytes.
+  struct AssetRecord
+  {
+    uint32_t m_size;
+    uint8_t m_flags;
+    uint8_t m_reserved[3];
+    uint32_t m_idSize;
+    uint32_t m_typeSize;
+    uint32_t m_deviceSize;
+    uint32_t m_documentSize;
+    uint64_t m_sequence;
+    int64_t m_timestamp;
+  };
+
+  AssetFileStorage::AssetFileStorage(size_t max, const fs::path &file, size_t cacheSize)
+    : AssetBuffer(max), m_path(file), m_cacheSize(std::max<size_t>(cacheSize, 1))
+  {
+    open();
+    recover();
+  }
+
+  AssetFileStorage::~AssetFileStorage()
+  {
+    if (m_region)
+      m_region->flush();
+  }
+
+  void AssetFileStorage::open()
+  {
+    NAMED_SCOPE("AssetFileStorage::open");
+    try
+    {
+      std::error_code ec;
+      uint64_t size = 0;
+      if (fs::exists(m_path, ec))
+      {
+        size = fs::file_size(m_path);
+      }
+      else
+      {
+        ofstream create(m_path, ios::binary | ios::trunc);
+      }
+
+      if (size < LogDataOffset + MinLogSize)
+      {
+        size = LogDataOffset + MinLogSize;
+        fs::resize_file(m_path, size);
+      }
+      if (!map(size))
+      {
+        LOG(error) << "Asset log: assets will only be held in memory";
+        return;
+      }
+
+      auto h = header();
+      if (memcmp(h->m_magic, LogMagic, sizeof(LogMagic)) != 0 || h->m_end < LogDataOffset ||
+          h->m_end > size)
+      {
+        memcpy(h->m_magic, LogMagic, sizeof(LogMagic));
+        h->m_end = LogDataOffset;
+      }
+    }
+    catch (std::exception &e)
+    {
+      LOG(error) << "Asset log: cannot map " << m_path << ": " << e.what()
+                 << ", assets will only be held in memory";
+      m_region.reset();
+      m_file.reset();
+    }
+  }
+
+  bool AssetFileStorage::map(uint64_t size)
+  {
+    NAMED_SCOPE("AssetFileStorage::map");
+
+    // The mapping is only replaced once the new one has been mapped
+    string error;
+    auto attempt = [this, &error](uint64_t size) {
+      try
+      {
+        if (fs::file_size(m_path) < size)
+          fs::resize_file(m_path, size);
+
+        auto file = make_unique<bip::file_mapping>(m_path.string().c_str(), bip::read_write);
+        auto region = make_unique<bip::mapped_region>(*file, bip::read_write);
+        m_region = std::move(region);
+        m_file = std::move(file);
+        return true;
+      }
+      catch (std::exception &e)
+      {
+        error = e.what();
+        return false;
+      }
+    };
+
+    if (m_region)
+      m_region->flush();
+    if (attempt(size))
+      return true;
+
+    // Windows cannot resize a mapped file. Release the mapping and try again, mapping the log
+    // as it is if it still cannot be resized.
+    if (m_region)
+    {
+      m_region.reset();
+      m_file.reset();
+      if (attempt(size))
+        return true;
+      attempt(0);
+    }
+
+    LOG(error) << "Asset log: cannot map " << m_path << " with " << size << " bytes: " << error;
+    return false;
+  }
+
+  // Only the record headers are read, the documents are parsed when the asset is requested.
+  void AssetFileStorage::recover()
+  {
+    NAMED_SCOPE("AssetFileStorage::recover");
+    if (!m_region)
+      return;
+
+    // The last record for an assetId is the current state of the asset
+    unordered_map<string, uint64_t> latest;
+    auto h = header();
+    for (uint64_t pos = LogDataOffset; pos < h->m_end;)
+    {
+      AssetRecord record;
+      memcpy(&record, data(pos), sizeof(record));
+      uint64_t used = uint64_t(sizeof(record)) + record.m_idSize + record.m_typeSize +
+                      record.m_deviceSize + record.m_documentSize;
+      if (record.m_size < sizeof(record) || pos + record.m_size > h->m_end ||
+          used > record.m_size)
+      {
+        LOG(warning) << "Asset log: invalid record at " << pos << " in " << m_path
+                     << ", ignoring the rest of the log";
+        h->m_end = pos;
+        break;
+      }
+
+      string id(data(pos) + sizeof(record), record.m_idSize);
+      auto it = latest.find(id);
+      if (it != latest.end())
+        m_garbage += recordSize(it->second);
+
+      if ((record.m_flags & DELETED) != 0)
+      {
+        m_garbage += record.m_size;
+        if (it != latest.end())
+          latest.erase(it);
+      }
+      else
+      {
+        latest.insert_or_assign(id, pos);
+      }
+
+      pos += record.m_size;
+    }
+
+    vector<pair<uint64_t, uint64_t>> live;
+    live.reserve(latest.size());
+    for (auto &[id, location] : latest)
+    {
+      AssetRecord record;
+      memcpy(&record, data(location), sizeof(record));
+      live.emplace_back(record.m_sequence, location);
+    }
+    sort(live.begin(), live.end());
+
+    for (auto &[sequence, location] : live)
+    {
+      AssetRecord record;
+      memcpy(&record, data(location), sizeof(record));
+      auto p = data(location) + sizeof(record);
+      string id(p, record.m_idSize);
+      p += record.m_idSize;
+      string type(p, record.m_typeSize);
+      p += record.m_typeSize;
+      string device(p, record.m_deviceSize);
+
+      Timestamp timestamp {Timestamp::duration(record.m_timestamp)};
+      auto added = m_index.emplace_front(id, type, device, (record.m_flags & REMOVED) != 0,
+                                         timestamp, sequence);
+      added.first->m_location = location;
+      adjustCount(*added.first, 1);
+      m_sequence = std::max(m_sequence, sequence);
+    }
+
+    while (m_index.size() > m_maxAssets)
+    {
+      adjustCount(m_index.back(), -1);
+      erase(m_index.back());
+      m_index.pop_back();
+    }
+
+    if (!m_index.empty())
+      LOG(info) << "Asset log: recovered " << m_index.size() << " assets from " << m_path;
+  }
+
+  AssetFileStorage::LogHeader *AssetFileStorage::header() const
+  {
+    return static_cast<LogHeader *>(m_region->get_address());
+  }
+
+  char *AssetFileStorage::data(uint64_t location) const
+  {
+    return static_cast<char *>(m_region->get_address()) + location;
+  }
+
+  uint32_t AssetFileStorage::recordSize(uint64_t location) const
+  {
+    uint32_t size;
+    memcpy(&size, data(location), sizeof(size));
+    return size;
+  }
+
+  uint64_t AssetFileStorage::getLogSize() const
+  {
+    std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
+    return m_region ? header()->m_end - LogDataOffset : 0;
+  }
+
+  uint64_t AssetFileStorage::append(const AssetNode &node, const std::string &document,
+                                    uint8_t flags)
+  {
+    const auto &id = node.getAssetId();
+    const auto &type = node.getType();
+    const auto &device = node.getDeviceUuid();
+
+    AssetRecord record {0,
+                        flags,
+                        {0, 0, 0},
+                        uint32_t(id.size()),
+                        uint32_t(type.size()),
+                        uint32_t(device.size()),
+                        uint32_t(document.size()),
+                        node.m_sequence,
+                        int64_t(node.m_timestamp.time_since_epoch().count())};
+    uint64_t size = sizeof(record) + id.size() + type.size() + device.size() + document.size();
+    size = (size + 7) & ~uint64_t(7);
+    record.m_size = uint32_t(size);
+
+    if (header()->m_end + size > m_region->get_size() &&
+        !map(std::max(uint64_t(m_region->get_size()) * 2, header()->m_end + size)))
+    {
+      // The assets already in the log can still be loaded, the rest stay in memory
+      if (m_pageOut)
+        LOG(error) << "Asset log: cannot grow " << m_path << ", assets will be held in memory";
+      m_pageOut = false;
+      return 0;
+    }
+
+    auto h = header();
+    auto location = h->m_end;
+    auto p = data(location);
+    memcpy(p, &record, sizeof(record));
+    p += sizeof(record);
+    for (auto s : {&id, &type, &device, &document})
+    {
+      memcpy(p, s->data(), s->size());
+      p += s->size();
+    }
+
+    h->m_end += size;
+    return location;
+  }
+
+  AssetPtr AssetFileStorage::load(const AssetNode &node) const
+  {
+    NAMED_SCOPE("AssetFileStorage::load");
+    if (!m_region || node.m_location == 0)
+      return node.m_asset;
+
+    if (!node.m_asset)
+    {
+      AssetRecord record;
+      memcpy(&record, data(node.m_location), sizeof(record));
+      auto document = data(node.m_location) + sizeof(record) + record.m_idSize +
+                      record.m_typeSize + record.m_deviceSize;
+
+      entity::ErrorList errors;
+      auto entity = entity::XmlParser::parse(Asset::getRoot(),
+                                             string(document, record.m_documentSize), errors);
+      auto asset = dynamic_pointer_cast<Asset>(entity);
+      if (!asset)
+      {
+        LOG(error) << "Asset log: cannot load asset " << node.getAssetId() << " from " << m_path;
+        for (auto &e : errors)
+          LOG(error) << "  " << e->what();
+        return nullptr;
+      }
+      node.m_asset = asset;
+    }
+
+    touch(node);
+    return node.m_asset;
+  }
+
+  void AssetFileStorage::store(const AssetNode &node)
+  {
+    if (!m_region || !node.m_asset)
+      return;
+
+    printer::XmlWriter writer(false);
+    entity::XmlPrinter printer;
+    printer.print(writer, node.m_asset, {});
+    auto document = writer.getContent();
+
+    if (node.m_location != 0)
+      m_garbage += recordSize(node.m_location);
+    node.m_location = append(node, document, node.isRemoved() ? REMOVED : 0);
+    touch(node);
+
+    auto size = header()->m_end - LogDataOffset;
+    if (size > MinCompactSize && m_garbage > size / 2)
+      compact();
+  }
+
+  void AssetFileStorage::erase(const AssetNode &node)
+  {
+    if (!m_region)
+      return;
+
+    forget(node.getAssetId());
+    if (node.m_location != 0)
+    {
+      m_garbage += recordSize(node.m_location);
+      node.m_location = 0;
+      if (auto location = append(node, "", DELETED); location != 0)
+        m_garbage += recordSize(location);
+    }
+  }
+
+  void AssetFileStorage::touch(const AssetNode &node) const
+  {
+    const auto &id = node.getAssetId();
+    if (auto it = m_cached.find(id); it != m_cached.end())
+    {
+      m_cache.splice(m_cache.begin(), m_cache, it->second);
+    }
+    else
+    {
+      m_cache.push_front(id);
+      m_cached.emplace(id, m_cache.begin());
+    }
+
+    // Page out the least recently used assets, they are reloaded from the log
+    auto &idx = m_index.get<ByAssetId>();
+    while (m_cache.size() > m_cacheSize)
+    {
+      const auto &last = m_cache.back();
+      if (auto it = idx.find(last); m_pageOut && it != idx.end() && it->m_location != 0)
+        it->m_asset.reset();
+      m_cached.erase(last);
+      m_cache.pop_back();
+    }
+  }
+
+  void AssetFileStorage::forget(const std::string &id) const
+  {
+    if (auto it = m_cached.find(id); it != m_cached.end())
+    {
+      m_cache.erase(it->second);
+      m_cached.erase(it);
+    }
+  }
+
+  void AssetFileStorage::compact()
+  {
+    NAMED_SCOPE("AssetFileStorage::compact");
+    std::lock_guard<std::recursive_mutex> lock(m_bufferLock);
+    if (!m_region)
+      return;
+
+    auto before = header()->m_end - LogDataOffset;
+    auto temp = m_path;
+    temp += ".compact";
+
+    uint64_t size = LogDataOffset;
+    for (const auto &node : m_index)
+    {
+      if (node.m_location != 0)
+        size += recordSize(node.m_location);
+    }
+    size = std::max(size, LogDataOffset + MinLogSize);
+
+    vector<pair<const AssetNode *, uint64_t>> locations;
+    unique_ptr<bip::file_mapping> file;
+    unique_ptr<bip::mapped_region> region;
+    try
+    {
+      {
+        ofstream create(temp, ios::binary | ios::trunc);
+      }
+      fs::resize_file(temp, size);
+
+      file = make_unique<bip::file_mapping>(temp.string().c_str(), bip::read_write);
+      region = make_unique<bip::mapped_region>(*file, bip::read_write);
+      auto out = static_cast<char *>(region->get_address());
+
+      // Oldest first, the order the records would have been written
+      uint64_t end = LogDataOffset;
+      for (auto it = m_index.rbegin(); it != m_index.rend(); it++)
+      {
+        if (it->m_location == 0)
+          continue;
+        auto rs = recordSize(it->m_location);
+        memcpy(out + end, data(it->m_location), rs);
+        locations.emplace_back(&*it, end);
+        end += rs;
+      }
+
+      LogHeader h;
+      memcpy(h.m_magic, LogMagic, sizeof(LogMagic));
+      h.m_end = end;
+      memcpy(out, &h, sizeof(h));
+      region->flush();
+    }
+    catch (std::exception &e)
+    {
+      LOG(error) << "Asset log: cannot compact " << m_path << ": " << e.what();
+      region.reset();
+      file.reset();
+      std::error_code ec;
+      fs::remove(temp, ec);
+      return;
+    }
+
+    // The compacted log stays mapped when it is renamed, the original log cannot be replaced on
+    // Windows while it is mapped.
+    m_region->flush();
+    m_region.reset();
+    m_file.reset();
+    std::error_code ec;
+    fs::rename(temp, m_path, ec);
+    if (ec)
+    {
+      LOG(error) << "Asset log: cannot replace " << m_path
+                 << " with the compacted log: " << ec.message();
+      if (map(0))
+      {
+        // Keep using the original log
+        region.reset();
+        file.reset();
+        fs::remove(temp, ec);
+        return;
+      }
+
+      LOG(error) << "Asset log: continuing with the compacted log " << temp;
+      m_path = temp;
+    }
+
+    m_file = std::move(file);
+    m_region = std::move(region);
+    for (auto &[node, location] : locations)
+      node->m_location = location;
+    m_garbage = 0;
+    m_pageOut = true;
+
+    LOG(info) << "Asset log: compacted " << m_path << " from " << before << " to "
+              << header()->m_end - LogDataOffset << " bytes";
+  }
+}  // namespace mtconnect::asset
@@ -0,0 +1,98 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "asset_buffer.hpp"
+#include "mtconnect/config.hpp"
+
+namespace mtconnect::asset {
+  /// @brief Asset storage persisted in an append-only log file
+  ///
+  /// Every change to an asset appends the asset document to a memory mapped log. When the agent
+  /// starts, only the record headers are read to rebuild the indexes and counts, the documents
+  /// are parsed when the asset is first requested. The most recently used assets are kept in
+  /// memory, up to the cache size, and the rest are paged in from the log on demand. The number
+  /// of assets is therefore limited by the disk and not the memory.
+  ///
+  /// Records that have been replaced or removed from storage are garbage. The log is compacted
+  /// when the garbage is larger than the live records, copying the live records to a new file.
+  class AGENT_LIB_API AssetFileStorage : public AssetBuffer
+  {
+  public:
+    /// @brief Open or create the asset log
+    /// @param[in] max the maximum number of assets
+    /// @param[in] file the path of the log file
+    /// @param[in] cacheSize the number of assets to keep in memory
+    AssetFileStorage(size_t max, const std::filesystem::path &file, size_t cacheSize = 1024);
+    ~AssetFileStorage();
+
+    /// @brief copy the live records to a new log, dropping the garbage
+    void compact();
+
+    /// @brief get the number of bytes in the log
+    uint64_t getLogSize() const;
+    /// @brief get the number of bytes in the log that are replaced or removed records
+    uint64_t getGarbageSize() const { return m_garbage; }
+    /// @brief get the number of assets held in memory
+    size_t getCachedCount() const { return m_cache.size(); }
+
+    /// @brief the minimum log size before it is compacted
+    static constexpr uint64_t MinCompactSize {1024 * 1024};
+
+  protected:
+    struct LogHeader;
+
+    AssetPtr load(const AssetNode &node) const override;
+    void store(const AssetNode &node) override;
+    void erase(const AssetNode &node) override;
+
+    void open();
+    /// @brief grow the mapping of the log, keeping the current mapping if it fails
+    /// @return `true` if the log is mapped with at least `size` bytes
+    bool map(uint64_t size);
+    void recover();
+    LogHeader *header() const;
+    char *data(uint64_t location) const;
+    uint64_t append(const AssetNode &node, const std::string &document, uint8_t flags);
+    uint32_t recordSize(uint64_t location) const;
+    void touch(const AssetNode &node) const;
+    void forget(const std::string &id) const;
+
+  protected:
+    std::filesystem::path m_path;
+    std::unique_ptr<boost::interprocess::file_mapping> m_file;
+    std::unique_ptr<boost::interprocess::mapped_region> m_region;
+    uint64_t m_garbage {0};
+    // Cleared when the log cannot grow, the assets are then held in memory
+    bool m_pageOut {true};
+
+    // Most recently used assets are at the front
+    size_t m_cacheSize;
+    mutable std::list<std::string> m_cache;
+    mutable std::unordered_map<std::string, std::list<std::string>::iterator> m_cached;
+  };
+}  // namespace mtconnect::asset
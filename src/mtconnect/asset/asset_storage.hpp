@@ -114,6 +114,15 @@ namespace mtconnect {
       /// @param[in] ids assetIds to find
       /// @return the number of assets found
       virtual size_t getAssets(AssetList &list, const std::list<std::string> &ids) const = 0;
+      /// @brief get a list of assets with timestamps in a range, most recent first
+      /// @param[out] list returned list of assets
+      /// @param[in] max maximum number of assets to find
+      /// @param[in] from the earliest timestamp, inclusive
+      /// @param[in] to the latest timestamp, inclusive
+      /// @param[in] active `false` to skip removed assets
+      /// @return the number of assets found
+      virtual size_t getAssetsByTime(AssetList &list, size_t max, const Timestamp &from,
+                                     const Timestamp &to, const bool active = true) const = 0;
       ///@}
 
       /// @name Count related methods
@@ -133,7 +133,8 @@ namespace mtconnect {
       const auto &id = item->getId();
       auto old = m_observations.find(id);
 
-      if (old != m_observations.end())
+      // Observations of a removed data item with the same id are replaced
+      if (old != m_observations.end() && !old->second->isOrphan())
       {
         if (item->isCondition())
         {
@@ -17,11 +17,15 @@
 
 #pragma once
 
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/circular_buffer.hpp>
 
 #include <cassert>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "checkpoint.hpp"
 #include "mtconnect/config.hpp"
@@ -58,7 +62,7 @@ namespace mtconnect::buffer {
     observation::ObservationPtr getFromBuffer(uint64_t seq) const
     {
       auto off = seq - m_firstSequence;
-      if (off < m_slidingBufferSize)
+      if (off < m_slidingBuffer.size())
         return m_slidingBuffer[off];
       else
         return observation::ObservationPtr();
@@ -80,29 +84,6 @@ namespace mtconnect::buffer {
     /// @return first sequence
     SequenceNumber_t getFirstSequence() const { return m_firstSequence; }
 
-    /// @brief update the data item references when device model changes
-    /// @param diMap the map of data item ids to new data item entities
-    void updateDataItems(std::unordered_map<std::string, WeakDataItemPtr> &diMap)
-    {
-      for (auto &o : m_slidingBuffer)
-      {
-        if (o->isOrphan())
-        {
-          continue;
-        }
-        o->updateDataItem(diMap);
-      }
-
-      // checkpoints will remove orphans from its observations
-      m_first.updateDataItems(diMap);
-      m_latest.updateDataItems(diMap);
-
-      for (auto &cp : m_checkpoints)
-      {
-        cp->updateDataItems(diMap);
-      }
-    }
-
     /// @brief Set the sequence number
     ///
     /// recomputes the first sequence if the sequence is larger than the circular buffer size.
@@ -233,28 +214,39 @@ namespace mtconnect::buffer {
     }
     ///@}
 
-    /// @brief Get a list of observations from the circular buffer
+    /// @brief The part of the buffer a request for observations scans
+    ///
+    /// The range is fixed while holding the lock so the scan can run after the lock is released.
+    struct ScanRange
+    {
+      SequenceNumber_t m_base;      ///< the first sequence in the buffer
+      SequenceNumber_t m_sequence;  ///< the next sequence of the buffer
+      SequenceNumber_t m_firstSeq;  ///< the first sequence that can be returned
+      SequenceNumber_t m_first;     ///< the sequence where the scan starts
+      size_t m_size;                ///< the number of observations in the buffer
+      int m_limit;                  ///< the maximum number of observations
+      int m_inc;                    ///< the direction of the scan
+      bool m_forward;               ///< `true` if the count was positive
+      bool m_to;                    ///< `true` if the scan ends at a sequence
+    };
+
+    /// @brief Get the range of the buffer to scan for observations
     /// @param[in] count maximum number of observations to get
-    /// @param[in] filterSet optional filter set of data item ids
     /// @param[in] start optional starting sequence
     /// @param[in] to optional ending sequence
-    /// @param[out] end last sequence number in the list
-    /// @param[out] firstSeq first sequence number in the list
-    /// @param[out] endOfBuffer `true` if the last sequence is at the end of the buffer
-    /// @return unique pointer to a list of shared observation pointers
-    std::unique_ptr<observation::ObservationList> getObservations(
-        int count, const FilterSetOpt &filterSet, const std::optional<SequenceNumber_t> start,
-        const std::optional<SequenceNumber_t> to, SequenceNumber_t &end, SequenceNumber_t &firstSeq,
-        bool &endOfBuffer) const
+    /// @return the range to pass to `getObservations()`
+    ScanRange getScanRange(int count, const std::optional<SequenceNumber_t> start,
+                           const std::optional<SequenceNumber_t> to) const
     {
-      auto results = std::make_unique<observation::ObservationList>();
-
       std::lock_guard<std::recursive_mutex> lock(m_sequenceLock);
-      firstSeq = m_firstSequence;
-      int limit, inc;
 
-      SequenceNumber_t first;
-      size_t max = m_slidingBuffer.size();
+      ScanRange range;
+      range.m_base = m_firstSequence;
+      range.m_sequence = m_sequence;
+      range.m_firstSeq = m_firstSequence;
+      range.m_size = m_slidingBuffer.size();
+      range.m_forward = count >= 0;
+      range.m_to = bool(to);
 
       // Determine where to start and direction of iteration.
       if (count >= 0)
@@ -262,54 +254,133 @@ namespace mtconnect::buffer {
         if (to)
         {
           if (start && *start > m_firstSequence)
-            firstSeq = *start;
-          first = *to;
-          inc = -1;
+            range.m_firstSeq = *start;
+          range.m_first = *to;
+          range.m_inc = -1;
         }
         else
         {
-          first = (start && *start > firstSeq) ? *start : firstSeq;
-          inc = 1;
+          range.m_first = (start && *start > range.m_firstSeq) ? *start : range.m_firstSeq;
+          range.m_inc = 1;
         }
-        limit = count;
+        range.m_limit = count;
       }
       else
       {
-        first = (start && *start < m_sequence) ? *start : m_sequence - 1;
-        limit = -count;
-        inc = -1;
+        range.m_first = (start && *start < m_sequence) ? *start : m_sequence - 1;
+        range.m_limit = -count;
+        range.m_inc = -1;
       }
 
-      size_t min = firstSeq - m_firstSequence;
-      size_t i = first - m_firstSequence;
-      for (int added = 0; added < limit && i < max && i >= min; i += inc)
+      return range;
+    }
+
+    /// @brief Get a list of observations from the circular buffer
+    /// @param[in] count maximum number of observations to get
+    /// @param[in] filterSet optional filter set of data item ids
+    /// @param[in] start optional starting sequence
+    /// @param[in] to optional ending sequence
+    /// @param[out] end last sequence number in the list
+    /// @param[out] firstSeq first sequence number in the list
+    /// @param[out] endOfBuffer `true` if the last sequence is at the end of the buffer
+    /// @return unique pointer to a list of shared observation pointers
+    std::unique_ptr<observation::ObservationList> getObservations(
+        int count, const FilterSetOpt &filterSet, const std::optional<SequenceNumber_t> start,
+        const std::optional<SequenceNumber_t> to, SequenceNumber_t &end, SequenceNumber_t &firstSeq,
+        bool &endOfBuffer) const
+    {
+      auto range = getScanRange(count, start, to);
+      firstSeq = range.m_firstSeq;
+      return getObservations(range, filterSet, end, endOfBuffer);
+    }
+
+    /// @brief Get a list of observations in a range of the circular buffer
+    ///
+    /// Large filtered scans release the lock between waves so observations can be added while
+    /// scanning. The caller must not hold the lock, observations that are overwritten before they
+    /// are scanned end the scan.
+    ///
+    /// @param[in] range the range from `getScanRange()`
+    /// @param[in] filterSet optional filter set of data item ids
+    /// @param[out] end last sequence number in the list
+    /// @param[out] endOfBuffer `true` if the last sequence is at the end of the buffer
+    /// @return unique pointer to a list of shared observation pointers
+    std::unique_ptr<observation::ObservationList> getObservations(const ScanRange &range,
+                                                                  const FilterSetOpt &filterSet,
+                                                                  SequenceNumber_t &end,
+                                                                  bool &endOfBuffer) const
+    {
+      auto results = std::make_unique<observation::ObservationList>();
+
+      const auto base = range.m_base, sequence = range.m_sequence;
+      size_t max = range.m_size;
+      size_t min = range.m_firstSeq - base;
+      size_t i = range.m_first - base;
+      size_t count = 0;
+      if (i < max && i >= min)
+        count = range.m_inc > 0 ? max - i : i - min + 1;
+
+      std::unique_lock<std::recursive_mutex> lock(m_sequenceLock);
+      if (m_scanPool && filterSet && count >= MinParallelScan)
+      {
+        i = scanParallel(lock, *results, *filterSet, range.m_limit, range.m_inc, base, i, min,
+                         max);
+      }
+      else
       {
-        // Filter out according to if it exists in the list
-        auto &event = m_slidingBuffer[i];
-        if (!event->isOrphan())
+        for (int added = 0; added < range.m_limit && i < max && i >= min; i += range.m_inc)
         {
-          const std::string &dataId = event->getDataItem()->getId();
-          if (!filterSet || filterSet->count(dataId) > 0)
+          // Filter out according to if it exists in the list
+          auto event = getFromBuffer(base + i);
+          if (!event)
+            break;
+          if (!event->isOrphan())
           {
-            results->push_back(event);
-            added++;
+            const std::string &dataId = event->getDataItem()->getId();
+            if (!filterSet || filterSet->count(dataId) > 0)
+            {
+              results->push_back(event);
+              added++;
+            }
           }
         }
       }
 
-      if (to)
-        end = first < m_sequence ? first + 1 : m_sequence;
+      if (range.m_to)
+        end = range.m_first < sequence ? range.m_first + 1 : sequence;
       else
-        end = m_firstSequence + i;
+        end = base + i;
 
-      if (count >= 0)
-        endOfBuffer = i + m_firstSequence >= m_sequence;
+      if (range.m_forward)
+        endOfBuffer = i + base >= sequence;
       else
-        endOfBuffer = i + m_firstSequence <= m_firstSequence;
+        endOfBuffer = i + base <= base;
 
       return results;
     }
 
+    /// @brief scan large ranges of the buffer with a thread pool
+    ///
+    /// Only used for requests with a filter that need to check at least `MinParallelScan`
+    /// observations.
+    ///
+    /// @param threads the number of threads, `0` always scans on the calling thread
+    void setScanThreads(size_t threads)
+    {
+      m_scanThreads = threads;
+      if (threads > 0)
+        m_scanPool = std::make_unique<boost::asio::thread_pool>(threads);
+      else
+        m_scanPool.reset();
+    }
+    /// @brief get the number of threads used to scan the buffer
+    auto getScanThreads() const { return m_scanThreads; }
+
+    /// @brief the minimum number of observations to check before scanning in parallel
+    static constexpr size_t MinParallelScan {1 << 16};
+    /// @brief the number of observations each thread checks at a time
+    static constexpr size_t ScanChunkSize {1 << 14};
+
     /// @name Mutex lock  management
     ///@{
 
@@ -321,6 +392,86 @@ namespace mtconnect::buffer {
     auto try_lock() { return m_sequenceLock.try_lock(); }
     ///@}
 
+  protected:
+    /// @brief filter the observations in the range with the scan threads
+    ///
+    /// The observations are copied out of the buffer in waves while holding the lock. Each
+    /// wave is split into chunks that are filtered in parallel without the lock, and the matches
+    /// are added to the results in order. Observations that are overwritten while scanning end
+    /// the scan.
+    ///
+    /// @return the index after the last observation checked, the same as the serial scan
+    size_t scanParallel(std::unique_lock<std::recursive_mutex> &lock,
+                        observation::ObservationList &results, const FilterSet &filter, int limit,
+                        int inc, SequenceNumber_t base, size_t i, size_t min, size_t max) const
+    {
+      using namespace observation;
+
+      const size_t wave = m_scanThreads * ScanChunkSize;
+      std::vector<ObservationPtr> window;
+      window.reserve(wave);
+
+      int added = 0;
+      while (added < limit && i < max && i >= min)
+      {
+        if (!lock.owns_lock())
+          lock.lock();
+        window.clear();
+        for (size_t j = i; window.size() < wave && j < max && j >= min; j += inc)
+        {
+          auto obs = getFromBuffer(base + j);
+          if (!obs)
+            break;
+          window.push_back(obs);
+        }
+        lock.unlock();
+
+        if (window.empty())
+          break;
+
+        auto chunk = (window.size() + m_scanThreads - 1) / m_scanThreads;
+        std::vector<std::vector<uint32_t>> matches((window.size() + chunk - 1) / chunk);
+        std::vector<std::future<void>> done;
+        for (size_t c = 0; c < matches.size(); c++)
+        {
+          std::packaged_task<void()> task([&window, &matches, &filter, chunk, c]() {
+            auto last = std::min(window.size(), (c + 1) * chunk);
+            for (auto k = c * chunk; k < last; k++)
+            {
+              if (window[k]->isOrphan())
+                continue;
+              auto di = window[k]->getDataItem();
+              if (di && filter.count(di->getId()) > 0)
+                matches[c].push_back(uint32_t(k));
+            }
+          });
+          done.emplace_back(task.get_future());
+          boost::asio::post(*m_scanPool, std::move(task));
+        }
+        for (auto &f : done)
+          f.get();
+
+        // Add the matches in the order of the scan
+        size_t checked = window.size();
+        for (auto m = matches.begin(); m != matches.end() && added < limit; m++)
+        {
+          for (auto k : *m)
+          {
+            results.push_back(window[k]);
+            if (++added == limit)
+            {
+              checked = k + 1;
+              break;
+            }
+          }
+        }
+
+        i = inc > 0 ? i + checked : i - checked;
+      }
+
+      return i;
+    }
+
   protected:
     // Access control to the buffer
     mutable std::recursive_mutex m_sequenceLock;
@@ -340,5 +491,9 @@ namespace mtconnect::buffer {
     Checkpoint m_latest;
     Checkpoint m_first;
     boost::circular_buffer<std::unique_ptr<Checkpoint>> m_checkpoints;
+
+    // Parallel scans
+    size_t m_scanThreads {0};
+    std::unique_ptr<boost::asio::thread_pool> m_scanPool;
   };
 }  // namespace mtconnect::buffer
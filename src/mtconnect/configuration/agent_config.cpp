@@ -752,10 +752,17 @@ namespace mtconnect::configuration {
                 {configuration::PluginPath, StringList()},
                 {configuration::ConfigPath, StringList()},
                 {configuration::ServerIp, "0.0.0.0"s},
+                {configuration::ServerThreads, 0},
                 {configuration::Devices, "Devices.xml"s},
+                {configuration::DeviceSnapshot, string()},
+                {configuration::DeviceParseThreads, 1},
                 {configuration::BufferSize, int(DEFAULT_SLIDING_BUFFER_EXP)},
                 {configuration::MaxAssets, int(DEFAULT_MAX_ASSETS)},
+                {configuration::AssetFile, string()},
+                {configuration::AssetCacheSize, 1024},
                 {configuration::CheckpointFrequency, 1000},
+                {configuration::SampleScanThreads, 0},
+                {configuration::PathCacheSize, 256},
                 {configuration::LegacyTimeout, 600s},
                 {configuration::CreateUniqueIds, false},
                 {configuration::ReconnectInterval, 10000ms},
@@ -1085,7 +1092,9 @@ namespace mtconnect::configuration {
                  {{"Module", string()},
                   {"Initialization", string()},
                   {"module", string()},
-                  {"initialization", string()}});
+                  {"initialization", string()},
+                  {"PoolSize", int()},
+                  {"Threads", int()}});
     }
     m_ruby = make_unique<ruby::Embedded>(this, rubyOptions);
   }
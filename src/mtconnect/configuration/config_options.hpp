@@ -46,8 +46,12 @@ namespace mtconnect {
     DECLARE_CONFIGURATION(DisableAgentDevice);
     DECLARE_CONFIGURATION(AllowPut);
     DECLARE_CONFIGURATION(AllowPutFrom);
+    DECLARE_CONFIGURATION(AssetCacheSize);
+    DECLARE_CONFIGURATION(AssetFile);
     DECLARE_CONFIGURATION(BufferSize);
     DECLARE_CONFIGURATION(CheckpointFrequency);
+    DECLARE_CONFIGURATION(DeviceParseThreads);
+    DECLARE_CONFIGURATION(DeviceSnapshot);
     DECLARE_CONFIGURATION(Devices);
     DECLARE_CONFIGURATION(HttpHeaders);
     DECLARE_CONFIGURATION(JsonVersion);
@@ -58,11 +62,16 @@ namespace mtconnect {
     DECLARE_CONFIGURATION(MinimumConfigReloadAge);
     DECLARE_CONFIGURATION(MonitorConfigFiles);
     DECLARE_CONFIGURATION(MonitorInterval);
+    DECLARE_CONFIGURATION(PathCacheSize);
     DECLARE_CONFIGURATION(PidFile);
     DECLARE_CONFIGURATION(Port);
+    DECLARE_CONFIGURATION(PublishQueueOverflow);
+    DECLARE_CONFIGURATION(PublishQueueSize);
     DECLARE_CONFIGURATION(Pretty);
+    DECLARE_CONFIGURATION(SampleScanThreads);
     DECLARE_CONFIGURATION(SchemaVersion);
     DECLARE_CONFIGURATION(ServerIp);
+    DECLARE_CONFIGURATION(ServerThreads);
     DECLARE_CONFIGURATION(ServiceName);
     DECLARE_CONFIGURATION(Sender);
     DECLARE_CONFIGURATION(TlsCertificateChain);
@@ -89,6 +98,15 @@ namespace mtconnect {
     DECLARE_CONFIGURATION(MqttCurrentInterval);
     DECLARE_CONFIGURATION(MqttSampleInterval);
     DECLARE_CONFIGURATION(MqttSampleCount);
+    DECLARE_CONFIGURATION(MqttBatchInterval);
+    DECLARE_CONFIGURATION(MqttFormat);
+    DECLARE_CONFIGURATION(MqttBatchHistory);
+    DECLARE_CONFIGURATION(MqttSampleQoS);
+    DECLARE_CONFIGURATION(MqttEventQoS);
+    DECLARE_CONFIGURATION(MqttConditionQoS);
+    DECLARE_CONFIGURATION(MqttSampleRetain);
+    DECLARE_CONFIGURATION(MqttEventRetain);
+    DECLARE_CONFIGURATION(MqttConditionRetain);
     DECLARE_CONFIGURATION(MqttCaCert);
     DECLARE_CONFIGURATION(MqttCert);
     DECLARE_CONFIGURATION(MqttPrivateKey);
@@ -102,6 +120,11 @@ namespace mtconnect {
     DECLARE_CONFIGURATION(MqttPassword);
     DECLARE_CONFIGURATION(MqttMaxTopicDepth);
     DECLARE_CONFIGURATION(MqttLastWillTopic);
+    DECLARE_CONFIGURATION(MqttQueueSize);
+    DECLARE_CONFIGURATION(MqttQueueFile);
+    DECLARE_CONFIGURATION(MqttQueueFileSize);
+    DECLARE_CONFIGURATION(MqttMaxInflight);
+    DECLARE_CONFIGURATION(MqttCleanSession);
     ///@}
 
     /// @name Adapter Configuration
@@ -112,6 +135,7 @@ namespace mtconnect {
     DECLARE_CONFIGURATION(ConversionRequired);
     DECLARE_CONFIGURATION(Count);
     DECLARE_CONFIGURATION(Device);
+    DECLARE_CONFIGURATION(EnableCompression);
     DECLARE_CONFIGURATION(FilterDuplicates);
     DECLARE_CONFIGURATION(Heartbeat);
     DECLARE_CONFIGURATION(Host);
@@ -129,6 +153,7 @@ namespace mtconnect {
     DECLARE_CONFIGURATION(ShdrVersion);
     DECLARE_CONFIGURATION(SourceDevice);
     DECLARE_CONFIGURATION(Station);
+    DECLARE_CONFIGURATION(StreamFormat);
     DECLARE_CONFIGURATION(SuppressIPAddress);
     DECLARE_CONFIGURATION(Topics);
     DECLARE_CONFIGURATION(UUID);
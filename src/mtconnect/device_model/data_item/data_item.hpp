@@ -18,6 +18,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 
 #include "constraints.hpp"
 #include "definition.hpp"
@@ -44,6 +45,46 @@ namespace mtconnect {
 
     /// @brief DataItem related entities
     namespace data_item {
+      class DataItem;
+
+      /// @brief A stable reference to the current data item with an id
+      ///
+      /// Observations refer to their data item through the handle. When a device is updated, the
+      /// new data item takes over the handle of the data item it replaces, so the observations in
+      /// the buffer and checkpoints refer to the new data item without being updated. The
+      /// handle expires when the data item is removed from the device model.
+      class AGENT_LIB_API DataItemHandle
+      {
+      public:
+        /// @brief create a handle for a data item
+        /// @param[in] dataItem the data item
+        DataItemHandle(std::weak_ptr<DataItem> dataItem)
+          : m_dataItem(std::make_shared<const std::weak_ptr<DataItem>>(std::move(dataItem)))
+        {}
+
+        /// @brief get the current data item
+        /// @return shared pointer to the data item or `nullptr` if it was removed
+        std::shared_ptr<DataItem> lock() const { return std::atomic_load(&m_dataItem)->lock(); }
+        /// @brief check if the data item was removed
+        /// @return `true` if there is no data item
+        bool expired() const { return std::atomic_load(&m_dataItem)->expired(); }
+        /// @brief refer to a new data item
+        ///
+        /// Only called when a device is updated, readers never wait on a lock held by another
+        /// reader.
+        /// @param[in] dataItem the data item
+        void bind(std::weak_ptr<DataItem> dataItem)
+        {
+          std::atomic_store(&m_dataItem,
+                            std::make_shared<const std::weak_ptr<DataItem>>(std::move(dataItem)));
+        }
+
+      protected:
+        std::shared_ptr<const std::weak_ptr<DataItem>> m_dataItem;
+      };
+
+      using DataItemHandlePtr = std::shared_ptr<DataItemHandle>;
+
       /// @brief Data Item entity
       class AGENT_LIB_API DataItem : public entity::Entity, public observation::ChangeSignaler
       {
@@ -219,6 +260,19 @@ namespace mtconnect {
         /// @param[in] topic the topic
         void setTopic(const std::string &topic) { m_topic = topic; }
 
+        /// @brief get the handle observations use to refer to this data item
+        /// @return shared pointer to the handle
+        const auto &getHandle() const { return m_handle; }
+        /// @brief take over the handle of the data item this data item replaces
+        ///
+        /// The observations of the old data item will refer to this data item.
+        /// @param[in] old the data item with the same id in the previous device model
+        void replace(const DataItem &old)
+        {
+          m_handle = old.m_handle;
+          m_handle->bind(std::dynamic_pointer_cast<DataItem>(getptr()));
+        }
+
         bool operator<(const DataItem &another) const;
         bool operator==(const DataItem &another) const { return m_id == another.m_id; }
 
@@ -313,6 +367,9 @@ namespace mtconnect {
 
         // Conversions
         std::unique_ptr<UnitConversion> m_converter;
+
+        // Stable reference for observations
+        DataItemHandlePtr m_handle;
       };
 
       using DataItemPtr = std::shared_ptr<DataItem>;
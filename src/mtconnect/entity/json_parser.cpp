@@ -26,7 +26,8 @@ using json = nlohmann::json;
 
 namespace mtconnect {
   namespace entity {
-    static EntityPtr parseJson(FactoryPtr factory, string entity_name, json jNode,
+    // The nodes are passed by reference, copying a node copies the whole subtree
+    static EntityPtr parseJson(FactoryPtr factory, const string& entity_name, const json& jNode,
                                ErrorList& errors)
     {
       auto ef = factory->factoryFor(entity_name);
@@ -52,14 +53,14 @@ namespace mtconnect {
 
           if (value.is_string())
           {
-            properties.insert({property_key, string {value}});
+            properties.insert({property_key, value.get_ref<const string&>()});
           }
           else if (value.is_number())
           {
-            if (jNode[key].get<double>() == jNode[key].get<int64_t>())
-              properties.insert({property_key, int64_t(value)});
+            if (value.get<double>() == value.get<int64_t>())
+              properties.insert({property_key, value.get<int64_t>()});
             else
-              properties.insert({property_key, double(value)});
+              properties.insert({property_key, value.get<double>()});
           }
           else if (value.is_boolean())
           {
@@ -69,7 +70,7 @@ namespace mtconnect {
 
         if (ef->hasRaw())
         {
-          properties.insert({"RAW", string {jNode["value"]}});
+          properties.insert({"RAW", jNode.at("value").get<string>()});
         }
         else
         {
@@ -133,7 +134,7 @@ namespace mtconnect {
     {
       NAMED_SCOPE("entity.json_parser");
       EntityPtr entity;
-      auto jsonObj = json::parse(document.c_str());
+      auto jsonObj = json::parse(document);
       auto entity_name = jsonObj.begin().key();
 
       if (jsonObj.size() == 1)
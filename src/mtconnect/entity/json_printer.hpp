@@ -276,12 +276,15 @@ namespace mtconnect::entity {
   };
 
   /// @brief Serialization wrapper to turn an entity into a json string.
+  ///
+  /// If an encoding is given, the string contains the CBOR or MessagePack encoded document.
   class AGENT_LIB_API JsonEntityPrinter
   {
   public:
     /// @brief Create a printer for with a JSON vesion and flag to pretty print
-    JsonEntityPrinter(uint32_t version, bool pretty = false, bool includeHidden = false)
-      : m_version(version), m_pretty(pretty), m_includeHidden(includeHidden)
+    JsonEntityPrinter(uint32_t version, bool pretty = false, bool includeHidden = false,
+                      std::optional<BinaryEncoding> encoding = std::nullopt)
+      : m_version(version), m_pretty(pretty), m_includeHidden(includeHidden), m_encoding(encoding)
     {}
 
     /// @brief wrapper around the JsonPrinter print method that creates the correct printer
@@ -290,14 +293,10 @@ namespace mtconnect::entity {
     /// @returns string representation  of the json
     std::string printEntity(const EntityPtr entity)
     {
-      using namespace rapidjson;
-      StringBuffer output;
-      RenderJson(output, m_pretty, [&](auto &writer) {
+      return RenderDocument(m_encoding, m_pretty, [&](auto &writer) {
         JsonPrinter printer(writer, m_version, m_includeHidden);
         printer.printEntity(entity);
       });
-
-      return std::string(output.GetString(), output.GetLength());
     }
 
     /// @brief wrapper around the JsonPrinter print method that creates the correct printer
@@ -309,19 +308,38 @@ namespace mtconnect::entity {
     /// @returns string representation  of the json
     std::string print(const EntityPtr entity)
     {
-      using namespace rapidjson;
-      StringBuffer output;
-      RenderJson(output, m_pretty, [&](auto &writer) {
+      return RenderDocument(m_encoding, m_pretty, [&](auto &writer) {
         JsonPrinter printer(writer, m_version, m_includeHidden);
         printer.print(entity);
       });
+    }
+
+    /// @brief combine printed documents into an array
+    /// @param[in] documents documents returned by `print()` or `printEntity()`
+    /// @returns the array of documents in the same encoding
+    std::string printArray(const std::vector<std::string> &documents)
+    {
+      if (m_encoding)
+        return BinaryWriter::Array(*m_encoding, documents);
 
-      return std::string(output.GetString(), output.GetLength());
+      std::string doc("[");
+      for (auto &d : documents)
+      {
+        if (doc.size() > 1)
+          doc.append(",");
+        doc.append(d);
+      }
+      doc.append("]");
+      return doc;
     }
 
+    /// @brief get the binary encoding
+    const auto &getEncoding() const { return m_encoding; }
+
   protected:
     uint32_t m_version;
     bool m_pretty;
     bool m_includeHidden {false};
+    std::optional<BinaryEncoding> m_encoding;
   };
 }  // namespace mtconnect::entity
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "mqtt_outbound_queue.hpp"
 #include "mtconnect/config.hpp"
 #include "mtconnect/source/adapter/adapter.hpp"
 #include "mtconnect/source/adapter/adapter_pipeline.hpp"
@@ -78,10 +79,16 @@ namespace mtconnect {
       virtual bool subscribe(const std::string &topic) = 0;
 
       /// @brief Publish Topic to the Mqtt Client
+      ///
+      /// The message is added to the outbound queue and sent in order once the client is
+      /// connected and there is room in the in-flight window.
       /// @param topic Publishing to the topic
       /// @param payload Publishing to the payload
-      /// @return boolean either topic sucessfully connected and published
-      virtual bool publish(const std::string &topic, const std::string &payload) = 0;
+      /// @param qos the delivery guarantee
+      /// @param retain `true` if the broker should retain the message for new subscribers
+      /// @return boolean `false` if the message could not be queued
+      virtual bool publish(const std::string &topic, const std::string &payload,
+                           MqttQoS qos = MqttQoS::AT_LEAST_ONCE, bool retain = true) = 0;
 
       /// @brief Publish Topic to the Mqtt Client and call the async handler
       /// @param topic Publishing to the topic
@@ -98,8 +105,25 @@ namespace mtconnect {
       /// @return bool Either Client is sucessfully running or not
       auto isRunning() { return m_running; }
 
+      /// @brief check if the client starts a new session each time it connects
+      /// @return `false` if the broker keeps the session across reconnects
+      auto isCleanSession() const { return m_cleanSession; }
+
       /// @brief set the Mqtt Client is completly connected
-      void connectComplete() { m_connected = true; }
+      virtual void connectComplete() { m_connected = true; }
+
+      /// @name Outbound queue metrics
+      ///@{
+
+      /// @brief get the number of messages waiting to be sent
+      size_t getQueuedMessages() const { return m_queue ? m_queue->size() : 0; }
+      /// @brief get the topic and payload bytes waiting to be sent
+      size_t getQueuedBytes() const { return m_queue ? m_queue->getQueuedBytes() : 0; }
+      /// @brief get the number of messages dropped because the outbound queue was full
+      uint64_t getDroppedMessages() const { return m_queue ? m_queue->getDropped() : 0; }
+      /// @brief get the number of messages sent and waiting for an acknowledgement
+      virtual size_t getInflightMessages() const { return 0; }
+      ///@}
 
     protected:
       boost::asio::io_context &m_ioContext;
@@ -110,8 +134,11 @@ namespace mtconnect {
       std::optional<std::string> m_willTopic;
       std::optional<std::string> m_willPayload;
 
+      std::unique_ptr<MqttOutboundQueue> m_queue;
+
       bool m_running {false};
       bool m_connected {false};
+      bool m_cleanSession {true};
     };
 
   }  // namespace mqtt_client
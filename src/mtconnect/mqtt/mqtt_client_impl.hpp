@@ -21,10 +21,12 @@
 #include <boost/uuid/name_generator_sha1.hpp>
 
 #include <chrono>
+#include <deque>
 #include <inttypes.h>
 #include <mqtt/async_client.hpp>
 #include <mqtt/setup_log.hpp>
 #include <mqtt/will.hpp>
+#include <mutex>
 #include <random>
 
 #include "mqtt_client.hpp"
@@ -73,6 +75,11 @@ namespace mtconnect {
       /// - Port, defaults to 1883
       /// - MqttTls, defaults to false
       /// - MqttHost, defaults to LocalHost
+      /// - MqttQueueSize, defaults to 1MiB
+      /// - MqttQueueFile, defaults to no spill file
+      /// - MqttQueueFileSize, defaults to 64MiB
+      /// - MqttMaxInflight, defaults to 16
+      /// - MqttCleanSession, defaults to `false` if the MqttClientId is given
       MqttClientImpl(boost::asio::io_context &ioContext, const ConfigOptions &options,
                      std::unique_ptr<ClientHandler> &&handler,
                      const std::optional<std::string> willTopic = std::nullopt,
@@ -114,6 +121,24 @@ namespace mtconnect {
         auto ci = GetOption<Seconds>(options, configuration::MqttConnectInterval);
         if (ci)
           m_connectInterval = *ci;
+
+        // A persistent session needs a stable client id
+        m_cleanSession = GetOption<bool>(options, configuration::MqttCleanSession)
+                             .value_or(!client_id || client_id->empty());
+
+        auto queueSize =
+            GetOption<int>(options, configuration::MqttQueueSize).value_or(1024 * 1024);
+        auto queueFile = GetOption<string>(options, configuration::MqttQueueFile);
+        auto queueFileSize =
+            GetOption<int>(options, configuration::MqttQueueFileSize).value_or(64 * 1024 * 1024);
+        std::optional<std::filesystem::path> spillFile;
+        if (queueFile && !queueFile->empty())
+          spillFile = *queueFile;
+        m_queue = std::make_unique<MqttOutboundQueue>(std::max(queueSize, 0), spillFile,
+                                                      std::max(queueFileSize, 0));
+
+        auto maxInflight = GetOption<int>(options, configuration::MqttMaxInflight).value_or(16);
+        m_maxInflight = std::max(maxInflight, 1);
       }
 
       ~MqttClientImpl() { stop(); }
@@ -138,7 +163,12 @@ namespace mtconnect {
           }
           else if (ec == mqtt::connect_return_code::accepted)
           {
-            LOG(info) << "MQTT ConnAck: MQTT Connected";
+            LOG(info) << "MQTT ConnAck: MQTT Connected, session present: " << sp;
+
+            // Without a session the broker has discarded the unacknowledged messages, send them
+            // again before anything else
+            if (!sp)
+              requeueInflight();
 
             if (m_handler && m_handler->m_connected)
             {
@@ -147,7 +177,7 @@ namespace mtconnect {
             else
             {
               LOG(debug) << "No connect handler, setting connected";
-              m_connected = true;
+              connectComplete();
             }
           }
           else
@@ -175,6 +205,16 @@ namespace mtconnect {
           }
         });
 
+        client->set_puback_handler([this](std::uint16_t packetId) {
+          acknowledge(packetId);
+          return true;
+        });
+
+        client->set_pubcomp_handler([this](std::uint16_t packetId) {
+          acknowledge(packetId);
+          return true;
+        });
+
         client->set_error_handler([this](mqtt::error_code ec) {
           LOG(error) << "error: " << ec.message();
           m_connected = false;
@@ -276,26 +316,19 @@ namespace mtconnect {
       /// @brief Publish Topic to the Mqtt Client
       /// @param topic Publishing to the topic
       /// @param payload Publishing to the payload
+      /// @param qos the delivery guarantee
+      /// @param retain `true` if the broker should retain the message for new subscribers
       /// @return boolean either topic sucessfully connected and published
-      bool publish(const std::string &topic, const std::string &payload) override
+      bool publish(const std::string &topic, const std::string &payload,
+                   MqttQoS qos = MqttQoS::AT_LEAST_ONCE, bool retain = true) override
       {
         NAMED_SCOPE("MqttClientImpl::publish");
-        if (!m_connected)
-        {
-          LOG(debug) << "Not connected, cannot publish to " << topic;
+        if (!m_queue->push({topic, payload, qos, retain}))
           return false;
-        }
 
-        m_packetId = derived().getClient()->acquire_unique_packet_id();
-        derived().getClient()->async_publish(
-            m_packetId, topic, payload, mqtt::qos::at_least_once | mqtt::retain::yes,
-            [topic](mqtt::error_code ec) {
-              if (ec)
-              {
-                LOG(error) << "MqttClientImpl::publish: Publish failed to topic " << topic << ": "
-                           << ec.message();
-              }
-            });
+        if (!m_connected)
+          LOG(trace) << "Not connected, queued publish to " << topic;
+        sendQueued();
 
         return true;
       }
@@ -329,13 +362,92 @@ namespace mtconnect {
         return true;
       }
 
+      /// @brief set the Mqtt Client is completly connected and send the queued messages
+      void connectComplete() override
+      {
+        m_connected = true;
+        sendQueued();
+      }
+
+      /// @brief get the number of messages sent and waiting for an acknowledgement
+      size_t getInflightMessages() const override
+      {
+        std::lock_guard<std::recursive_mutex> lock(m_inflightMutex);
+        return m_inflight.size();
+      }
+
     protected:
+      /// @brief send queued messages until the in-flight window is full
+      void sendQueued()
+      {
+        NAMED_SCOPE("MqttClientImpl::sendQueued");
+
+        std::lock_guard<std::recursive_mutex> lock(m_inflightMutex);
+        while (m_running && m_connected && m_inflight.size() < m_maxInflight)
+        {
+          auto message = m_queue->pop();
+          if (!message)
+            break;
+
+          // QoS 0 messages are never acknowledged and must not carry a packet id. The others
+          // are held until the broker acknowledges them.
+          std::uint16_t packetId = 0;
+          if (message->m_qos != MqttQoS::AT_MOST_ONCE)
+            packetId = m_packetId = derived().getClient()->acquire_unique_packet_id();
+
+          derived().getClient()->async_publish(
+              packetId, message->m_topic, message->m_payload,
+              static_cast<mqtt::qos>(message->m_qos) |
+                  (message->m_retain ? mqtt::retain::yes : mqtt::retain::no),
+              [topic = message->m_topic](mqtt::error_code ec) {
+                if (ec)
+                {
+                  LOG(error) << "MqttClientImpl::publish: Publish failed to topic " << topic
+                             << ": " << ec.message();
+                }
+              });
+
+          if (packetId != 0)
+            m_inflight.emplace_back(packetId, std::move(*message));
+        }
+      }
+
+      /// @brief remove an acknowledged message from the in-flight window
+      void acknowledge(std::uint16_t packetId)
+      {
+        {
+          std::lock_guard<std::recursive_mutex> lock(m_inflightMutex);
+          auto it = std::find_if(m_inflight.begin(), m_inflight.end(),
+                                 [packetId](auto &inflight) { return inflight.first == packetId; });
+          if (it != m_inflight.end())
+            m_inflight.erase(it);
+        }
+
+        sendQueued();
+      }
+
+      /// @brief return the unacknowledged messages to the front of the queue
+      void requeueInflight()
+      {
+        std::lock_guard<std::recursive_mutex> lock(m_inflightMutex);
+        if (m_inflight.empty())
+          return;
+
+        LOG(debug) << "MqttClientImpl: resending " << m_inflight.size()
+                   << " unacknowledged messages";
+        std::deque<MqttOutboundQueue::Message> messages;
+        for (auto &inflight : m_inflight)
+          messages.emplace_back(std::move(inflight.second));
+        m_inflight.clear();
+        m_queue->pushFront(std::move(messages));
+      }
+
       void connect()
       {
         if (m_handler && m_handler->m_connecting)
           m_handler->m_connecting(shared_from_this());
 
-        derived().getClient()->set_clean_session(true);
+        derived().getClient()->set_clean_session(m_cleanSession);
         derived().getClient()->async_connect([this](mqtt::error_code ec) {
           if (ec)
           {
@@ -403,6 +515,10 @@ namespace mtconnect {
       std::optional<std::string> m_password;
 
       boost::asio::steady_timer m_reconnectTimer;
+
+      size_t m_maxInflight {16};
+      mutable std::recursive_mutex m_inflightMutex;
+      std::deque<std::pair<std::uint16_t, MqttOutboundQueue::Message>> m_inflight;
     };
 
     /// @brief Create an Mqtt TCP Client
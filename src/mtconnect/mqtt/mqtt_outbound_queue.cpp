@@ -0,0 +1,348 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#include "mqtt_outbound_queue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "mtconnect/logging.hpp"
+
+namespace mtconnect::mqtt_client {
+  using namespace std;
+  namespace bip = boost::interprocess;
+
+  static constexpr char SpillMagic[8] = {'M', 'T', 'C', 'M', 'Q', 'T', 'T', '1'};
+
+  /// The header at the start of the spill file. Positions are relative to the start of the data.
+  struct MqttOutboundQueue::SpillHeader
+  {
+    char m_magic[8];
+    uint64_t m_read;
+    uint64_t m_write;
+    uint64_t m_count;
+    uint64_t m_bytes;
+  };
+
+  // The data starts on a cache line after the header
+  static constexpr size_t SpillDataOffset {64};
+
+  /// Each spilled message is a fixed record header followed by the topic and payload
+  struct MqttOutboundQueue::SpillRecord
+  {
+    uint32_t m_topicSize;
+    uint32_t m_payloadSize;
+    uint8_t m_qos;
+    uint8_t m_retain;
+    uint16_t m_reserved;
+  };
+
+  size_t MqttOutboundQueue::recordSize(size_t bytes) { return sizeof(SpillRecord) + bytes; }
+
+  MqttOutboundQueue::MqttOutboundQueue(size_t memoryLimit,
+                                       const std::optional<std::filesystem::path> &spillFile,
+                                       size_t spillSize)
+    : m_memoryLimit(memoryLimit)
+  {
+    if (spillFile && spillSize > 0)
+      openSpillFile(*spillFile, spillSize);
+  }
+
+  MqttOutboundQueue::~MqttOutboundQueue()
+  {
+    if (m_region)
+      m_region->flush();
+  }
+
+  void MqttOutboundQueue::openSpillFile(const std::filesystem::path &path, size_t size)
+  {
+    NAMED_SCOPE("MqttOutboundQueue::openSpillFile");
+    try
+    {
+      auto fileSize = size + SpillDataOffset;
+      bool existing = false;
+      std::error_code ec;
+      if (filesystem::exists(path, ec) && filesystem::file_size(path, ec) == fileSize)
+      {
+        existing = true;
+      }
+      else
+      {
+        ofstream create(path, ios::binary | ios::trunc);
+        create.close();
+        filesystem::resize_file(path, fileSize);
+      }
+
+      m_file = make_unique<bip::file_mapping>(path.string().c_str(), bip::read_write);
+      m_region = make_unique<bip::mapped_region>(*m_file, bip::read_write);
+
+      auto h = header();
+      if (existing && memcmp(h->m_magic, SpillMagic, sizeof(SpillMagic)) == 0 &&
+          h->m_read <= h->m_write && h->m_write <= spillCapacity())
+      {
+        if (h->m_count > 0)
+          LOG(info) << "MQTT queue: recovered " << h->m_count << " messages from " << path;
+      }
+      else
+      {
+        memcpy(h->m_magic, SpillMagic, sizeof(SpillMagic));
+        h->m_read = h->m_write = h->m_count = h->m_bytes = 0;
+      }
+    }
+    catch (std::exception &e)
+    {
+      LOG(error) << "MQTT queue: cannot map spill file " << path << ": " << e.what()
+                 << ", messages will only be queued in memory";
+      m_region.reset();
+      m_file.reset();
+    }
+  }
+
+  MqttOutboundQueue::SpillHeader *MqttOutboundQueue::header() const
+  {
+    return static_cast<SpillHeader *>(m_region->get_address());
+  }
+
+  char *MqttOutboundQueue::spillData() const
+  {
+    return static_cast<char *>(m_region->get_address()) + SpillDataOffset;
+  }
+
+  size_t MqttOutboundQueue::spillCapacity() const { return m_region->get_size() - SpillDataOffset; }
+
+  void MqttOutboundQueue::resetSpill()
+  {
+    auto h = header();
+    h->m_read = h->m_write = h->m_count = h->m_bytes = 0;
+  }
+
+  bool MqttOutboundQueue::spill(const Message &message)
+  {
+    auto h = header();
+    auto size = recordSize(message.size());
+    if (h->m_write + size > spillCapacity())
+    {
+      // Move the unread records to the start of the file to reclaim the space already read
+      if (h->m_read > 0)
+      {
+        memmove(spillData(), spillData() + h->m_read, h->m_write - h->m_read);
+        h->m_write -= h->m_read;
+        h->m_read = 0;
+      }
+      if (h->m_write + size > spillCapacity())
+        return false;
+    }
+
+    if (h->m_count == 0)
+      LOG(warning) << "MQTT queue: memory limit reached, spilling messages to disk";
+
+    SpillRecord record {uint32_t(message.m_topic.size()), uint32_t(message.m_payload.size()),
+                        uint8_t(message.m_qos), uint8_t(message.m_retain), 0};
+    auto data = spillData() + h->m_write;
+    memcpy(data, &record, sizeof(record));
+    data += sizeof(record);
+    memcpy(data, message.m_topic.data(), message.m_topic.size());
+    data += message.m_topic.size();
+    memcpy(data, message.m_payload.data(), message.m_payload.size());
+
+    h->m_write += size;
+    h->m_count++;
+    h->m_bytes += message.size();
+    return true;
+  }
+
+  // The spill file may have been left inconsistent by a crash or edited on disk, so every
+  // record is checked to lie within the written data before it is read.
+  std::optional<MqttOutboundQueue::SpillRecord> MqttOutboundQueue::nextRecord()
+  {
+    auto h = header();
+    if (h->m_count == 0)
+      return nullopt;
+
+    SpillRecord record;
+    if (h->m_read + sizeof(record) <= h->m_write)
+    {
+      memcpy(&record, spillData() + h->m_read, sizeof(record));
+      if (h->m_read + recordSize(size_t(record.m_topicSize) + record.m_payloadSize) <= h->m_write)
+        return record;
+    }
+
+    LOG(error) << "MQTT queue: spill file is corrupt at offset " << h->m_read << ", discarding "
+               << h->m_count << " spilled messages";
+    resetSpill();
+    return nullopt;
+  }
+
+  std::optional<MqttOutboundQueue::Message> MqttOutboundQueue::unspill()
+  {
+    if (!m_region)
+      return nullopt;
+
+    auto record = nextRecord();
+    if (!record)
+      return nullopt;
+
+    auto h = header();
+    auto data = spillData() + h->m_read + sizeof(SpillRecord);
+
+    Message message;
+    message.m_topic.assign(data, record->m_topicSize);
+    data += record->m_topicSize;
+    message.m_payload.assign(data, record->m_payloadSize);
+    message.m_qos = MqttQoS(record->m_qos);
+    message.m_retain = record->m_retain != 0;
+
+    h->m_read += recordSize(message.size());
+    h->m_count--;
+    h->m_bytes -= std::min<uint64_t>(h->m_bytes, message.size());
+    if (h->m_count == 0)
+      h->m_read = h->m_write = 0;
+
+    return message;
+  }
+
+  // Spilled messages are always newer than the messages in memory, move them back as the
+  // memory queue drains.
+  void MqttOutboundQueue::refill()
+  {
+    if (!m_region)
+      return;
+
+    while (auto record = nextRecord())
+    {
+      if (m_memoryBytes + record->m_topicSize + record->m_payloadSize > m_memoryLimit)
+        break;
+
+      auto message = unspill();
+      m_memoryBytes += message->size();
+      m_messages.emplace_back(std::move(*message));
+    }
+  }
+
+  void MqttOutboundQueue::dropOldest()
+  {
+    if (!m_messages.empty())
+    {
+      m_memoryBytes -= m_messages.front().size();
+      m_messages.pop_front();
+      refill();
+    }
+    else
+    {
+      unspill();
+    }
+
+    m_dropped++;
+    if (!m_dropping)
+    {
+      LOG(warning) << "MQTT queue: queue is full, dropping the oldest messages";
+      m_dropping = true;
+    }
+  }
+
+  bool MqttOutboundQueue::push(Message &&message)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto size = message.size();
+    if (size > m_memoryLimit && (!m_region || recordSize(size) > spillCapacity()))
+    {
+      LOG(warning) << "MQTT queue: message for " << message.m_topic << " is larger than the queue";
+      m_dropped++;
+      return false;
+    }
+
+    while (true)
+    {
+      // Messages can only go to memory if nothing has been spilled to keep them in order
+      bool spilled = m_region && header()->m_count > 0;
+      if (!spilled && m_memoryBytes + size <= m_memoryLimit)
+      {
+        m_memoryBytes += size;
+        m_messages.emplace_back(std::move(message));
+        return true;
+      }
+
+      if (m_region && spill(message))
+        return true;
+
+      dropOldest();
+    }
+  }
+
+  void MqttOutboundQueue::pushFront(std::deque<Message> &&messages)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = messages.rbegin(); it != messages.rend(); it++)
+    {
+      m_memoryBytes += it->size();
+      m_messages.emplace_front(std::move(*it));
+    }
+  }
+
+  std::optional<MqttOutboundQueue::Message> MqttOutboundQueue::pop()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_dropping = false;
+    if (m_messages.empty())
+      return unspill();
+
+    auto message = std::move(m_messages.front());
+    m_messages.pop_front();
+    m_memoryBytes -= message.size();
+    refill();
+
+    return message;
+  }
+
+  void MqttOutboundQueue::clear()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_messages.clear();
+    m_memoryBytes = 0;
+    if (m_region)
+      resetSpill();
+  }
+
+  size_t MqttOutboundQueue::size() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_messages.size() + (m_region ? header()->m_count : 0);
+  }
+
+  size_t MqttOutboundQueue::getQueuedBytes() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryBytes + (m_region ? header()->m_bytes : 0);
+  }
+
+  size_t MqttOutboundQueue::getSpilledBytes() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_region ? header()->m_bytes : 0;
+  }
+
+  uint64_t MqttOutboundQueue::getDropped() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+  }
+}  // namespace mtconnect::mqtt_client
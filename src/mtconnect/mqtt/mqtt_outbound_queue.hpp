@@ -0,0 +1,143 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "mtconnect/config.hpp"
+
+namespace mtconnect::mqtt_client {
+  /// @brief MQTT delivery guarantee for a published message
+  enum class MqttQoS
+  {
+    AT_MOST_ONCE = 0,   ///< Fire and forget, no acknowledgement
+    AT_LEAST_ONCE = 1,  ///< Acknowledged with a PUBACK
+    EXACTLY_ONCE = 2    ///< Acknowledged with the PUBREC, PUBREL, PUBCOMP handshake
+  };
+
+  /// @brief Queue of messages waiting to be sent to the broker
+  ///
+  /// Messages are held in memory up to the memory limit. When a spill file is given, messages
+  /// that do not fit in memory are appended to the memory mapped file and read back in order as
+  /// the memory queue drains. The spill file keeps its read and write positions in a header, so
+  /// messages spilled before the agent stopped are sent when it restarts.
+  ///
+  /// When the queue is full the oldest messages are dropped so the publisher is never blocked.
+  /// The queue is thread safe.
+  class AGENT_LIB_API MqttOutboundQueue
+  {
+  public:
+    /// @brief A message to publish
+    struct Message
+    {
+      std::string m_topic;
+      std::string m_payload;
+      MqttQoS m_qos {MqttQoS::AT_LEAST_ONCE};
+      bool m_retain {true};
+
+      /// @brief the number of bytes counted against the queue limits
+      size_t size() const { return m_topic.size() + m_payload.size(); }
+    };
+
+    /// @brief Create an outbound queue
+    /// @param[in] memoryLimit the maximum number of bytes held in memory
+    /// @param[in] spillFile optional file to hold messages that do not fit in memory
+    /// @param[in] spillSize the size of the spill file in bytes
+    MqttOutboundQueue(size_t memoryLimit = 1024 * 1024,
+                      const std::optional<std::filesystem::path> &spillFile = std::nullopt,
+                      size_t spillSize = 64 * 1024 * 1024);
+    ~MqttOutboundQueue();
+
+    /// @brief add a message to the end of the queue
+    ///
+    /// If the queue is full, the oldest messages are dropped to make room.
+    /// @param[in] message the message
+    /// @return `false` if the message is larger than the queue and was dropped
+    bool push(Message &&message);
+
+    /// @brief return messages to the front of the queue
+    ///
+    /// Used to resend messages that were in flight when the broker lost the session. They are
+    /// held in memory even if this exceeds the memory limit.
+    /// @param[in] messages the messages in the order they were sent
+    void pushFront(std::deque<Message> &&messages);
+
+    /// @brief remove the oldest message
+    /// @return the message or `nullopt` if the queue is empty
+    std::optional<Message> pop();
+
+    /// @brief remove all messages
+    void clear();
+
+    /// @name Metrics
+    ///@{
+
+    /// @brief get the number of queued messages
+    size_t size() const;
+    /// @brief check if there are no queued messages
+    bool empty() const { return size() == 0; }
+    /// @brief get the number of queued topic and payload bytes, in memory and spilled
+    size_t getQueuedBytes() const;
+    /// @brief get the number of bytes held in the spill file
+    size_t getSpilledBytes() const;
+    /// @brief get the number of messages dropped because the queue was full
+    uint64_t getDropped() const;
+    ///@}
+
+    /// @brief check if the queue has a spill file
+    bool hasSpillFile() const { return bool(m_region); }
+
+  protected:
+    struct SpillHeader;
+    struct SpillRecord;
+    static size_t recordSize(size_t bytes);
+
+    void openSpillFile(const std::filesystem::path &path, size_t size);
+    SpillHeader *header() const;
+    char *spillData() const;
+    size_t spillCapacity() const;
+    void resetSpill();
+    bool spill(const Message &message);
+    std::optional<SpillRecord> nextRecord();
+    std::optional<Message> unspill();
+    void refill();
+    void dropOldest();
+
+  protected:
+    mutable std::mutex m_mutex;
+
+    size_t m_memoryLimit;
+    std::deque<Message> m_messages;
+    size_t m_memoryBytes {0};
+
+    std::unique_ptr<boost::interprocess::file_mapping> m_file;
+    std::unique_ptr<boost::interprocess::mapped_region> m_region;
+
+    uint64_t m_dropped {0};
+    bool m_dropping {false};
+  };
+}  // namespace mtconnect::mqtt_client
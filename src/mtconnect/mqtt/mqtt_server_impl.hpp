@@ -16,21 +16,20 @@
 //
 
 #include <boost/log/trivial.hpp>
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index_container.hpp>
 #include <boost/uuid/name_generator_sha1.hpp>
 
 #include <inttypes.h>
+#include <map>
 #include <mqtt/async_client.hpp>
 #include <mqtt/setup_log.hpp>
 #include <mqtt_server_cpp.hpp>
+#include <mutex>
 
 #include "mqtt_server.hpp"
 #include "mtconnect/configuration/config_options.hpp"
 #include "mtconnect/source/adapter/adapter.hpp"
 #include "mtconnect/source/adapter/mqtt/mqtt_adapter.hpp"
+#include "topic_trie.hpp"
 
 using namespace std;
 namespace asio = boost::asio;
@@ -40,41 +39,14 @@ namespace mtconnect {
   using namespace entity;
   using namespace pipeline;
   using namespace source::adapter;
-  namespace mi = boost::multi_index;
 
   namespace mqtt_server {
 
     using con_t = MQTT_NS::server_tls_ws<>::endpoint_t;
     using con_sp_t = std::shared_ptr<con_t>;
 
-    struct sub_con
-    {
-      sub_con(MQTT_NS::buffer topic, con_sp_t con, MQTT_NS::qos qos_value)
-        : topic(std::move(topic)), con(std::move(con)), qos_value(qos_value)
-      {}
-      MQTT_NS::buffer topic;
-      con_sp_t con;
-      MQTT_NS::qos qos_value;
-    };
-
-    struct tag_topic
-    {};
-    struct tag_con
-    {};
-    struct tag_con_topic
-    {};
-
-    using mi_sub_con = mi::multi_index_container<
-        sub_con,
-        mi::indexed_by<
-            mi::ordered_unique<
-                mi::tag<tag_con_topic>,
-                mi::composite_key<sub_con, BOOST_MULTI_INDEX_MEMBER(sub_con, con_sp_t, con),
-                                  BOOST_MULTI_INDEX_MEMBER(sub_con, MQTT_NS::buffer, topic)>>,
-            mi::ordered_non_unique<mi::tag<tag_topic>,
-                                   BOOST_MULTI_INDEX_MEMBER(sub_con, MQTT_NS::buffer, topic)>,
-            mi::ordered_non_unique<mi::tag<tag_con>,
-                                   BOOST_MULTI_INDEX_MEMBER(sub_con, con_sp_t, con)>>>;
+    /// @brief Subscriptions of the connected clients indexed by topic filter
+    using Subscriptions = TopicTrie<con_sp_t, MQTT_NS::qos>;
 
     template <typename Derived>
     class MqttServerImpl : public MqttServer
@@ -141,6 +113,7 @@ namespace mtconnect {
               LOG(error) << "Server: Endpoint has been deleted";
               return false;
             }
+            std::lock_guard<std::mutex> lock(m_mutex);
             if (will)
               m_will = will;
             m_connections.insert(sp);
@@ -157,10 +130,9 @@ namespace mtconnect {
               LOG(error) << "Server Endpoint has been deleted";
               return false;
             }
+            std::lock_guard<std::mutex> lock(m_mutex);
             m_connections.erase(con);
-            auto &idx = m_subs.get<tag_con>();
-            auto r = idx.equal_range(con);
-            idx.erase(r.first, r.second);
+            m_subscriptions.erase(con);
 
             return true;
           });
@@ -173,10 +145,9 @@ namespace mtconnect {
               LOG(error) << "Server Endpoint has been deleted";
               return false;
             }
+            std::lock_guard<std::mutex> lock(m_mutex);
             m_connections.erase(con);
-            auto &idx = m_subs.get<tag_con>();
-            auto r = idx.equal_range(con);
-            idx.erase(r.first, r.second);
+            m_subscriptions.erase(con);
 
             return true;
           });
@@ -193,17 +164,49 @@ namespace mtconnect {
                   LOG(error) << "Server Endpoint has been deleted";
                   return false;
                 }
-                for (auto const &e : entries)
                 {
-                  LOG(debug) << "Server: topic_filter: " << e.topic_filter
-                             << " qos: " << e.subopts.get_qos() << std::endl;
-                  res.emplace_back(MQTT_NS::qos_to_suback_return_code(e.subopts.get_qos()));
-                  m_subs.emplace(std::move(e.topic_filter), sp, e.subopts.get_qos());
+                  std::lock_guard<std::mutex> lock(m_mutex);
+                  for (auto const &e : entries)
+                  {
+                    LOG(debug) << "Server: topic_filter: " << e.topic_filter
+                               << " qos: " << e.subopts.get_qos() << std::endl;
+                    std::string_view filter(e.topic_filter.data(), e.topic_filter.size());
+                    if (m_subscriptions.insert(filter, sp, e.subopts.get_qos()))
+                    {
+                      res.emplace_back(MQTT_NS::qos_to_suback_return_code(e.subopts.get_qos()));
+                    }
+                    else
+                    {
+                      LOG(warning) << "Server: invalid topic filter: " << e.topic_filter;
+                      res.emplace_back(MQTT_NS::suback_return_code::failure);
+                    }
+                  }
                 }
                 sp->suback(packet_id, res);
                 return true;
               });
 
+          ep.set_unsubscribe_handler(
+              [this, wp](packet_id_t packet_id, std::vector<MQTT_NS::unsubscribe_entry> entries) {
+                LOG(debug) << "Server: Unsubscribe received. packet_id: " << packet_id;
+                auto sp = wp.lock();
+                if (!sp)
+                {
+                  LOG(error) << "Server Endpoint has been deleted";
+                  return false;
+                }
+                {
+                  std::lock_guard<std::mutex> lock(m_mutex);
+                  for (auto const &e : entries)
+                  {
+                    std::string_view filter(e.topic_filter.data(), e.topic_filter.size());
+                    m_subscriptions.erase(filter, sp);
+                  }
+                }
+                sp->unsuback(packet_id);
+                return true;
+              });
+
           ep.set_publish_handler([this](mqtt::optional<std::uint16_t> packet_id,
                                         mqtt::publish_options pubopts, mqtt::buffer topic_name,
                                         mqtt::buffer contents) {
@@ -217,14 +220,24 @@ namespace mtconnect {
             LOG(debug) << "Server topic_name: " << topic_name;
             LOG(debug) << "Server contents: " << contents;
 
-            auto const &idx = m_subs.get<tag_topic>();
-            auto r = idx.equal_range(topic_name);
-            for (; r.first != r.second; ++r.first)
+            // A client receives the message once with the highest QoS of its matching
+            // subscriptions
+            std::map<con_sp_t, MQTT_NS::qos> targets;
             {
-              r.first->con->publish(topic_name, contents,
-                                    std::min(r.first->qos_value, pubopts.get_qos()));
+              std::lock_guard<std::mutex> lock(m_mutex);
+              std::string_view topic(topic_name.data(), topic_name.size());
+              m_subscriptions.match(topic, [&targets](const con_sp_t &con, MQTT_NS::qos qos) {
+                auto [target, added] = targets.try_emplace(con, qos);
+                if (!added && target->second < qos)
+                  target->second = qos;
+              });
             }
 
+            // The topic and contents buffers share the received packet's storage, so the same
+            // payload is sent to every subscriber without copying it.
+            for (auto &[con, qos] : targets)
+              con->publish(topic_name, contents, std::min(qos, pubopts.get_qos()));
+
             return true;
           });
 
@@ -254,8 +267,9 @@ namespace mtconnect {
 
     protected:
       ConfigOptions m_options;
+      std::mutex m_mutex;
       std::set<con_sp_t> m_connections;
-      mi_sub_con m_subs;
+      Subscriptions m_subscriptions;
       std::string m_host;
     };
 
@@ -0,0 +1,331 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "mtconnect/config.hpp"
+
+namespace mtconnect::mqtt_server {
+  /// @brief Index of MQTT subscriptions by topic filter level
+  ///
+  /// Each level of a topic filter is a node in the trie. Publishing to a topic walks the levels of
+  /// the topic once, following the exact level, `+`, and `#` children, so the cost depends on the
+  /// depth of the topic and not the number of subscriptions.
+  ///
+  /// Shared subscriptions, `$share/<group>/<filter>`, deliver each message to only one member of
+  /// the group, chosen round robin.
+  ///
+  /// @tparam Subscriber ordered type identifying the subscriber, for example a connection pointer
+  /// @tparam Value the value stored with the subscription, for example the QoS
+  template <typename Subscriber, typename Value>
+  class TopicTrie
+  {
+  public:
+    /// @brief The topic filter and share group of a subscription
+    struct Filter
+    {
+      std::string_view m_filter;
+      std::optional<std::string_view> m_group;
+    };
+
+    /// @brief Split a subscription into its share group and topic filter
+    /// @param[in] filter the filter as given in the SUBSCRIBE packet
+    /// @return the filter or `nullopt` if the filter is not valid
+    static std::optional<Filter> parseFilter(std::string_view filter)
+    {
+      Filter result {filter, std::nullopt};
+      constexpr std::string_view share("$share/");
+      if (filter.substr(0, share.size()) == share)
+      {
+        auto rest = filter.substr(share.size());
+        auto slash = rest.find('/');
+        if (slash == std::string_view::npos || slash == 0)
+          return std::nullopt;
+        auto group = rest.substr(0, slash);
+        if (group.find_first_of("+#") != std::string_view::npos)
+          return std::nullopt;
+
+        result.m_group = group;
+        result.m_filter = rest.substr(slash + 1);
+      }
+
+      if (result.m_filter.empty())
+        return std::nullopt;
+
+      // Wildcards must occupy an entire level and # must be the last level
+      size_t start = 0;
+      while (true)
+      {
+        auto end = result.m_filter.find('/', start);
+        auto level = result.m_filter.substr(start, end == std::string_view::npos ? end
+                                                                                 : end - start);
+        if (level.size() > 1 && level.find_first_of("+#") != std::string_view::npos)
+          return std::nullopt;
+        if (level == "#" && end != std::string_view::npos)
+          return std::nullopt;
+        if (end == std::string_view::npos)
+          break;
+        start = end + 1;
+      }
+
+      return result;
+    }
+
+    /// @brief Add or replace a subscription
+    /// @param[in] filter the topic filter, optionally prefixed with `$share/<group>/`
+    /// @param[in] subscriber the subscriber
+    /// @param[in] value the value delivered with matching topics
+    /// @return `false` if the filter is not valid
+    bool insert(std::string_view filter, const Subscriber &subscriber, const Value &value)
+    {
+      auto parsed = parseFilter(filter);
+      if (!parsed)
+        return false;
+
+      auto node = &m_root;
+      forEachLevel(parsed->m_filter, [&node](std::string_view level) {
+        auto child = node->m_children.find(level);
+        if (child == node->m_children.end())
+        {
+          auto n = std::make_unique<Node>();
+          n->m_parent = node;
+          n->m_level = std::string(level);
+          child = node->m_children.emplace(n->m_level, std::move(n)).first;
+        }
+        node = child->second.get();
+      });
+
+      if (parsed->m_group)
+      {
+        auto &members = node->m_groups[std::string(*parsed->m_group)].m_members;
+        auto member = std::find_if(members.begin(), members.end(),
+                                   [&subscriber](auto &m) { return m.first == subscriber; });
+        if (member == members.end())
+          members.emplace_back(subscriber, value);
+        else
+          member->second = value;
+      }
+      else
+      {
+        node->m_subscribers.insert_or_assign(subscriber, value);
+      }
+
+      if (m_filters[subscriber].emplace(filter).second)
+        m_size++;
+      return true;
+    }
+
+    /// @brief Remove a subscription
+    /// @param[in] filter the topic filter as given to `insert()`
+    /// @param[in] subscriber the subscriber
+    /// @return `true` if the subscription was found
+    bool erase(std::string_view filter, const Subscriber &subscriber)
+    {
+      auto filters = m_filters.find(subscriber);
+      if (filters == m_filters.end())
+        return false;
+      auto f = filters->second.find(filter);
+      if (f == filters->second.end())
+        return false;
+
+      remove(filter, subscriber);
+      filters->second.erase(f);
+      if (filters->second.empty())
+        m_filters.erase(filters);
+      m_size--;
+      return true;
+    }
+
+    /// @brief Remove all subscriptions for a subscriber
+    /// @param[in] subscriber the subscriber
+    void erase(const Subscriber &subscriber)
+    {
+      auto filters = m_filters.find(subscriber);
+      if (filters == m_filters.end())
+        return;
+
+      for (auto &filter : filters->second)
+        remove(filter, subscriber);
+      m_size -= filters->second.size();
+      m_filters.erase(filters);
+    }
+
+    /// @brief Call `func` for each subscription matching the topic
+    ///
+    /// A subscriber is called once for every filter that matches. Topics starting with `$` are not
+    /// matched by filters starting with a wildcard.
+    ///
+    /// @param[in] topic the topic name of the published message
+    /// @param[in] func called with the subscriber and value of every match
+    template <typename F>
+    void match(std::string_view topic, F &&func)
+    {
+      std::vector<std::string_view> levels;
+      forEachLevel(topic, [&levels](std::string_view level) { levels.emplace_back(level); });
+      bool system = !topic.empty() && topic[0] == '$';
+      match(m_root, levels, 0, system, func);
+    }
+
+    /// @brief get the number of subscriptions
+    size_t size() const { return m_size; }
+    /// @brief check if there are no subscriptions
+    bool empty() const { return m_size == 0; }
+
+  protected:
+    struct SharedGroup
+    {
+      std::vector<std::pair<Subscriber, Value>> m_members;
+      size_t m_next {0};
+    };
+
+    struct Node
+    {
+      bool empty() const
+      {
+        return m_children.empty() && m_subscribers.empty() && m_groups.empty();
+      }
+
+      Node *m_parent {nullptr};
+      std::string m_level;
+      std::map<std::string, std::unique_ptr<Node>, std::less<>> m_children;
+      std::map<Subscriber, Value> m_subscribers;
+      std::map<std::string, SharedGroup, std::less<>> m_groups;
+    };
+
+    template <typename F>
+    static void forEachLevel(std::string_view topic, F &&func)
+    {
+      size_t start = 0;
+      while (true)
+      {
+        auto end = topic.find('/', start);
+        if (end == std::string_view::npos)
+        {
+          func(topic.substr(start));
+          break;
+        }
+        func(topic.substr(start, end - start));
+        start = end + 1;
+      }
+    }
+
+    template <typename F>
+    void deliver(Node &node, F &func)
+    {
+      for (auto &[subscriber, value] : node.m_subscribers)
+        func(subscriber, value);
+      for (auto &[name, group] : node.m_groups)
+      {
+        auto &member = group.m_members[group.m_next++ % group.m_members.size()];
+        func(member.first, member.second);
+      }
+    }
+
+    template <typename F>
+    void match(Node &node, const std::vector<std::string_view> &levels, size_t index, bool system,
+               F &func)
+    {
+      // A # also matches the parent level, a/# matches a
+      auto hash = node.m_children.find(std::string_view("#"));
+      bool wildcards = !(index == 0 && system);
+
+      if (index == levels.size())
+      {
+        deliver(node, func);
+        if (wildcards && hash != node.m_children.end())
+          deliver(*hash->second, func);
+        return;
+      }
+
+      if (wildcards)
+      {
+        if (hash != node.m_children.end())
+          deliver(*hash->second, func);
+        auto plus = node.m_children.find(std::string_view("+"));
+        if (plus != node.m_children.end())
+          match(*plus->second, levels, index + 1, system, func);
+      }
+
+      auto child = node.m_children.find(levels[index]);
+      if (child != node.m_children.end())
+        match(*child->second, levels, index + 1, system, func);
+    }
+
+    void remove(std::string_view filter, const Subscriber &subscriber)
+    {
+      auto parsed = parseFilter(filter);
+      if (!parsed)
+        return;
+
+      Node *node = &m_root;
+      bool found = true;
+      forEachLevel(parsed->m_filter, [&node, &found](std::string_view level) {
+        if (!found)
+          return;
+        auto child = node->m_children.find(level);
+        if (child == node->m_children.end())
+          found = false;
+        else
+          node = child->second.get();
+      });
+      if (!found)
+        return;
+
+      if (parsed->m_group)
+      {
+        auto group = node->m_groups.find(*parsed->m_group);
+        if (group != node->m_groups.end())
+        {
+          auto &members = group->second.m_members;
+          members.erase(std::remove_if(members.begin(), members.end(),
+                                       [&subscriber](auto &m) { return m.first == subscriber; }),
+                        members.end());
+          if (members.empty())
+            node->m_groups.erase(group);
+        }
+      }
+      else
+      {
+        node->m_subscribers.erase(subscriber);
+      }
+
+      // Prune the branch that no longer has subscriptions
+      while (node != &m_root && node->empty())
+      {
+        auto parent = node->m_parent;
+        parent->m_children.erase(parent->m_children.find(node->m_level));
+        node = parent;
+      }
+    }
+
+  protected:
+    Node m_root;
+    std::map<Subscriber, std::set<std::string, std::less<>>> m_filters;
+    size_t m_size {0};
+  };
+}  // namespace mtconnect::mqtt_server
@@ -104,7 +104,7 @@ namespace mtconnect::observation {
       m_last(std::chrono::system_clock::now()),
       m_filter(std::move(filter)),
       m_strand(strand),
-      m_observer(strand),
+      m_observer(m_strand),
       m_buffer(buffer)
   {}
 
@@ -250,6 +250,7 @@ namespace mtconnect::observation {
     auto getSequence() const { return m_sequence; }
     auto isEndOfBuffer() const { return m_endOfBuffer; }
     const auto &getFilter() const { return m_filter; }
+    auto &getStrand() { return m_strand; }
 
     ///@}
     ///
@@ -158,7 +158,7 @@ namespace mtconnect {
 
       auto obs = dynamic_pointer_cast<Observation>(ent);
       obs->m_timestamp = timestamp;
-      obs->m_dataItem = dataItem;
+      obs->m_dataItem = dataItem->getHandle();
 
       if (unavailable)
         obs->makeUnavailable();
@@ -74,29 +74,17 @@ namespace mtconnect::observation {
     /// @param[in] dataItem the data item
     void setDataItem(const DataItemPtr dataItem)
     {
-      m_dataItem = dataItem;
+      m_dataItem = dataItem->getHandle();
       setProperties(dataItem, m_properties);
     }
 
     /// @brief get the associated data item
     /// @return shared pointer to the data item
-    const auto getDataItem() const { return m_dataItem.lock(); }
+    const DataItemPtr getDataItem() const { return m_dataItem ? m_dataItem->lock() : nullptr; }
     /// @brief get the sequence number of the observation
     /// @return the sequence number
     auto getSequence() const { return m_sequence; }
 
-    /// @brief update related data item when the device is updated
-    /// @param[in] diMap a map of data item ids to data items
-    void updateDataItem(std::unordered_map<std::string, WeakDataItemPtr> &diMap)
-    {
-      auto old = m_dataItem.lock();
-      auto ndi = diMap.find(old->getId());
-      if (ndi != diMap.end())
-        m_dataItem = ndi->second;
-      else
-        LOG(trace) << "Observation cannot find data item: " << old->getId();
-    }
-
     /// @brief set the timestamp
     /// @param[in] ts the timestamp
     void setTimestamp(const Timestamp &ts)
@@ -128,7 +116,7 @@ namespace mtconnect::observation {
     /// @brief set the entity name (QName) from the data item observation name
     virtual void setEntityName()
     {
-      auto di = m_dataItem.lock();
+      auto di = getDataItem();
       if (di)
         Entity::setQName(di->getObservationName());
     }
@@ -139,10 +127,10 @@ namespace mtconnect::observation {
     /// @return `true` if this observation is less than `another`
     bool operator<(const Observation &another) const
     {
-      auto di = m_dataItem.lock();
+      auto di = getDataItem();
       if (!di)
         return false;
-      auto odi = another.m_dataItem.lock();
+      auto odi = another.getDataItem();
       if (!odi)
         return true;
 
@@ -159,13 +147,13 @@ namespace mtconnect::observation {
     bool isOrphan() const
     {
 #ifdef NDEBUG
-      return m_dataItem.expired();
+      return !m_dataItem || m_dataItem->expired();
 #else
-      if (m_dataItem.expired())
+      auto di = getDataItem();
+      if (!di)
         return true;
-      if (m_dataItem.lock()->isOrphan())
+      if (di->isOrphan())
       {
-        auto di = m_dataItem.lock();
         LOG(trace) << "!!! DataItem " << di->getTopicName() << " orphaned";
         return true;
       }
@@ -179,7 +167,7 @@ namespace mtconnect::observation {
   protected:
     Timestamp m_timestamp;
     bool m_unavailable {false};
-    std::weak_ptr<device_model::data_item::DataItem> m_dataItem;
+    device_model::data_item::DataItemHandlePtr m_dataItem;
     uint64_t m_sequence {0};
   };
 
@@ -0,0 +1,423 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#include "device_snapshot.hpp"
+
+#include <boost/beast/core/detail/base64.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/uuid/detail/sha1.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "mtconnect/logging.hpp"
+#include "mtconnect/version.h"
+
+using namespace std;
+
+namespace mtconnect::parser {
+  namespace bip = boost::interprocess;
+  namespace fs = std::filesystem;
+  using namespace entity;
+  using namespace device_model;
+
+  static constexpr char SnapshotMagic[8] = {'M', 'T', 'C', 'D', 'E', 'V', 'S', 'N'};
+
+  /// @brief Appends the snapshot records to a buffer
+  class SnapshotWriter
+  {
+  public:
+    template <typename T>
+    void put(T value)
+    {
+      m_buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void put(const string &value)
+    {
+      put(uint32_t(value.size()));
+      m_buffer.append(value);
+    }
+
+    void put(const DataSet &set)
+    {
+      put(uint32_t(set.size()));
+      for (auto &entry : set)
+      {
+        put(entry.m_key);
+        put(uint8_t(entry.m_removed));
+        put(uint8_t(entry.m_value.index()));
+        visit(overloaded {[](const monostate &) {}, [this](const DataSet &v) { put(v); },
+                          [this](const string &v) { put(v); }, [this](int64_t v) { put(v); },
+                          [this](double v) { put(v); }},
+              entry.m_value);
+      }
+    }
+
+    void put(const Value &value)
+    {
+      put(uint8_t(value.index()));
+      visit(overloaded {[](const monostate &) {}, [this](const EntityPtr &v) { put(*v); },
+                        [this](const EntityList &v) {
+                          put(uint32_t(v.size()));
+                          for (auto &e : v)
+                            put(*e);
+                        },
+                        [this](const string &v) { put(v); }, [this](int64_t v) { put(v); },
+                        [this](double v) { put(v); }, [this](bool v) { put(uint8_t(v)); },
+                        [this](const Vector &v) {
+                          put(uint32_t(v.size()));
+                          for (auto d : v)
+                            put(d);
+                        },
+                        [this](const DataSet &v) { put(v); },
+                        [this](const Timestamp &v) { put(int64_t(v.time_since_epoch().count())); },
+                        [](const nullptr_t &) {}},
+            value);
+    }
+
+    void put(const Entity &entity)
+    {
+      put(string(entity.getName()));
+
+      const auto &properties = entity.getProperties();
+      put(uint32_t(properties.size()));
+      for (auto &[key, value] : properties)
+      {
+        put(string(key));
+        put(value);
+      }
+
+      auto order = entity.getOrder();
+      put(uint32_t(order ? order->size() : 0));
+      if (order)
+      {
+        for (auto &[name, position] : *order)
+        {
+          put(name);
+          put(int32_t(position));
+        }
+      }
+
+      const auto &attributes = entity.getAttributes();
+      put(uint32_t(attributes.size()));
+      for (auto &attr : attributes)
+        put(string(attr));
+    }
+
+    string m_buffer;
+  };
+
+  /// @brief Reads the snapshot records from the mapped file
+  class SnapshotReader
+  {
+  public:
+    SnapshotReader(const char *begin, const char *end) : m_pos(begin), m_end(end) {}
+
+    template <typename T>
+    T get()
+    {
+      T value;
+      memcpy(&value, take(sizeof(T)), sizeof(T));
+      return value;
+    }
+
+    string getString()
+    {
+      auto size = get<uint32_t>();
+      return string(take(size), size);
+    }
+
+    DataSet getDataSet()
+    {
+      DataSet set;
+      auto count = get<uint32_t>();
+      for (uint32_t i = 0; i < count; i++)
+      {
+        auto key = getString();
+        bool removed = get<uint8_t>();
+        DataSetValue value;
+        switch (get<uint8_t>())
+        {
+          case 0:
+            break;
+          case 1:
+            value = getDataSet();
+            break;
+          case 2:
+            value = getString();
+            break;
+          case 3:
+            value = get<int64_t>();
+            break;
+          case 4:
+            value = get<double>();
+            break;
+          default:
+            throw runtime_error("Invalid data set value in device snapshot");
+        }
+        set.emplace(key, value, removed);
+      }
+      return set;
+    }
+
+    Value getValue(FactoryPtr factory, ErrorList &errors)
+    {
+      switch (get<uint8_t>())
+      {
+        case 0:
+          return monostate();
+        case 1:
+          return getEntity(factory, errors);
+        case 2:
+        {
+          EntityList list;
+          auto count = get<uint32_t>();
+          for (uint32_t i = 0; i < count; i++)
+            if (auto entity = getEntity(factory, errors))
+              list.emplace_back(entity);
+          return list;
+        }
+        case 3:
+          return getString();
+        case 4:
+          return get<int64_t>();
+        case 5:
+          return get<double>();
+        case 6:
+          return bool(get<uint8_t>());
+        case 7:
+        {
+          Vector vector(get<uint32_t>());
+          for (auto &d : vector)
+            d = get<double>();
+          return vector;
+        }
+        case 8:
+          return getDataSet();
+        case 9:
+          return Timestamp(Timestamp::duration(get<int64_t>()));
+        case 10:
+          return nullptr;
+      }
+
+      throw runtime_error("Invalid value in device snapshot");
+    }
+
+    /// @brief recreate an entity with the factory for its parent, the same way as the XML parser
+    EntityPtr getEntity(FactoryPtr factory, ErrorList &errors)
+    {
+      QName name(getString());
+      auto ef = factory->factoryFor(name);
+      if (!ef)
+        throw runtime_error("No factory for " + name + " in device snapshot");
+
+      Properties properties;
+      auto count = get<uint32_t>();
+      for (uint32_t i = 0; i < count; i++)
+      {
+        auto key = getString();
+        properties.emplace(key, getValue(ef, errors));
+      }
+
+      OrderMapPtr order;
+      if (auto size = get<uint32_t>(); size > 0)
+      {
+        order = make_shared<OrderMap>();
+        for (uint32_t i = 0; i < size; i++)
+        {
+          auto key = getString();
+          order->emplace(key, get<int32_t>());
+        }
+      }
+
+      AttributeSet attributes;
+      auto attrCount = get<uint32_t>();
+      for (uint32_t i = 0; i < attrCount; i++)
+        attributes.emplace(getString());
+
+      auto entity = ef->make(name, properties, errors);
+      if (entity)
+      {
+        if (order)
+          entity->setOrder(order);
+        if (!attributes.empty())
+          entity->setAttributes(attributes);
+      }
+      return entity;
+    }
+
+  protected:
+    const char *take(size_t size)
+    {
+      if (size_t(m_end - m_pos) < size)
+        throw runtime_error("Device snapshot is truncated");
+      auto pos = m_pos;
+      m_pos += size;
+      return pos;
+    }
+
+  protected:
+    const char *m_pos;
+    const char *m_end;
+  };
+
+  static void putHeader(SnapshotWriter &writer)
+  {
+    writer.m_buffer.append(SnapshotMagic, sizeof(SnapshotMagic));
+    writer.put(DeviceSnapshot::Version);
+    writer.put(uint32_t(AGENT_VERSION_MAJOR));
+    writer.put(uint32_t(AGENT_VERSION_MINOR));
+    writer.put(uint32_t(AGENT_VERSION_PATCH));
+    writer.put(uint32_t(AGENT_VERSION_BUILD));
+  }
+
+  string DeviceSnapshot::hash(const string &document)
+  {
+    boost::uuids::detail::sha1 sha1;
+    sha1.process_bytes(document.c_str(), document.length());
+
+    unsigned int digest[5];
+    sha1.get_digest(digest);
+
+    char encoded[32];
+    auto len = boost::beast::detail::base64::encode(encoded, digest, sizeof(digest));
+
+    return string(encoded, len);
+  }
+
+  bool DeviceSnapshot::write(const fs::path &file) const
+  {
+    NAMED_SCOPE("DeviceSnapshot::write");
+
+    SnapshotWriter writer;
+    putHeader(writer);
+    writer.put(m_hash);
+    writer.put(uint8_t(bool(m_schemaVersion)));
+    if (m_schemaVersion)
+      writer.put(*m_schemaVersion);
+
+    writer.put(uint32_t(m_namespaces.size()));
+    for (auto &ns : m_namespaces)
+    {
+      writer.put(ns.m_urn);
+      writer.put(ns.m_location);
+      writer.put(ns.m_prefix);
+    }
+
+    writer.put(uint32_t(m_devices.size()));
+    for (auto &device : m_devices)
+      writer.put(*device);
+
+    // Write to a temporary file so a partial snapshot is never read
+    auto temp = file;
+    temp += ".tmp";
+    {
+      ofstream out(temp, ios::binary | ios::trunc);
+      out.write(writer.m_buffer.data(), writer.m_buffer.size());
+      if (!out)
+      {
+        LOG(warning) << "Cannot write device snapshot: " << temp;
+        return false;
+      }
+    }
+
+    error_code ec;
+    fs::rename(temp, file, ec);
+    if (ec)
+    {
+      LOG(warning) << "Cannot write device snapshot: " << file << ": " << ec.message();
+      fs::remove(temp, ec);
+      return false;
+    }
+
+    LOG(debug) << "Wrote device snapshot: " << file;
+    return true;
+  }
+
+  optional<DeviceSnapshot> DeviceSnapshot::read(const fs::path &file, const string &hash)
+  {
+    NAMED_SCOPE("DeviceSnapshot::read");
+
+    error_code ec;
+    if (!fs::exists(file, ec) || fs::file_size(file, ec) == 0)
+      return nullopt;
+
+    try
+    {
+      bip::file_mapping mapping(file.string().c_str(), bip::read_only);
+      bip::mapped_region region(mapping, bip::read_only);
+      auto begin = static_cast<const char *>(region.get_address());
+
+      SnapshotWriter expected;
+      putHeader(expected);
+      auto &header = expected.m_buffer;
+      if (region.get_size() < header.size() || memcmp(begin, header.data(), header.size()) != 0)
+      {
+        LOG(info) << "Device snapshot " << file << " was written by another version, ignoring";
+        return nullopt;
+      }
+
+      SnapshotReader reader(begin + header.size(), begin + region.get_size());
+      DeviceSnapshot snapshot;
+      snapshot.m_hash = reader.getString();
+      if (snapshot.m_hash != hash)
+      {
+        LOG(info) << "Device snapshot " << file << " does not match the device file, ignoring";
+        return nullopt;
+      }
+
+      if (reader.get<uint8_t>())
+        snapshot.m_schemaVersion = reader.getString();
+
+      auto count = reader.get<uint32_t>();
+      for (uint32_t i = 0; i < count; i++)
+      {
+        Namespace ns;
+        ns.m_urn = reader.getString();
+        ns.m_location = reader.getString();
+        ns.m_prefix = reader.getString();
+        snapshot.m_namespaces.emplace_back(ns);
+      }
+
+      auto root = Device::getRoot();
+      auto devices = reader.get<uint32_t>();
+      for (uint32_t i = 0; i < devices; i++)
+      {
+        ErrorList errors;
+        auto device = dynamic_pointer_cast<Device>(reader.getEntity(root, errors));
+        if (!device || !errors.empty())
+        {
+          for (auto &e : errors)
+            LOG(warning) << "Error restoring device: " << e->what();
+          return nullopt;
+        }
+        snapshot.m_devices.emplace_back(device);
+      }
+
+      return snapshot;
+    }
+    catch (exception &e)
+    {
+      LOG(warning) << "Cannot read device snapshot " << file << ": " << e.what();
+    }
+
+    return nullopt;
+  }
+}  // namespace mtconnect::parser
@@ -0,0 +1,74 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <filesystem>
+#include <list>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mtconnect/config.hpp"
+#include "mtconnect/device_model/device.hpp"
+
+namespace mtconnect::parser {
+  /// @brief A binary snapshot of the devices loaded from a device file
+  ///
+  /// The snapshot holds the validated and converted properties of every entity in the device
+  /// model, the namespaces, and the schema version of the device file. Restoring the snapshot
+  /// skips the XML parsing and string conversions and recreates the entities with their
+  /// factories, so the indexes of each device are rebuilt by `Device::initialize()`.
+  ///
+  /// The snapshot is only used if it was written by the same snapshot version for a device file
+  /// with the same hash.
+  struct AGENT_LIB_API DeviceSnapshot
+  {
+    /// @brief A namespace referenced by the device file
+    struct Namespace
+    {
+      std::string m_urn;
+      std::string m_location;
+      std::string m_prefix;
+    };
+
+    /// @brief compute the hash of a device file
+    /// @param[in] document the contents of the device file
+    /// @return a base64 encoded sha1 digest
+    static std::string hash(const std::string &document);
+
+    /// @brief write the snapshot to a file
+    /// @param[in] file the snapshot file
+    /// @return `true` if the snapshot was written
+    bool write(const std::filesystem::path &file) const;
+
+    /// @brief read a snapshot from a memory mapped file
+    /// @param[in] file the snapshot file
+    /// @param[in] hash the hash of the current device file
+    /// @return the snapshot if it exists and matches the hash and version
+    static std::optional<DeviceSnapshot> read(const std::filesystem::path &file,
+                                              const std::string &hash);
+
+    /// @brief the snapshot file format version
+    static constexpr uint32_t Version {1};
+
+    std::string m_hash;
+    std::optional<std::string> m_schemaVersion;
+    std::vector<Namespace> m_namespaces;
+    std::list<device_model::DevicePtr> m_devices;
+  };
+}  // namespace mtconnect::parser
@@ -0,0 +1,151 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "mtconnect/config.hpp"
+#include "mtconnect/device_model/device.hpp"
+#include "mtconnect/utilities.hpp"
+
+namespace mtconnect::parser {
+  /// @brief Least recently used cache of resolved `path=` filters
+  ///
+  /// Maps the (device, path, deviceType) of a request to the set of data item ids the path
+  /// resolved to. The cache must be cleared whenever the device model changes. Clearing starts a
+  /// new generation, paths resolved against an earlier generation of the model are not cached.
+  class AGENT_LIB_API PathCache
+  {
+  public:
+    /// @brief Create a path cache
+    /// @param[in] capacity the maximum number of paths to retain. `0` disables the cache.
+    PathCache(size_t capacity = 256) : m_capacity(capacity) {}
+
+    /// @brief create the cache key for a request
+    /// @param[in] device optional device the path is relative to
+    /// @param[in] path optional xpath
+    /// @param[in] deviceType optional Agent or Device selector
+    /// @return the key
+    static std::string makeKey(const DevicePtr &device, const std::optional<std::string> &path,
+                               const std::optional<std::string> &deviceType)
+    {
+      std::string key;
+      if (device)
+        key.append(*device->getUuid());
+      key.push_back('\0');
+      if (deviceType)
+        key.append(*deviceType);
+      key.push_back('\0');
+      if (path)
+        key.append(*path);
+      return key;
+    }
+
+    /// @brief find a previously resolved filter
+    /// @param[in] key the key from `makeKey()`
+    /// @param[out] filter the filter set to add the cached data items to
+    /// @return `true` if the key was found
+    bool find(const std::string &key, FilterSet &filter)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_index.find(key);
+      if (it == m_index.end())
+        return false;
+
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      filter.insert(it->second->second.begin(), it->second->second.end());
+      return true;
+    }
+
+    /// @brief add a resolved filter to the cache, evicting the least recently used if full
+    /// @param[in] key the key from `makeKey()`
+    /// @param[in] filter the resolved filter set
+    /// @param[in] generation the generation from `getGeneration()` before the path was resolved
+    void insert(const std::string &key, const FilterSet &filter, uint64_t generation)
+    {
+      if (m_capacity == 0)
+        return;
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (generation != m_generation)
+        return;
+
+      auto it = m_index.find(key);
+      if (it != m_index.end())
+      {
+        it->second->second = filter;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+      }
+
+      while (m_entries.size() >= m_capacity)
+      {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+      }
+
+      m_entries.emplace_front(key, filter);
+      m_index.emplace(key, m_entries.begin());
+    }
+
+    /// @brief remove all entries and start a new generation. Called when the device model
+    /// changes.
+    void clear()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_index.clear();
+      m_entries.clear();
+      m_generation++;
+    }
+
+    /// @brief get the generation of the device model the cache holds paths for
+    /// @return the number of times the cache was cleared
+    uint64_t getGeneration() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_generation;
+    }
+
+    /// @brief get the number of cached paths
+    /// @return the number of entries
+    size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_entries.size();
+    }
+
+    /// @brief get the maximum number of cached paths
+    /// @return the capacity
+    size_t getCapacity() const { return m_capacity; }
+
+  protected:
+    using Entry = std::pair<std::string, FilterSet>;
+    using EntryList = std::list<Entry>;
+
+    size_t m_capacity;
+    uint64_t m_generation {0};
+    mutable std::mutex m_mutex;
+    EntryList m_entries;
+    std::unordered_map<std::string, EntryList::iterator> m_index;
+  };
+}  // namespace mtconnect::parser
@@ -0,0 +1,639 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#include "path_resolver.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <memory>
+#include <set>
+
+#include "mtconnect/entity/requirement.hpp"
+#include "mtconnect/logging.hpp"
+
+using namespace std;
+
+namespace mtconnect::parser {
+  using namespace entity;
+
+  /// @brief Thrown when a path uses XPath outside of the supported subset
+  struct PathUnsupported
+  {};
+
+  /// @brief An attribute predicate
+  struct Predicate
+  {
+    enum Op
+    {
+      EXISTS,
+      EQUAL,
+      NOT_EQUAL,
+      AND,
+      OR
+    };
+
+    Op m_op {EXISTS};
+    string m_attribute;
+    string m_value;
+    unique_ptr<Predicate> m_left;
+    unique_ptr<Predicate> m_right;
+  };
+  using PredicatePtr = unique_ptr<Predicate>;
+
+  /// @brief A location step using the child or descendant axis
+  struct Step
+  {
+    bool m_descendant {false};
+    string m_name;
+    vector<PredicatePtr> m_predicates;
+  };
+
+  /// @brief A location path
+  struct LocationPath
+  {
+    bool m_absolute {false};
+    vector<Step> m_steps;
+  };
+  using PathExpression = vector<LocationPath>;
+
+  static inline bool isNameStart(char c) { return isalpha((unsigned char)c) || c == '_'; }
+
+  static inline bool isNameChar(char c)
+  {
+    return isalnum((unsigned char)c) || c == '_' || c == '-' || c == '.';
+  }
+
+  static optional<string> attributeValue(const Entity *entity, const string &name)
+  {
+    if (entity == nullptr || entity->isHidden(name))
+      return nullopt;
+
+    const auto &properties = entity->getProperties();
+    auto it = properties.find(name);
+    if (it == properties.end())
+      return nullopt;
+
+    // Same partitioning the entity XmlPrinter uses to decide what is an attribute
+    if (!islower(it->first.getName()[0]) && entity->getAttributes().count(it->first) == 0)
+      return nullopt;
+
+    if (auto s = get_if<string>(&it->second))
+      return *s;
+
+    if (holds_alternative<EntityPtr>(it->second) || holds_alternative<EntityList>(it->second) ||
+        holds_alternative<DataSet>(it->second))
+      return nullopt;
+
+    Value conv = it->second;
+    ConvertValueToType(conv, ValueType::STRING);
+    if (auto s = get_if<string>(&conv))
+      return *s;
+
+    return nullopt;
+  }
+
+  /// @brief Parses and evaluates a path against the resolver's node array
+  class PathEvaluator
+  {
+  public:
+    PathEvaluator(const PathResolver &resolver, const string &text)
+      : m_resolver(resolver), m_nodes(resolver.m_nodes), m_text(text)
+    {}
+
+    /// @name Parser
+    ///@{
+    PathExpression parse()
+    {
+      PathExpression expression;
+      expression.emplace_back(parsePath());
+      skipWhitespace();
+      while (match("|"))
+      {
+        skipWhitespace();
+        expression.emplace_back(parsePath());
+        skipWhitespace();
+      }
+
+      if (m_pos != m_text.size())
+        throw PathUnsupported();
+
+      return expression;
+    }
+
+    LocationPath parsePath()
+    {
+      LocationPath path;
+      bool descendant = false;
+      if (match("//"))
+      {
+        path.m_absolute = true;
+        descendant = true;
+      }
+      else if (match("/"))
+      {
+        path.m_absolute = true;
+      }
+
+      while (true)
+      {
+        path.m_steps.emplace_back(parseStep(descendant));
+        if (match("//"))
+          descendant = true;
+        else if (match("/"))
+          descendant = false;
+        else
+          break;
+      }
+
+      return path;
+    }
+
+    Step parseStep(bool descendant)
+    {
+      Step step;
+      step.m_descendant = descendant;
+      if (match("*"))
+        step.m_name = "*";
+      else
+        step.m_name = parseName();
+
+      while (match("["))
+      {
+        step.m_predicates.emplace_back(parseOr());
+        skipWhitespace();
+        if (!match("]"))
+          throw PathUnsupported();
+      }
+
+      return step;
+    }
+
+    PredicatePtr parseOr()
+    {
+      auto left = parseAnd();
+      while (matchKeyword("or"))
+        left = combine(Predicate::OR, std::move(left), parseAnd());
+      return left;
+    }
+
+    PredicatePtr parseAnd()
+    {
+      auto left = parsePrimary();
+      while (matchKeyword("and"))
+        left = combine(Predicate::AND, std::move(left), parsePrimary());
+      return left;
+    }
+
+    PredicatePtr parsePrimary()
+    {
+      skipWhitespace();
+      if (match("("))
+      {
+        auto pred = parseOr();
+        skipWhitespace();
+        if (!match(")"))
+          throw PathUnsupported();
+        return pred;
+      }
+
+      if (!match("@"))
+        throw PathUnsupported();
+
+      auto pred = make_unique<Predicate>();
+      pred->m_attribute = parseName();
+      skipWhitespace();
+      if (match("!="))
+        pred->m_op = Predicate::NOT_EQUAL;
+      else if (match("="))
+        pred->m_op = Predicate::EQUAL;
+      else
+        return pred;
+
+      skipWhitespace();
+      pred->m_value = parseLiteral();
+      return pred;
+    }
+
+    string parseName()
+    {
+      auto start = m_pos;
+      if (m_pos >= m_text.size() || !isNameStart(m_text[m_pos]))
+        throw PathUnsupported();
+      while (m_pos < m_text.size() && isNameChar(m_text[m_pos]))
+        m_pos++;
+
+      // Namespace prefixed name, axes such as child:: are not supported
+      if (m_pos < m_text.size() && m_text[m_pos] == ':')
+      {
+        m_pos++;
+        if (m_pos >= m_text.size() || !isNameStart(m_text[m_pos]))
+          throw PathUnsupported();
+        while (m_pos < m_text.size() && isNameChar(m_text[m_pos]))
+          m_pos++;
+      }
+
+      return m_text.substr(start, m_pos - start);
+    }
+
+    string parseLiteral()
+    {
+      if (m_pos >= m_text.size() || (m_text[m_pos] != '\'' && m_text[m_pos] != '"'))
+        throw PathUnsupported();
+
+      auto quote = m_text[m_pos++];
+      auto end = m_text.find(quote, m_pos);
+      if (end == string::npos)
+        throw PathUnsupported();
+
+      auto value = m_text.substr(m_pos, end - m_pos);
+      m_pos = end + 1;
+      return value;
+    }
+    ///@}
+
+    /// @name Evaluator
+    ///@{
+    PathResolver::NodeList evaluate(const LocationPath &path)
+    {
+      // Relative paths are evaluated from the MTConnectDevices element
+      PathResolver::NodeList context {path.m_absolute ? 0u : 1u};
+      for (const auto &step : path.m_steps)
+      {
+        context = evaluate(context, step);
+        if (context.empty())
+          break;
+      }
+
+      return context;
+    }
+
+    PathResolver::NodeList evaluate(const PathResolver::NodeList &context, const Step &step)
+    {
+      PathResolver::NodeList result;
+      if (!step.m_descendant)
+      {
+        for (auto c : context)
+        {
+          for (auto child = c + 1; child < m_nodes[c].m_end; child = m_nodes[child].m_end)
+          {
+            if (matches(child, step))
+              result.push_back(child);
+          }
+        }
+        sort(result.begin(), result.end());
+        result.erase(unique(result.begin(), result.end()), result.end());
+      }
+      else
+      {
+        const auto *candidates = candidatesFor(step);
+        size_t covered = 0;
+        for (auto c : context)
+        {
+          // Context nodes are in document order, so a nested node's descendants were already
+          // visited with its ancestor
+          if (c < covered)
+            continue;
+
+          auto begin = c + 1;
+          auto end = m_nodes[c].m_end;
+          covered = end;
+
+          if (candidates)
+          {
+            for (auto it = lower_bound(candidates->begin(), candidates->end(), begin);
+                 it != candidates->end() && *it < end; it++)
+            {
+              if (matches(*it, step))
+                result.push_back(*it);
+            }
+          }
+          else
+          {
+            for (auto n = begin; n < end; n++)
+            {
+              if (matches(n, step))
+                result.push_back(n);
+            }
+          }
+        }
+      }
+
+      return result;
+    }
+
+    void collect(size_t n, FilterSet &filterSet, set<size_t> &visited)
+    {
+      if (!visited.insert(n).second)
+        return;
+
+      const auto &node = m_nodes[n];
+      if (node.m_name == "DataItem")
+      {
+        addAttribute(filterSet, node, "id");
+      }
+      else if (node.m_name == "DataItems")
+      {
+        for (auto child = n + 1; child < node.m_end; child = m_nodes[child].m_end)
+        {
+          if (m_nodes[child].m_name == "DataItem")
+            addAttribute(filterSet, m_nodes[child], "id");
+        }
+      }
+      else if (node.m_name == "Reference")
+      {
+        addAttribute(filterSet, node, "dataItemId");
+      }
+      else if (node.m_name == "DataItemRef")
+      {
+        addAttribute(filterSet, node, "idRef");
+      }
+      else if (node.m_name == "ComponentRef")
+      {
+        auto id = attributeValue(node.m_entity, "idRef");
+        if (id)
+        {
+          auto refs = m_resolver.m_byId.find(*id);
+          if (refs != m_resolver.m_byId.end())
+          {
+            for (auto r : refs->second)
+              collect(r, filterSet, visited);
+          }
+        }
+      }
+      else
+      {
+        // Find all the data items and references at least two levels below this node
+        for (const auto *name : {"DataItem", "Reference", "DataItemRef", "ComponentRef"})
+        {
+          auto list = m_resolver.m_byName.find(name);
+          if (list == m_resolver.m_byName.end())
+            continue;
+
+          for (auto it = lower_bound(list->second.begin(), list->second.end(), n + 1);
+               it != list->second.end() && *it < node.m_end; it++)
+          {
+            if (m_nodes[*it].m_depth >= node.m_depth + 2)
+              collect(*it, filterSet, visited);
+          }
+        }
+      }
+    }
+    ///@}
+
+  protected:
+    void skipWhitespace()
+    {
+      while (m_pos < m_text.size() && isspace((unsigned char)m_text[m_pos]))
+        m_pos++;
+    }
+
+    bool match(const char *token)
+    {
+      auto len = strlen(token);
+      if (m_text.compare(m_pos, len, token) == 0)
+      {
+        m_pos += len;
+        return true;
+      }
+      return false;
+    }
+
+    bool matchKeyword(const char *keyword)
+    {
+      skipWhitespace();
+      auto len = strlen(keyword);
+      if (m_text.compare(m_pos, len, keyword) == 0 &&
+          (m_pos + len >= m_text.size() || !isNameChar(m_text[m_pos + len])))
+      {
+        m_pos += len;
+        return true;
+      }
+      return false;
+    }
+
+    static PredicatePtr combine(Predicate::Op op, PredicatePtr &&left, PredicatePtr &&right)
+    {
+      auto pred = make_unique<Predicate>();
+      pred->m_op = op;
+      pred->m_left = std::move(left);
+      pred->m_right = std::move(right);
+      return pred;
+    }
+
+    static const string *requiredValue(const Predicate &pred, const char *attribute)
+    {
+      if (pred.m_op == Predicate::EQUAL && pred.m_attribute == attribute)
+        return &pred.m_value;
+      if (pred.m_op == Predicate::AND)
+      {
+        if (auto v = requiredValue(*pred.m_left, attribute))
+          return v;
+        return requiredValue(*pred.m_right, attribute);
+      }
+      return nullptr;
+    }
+
+    /// @brief Select the smallest precomputed index for a descendant step
+    /// @return the ordered candidate list or `nullptr` if every node must be visited
+    const PathResolver::NodeList *candidatesFor(const Step &step) const
+    {
+      if (step.m_name == "*")
+        return nullptr;
+
+      if (step.m_name == "DataItem")
+      {
+        for (const auto &pred : step.m_predicates)
+        {
+          if (auto type = requiredValue(*pred, "type"))
+            return lookup(m_resolver.m_byType, *type);
+          if (auto category = requiredValue(*pred, "category"))
+            return lookup(m_resolver.m_byCategory, *category);
+        }
+      }
+
+      return lookup(m_resolver.m_byName, step.m_name);
+    }
+
+    static const PathResolver::NodeList *lookup(const PathResolver::NodeIndex &index,
+                                                const string &key)
+    {
+      static const PathResolver::NodeList empty;
+      auto it = index.find(key);
+      if (it == index.end())
+        return &empty;
+      return &it->second;
+    }
+
+    bool matches(size_t n, const Step &step) const
+    {
+      const auto &node = m_nodes[n];
+      if (step.m_name != "*" && node.m_name != step.m_name)
+        return false;
+
+      for (const auto &pred : step.m_predicates)
+      {
+        if (!test(*pred, node))
+          return false;
+      }
+
+      return true;
+    }
+
+    bool test(const Predicate &pred, const PathResolver::Node &node) const
+    {
+      switch (pred.m_op)
+      {
+        case Predicate::EXISTS:
+          return bool(attributeValue(node.m_entity, pred.m_attribute));
+
+        case Predicate::EQUAL:
+        {
+          auto value = attributeValue(node.m_entity, pred.m_attribute);
+          return value && *value == pred.m_value;
+        }
+
+        case Predicate::NOT_EQUAL:
+        {
+          auto value = attributeValue(node.m_entity, pred.m_attribute);
+          return value && *value != pred.m_value;
+        }
+
+        case Predicate::AND:
+          return test(*pred.m_left, node) && test(*pred.m_right, node);
+
+        case Predicate::OR:
+          return test(*pred.m_left, node) || test(*pred.m_right, node);
+      }
+
+      return false;
+    }
+
+    static void addAttribute(FilterSet &filterSet, const PathResolver::Node &node,
+                             const char *name)
+    {
+      auto value = attributeValue(node.m_entity, name);
+      if (value && !value->empty())
+        filterSet.insert(*value);
+    }
+
+  protected:
+    const PathResolver &m_resolver;
+    const vector<PathResolver::Node> &m_nodes;
+    const string &m_text;
+    size_t m_pos {0};
+  };
+
+  void PathResolver::addNode(const std::string &name, const Entity *entity, uint32_t depth)
+  {
+    auto index = m_nodes.size();
+    m_nodes.emplace_back(Node {name, entity, index + 1, depth});
+    m_byName[name].push_back(index);
+
+    if (entity)
+    {
+      if (auto id = attributeValue(entity, "id"))
+        m_byId[*id].push_back(index);
+
+      if (name == "DataItem")
+      {
+        if (auto type = attributeValue(entity, "type"))
+          m_byType[*type].push_back(index);
+        if (auto category = attributeValue(entity, "category"))
+          m_byCategory[*category].push_back(index);
+      }
+    }
+  }
+
+  void PathResolver::addEntity(const EntityPtr &entity, uint32_t depth)
+  {
+    auto index = m_nodes.size();
+    addNode(entity->getName(), entity.get(), depth);
+
+    for (const auto &[key, value] : entity->getProperties())
+    {
+      if (entity->isHidden(key))
+        continue;
+
+      if (auto child = get_if<EntityPtr>(&value))
+      {
+        addEntity(*child, depth + 1);
+      }
+      else if (auto list = get_if<EntityList>(&value))
+      {
+        for (const auto &e : *list)
+          addEntity(e, depth + 1);
+      }
+    }
+
+    m_nodes[index].m_end = m_nodes.size();
+  }
+
+  void PathResolver::load(const std::list<DevicePtr> &devices)
+  {
+    NAMED_SCOPE("PathResolver::load");
+
+    std::unique_lock lock(m_mutex);
+
+    m_devices = devices;
+    m_nodes.clear();
+    m_byName.clear();
+    m_byId.clear();
+    m_byType.clear();
+    m_byCategory.clear();
+
+    // The document node, the MTConnectDevices root element, and Devices mirror the probe document
+    addNode("", nullptr, 0);
+    addNode("MTConnectDevices", nullptr, 1);
+    addNode("Devices", nullptr, 2);
+    for (const auto &device : devices)
+      addEntity(device, 3);
+
+    for (size_t i = 0; i < 3; i++)
+      m_nodes[i].m_end = m_nodes.size();
+
+    LOG(debug) << "Path resolver indexed " << m_nodes.size() << " nodes";
+  }
+
+  bool PathResolver::getDataItems(FilterSet &filterSet, const std::string &path) const
+  {
+    std::shared_lock lock(m_mutex);
+
+    if (m_nodes.empty())
+      return false;
+
+    PathEvaluator evaluator(*this, path);
+    PathExpression expression;
+    try
+    {
+      expression = evaluator.parse();
+    }
+    catch (PathUnsupported &)
+    {
+      return false;
+    }
+
+    set<size_t> visited;
+    for (const auto &locationPath : expression)
+    {
+      for (auto n : evaluator.evaluate(locationPath))
+        evaluator.collect(n, filterSet, visited);
+    }
+
+    return true;
+  }
+}  // namespace mtconnect::parser
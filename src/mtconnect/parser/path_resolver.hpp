@@ -0,0 +1,100 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <list>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mtconnect/config.hpp"
+#include "mtconnect/device_model/device.hpp"
+#include "mtconnect/entity/entity.hpp"
+#include "mtconnect/utilities.hpp"
+
+namespace mtconnect::parser {
+  /// @brief Resolves `path=` queries directly against the device model
+  ///
+  /// Supports the subset of XPath used to select MTConnect data items:
+  /// - absolute and relative location paths using `/` and `//`
+  /// - element names, including namespace prefixed extension elements, and `*`
+  /// - attribute predicates using `=`, `!=`, existence, `and`, `or` and parenthesis
+  /// - unions using `|`
+  ///
+  /// The device model is flattened into a pre-order node array when the devices are loaded. Element
+  /// names, data item `type`s and `category`s, and `id`s are indexed so `//` steps use a range
+  /// lookup instead of walking the tree. Paths outside of the subset are reported as unsupported
+  /// so the caller can fall back to a full XPath implementation.
+  class AGENT_LIB_API PathResolver
+  {
+  public:
+    PathResolver() = default;
+    ~PathResolver() = default;
+
+    /// @brief Build the node array and indexes for a list of devices
+    /// @param[in] devices the devices in probe order
+    void load(const std::list<DevicePtr> &devices);
+
+    /// @brief get data items given a filter set and a path
+    /// @param[out] filterSet a filter set to add the data item ids to
+    /// @param[in] path the path to resolve
+    /// @return `false` if the path is not in the supported XPath subset
+    bool getDataItems(FilterSet &filterSet, const std::string &path) const;
+
+    /// @brief get the number of nodes in the flattened device model
+    /// @return the number of nodes
+    size_t size() const
+    {
+      std::shared_lock lock(m_mutex);
+      return m_nodes.size();
+    }
+
+    /// @brief A node in the flattened device model
+    struct Node
+    {
+      std::string m_name;                        //< Element name
+      const entity::Entity *m_entity {nullptr};  //< The entity, `nullptr` for synthetic elements
+      size_t m_end {0};                          //< One past the last descendant
+      uint32_t m_depth {0};                      //< Depth from the document node
+    };
+
+    /// @brief An ordered list of node indexes
+    using NodeList = std::vector<size_t>;
+    /// @brief Index from a key to an ordered list of node indexes
+    using NodeIndex = std::unordered_map<std::string, NodeList>;
+
+  protected:
+    void addNode(const std::string &name, const entity::Entity *entity, uint32_t depth);
+    void addEntity(const entity::EntityPtr &entity, uint32_t depth);
+
+    friend class PathEvaluator;
+
+  protected:
+    mutable std::shared_mutex m_mutex;
+
+    std::list<DevicePtr> m_devices;
+    std::vector<Node> m_nodes;
+
+    NodeIndex m_byName;
+    NodeIndex m_byId;
+    NodeIndex m_byType;
+    NodeIndex m_byCategory;
+  };
+}  // namespace mtconnect::parser
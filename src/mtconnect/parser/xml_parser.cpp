@@ -18,6 +18,8 @@
 #include "xml_parser.hpp"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/range/adaptors.hpp>
 #include <boost/range/algorithm.hpp>
 #include <boost/range/algorithm_ext.hpp>
@@ -26,7 +28,10 @@
 #include <boost/range/metafunctions.hpp>
 #include <boost/range/numeric.hpp>
 
+#include <fstream>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include <libxml/parser.h>
 #include <libxml/xpath.h>
@@ -36,6 +41,7 @@
 #include "mtconnect/device_model/composition.hpp"
 #include "mtconnect/entity/xml_parser.hpp"
 #include "mtconnect/logging.hpp"
+#include "mtconnect/parser/device_snapshot.hpp"
 #include "mtconnect/printer/xml_printer.hpp"
 
 #if _MSC_VER >= 1900
@@ -107,9 +113,34 @@ namespace mtconnect::parser {
       m_doc = nullptr;
     }
 
+    // Restore the devices from the snapshot if the device file has not changed
+    std::optional<DeviceSnapshot> snapshot;
+    if (m_snapshotFile)
+    {
+      std::ifstream file(filePath, std::ios::binary);
+      if (file)
+      {
+        std::string document((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+        snapshot.emplace();
+        snapshot->m_hash = DeviceSnapshot::hash(document);
+
+        if (auto restored = DeviceSnapshot::read(*m_snapshotFile, snapshot->m_hash))
+        {
+          LOG(info) << "Loaded " << restored->m_devices.size()
+                    << " devices from snapshot: " << *m_snapshotFile;
+          m_schemaVersion = restored->m_schemaVersion;
+          for (auto &ns : restored->m_namespaces)
+            aPrinter->addDevicesNamespace(ns.m_urn, ns.m_location, ns.m_prefix);
+          return restored->m_devices;
+        }
+      }
+    }
+
     xmlXPathContextPtr xpathCtx = nullptr;
     xmlXPathObjectPtr devices = nullptr;
     std::list<DevicePtr> deviceList;
+    bool valid = true;
 
     try
     {
@@ -163,6 +194,8 @@ namespace mtconnect::parser {
             prefix = (const char *)ns->prefix;
 
           aPrinter->addDevicesNamespace(locationUrn, uri, prefix);
+          if (snapshot)
+            snapshot->m_namespaces.push_back({locationUrn, uri, prefix});
         }
       }
 
@@ -182,6 +215,8 @@ namespace mtconnect::parser {
             string urn = (const char *)ns->href;
             string prefix = (const char *)ns->prefix;
             aPrinter->addDevicesNamespace(urn, "", prefix);
+            if (snapshot)
+              snapshot->m_namespaces.push_back({urn, "", prefix});
           }
 
           ns = ns->next;
@@ -197,26 +232,69 @@ namespace mtconnect::parser {
       else
       {
         xmlNodeSetPtr nodeset = devices->nodesetval;
+        size_t count = nodeset->nodeNr;
+
+        // Each device is parsed and initialized into its own slot so the devices are returned in
+        // document order regardless of which thread builds them.
+        vector<entity::EntityPtr> parsed(count);
+        vector<entity::ErrorList> errors(count);
+        vector<std::exception_ptr> exceptions(count);
+
+        // Create the factories on this thread, they are lazily constructed and are read only
+        // afterwards.
+        auto factory = Device::getRoot();
+        auto parse = [&](size_t i) {
+          try
+          {
+            parsed[i] = entity::XmlParser::parseXmlNode(factory, nodeset->nodeTab[i], errors[i]);
+          }
+          catch (...)
+          {
+            exceptions[i] = std::current_exception();
+          }
+        };
 
-        entity::ErrorList errors;
-        for (int i = 0; i != nodeset->nodeNr; ++i)
+        auto threads = std::min(count, m_threads > 0 ? m_threads
+                                                     : size_t(std::thread::hardware_concurrency()));
+        if (threads > 1)
+        {
+          boost::asio::thread_pool pool(threads);
+          for (size_t i = 0; i < count; i++)
+            boost::asio::post(pool, [&parse, i]() { parse(i); });
+          pool.join();
+        }
+        else
         {
-          auto device =
-              entity::XmlParser::parseXmlNode(Device::getRoot(), nodeset->nodeTab[i], errors);
-          if (device)
-            deviceList.emplace_back(dynamic_pointer_cast<Device>(device));
+          for (size_t i = 0; i < count; i++)
+            parse(i);
+        }
 
-          if (!errors.empty())
-          {
-            for (auto &e : errors)
-              LOG(warning) << "Error parsing device: " << e->what();
-          }
+        for (size_t i = 0; i < count; i++)
+        {
+          if (exceptions[i])
+            std::rethrow_exception(exceptions[i]);
+
+          for (auto &e : errors[i])
+            LOG(warning) << "Error parsing device: " << e->what();
+
+          if (parsed[i])
+            deviceList.emplace_back(dynamic_pointer_cast<Device>(parsed[i]));
+          if (!parsed[i] || !errors[i].empty())
+            valid = false;
         }
       }
 
       if (devices)
         xmlXPathFreeObject(devices);
       xmlXPathFreeContext(xpathCtx);
+
+      // Only snapshot device files without errors so the errors are reported on every start
+      if (snapshot && valid)
+      {
+        snapshot->m_schemaVersion = m_schemaVersion;
+        snapshot->m_devices = deviceList;
+        snapshot->write(*m_snapshotFile);
+      }
     }
     catch (string e)
     {
@@ -316,10 +394,27 @@ namespace mtconnect::parser {
     }
   }
 
+  void XmlParser::unloadDocument()
+  {
+    std::unique_lock lock(m_mutex);
+
+    if (m_doc)
+    {
+      xmlFreeDoc(m_doc);
+      m_doc = nullptr;
+    }
+  }
+
   void XmlParser::getDataItems(FilterSet &filterSet, const string &inputPath, xmlNodePtr node)
   {
     std::shared_lock lock(m_mutex);
 
+    if (!m_doc)
+    {
+      LOG(warning) << "getDataItems: No document loaded for path: " << inputPath;
+      return;
+    }
+
     xmlNodePtr root = xmlDocGetRootElement(m_doc);
 
     if (!node)
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <filesystem>
 #include <list>
 #include <set>
 #include <shared_mutex>
@@ -47,6 +48,10 @@ namespace mtconnect::parser {
     virtual ~XmlParser();
 
     /// @brief Parses a file and returns a list of devices
+    ///
+    /// The devices are parsed in parallel only when threads are configured with `setThreads()`
+    /// (`DeviceParseThreads`). The default of `1` parses them serially on the calling thread. They
+    /// are returned in the order they appear in the file.
     /// @param[in] aPath to the file
     /// @param[in] aPrinter the printer to obtain and set namespaces
     /// @returns a list of device pointers
@@ -62,11 +67,36 @@ namespace mtconnect::parser {
     /// @brief Just loads the document, assumed it has already been parsed before.
     /// @param aDoc the XML document to parse
     void loadDocument(const std::string &aDoc);
+    /// @brief Free the document when path resolution no longer needs it.
+    void unloadDocument();
+    /// @brief check if a document is loaded
+    /// @return `true` if there is a document
+    bool hasDocument() const
+    {
+      std::shared_lock lock(m_mutex);
+      return m_doc != nullptr;
+    }
     /// @brief get data items given a filter set and an xpath
     /// @param[out] filterSet a filter set to build
     /// @param[in] path the xpath
     /// @param[in] node an option node pointer to start from. defaults to the document root.
     void getDataItems(FilterSet &filterSet, const std::string &path, xmlNodePtr node = nullptr);
+    /// @brief set the number of threads used to parse devices
+    /// @param[in] threads the number of threads, `0` uses the hardware concurrency. Defaults to `1`,
+    /// parsing the devices on the calling thread.
+    void setThreads(size_t threads) { m_threads = threads; }
+    /// @brief get the number of threads used to parse devices
+    auto getThreads() const { return m_threads; }
+    /// @brief set the file used to snapshot the devices
+    ///
+    /// When set, the devices are restored from the snapshot if the device file has not changed
+    /// since the snapshot was written. Otherwise the snapshot is written after the device file is
+    /// parsed without errors.
+    /// @param[in] file the snapshot file
+    void setSnapshotFile(const std::optional<std::filesystem::path> &file)
+    {
+      m_snapshotFile = file;
+    }
     /// @brief get the schema version
     /// @return the version
     const auto &getSchemaVersion() const { return m_schemaVersion; }
@@ -76,5 +106,7 @@ namespace mtconnect::parser {
     xmlDocPtr m_doc = nullptr;
     std::optional<std::string> m_schemaVersion;
     mutable std::shared_mutex m_mutex;
+    size_t m_threads {1};
+    std::optional<std::filesystem::path> m_snapshotFile;
   };
 }  // namespace mtconnect::parser
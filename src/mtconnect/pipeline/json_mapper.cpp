@@ -19,11 +19,13 @@
 #include <boost/algorithm/string.hpp>
 
 #include <chrono>
+#include <mutex>
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 #include <rapidjson/reader.h>
 #include <regex>
 #include <unordered_map>
+#include <vector>
 
 #include "mtconnect/asset/asset.hpp"
 #include "mtconnect/config.hpp"
@@ -41,6 +43,11 @@ using namespace std;
 namespace rj = ::rapidjson;
 
 namespace mtconnect::pipeline {
+  // The message is parsed in place in a mutable copy of the message. Strings passed to the
+  // handlers point into the buffer and are not copied by the reader.
+  using Stream = rj::InsituStringStream;
+  static constexpr unsigned ParseFlags = rj::kParseNanAndInfFlag | rj::kParseInsituFlag;
+
   enum class Expectation
   {
     NONE,
@@ -57,10 +64,50 @@ namespace mtconnect::pipeline {
     VECTOR
   };
 
+  // Limit on the number of cached keys, protects against sources sending arbitrary keys
+  static constexpr size_t MaxCachedKeys {8192};
+
+  /// @brief Cache of the devices and data items the keys in the messages refer to.
+  ///
+  /// Unknown keys are cached as `nullptr`. The cache is cleared when the device model changes.
+  struct KeyCache
+  {
+    /// @brief clear the cache if the device model has changed since it was filled
+    void validate(PipelineContract *contract)
+    {
+      auto generation = contract->getDeviceModelGeneration();
+      if (generation != m_generation || m_size > MaxCachedKeys)
+      {
+        m_devices.clear();
+        m_dataItems.clear();
+        m_size = 0;
+        m_generation = generation;
+      }
+    }
+
+    std::map<std::string, DevicePtr, std::less<>> m_devices;
+    std::unordered_map<const device_model::Device *,
+                       std::map<std::string, DataItemPtr, std::less<>>>
+        m_dataItems;
+    size_t m_size {0};
+    uint64_t m_generation {0};
+  };
+
+  /// @brief The parser state kept between messages
+  struct JsonMapper::State
+  {
+    std::mutex m_mutex;
+    rj::Reader m_reader;
+    std::vector<char> m_buffer;
+    KeyCache m_keys;
+  };
+
   /// @brief The current context for the parser. Keeps all the interpediary state.
   struct ParserContext
   {
-    ParserContext(PipelineContextPtr pipelineContext) : m_pipelineContext(pipelineContext) {}
+    ParserContext(PipelineContextPtr pipelineContext, KeyCache &keys)
+      : m_pipelineContext(pipelineContext), m_keys(keys)
+    {}
 
     using Forward =
         std::function<void(entity::EntityPtr &&entity)>;  //!< Lambda to send a completed entity
@@ -76,6 +123,10 @@ namespace mtconnect::pipeline {
     /// @brief Get the data item for a device
     DataItemPtr getDataItemForDevice(const std::string_view &sv)
     {
+      auto &items = m_keys.m_dataItems[getDevice().get()];
+      if (auto it = items.find(sv); it != items.end())
+        return it->second;
+
       DataItemPtr di;
       DevicePtr device;
       auto keys = splitKey({sv.data(), sv.length()});
@@ -88,6 +139,8 @@ namespace mtconnect::pipeline {
       else
         di = device->getDeviceDataItem(keys.first);
 
+      items.emplace(sv, di);
+      m_keys.m_size++;
       return di;
     }
 
@@ -104,7 +157,13 @@ namespace mtconnect::pipeline {
     /// @brief get a device from the agent
     DevicePtr getDevice(const std::string_view &name)
     {
-      return m_pipelineContext->m_contract->findDevice({name.data(), name.length()});
+      if (auto it = m_keys.m_devices.find(name); it != m_keys.m_devices.end())
+        return it->second;
+
+      auto device = m_pipelineContext->m_contract->findDevice({name.data(), name.length()});
+      m_keys.m_devices.emplace(name, device);
+      m_keys.m_size++;
+      return device;
     }
 
     /// @brief set the timestamp
@@ -172,6 +231,7 @@ namespace mtconnect::pipeline {
 
     EntityList m_entities;
     PipelineContextPtr m_pipelineContext;
+    KeyCache &m_keys;
     Forward m_forward;
     std::list<pair<DataItemPtr, entity::Properties>> m_queue;
   };
@@ -204,17 +264,17 @@ namespace mtconnect::pipeline {
       return true;
     }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       LOG(warning) << "Consuming value due to error";
 
-      if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+      if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
         return false;
 
       while (m_depth > 0 && !reader.IterativeParseComplete())
       {
         // Read the key
-        if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+        if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
           return false;
       }
 
@@ -316,11 +376,11 @@ namespace mtconnect::pipeline {
     bool StartArray() { return false; }
     bool EndArray(rj::SizeType elementCount) { return false; }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       // Parse initial object
       if (m_expectation == Expectation::OBJECT &&
-          !reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+          !reader.IterativeParseNext<ParseFlags>(buff, *this))
         return false;
 
       while (!reader.IterativeParseComplete() && !m_done)
@@ -328,7 +388,7 @@ namespace mtconnect::pipeline {
         // Read the key
         if (m_expectation == Expectation::KEY)
         {
-          if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+          if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
             return false;
           else if (m_done)
             break;
@@ -344,7 +404,7 @@ namespace mtconnect::pipeline {
         else
         {
           // Read the value
-          if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+          if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
             return false;
 
           if (m_expectation == Expectation::ROW)
@@ -554,13 +614,13 @@ namespace mtconnect::pipeline {
       return false;
     }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       while (!reader.IterativeParseComplete() && !m_done)
       {
         if (m_expectation == Expectation::KEY)
         {
-          if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+          if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
             return false;
         }
 
@@ -585,7 +645,7 @@ namespace mtconnect::pipeline {
           }
           else
           {
-            if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+            if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
               return false;
             else if (m_expectation != Expectation::VECTOR)
             {
@@ -634,10 +694,10 @@ namespace mtconnect::pipeline {
       return true;
     }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       auto success = (!reader.IterativeParseComplete() &&
-                      reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this));
+                      reader.IterativeParseNext<ParseFlags>(buff, *this));
       return success;
     }
 
@@ -708,12 +768,12 @@ namespace mtconnect::pipeline {
       return true;
     }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       // Consume start object
       if (m_expectation == Expectation::OBJECT)
       {
-        if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+        if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
           return false;
       }
 
@@ -722,7 +782,7 @@ namespace mtconnect::pipeline {
       while (!m_done && !reader.IterativeParseComplete())
       {
         // Consume the key
-        if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+        if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
           return false;
 
         if (!m_done)
@@ -730,7 +790,7 @@ namespace mtconnect::pipeline {
           if (m_expectation == Expectation::ASSET)
           {
             // Consume the value
-            if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+            if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
               return false;
           }
           else
@@ -806,14 +866,14 @@ namespace mtconnect::pipeline {
       return true;
     }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       while (!m_complete && !reader.IterativeParseComplete())
       {
         // Consume the key
         if (m_expectation == Expectation::KEY)
         {
-          if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+          if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
             return false;
         }
 
@@ -930,11 +990,11 @@ namespace mtconnect::pipeline {
       return true;
     }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       while (!reader.IterativeParseComplete() && !m_complete)
       {
-        if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+        if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
           return false;
 
         if (m_expectation == Expectation::OBJECT)
@@ -979,11 +1039,11 @@ namespace mtconnect::pipeline {
     }
     bool EndArray(rj::SizeType elementCount) { return true; }
 
-    bool operator()(rj::Reader &reader, rj::StringStream &buff)
+    bool operator()(rj::Reader &reader, Stream &buff)
     {
       while (!reader.IterativeParseComplete())
       {
-        if (!reader.IterativeParseNext<rj::kParseNanAndInfFlag>(buff, *this))
+        if (!reader.IterativeParseNext<ParseFlags>(buff, *this))
           return false;
         if (m_expectation == Expectation::OBJECT)
         {
@@ -1008,6 +1068,12 @@ namespace mtconnect::pipeline {
     ParserContext &m_context;
   };
 
+  JsonMapper::JsonMapper(PipelineContextPtr context)
+    : Transform("JsonMapper"), m_context(context), m_state(std::make_shared<State>())
+  {
+    m_guard = TypeGuard<JsonMessage>(RUN);
+  }
+
   /// @brief Use rapidjson to parse the json content. If there is an error, output the text and
   /// log the error.
   EntityPtr JsonMapper::operator()(entity::EntityPtr &&entity)
@@ -1018,10 +1084,18 @@ namespace mtconnect::pipeline {
     DevicePtr device = json->m_device.lock();
     auto &body = entity->getValue<std::string>();
 
-    rj::StringStream buff(body.c_str());
-    rj::Reader reader;
+    // The reader keeps its stack and the key cache between messages
+    std::lock_guard<std::mutex> lock(m_state->m_mutex);
+    m_state->m_keys.validate(m_context->m_contract.get());
+
+    auto &buffer = m_state->m_buffer;
+    buffer.assign(body.begin(), body.end());
+    buffer.push_back('\0');
+
+    Stream buff(buffer.data());
+    auto &reader = m_state->m_reader;
     reader.IterativeParseInit();
-    ParserContext context(m_context);
+    ParserContext context(m_context, m_state->m_keys);
     context.m_forward = [this](entity::EntityPtr &&entity) { next(std::move(entity)); };
 
     TopLevelHandler handler(context);
@@ -1039,7 +1113,7 @@ namespace mtconnect::pipeline {
     else
     {
       res = std::make_shared<Entity>("JsonEntities");
-      res->setValue(handler.m_context.m_entities);
+      res->setValue(std::move(handler.m_context.m_entities));
     }
     return res;
   }
@@ -30,22 +30,25 @@
 #include "transform.hpp"
 
 namespace mtconnect::pipeline {
-  /// @brief JsonMapper does nothing, it is a placeholder for a json interpreter
+  /// @brief Map JSON messages to observations and assets
+  ///
+  /// A message can be an object or an array of objects. The reader and a cache of the devices and
+  /// data items referenced by the keys are kept between messages.
   class AGENT_LIB_API JsonMapper : public Transform
   {
   public:
     JsonMapper(const JsonMapper &) = default;
-    JsonMapper(PipelineContextPtr context) : Transform("JsonMapper"), m_context(context)
-    {
-      m_guard = TypeGuard<JsonMessage>(RUN);
-    }
+    JsonMapper(PipelineContextPtr context);
 
     /// @brief Use rapidjson to parse the json content. If there is an error, output the text and
     /// log the error.
     EntityPtr operator()(entity::EntityPtr &&entity) override;
 
   protected:
+    struct State;
+
     PipelineContextPtr m_context;
+    std::shared_ptr<State> m_state;
   };
 
 }  // namespace mtconnect::pipeline
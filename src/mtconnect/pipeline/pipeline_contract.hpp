@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <string>
@@ -73,6 +74,11 @@ namespace mtconnect {
       /// @param[in] name name or id of the data item
       /// @return shared pointer to the data item if found
       virtual DataItemPtr findDataItem(const std::string &device, const std::string &name) = 0;
+      /// @brief get a number that changes whenever devices or data items are added or replaced
+      ///
+      /// Transforms that cache devices or data items use this to know when to clear the cache.
+      /// @return the device model generation
+      virtual uint64_t getDeviceModelGeneration() const { return 0; }
       /// @brief get the current schema version as an integer
       /// @returns the schema version as an integer [major * 100 + minor] as a 32bit integer.
       virtual int32_t getSchemaVersion() const = 0;
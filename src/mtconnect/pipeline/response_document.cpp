@@ -20,9 +20,12 @@
 #include <date/date.h>
 
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
 
+#include <nlohmann/json.hpp>
+
 #include "mtconnect/asset/asset.hpp"
 #include "mtconnect/device_model/device.hpp"
 #include "mtconnect/entity/data_set.hpp"
@@ -120,13 +123,6 @@ namespace mtconnect::pipeline {
     {
       out.m_instanceId =
           boost::lexical_cast<SequenceNumber_t>(attributeValue(header, "instanceId"));
-
-      if (xmlStrcmp(root->name, BAD_CAST "MTConnectStreams") == 0)
-      {
-        auto next = attributeValue(header, "nextSequence", false);
-        if (!next.empty())
-          out.m_next = boost::lexical_cast<SequenceNumber_t>(next);
-      }
       return true;
     }
 
@@ -330,119 +326,265 @@ namespace mtconnect::pipeline {
     return di;
   }
 
-  inline static bool parseObservations(ResponseDocument &out, xmlNodePtr node,
-                                       pipeline::PipelineContextPtr context,
-                                       const std::optional<std::string> &deviceName)
+  using TextReaderPtr = unique_ptr<xmlTextReader, function<void(xmlTextReaderPtr)>>;
+
+  inline static bool isElement(xmlTextReaderPtr reader)
   {
-    auto streams = findChild(node, "Streams");
-    if (streams == nullptr)
-      return false;
+    return xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT;
+  }
 
-    auto contract = context->m_contract.get();
+  inline static bool isNamed(xmlTextReaderPtr reader, const char *name)
+  {
+    return xmlStrcmp(BAD_CAST name, xmlTextReaderConstLocalName(reader)) == 0;
+  }
 
-    eachElement(streams, "DeviceStream", [&out, &contract, &deviceName](xmlNodePtr dev) {
-      DevicePtr device;
-      if (deviceName)
+  inline static string readerAttribute(xmlTextReaderPtr reader, const char *name)
+  {
+    string res;
+    auto value = xmlTextReaderGetAttribute(reader, BAD_CAST name);
+    if (value != nullptr)
+    {
+      res = (const char *)value;
+      xmlFree(value);
+    }
+    else
+    {
+      LOG(debug) << "Cannot find attribute " << name << " in resonse doc";
+    }
+
+    return res;
+  }
+
+  /// @brief Read the text content of the current element and leave the reader on its end tag
+  inline static string readerText(xmlTextReaderPtr reader)
+  {
+    string res;
+    if (xmlTextReaderIsEmptyElement(reader))
+      return res;
+
+    auto depth = xmlTextReaderDepth(reader);
+    while (xmlTextReaderRead(reader) == 1)
+    {
+      auto type = xmlTextReaderNodeType(reader);
+      if (type == XML_READER_TYPE_END_ELEMENT && xmlTextReaderDepth(reader) == depth)
+        break;
+      if ((type == XML_READER_TYPE_TEXT || type == XML_READER_TYPE_CDATA) &&
+          xmlTextReaderDepth(reader) == depth + 1)
+        res.append((const char *)xmlTextReaderConstValue(reader));
+    }
+
+    return trim(res);
+  }
+
+  /// @brief Create an observation or asset command from the properties of an observation
+  /// @param[in] properties the observation properties including the `VALUE`
+  inline static void addObservation(ResponseDocument &out, DevicePtr device, DataItemPtr di,
+                                    Properties &properties)
+  {
+    // Remove old properties
+    properties.erase("name");
+    properties.erase("dataItemId");
+
+    auto ts = properties["timestamp"];
+    auto timestamp = parseTimestamp(get<string>(ts));
+
+    if (di->isAssetRemoved())
+    {
+      auto val = properties.find("VALUE");
+      if (val != properties.end() && holds_alternative<string>(val->second) &&
+          get<string>(val->second) != "UNAVAILABLE")
       {
-        device = contract->findDevice(*deviceName);
-        if (!device)
-        {
-          LOG(warning) << "Parsing XML document: cannot find device by uuid: " << *deviceName
-                       << ", skipping device";
-          return true;
-        }
+        auto ac = make_shared<pipeline::AssetCommand>(
+            "AssetCommand", Properties {{"assetId"s, val->second},
+                                        {"device"s, *(device->getUuid())},
+                                        {"VALUE"s, "RemoveAsset"s}});
+        out.m_entities.emplace_back(ac);
+        return;
+      }
+    }
+
+    ErrorList errors;
+    auto obs = observation::Observation::make(di, properties, timestamp, errors);
+    if (!errors.empty())
+    {
+      for (auto &e : errors)
+      {
+        LOG(warning) << "Error while parsing response document: " << e->what();
+      }
+      return;
+    }
+
+    if (di->isAssetChanged())
+      out.m_assetEvents.emplace_back((obs));
+    else
+      out.m_entities.emplace_back(obs);
+  }
+
+  /// @brief Create an observation from the observation element at the reader position
+  ///
+  /// Only the value is read for most observations. Data sets and tables expand the element to walk
+  /// the entries, the expanded nodes are freed when the reader moves on.
+  inline static void parseObservation(ResponseDocument &out, xmlTextReaderPtr reader,
+                                      DevicePtr device)
+  {
+    Properties properties;
+    string name((const char *)xmlTextReaderConstLocalName(reader));
+
+    while (xmlTextReaderMoveToNextAttribute(reader) == 1)
+    {
+      if (xmlTextReaderIsNamespaceDecl(reader) == 1 || isNamed(reader, "sequence"))
+        continue;
+
+      string s((const char *)xmlTextReaderConstValue(reader));
+      properties.insert({(const char *)xmlTextReaderConstLocalName(reader), s});
+    }
+    xmlTextReaderMoveToElement(reader);
+
+    // Check for table or data set
+    auto di = findDataItem(name, device, properties);
+    if (!di)
+    {
+      readerText(reader);
+      return;
+    }
+
+    if (di->isDataSet())
+    {
+      auto o = xmlTextReaderExpand(reader);
+      if (o == nullptr)
+      {
+        LOG(warning) << "Parsing XML document: cannot read the entries of " << name;
+        return;
+      }
+
+      auto val = text(o);
+      if (val == "UNAVAILABLE")
+      {
+        properties.insert({"VALUE", val});
       }
       else
       {
-        auto uuid = attributeValue(dev, "uuid");
-        device = contract->findDevice(uuid);
-        if (!device)
-        {
-          LOG(warning) << "Parsing XML document: cannot find device by uuid: " << uuid
-                       << ", skipping device";
-          return true;
-        }
+        Value &v = properties["VALUE"];
+        v.emplace<DataSet>();
+        DataSet &ds = get<DataSet>(v);
+        dataSet(o, di->isTable(), ds);
       }
+    }
+    else
+    {
+      properties.insert({"VALUE", readerText(reader)});
+    }
+
+    addObservation(out, device, di, properties);
+  }
+
+  /// @brief Stream the observations from an MTConnectStreams document
+  ///
+  /// The document is read with a pull parser and the observations are created as the elements
+  /// are read, so the document tree is never built. The elements are at fixed depths:
+  /// `Streams/DeviceStream/ComponentStream/<Samples|Events|Condition>/<Observation>`.
+  /// @param[in] reader the reader positioned on the root element
+  inline static bool parseObservations(ResponseDocument &out, xmlTextReaderPtr reader,
+                                       pipeline::PipelineContextPtr context,
+                                       const std::optional<std::string> &deviceName)
+  {
+    enum Level
+    {
+      STREAMS = 1,
+      DEVICE_STREAM = 2,
+      COMPONENT_STREAM = 3,
+      ORGANIZER = 4,
+      OBSERVATION = 5
+    };
 
-      eachElement(dev, "ComponentStream", [&out, &device](xmlNodePtr comp) {
-        eachElement(comp, [&out, &device](xmlNodePtr org) {
-          eachElement(org, [&out, &device](xmlNodePtr o) {
-            Properties properties;
+    auto contract = context->m_contract.get();
+    auto root = xmlTextReaderDepth(reader);
 
-            eachAttribute(o, [&properties](xmlAttrPtr attr) {
-              if (xmlStrcmp(BAD_CAST "sequence", attr->name) != 0)
-              {
-                string s((const char *)attr->children->content);
-                properties.insert({(const char *)attr->name, s});
-              }
+    bool header = false, streams = false, component = false;
+    DevicePtr device;
 
-              return true;
-            });
+    int ret;
+    while ((ret = xmlTextReaderRead(reader)) == 1)
+    {
+      if (!isElement(reader))
+        continue;
 
-            // Check for table or data set
-            string name((const char *)o->name);
-            auto di = findDataItem(name, device, properties);
-            if (!di)
+      switch (xmlTextReaderDepth(reader) - root)
+      {
+        case STREAMS:
+          if (isNamed(reader, "Header"))
+          {
+            header = true;
+            out.m_instanceId =
+                boost::lexical_cast<SequenceNumber_t>(readerAttribute(reader, "instanceId"));
+            auto next = readerAttribute(reader, "nextSequence");
+            if (!next.empty())
+              out.m_next = boost::lexical_cast<SequenceNumber_t>(next);
+          }
+          else if (isNamed(reader, "Streams"))
+          {
+            if (!header)
             {
-              return true;
+              LOG(error) << "Cannot find next in header for streams doc";
+              return false;
             }
+            streams = true;
+          }
+          break;
 
-            // Remove old properties
-            properties.erase("name");
-            properties.erase("dataItemId");
+        case DEVICE_STREAM:
+          device.reset();
+          if (!streams || !isNamed(reader, "DeviceStream"))
+            break;
 
-            auto ts = properties["timestamp"];
-            auto timestamp = parseTimestamp(get<string>(ts));
+          if (deviceName)
+          {
+            device = contract->findDevice(*deviceName);
+            if (!device)
+              LOG(warning) << "Parsing XML document: cannot find device by uuid: " << *deviceName
+                           << ", skipping device";
+          }
+          else
+          {
+            auto uuid = readerAttribute(reader, "uuid");
+            device = contract->findDevice(uuid);
+            if (!device)
+              LOG(warning) << "Parsing XML document: cannot find device by uuid: " << uuid
+                           << ", skipping device";
+          }
+          break;
 
-            auto val = text(o);
-            if (val == "UNAVAILABLE" || (!di->isDataSet() && !di->isAssetRemoved()))
-            {
-              properties.insert({"VALUE", val});
-            }
-            else if (di->isAssetRemoved())
-            {
-              auto ac = make_shared<pipeline::AssetCommand>(
-                  "AssetCommand", Properties {{"assetId"s, val},
-                                              {"device"s, *(device->getUuid())},
-                                              {"VALUE"s, "RemoveAsset"s}});
-              out.m_entities.emplace_back(ac);
-              return true;
-            }
-            else  // isDataSet
-            {
-              Value &v = properties["VALUE"];
-              v.emplace<DataSet>();
-              DataSet &ds = get<DataSet>(v);
-              dataSet(o, di->isTable(), ds);
-            }
+        case COMPONENT_STREAM:
+          component = device && isNamed(reader, "ComponentStream");
+          break;
 
-            ErrorList errors;
-            auto obs = observation::Observation::make(di, properties, timestamp, errors);
-            if (!errors.empty())
-            {
-              for (auto &e : errors)
-              {
-                LOG(warning) << "Error while parsing XML: " << e->what();
-              }
-              return true;
-            }
+        case ORGANIZER:
+          break;
 
-            if (di->isAssetChanged())
-              out.m_assetEvents.emplace_back((obs));
-            else
-              out.m_entities.emplace_back(obs);
-            return true;
-          });
-          return true;
-        });
+        case OBSERVATION:
+          if (component)
+            parseObservation(out, reader, device);
+          break;
 
-        return true;
-      });
+        default:
+          // Children of observations are consumed by parseObservation
+          break;
+      }
+    }
 
-      return true;
-    });
+    if (ret < 0)
+    {
+      LOG(error) << "Parsing XML document: error reading MTConnectStreams document";
+      return false;
+    }
 
-    return true;
+    if (!header)
+    {
+      LOG(error) << "Received incorred document: MTConnectStreams";
+      return false;
+    }
+
+    return streams;
   }
 
   inline static bool parseAssets(ResponseDocument &out, xmlNodePtr node,
@@ -505,18 +647,353 @@ namespace mtconnect::pipeline {
     }
   }
 
+  /// @name JSON response documents
+  ///
+  /// Agents return JSON when asked for `application/mtconnect+json`. Version 1 documents hold
+  /// arrays of single key objects and version 2 documents group the entities by name, both are
+  /// accepted. Only streams and errors are supported, devices and assets are requested as XML.
+  ///@{
+
+  using json = nlohmann::json;
+
+  inline static string jsonText(const json &value)
+  {
+    if (value.is_string())
+    {
+      return value.get<string>();
+    }
+    else if (value.is_array())
+    {
+      // Three space samples are arrays of numbers, the XML value separates them with spaces
+      string res;
+      for (auto &v : value)
+      {
+        if (!res.empty())
+          res.append(" ");
+        res.append(jsonText(v));
+      }
+      return res;
+    }
+    else
+    {
+      return value.dump();
+    }
+  }
+
+  inline static SequenceNumber_t jsonSequence(const json &value)
+  {
+    if (value.is_number_unsigned())
+      return value.get<SequenceNumber_t>();
+    else
+      return boost::lexical_cast<SequenceNumber_t>(jsonText(value));
+  }
+
+  inline static DataSetValue jsonDataSetValue(const json &value)
+  {
+    if (value.is_string())
+      return value.get<string>();
+    else if (value.is_number_float())
+      return value.get<double>();
+    else if (value.is_number())
+      return value.get<int64_t>();
+    else
+      return std::monostate();
+  }
+
+  inline void dataSet(const json &value, bool table, DataSet &ds)
+  {
+    for (auto &item : value.items())
+    {
+      DataSetEntry entry;
+      entry.m_key = item.key();
+      auto &v = item.value();
+
+      // Removed entries are written as {"removed": true}
+      if (v.is_object() && v.size() == 1 && v.contains("removed"))
+      {
+        entry.m_removed = v.at("removed") == true;
+        entry.m_value.emplace<monostate>();
+      }
+      else if (table && v.is_object())
+      {
+        entry.m_value.emplace<DataSet>();
+        DataSet &row = get<DataSet>(entry.m_value);
+        for (auto &cell : v.items())
+          row.emplace(cell.key(), jsonDataSetValue(cell.value()));
+
+        if (row.empty())
+          entry.m_value.emplace<monostate>();
+      }
+      else
+      {
+        entry.m_value = jsonDataSetValue(v);
+      }
+
+      ds.insert(entry);
+    }
+  }
+
+  inline static bool parseJsonHeader(ResponseDocument &out, const json &root)
+  {
+    auto header = root.find("Header");
+    if (header == root.end() || !header->is_object())
+    {
+      LOG(error) << "Received incorred document: no Header";
+      return false;
+    }
+
+    if (auto id = header->find("instanceId"); id != header->end())
+      out.m_instanceId = jsonSequence(*id);
+    if (auto next = header->find("nextSequence"); next != header->end())
+      out.m_next = jsonSequence(*next);
+
+    return true;
+  }
+
+  inline static void parseObservation(ResponseDocument &out, const string &name,
+                                      const json &node, DevicePtr device)
+  {
+    if (!node.is_object())
+      return;
+
+    Properties properties;
+    const json *value = nullptr;
+    for (auto &item : node.items())
+    {
+      if (item.key() == "value")
+        value = &item.value();
+      else if (item.key() != "sequence")
+        properties.insert({item.key(), jsonText(item.value())});
+    }
+
+    auto di = findDataItem(name, device, properties);
+    if (!di)
+      return;
+
+    if (di->isDataSet() && value != nullptr && value->is_object())
+    {
+      Value &v = properties["VALUE"];
+      v.emplace<DataSet>();
+      DataSet &ds = get<DataSet>(v);
+      dataSet(*value, di->isTable(), ds);
+    }
+    else
+    {
+      properties.insert({"VALUE", value != nullptr ? jsonText(*value) : ""s});
+    }
+
+    addObservation(out, device, di, properties);
+  }
+
+  inline static void parseComponentStream(ResponseDocument &out, const json &component,
+                                          DevicePtr device)
+  {
+    // The Samples, Events, and Condition organizers are the only compound members
+    for (auto &organizer : component.items())
+    {
+      auto &obs = organizer.value();
+      if (obs.is_object())
+      {
+        // Version 2: {"Events": {"Program": [{...}, ...]}}
+        for (auto &type : obs.items())
+        {
+          for (auto &o : type.value())
+            parseObservation(out, type.key(), o, device);
+        }
+      }
+      else if (obs.is_array())
+      {
+        // Version 1: {"Events": [{"Program": {...}}, ...]}
+        for (auto &entry : obs)
+        {
+          for (auto &o : entry.items())
+            parseObservation(out, o.key(), o.value(), device);
+        }
+      }
+    }
+  }
+
+  inline static DevicePtr findStreamDevice(PipelineContract *contract, const json &stream,
+                                           const std::optional<std::string> &deviceName)
+  {
+    string uuid;
+    if (deviceName)
+    {
+      uuid = *deviceName;
+    }
+    else if (auto u = stream.find("uuid"); u != stream.end())
+    {
+      uuid = jsonText(*u);
+    }
+
+    auto device = contract->findDevice(uuid);
+    if (!device)
+      LOG(warning) << "Parsing JSON document: cannot find device by uuid: " << uuid
+                   << ", skipping device";
+
+    return device;
+  }
+
+  inline static bool parseObservations(ResponseDocument &out, const json &root,
+                                       pipeline::PipelineContextPtr context,
+                                       const std::optional<std::string> &deviceName)
+  {
+    if (!parseJsonHeader(out, root))
+    {
+      LOG(error) << "Cannot find next in header for streams doc";
+      return false;
+    }
+
+    auto streams = root.find("Streams");
+    if (streams == root.end())
+      return false;
+
+    auto contract = context->m_contract.get();
+    if (streams->is_object())
+    {
+      // Version 2: {"DeviceStream": [{..., "ComponentStream": [{...}]}]}
+      auto devices = streams->find("DeviceStream");
+      if (devices == streams->end())
+        return true;
+
+      for (auto &stream : *devices)
+      {
+        auto device = findStreamDevice(contract, stream, deviceName);
+        auto components = stream.find("ComponentStream");
+        if (!device || components == stream.end())
+          continue;
+
+        for (auto &component : *components)
+          parseComponentStream(out, component, device);
+      }
+    }
+    else if (streams->is_array())
+    {
+      // Version 1: [{"DeviceStream": {..., "ComponentStreams": [{"ComponentStream": {...}}]}}]
+      for (auto &entry : *streams)
+      {
+        auto stream = entry.find("DeviceStream");
+        if (stream == entry.end())
+          continue;
+
+        auto device = findStreamDevice(contract, *stream, deviceName);
+        auto components = stream->find("ComponentStreams");
+        if (!device || components == stream->end())
+          continue;
+
+        for (auto &c : *components)
+        {
+          if (auto component = c.find("ComponentStream"); component != c.end())
+            parseComponentStream(out, *component, device);
+        }
+      }
+    }
+
+    return true;
+  }
+
+  inline static void parseErrors(ResponseDocument &out, const json &root)
+  {
+    parseJsonHeader(out, root);
+
+    auto addError = [&out](const json &error) {
+      ResponseDocument::Error e;
+      if (auto code = error.find("errorCode"); code != error.end())
+        e.m_code = jsonText(*code);
+      if (auto msg = error.find("value"); msg != error.end())
+        e.m_message = jsonText(*msg);
+
+      LOG(error) << "Received protocol error: " << e.m_code << " " << e.m_message;
+      out.m_errors.emplace_back(e);
+    };
+
+    auto errors = root.find("Errors");
+    if (errors == root.end())
+      return;
+
+    if (errors->is_object())
+    {
+      // Version 2: {"Error": [{...}]}
+      if (auto list = errors->find("Error"); list != errors->end())
+      {
+        for (auto &error : *list)
+          addError(error);
+      }
+    }
+    else
+    {
+      // Version 1: [{"Error": {...}}]
+      for (auto &entry : *errors)
+      {
+        if (auto error = entry.find("Error"); error != entry.end())
+          addError(*error);
+      }
+    }
+  }
+
+  inline static bool parseJson(const std::string_view &content, ResponseDocument &out,
+                               pipeline::PipelineContextPtr context,
+                               const std::optional<std::string> &device)
+  {
+    auto doc = json::parse(content.begin(), content.end(), nullptr, false);
+    if (doc.is_discarded() || !doc.is_object())
+    {
+      LOG(error) << "Cannot parse JSON response document";
+      return false;
+    }
+
+    if (auto root = doc.find("MTConnectStreams"); root != doc.end())
+    {
+      out.m_enityType = ResponseDocument::OBSERVATION;
+      return parseObservations(out, *root, context, device);
+    }
+    else if (auto root = doc.find("MTConnectError"); root != doc.end())
+    {
+      out.m_enityType = ResponseDocument::ERRORS;
+      parseErrors(out, *root);
+      return false;
+    }
+    else
+    {
+      LOG(error) << "Unsupported JSON document type, only streams and errors are accepted";
+      return false;
+    }
+  }
+  ///@}
+
   bool ResponseDocument::parse(const std::string_view &content, ResponseDocument &out,
                                pipeline::PipelineContextPtr context,
                                const std::optional<std::string> &device,
                                const std::optional<std::string> &uuid)
   {
+    auto first = content.find_first_not_of(" \t\r\n");
+    if (first != std::string_view::npos && content[first] == '{')
+      return parseJson(content, out, context, device);
+
     // xmlInitParser();
     // xmlXPathInit();
-    unique_ptr<xmlDoc, function<void(xmlDocPtr)>> doc(
-        xmlReadMemory(content.data(), static_cast<int>(content.length()), "incoming.xml", nullptr,
-                      XML_PARSE_NOBLANKS),
-        [](xmlDocPtr d) { xmlFreeDoc(d); });
-    xmlNodePtr root = xmlDocGetRootElement(doc.get());
+    TextReaderPtr reader(xmlReaderForMemory(content.data(), static_cast<int>(content.length()),
+                                            "incoming.xml", nullptr, XML_PARSE_NOBLANKS),
+                         [](xmlTextReaderPtr r) { xmlFreeTextReader(r); });
+    if (!reader)
+      return false;
+
+    // Find the root element
+    int ret;
+    while ((ret = xmlTextReaderRead(reader.get())) == 1 && !isElement(reader.get()))
+      ;
+    if (ret != 1)
+      return false;
+
+    // Streams are the bulk of the traffic, read the observations without building the document
+    if (isNamed(reader.get(), "MTConnectStreams"))
+    {
+      out.m_enityType = OBSERVATION;
+      return parseObservations(out, reader.get(), context, device);
+    }
+
+    // The other documents are small, expand the tree and walk the nodes
+    xmlNodePtr root = xmlTextReaderExpand(reader.get());
     if (root != nullptr)
     {
       if (!parseHeader(out, root))
@@ -524,12 +1001,7 @@ namespace mtconnect::pipeline {
         LOG(error) << "Cannot find next in header for streams doc";
         return false;
       }
-      if (xmlStrcmp(BAD_CAST "MTConnectStreams", root->name) == 0)
-      {
-        out.m_enityType = OBSERVATION;
-        return parseObservations(out, root, context, device);
-      }
-      else if (xmlStrcmp(BAD_CAST "MTConnectDevices", root->name) == 0)
+      if (xmlStrcmp(BAD_CAST "MTConnectDevices", root->name) == 0)
       {
         out.m_enityType = DEVICE;
         return parseDevices(out, root, context, device, uuid);
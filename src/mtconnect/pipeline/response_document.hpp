@@ -46,8 +46,10 @@ namespace mtconnect::pipeline {
     };
     using Errors = std::list<Error>;
 
-    /// @brief parse the content of the XML document
-    /// @param[in] content XML document
+    /// @brief parse the content of the XML or JSON document
+    ///
+    /// JSON is detected by the leading `{`. Only JSON streams and error documents are supported.
+    /// @param[in] content XML or JSON document
     /// @param[out] doc the created response document
     /// @param[in] context pipeline context
     /// @param[in] device optional device uuid
@@ -0,0 +1,148 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "mtconnect/asset/asset.hpp"
+#include "mtconnect/config.hpp"
+#include "mtconnect/utilities.hpp"
+
+namespace mtconnect::printer {
+  /// @brief Cache of serialized assets for a printer
+  ///
+  /// Each asset is rendered once and the fragment is copied into later documents. A fragment is
+  /// used while the asset has the same `hash`, timestamp, and removed state. Assets without a hash
+  /// must be the same asset object. The least recently used fragments are dropped when the cache
+  /// is full. The cache is thread safe.
+  class AGENT_LIB_API AssetCache
+  {
+  public:
+    using Fragment = std::shared_ptr<const std::string>;
+
+    /// @brief Create an asset cache
+    /// @param[in] max the maximum number of fragments
+    AssetCache(size_t max = 1024) : m_max(max) {}
+
+    /// @brief get the fragment for an asset, rendering it if it is not cached
+    /// @param[in] asset the asset
+    /// @param[in] render a function returning the serialized asset
+    /// @return the serialized asset
+    template <typename F>
+    Fragment get(const asset::AssetPtr &asset, F &&render)
+    {
+      const auto &id = asset->getAssetId();
+      auto hash = asset->maybeGet<std::string>("hash");
+      auto timestamp = asset->getTimestamp();
+      auto removed = asset->isRemoved();
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto it = m_entries.find(id); it != m_entries.end())
+        {
+          auto &entry = it->second;
+          if (entry.m_timestamp == timestamp && entry.m_removed == removed &&
+              (hash && entry.m_hash ? *hash == *entry.m_hash : entry.m_asset.lock() == asset))
+          {
+            m_order.splice(m_order.begin(), m_order, entry.m_position);
+            return entry.m_fragment;
+          }
+        }
+      }
+
+      // Render outside the lock, another thread may render the same asset
+      auto fragment = std::make_shared<const std::string>(render());
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_entries.find(id);
+      if (it == m_entries.end())
+      {
+        m_order.push_front(id);
+        it = m_entries.emplace(id, Entry {}).first;
+        it->second.m_position = m_order.begin();
+      }
+      else
+      {
+        m_order.splice(m_order.begin(), m_order, it->second.m_position);
+      }
+
+      auto &entry = it->second;
+      entry.m_asset = asset;
+      entry.m_hash = hash;
+      entry.m_timestamp = timestamp;
+      entry.m_removed = removed;
+      entry.m_fragment = fragment;
+
+      while (m_entries.size() > m_max)
+      {
+        m_entries.erase(m_order.back());
+        m_order.pop_back();
+      }
+
+      return fragment;
+    }
+
+    /// @brief remove the fragment for an asset
+    /// @param[in] id the assetId
+    void invalidate(const std::string &id)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (auto it = m_entries.find(id); it != m_entries.end())
+      {
+        m_order.erase(it->second.m_position);
+        m_entries.erase(it);
+      }
+    }
+
+    /// @brief remove all fragments
+    void clear()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_entries.clear();
+      m_order.clear();
+    }
+
+    /// @brief get the number of cached fragments
+    size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_entries.size();
+    }
+
+  protected:
+    struct Entry
+    {
+      std::weak_ptr<asset::Asset> m_asset;
+      std::optional<std::string> m_hash;
+      std::optional<Timestamp> m_timestamp;
+      bool m_removed {false};
+      Fragment m_fragment;
+      std::list<std::string>::iterator m_position;
+    };
+
+    mutable std::mutex m_mutex;
+    size_t m_max;
+    std::unordered_map<std::string, Entry> m_entries;
+    // Most recently used assets are at the front
+    std::list<std::string> m_order;
+  };
+}  // namespace mtconnect::printer
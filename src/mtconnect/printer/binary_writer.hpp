@@ -0,0 +1,394 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <rapidjson/rapidjson.h>
+
+#include "mtconnect/config.hpp"
+
+namespace mtconnect::printer {
+  /// @brief Binary encodings of the JSON document model
+  enum class BinaryEncoding
+  {
+    CBOR,    ///< RFC 8949 Concise Binary Object Representation
+    MSGPACK  ///< MessagePack
+  };
+
+  /// @brief convert a configuration value to a binary encoding
+  /// @param[in] format `cbor` or `msgpack`. Anything else, including `json`, is text.
+  /// @return the encoding or `nullopt` for text JSON
+  inline std::optional<BinaryEncoding> ParseBinaryEncoding(const std::string_view &format)
+  {
+    if (format == "cbor" || format == "CBOR")
+      return BinaryEncoding::CBOR;
+    else if (format == "msgpack" || format == "MSGPACK" || format == "messagepack")
+      return BinaryEncoding::MSGPACK;
+    else
+      return std::nullopt;
+  }
+
+  /// @brief get the mime type for a binary encoding
+  inline std::string BinaryEncodingMimeType(BinaryEncoding encoding)
+  {
+    return encoding == BinaryEncoding::CBOR ? "application/cbor" : "application/msgpack";
+  }
+
+  /// @brief A writer with the same interface as the rapidjson `Writer` that encodes the document
+  /// as CBOR or MessagePack.
+  ///
+  /// This allows the `JsonHelper`, `AutoJsonObject`, `AutoJsonArray` and `JsonStack` classes and
+  /// the printers built on them to produce the same document structure in a binary encoding.
+  /// Objects and arrays are written with definite lengths. Room for the largest length header is
+  /// reserved when the object or array is started and the header is written into it when it is
+  /// ended. Small objects and arrays are moved over their unused room when they are ended, the
+  /// rest of the unused room is removed in one pass when the outermost object or array is ended.
+  class AGENT_LIB_API BinaryWriter
+  {
+  public:
+    /// @brief Create a writer that appends to `output`
+    /// @param[in] output the buffer to encode into
+    /// @param[in] encoding the binary encoding
+    BinaryWriter(std::string &output, BinaryEncoding encoding)
+      : m_output(output), m_encoding(encoding)
+    {}
+
+    /// @name rapidjson Writer interface
+    /// @{
+    bool Null()
+    {
+      value();
+      m_output.push_back(cbor() ? char(0xF6) : char(0xC0));
+      return true;
+    }
+    bool Bool(bool b)
+    {
+      value();
+      if (cbor())
+        m_output.push_back(b ? char(0xF5) : char(0xF4));
+      else
+        m_output.push_back(b ? char(0xC3) : char(0xC2));
+      return true;
+    }
+    bool Int(int i) { return Int64(i); }
+    bool Uint(unsigned u) { return Uint64(u); }
+    bool Int64(int64_t i)
+    {
+      if (i >= 0)
+        return Uint64(uint64_t(i));
+
+      value();
+      if (cbor())
+      {
+        head(m_output, 1, uint64_t(-(i + 1)));
+      }
+      else if (i >= -32)
+      {
+        m_output.push_back(char(int8_t(i)));
+      }
+      else if (i >= INT8_MIN)
+      {
+        m_output.push_back(char(0xD0));
+        bigEndian(m_output, uint64_t(i), 1);
+      }
+      else if (i >= INT16_MIN)
+      {
+        m_output.push_back(char(0xD1));
+        bigEndian(m_output, uint64_t(i), 2);
+      }
+      else if (i >= INT32_MIN)
+      {
+        m_output.push_back(char(0xD2));
+        bigEndian(m_output, uint64_t(i), 4);
+      }
+      else
+      {
+        m_output.push_back(char(0xD3));
+        bigEndian(m_output, uint64_t(i), 8);
+      }
+      return true;
+    }
+    bool Uint64(uint64_t u)
+    {
+      value();
+      if (cbor())
+        head(m_output, 0, u);
+      else if (u < 0x80)
+        m_output.push_back(char(u));
+      else
+        msgpackUnsigned(m_output, u);
+      return true;
+    }
+    bool Double(double d)
+    {
+      value();
+      // Use single precision when it does not lose information
+      float f = float(d);
+      if (double(f) == d)
+      {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        m_output.push_back(cbor() ? char(0xFA) : char(0xCA));
+        bigEndian(m_output, bits, 4);
+      }
+      else
+      {
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        m_output.push_back(cbor() ? char(0xFB) : char(0xCB));
+        bigEndian(m_output, bits, 8);
+      }
+      return true;
+    }
+    bool String(const char *s, rapidjson::SizeType length, bool copy = false)
+    {
+      value();
+      if (cbor())
+        head(m_output, 3, length);
+      else if (length < 32)
+        m_output.push_back(char(0xA0 | length));
+      else if (length <= UINT8_MAX)
+      {
+        m_output.push_back(char(0xD9));
+        bigEndian(m_output, length, 1);
+      }
+      else if (length <= UINT16_MAX)
+      {
+        m_output.push_back(char(0xDA));
+        bigEndian(m_output, length, 2);
+      }
+      else
+      {
+        m_output.push_back(char(0xDB));
+        bigEndian(m_output, length, 4);
+      }
+      m_output.append(s, length);
+      return true;
+    }
+    bool String(const char *s) { return String(s, rapidjson::SizeType(std::strlen(s))); }
+    bool Key(const char *s, rapidjson::SizeType length, bool copy = false)
+    {
+      return String(s, length, copy);
+    }
+    bool Key(const char *s) { return String(s); }
+    bool StartObject() { return start(); }
+    bool EndObject(rapidjson::SizeType = 0) { return end(true); }
+    bool StartArray() { return start(); }
+    bool EndArray(rapidjson::SizeType = 0) { return end(false); }
+    /// @}
+
+    /// @brief check if all objects and arrays have been ended
+    bool IsComplete() const { return m_stack.empty() && !m_output.empty(); }
+
+    /// @brief encode an array of already encoded documents
+    /// @param[in] encoding the binary encoding of the documents
+    /// @param[in] documents the encoded documents
+    /// @return the encoded array
+    static std::string Array(BinaryEncoding encoding, const std::vector<std::string> &documents)
+    {
+      std::string output;
+      size_t size = 0;
+      for (auto &d : documents)
+        size += d.size();
+      output.reserve(size + 9);
+
+      containerHeader(output, encoding, false, documents.size());
+      for (auto &d : documents)
+        output.append(d);
+      return output;
+    }
+
+  protected:
+    bool cbor() const { return m_encoding == BinaryEncoding::CBOR; }
+
+    // Every key and value is counted in the enclosing object or array
+    void value()
+    {
+      if (!m_stack.empty())
+        m_stack.back().m_count++;
+    }
+
+    // The largest header, CBOR 8 byte and MessagePack 32 bit counts
+    size_t maxHeader() const { return cbor() ? 9 : 5; }
+    static constexpr size_t SmallContainer {256};
+
+    bool start()
+    {
+      value();
+      m_stack.push_back({m_output.size(), 0, m_unused.size()});
+      m_unused.push_back({m_output.size(), 0});
+      m_output.append(maxHeader(), '\0');
+      return true;
+    }
+
+    bool end(bool object)
+    {
+      auto container = m_stack.back();
+      m_stack.pop_back();
+
+      // Write the header at the end of the reserved room, the room before it is removed later
+      std::string header;
+      containerHeader(header, m_encoding, object,
+                      object ? container.m_count / 2 : container.m_count);
+      auto unused = maxHeader() - header.size();
+      auto out = m_output.data() + container.m_position;
+      std::memcpy(out + unused, header.data(), header.size());
+
+      // Small containers without room left inside are moved now, they are cheap to move and
+      // most of the containers in a document
+      auto content = m_output.size() - container.m_position - maxHeader();
+      if (m_unused.size() == container.m_unused + 1 && content <= SmallContainer)
+      {
+        if (unused > 0)
+        {
+          std::memmove(out, out + unused, header.size() + content);
+          m_output.resize(m_output.size() - unused);
+        }
+        m_unused.pop_back();
+      }
+      else
+      {
+        m_unused[container.m_unused].second = unused;
+      }
+
+      if (m_stack.empty())
+        compact();
+      return true;
+    }
+
+    // Remove the unused header room, moving every byte at most once. The room is recorded in the
+    // order the containers were started, which is the order of the positions.
+    void compact()
+    {
+      if (m_unused.empty())
+        return;
+
+      auto out = m_output.data();
+      auto to = m_unused.front().first;
+      for (size_t i = 0; i < m_unused.size(); i++)
+      {
+        auto from = m_unused[i].first + m_unused[i].second;
+        auto next = i + 1 < m_unused.size() ? m_unused[i + 1].first : m_output.size();
+        if (to != from)
+          std::memmove(out + to, out + from, next - from);
+        to += next - from;
+      }
+      m_output.resize(to);
+      m_unused.clear();
+    }
+
+    static void containerHeader(std::string &output, BinaryEncoding encoding, bool object,
+                                uint64_t count)
+    {
+      if (encoding == BinaryEncoding::CBOR)
+        head(output, object ? 5 : 4, count);
+      else if (count < 16)
+        output.push_back(char((object ? 0x80 : 0x90) | count));
+      else if (count <= UINT16_MAX)
+      {
+        output.push_back(object ? char(0xDE) : char(0xDC));
+        bigEndian(output, count, 2);
+      }
+      else
+      {
+        output.push_back(object ? char(0xDF) : char(0xDD));
+        bigEndian(output, count, 4);
+      }
+    }
+
+    static void bigEndian(std::string &output, uint64_t value, int bytes)
+    {
+      for (int i = bytes - 1; i >= 0; i--)
+        output.push_back(char((value >> (i * 8)) & 0xFF));
+    }
+
+    // CBOR major type and argument, RFC 8949 section 3
+    static void head(std::string &output, uint8_t major, uint64_t value)
+    {
+      uint8_t type = major << 5;
+      if (value < 24)
+        output.push_back(char(type | value));
+      else if (value <= UINT8_MAX)
+      {
+        output.push_back(char(type | 24));
+        bigEndian(output, value, 1);
+      }
+      else if (value <= UINT16_MAX)
+      {
+        output.push_back(char(type | 25));
+        bigEndian(output, value, 2);
+      }
+      else if (value <= UINT32_MAX)
+      {
+        output.push_back(char(type | 26));
+        bigEndian(output, value, 4);
+      }
+      else
+      {
+        output.push_back(char(type | 27));
+        bigEndian(output, value, 8);
+      }
+    }
+
+    // MessagePack uint 8, 16, 32, and 64
+    static void msgpackUnsigned(std::string &output, uint64_t value)
+    {
+      if (value <= UINT8_MAX)
+      {
+        output.push_back(char(0xCC));
+        bigEndian(output, value, 1);
+      }
+      else if (value <= UINT16_MAX)
+      {
+        output.push_back(char(0xCD));
+        bigEndian(output, value, 2);
+      }
+      else if (value <= UINT32_MAX)
+      {
+        output.push_back(char(0xCE));
+        bigEndian(output, value, 4);
+      }
+      else
+      {
+        output.push_back(char(0xCF));
+        bigEndian(output, value, 8);
+      }
+    }
+
+  protected:
+    struct Container
+    {
+      size_t m_position;
+      uint64_t m_count;
+      size_t m_unused;
+    };
+
+    std::string &m_output;
+    BinaryEncoding m_encoding;
+    std::vector<Container> m_stack;
+    // Position and size of the header room that is not used, in the order it was reserved
+    std::vector<std::pair<size_t, size_t>> m_unused;
+  };
+}  // namespace mtconnect::printer
@@ -28,8 +28,10 @@
 #include <boost/range/algorithm/sort.hpp>
 
 #include <cstdlib>
+#include <map>
 #include <set>
 #include <sstream>
+#include <type_traits>
 
 #include "mtconnect/device_model/composition.hpp"
 #include "mtconnect/device_model/configuration/configuration.hpp"
@@ -47,8 +49,9 @@ namespace mtconnect::printer {
   using namespace device_model;
   using namespace rapidjson;
 
-  JsonPrinter::JsonPrinter(uint32_t jsonVersion, bool pretty)
-    : Printer(pretty), m_jsonVersion(jsonVersion)
+  JsonPrinter::JsonPrinter(uint32_t jsonVersion, bool pretty,
+                           std::optional<BinaryEncoding> encoding)
+    : Printer(pretty), m_jsonVersion(jsonVersion), m_encoding(encoding)
   {
     NAMED_SCOPE("JsonPrinter::JsonPrinter");
     char appVersion[32] = {0};
@@ -113,8 +116,7 @@ namespace mtconnect::printer {
   {
     defaultSchemaVersion();
 
-    StringBuffer output;
-    RenderJson(output, m_pretty || pretty, [&](auto &writer) {
+    return RenderDocument(m_encoding, m_pretty || pretty, [&](auto &writer) {
       AutoJsonObject obj(writer);
       {
         AutoJsonObject obj(writer, "MTConnectError");
@@ -157,8 +159,6 @@ namespace mtconnect::printer {
         }
       }
     });
-
-    return string(output.GetString(), output.GetLength());
   }
 
   std::string JsonPrinter::printProbe(const uint64_t instanceId, const unsigned int bufferSize,
@@ -170,8 +170,7 @@ namespace mtconnect::printer {
   {
     defaultSchemaVersion();
 
-    StringBuffer output;
-    RenderJson(output, m_pretty || pretty, [&](auto &writer) {
+    return RenderDocument(m_encoding, m_pretty || pretty, [&](auto &writer) {
       entity::JsonPrinter printer(writer, m_jsonVersion, includeHidden);
 
       AutoJsonObject top(writer);
@@ -187,8 +186,56 @@ namespace mtconnect::printer {
         printer.printEntityList(devices);
       }
     });
+  }
 
-    return string(output.GetString(), output.GetLength());
+  // Compact JSON text copies the serialized assets from the cache. The assets are laid out the
+  // same way as entity::JsonPrinter::printEntityList.
+  template <typename T>
+  static void printAssetFragments(T &writer, uint32_t version, AssetCache &cache,
+                                  const asset::AssetList &assets)
+  {
+    auto print = [&writer, version, &cache](const asset::AssetPtr &asset) {
+      auto fragment = cache.get(asset, [&asset, version]() {
+        StringBuffer output;
+        rapidjson::Writer<StringBuffer> fragmentWriter(output);
+        entity::JsonPrinter printer(fragmentWriter, version);
+        printer.printEntity(asset);
+        return string(output.GetString(), output.GetLength());
+      });
+      writer.RawValue(fragment->data(), fragment->size(), kObjectType);
+    };
+
+    if (version == 1)
+    {
+      AutoJsonArray ary(writer);
+      for (auto &asset : assets)
+      {
+        AutoJsonObject obj(writer);
+        obj.Key(asset->getName());
+        print(asset);
+      }
+    }
+    else if (version == 2)
+    {
+      AutoJsonObject obj(writer);
+      std::multimap<std::string_view, asset::AssetPtr> byName;
+      for (auto &asset : assets)
+        byName.emplace(std::string_view(asset->getName()), asset);
+
+      for (auto it = byName.begin(); it != byName.end();)
+      {
+        auto next = byName.upper_bound(it->first);
+        obj.Key(it->first);
+
+        AutoJsonArray ary(writer);
+        for (; it != next; it++)
+          print(it->second);
+      }
+    }
+    else
+    {
+      throw std::runtime_error("Invalid json printer version");
+    }
   }
 
   std::string JsonPrinter::printAssets(const uint64_t instanceId, const unsigned int bufferSize,
@@ -197,8 +244,7 @@ namespace mtconnect::printer {
   {
     defaultSchemaVersion();
 
-    StringBuffer output;
-    RenderJson(output, m_pretty || pretty, [&](auto &writer) {
+    return RenderDocument(m_encoding, m_pretty || pretty, [&](auto &writer) {
       entity::JsonPrinter printer(writer, m_jsonVersion);
 
       AutoJsonObject top(writer);
@@ -211,10 +257,12 @@ namespace mtconnect::printer {
       }
       {
         obj.Key("Assets");
-        printer.printEntityList(asset);
+        if constexpr (is_same_v<decay_t<decltype(writer)>, rapidjson::Writer<StringBuffer>>)
+          printAssetFragments(writer, m_jsonVersion, m_assetCache, asset);
+        else
+          printer.printEntityList(asset);
       }
     });
-    return string(output.GetString(), output.GetLength());
   }
 
   using namespace boost;
@@ -397,8 +445,7 @@ namespace mtconnect::printer {
   {
     defaultSchemaVersion();
 
-    StringBuffer output;
-    RenderJson(output, m_pretty || pretty, [&](auto &writer) {
+    return RenderDocument(m_encoding, m_pretty || pretty, [&](auto &writer) {
       AutoJsonObject top(writer);
       AutoJsonObject obj(writer, "MTConnectStreams");
       obj.AddPairs("jsonVersion", m_jsonVersion, "schemaVersion", *m_schemaVersion);
@@ -430,7 +477,5 @@ namespace mtconnect::printer {
         }
       }
     });
-
-    return string(output.GetString(), output.GetLength());
   }
 }  // namespace mtconnect::printer
@@ -19,15 +19,23 @@
 
 #include "mtconnect/asset/cutting_tool.hpp"
 #include "mtconnect/config.hpp"
+#include "mtconnect/printer/binary_writer.hpp"
 #include "mtconnect/printer/printer.hpp"
 #include "mtconnect/utilities.hpp"
 
 namespace mtconnect::printer {
   /// @brief Printer to generate JSON Documents
+  ///
+  /// The documents can also be encoded as CBOR or MessagePack with the same structure.
   class AGENT_LIB_API JsonPrinter : public Printer
   {
   public:
-    JsonPrinter(uint32_t jsonVersion, bool pretty = false);
+    /// @brief Create a JSON printer
+    /// @param[in] jsonVersion the JSON serialization version
+    /// @param[in] pretty `true` to pretty print JSON text
+    /// @param[in] encoding the binary encoding or `nullopt` for JSON text
+    JsonPrinter(uint32_t jsonVersion, bool pretty = false,
+                std::optional<BinaryEncoding> encoding = std::nullopt);
     ~JsonPrinter() override = default;
 
     std::string printErrors(const uint64_t instanceId, const unsigned int bufferSize,
@@ -47,13 +55,21 @@ namespace mtconnect::printer {
     std::string printAssets(const uint64_t anInstanceId, const unsigned int bufferSize,
                             const unsigned int assetCount, const asset::AssetList &asset,
                             bool pretty = false) const override;
-    std::string mimeType() const override { return "application/mtconnect+json"; }
+    std::string mimeType() const override
+    {
+      if (m_encoding)
+        return BinaryEncodingMimeType(*m_encoding);
+      else
+        return "application/mtconnect+json";
+    }
 
     uint32_t getJsonVersion() const { return m_jsonVersion; }
+    const auto &getEncoding() const { return m_encoding; }
 
   protected:
     std::string m_version;
     std::string m_hostname;
     uint32_t m_jsonVersion;
+    std::optional<BinaryEncoding> m_encoding;
   };
 }  // namespace mtconnect::printer
@@ -18,11 +18,14 @@
 #pragma once
 
 #include <cmath>
+#include <optional>
 #include <rapidjson/document.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 
+#include "mtconnect/printer/binary_writer.hpp"
+
 namespace mtconnect::printer {
 
   /// @brief Abstract helper wrapping the rapidjson writer and providing some helper methods
@@ -357,6 +360,33 @@ namespace mtconnect::printer {
     }
   }
 
+  /// @brief Helper function that renders a document as JSON text or in a binary encoding.
+  ///
+  /// Calls func with a rapidjson writer or a `BinaryWriter`. The pretty flag is ignored for binary
+  /// encodings.
+  ///
+  /// @param[in] encoding the binary encoding or `nullopt` for JSON text
+  /// @param[in] pretty `true` to pretty print JSON text
+  /// @param[in] func the lambda to callback with the writer
+  /// @tparam T the type of the lambda
+  /// @returns the rendered document
+  template <typename T>
+  inline std::string RenderDocument(const std::optional<BinaryEncoding> &encoding, bool pretty,
+                                    T &&func)
+  {
+    if (encoding)
+    {
+      std::string output;
+      BinaryWriter writer(output, *encoding);
+      func(writer);
+      return output;
+    }
+
+    rapidjson::StringBuffer output;
+    RenderJson(output, pretty, func);
+    return std::string(output.GetString(), output.GetLength());
+  }
+
   /// @brief A hierarchy of Json Objects and Arrays that are automatically managed so the opens and
   /// closes always match.
   /// @tparam W the writer type
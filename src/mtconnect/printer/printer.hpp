@@ -25,6 +25,7 @@
 #include "mtconnect/asset/asset.hpp"
 #include "mtconnect/config.hpp"
 #include "mtconnect/observation/observation.hpp"
+#include "mtconnect/printer/asset_cache.hpp"
 #include "mtconnect/utilities.hpp"
 #include "mtconnect/version.h"
 
@@ -146,8 +147,16 @@ namespace mtconnect {
         }
       }
 
+      /// @brief Remove the serialized asset from the asset cache
+      /// @param id the assetId
+      void invalidateAsset(const std::string &id) { m_assetCache.invalidate(id); }
+      /// @brief Get the cache of serialized assets
+      /// @returns the asset cache
+      const AssetCache &getAssetCache() const { return m_assetCache; }
+
     protected:
       bool m_pretty;
+      mutable AssetCache m_assetCache;
       std::string m_modelChangeTime;
       std::optional<std::string> m_schemaVersion;
       std::string m_senderName {"localhost"};
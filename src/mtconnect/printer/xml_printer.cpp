@@ -510,7 +510,25 @@ namespace mtconnect::printer {
 
         for (const auto &asset : asset)
         {
-          printer.print(writer, asset, m_assetNsSet);
+          // Serialized assets are reused in compact documents, the indentation of pretty
+          // documents depends on the position in the document
+          if (m_pretty || pretty)
+          {
+            printer.print(writer, asset, m_assetNsSet);
+          }
+          else
+          {
+            auto fragment = m_assetCache.get(asset, [&]() {
+              XmlWriter fragmentWriter(false);
+              printer.print(fragmentWriter, asset, m_assetNsSet);
+              auto content = fragmentWriter.getContent();
+              while (!content.empty() && content.back() == '\n')
+                content.pop_back();
+              return content;
+            });
+            THROW_IF_XML2_ERROR(xmlTextWriterWriteRawLen(writer, BAD_CAST fragment->data(),
+                                                         int(fragment->size())));
+          }
         }
       }
 
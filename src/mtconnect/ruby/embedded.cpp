@@ -69,8 +69,14 @@ namespace mtconnect::ruby {
   RClass *RubyObservation::m_sampleClass;
   RClass *RubyObservation::m_conditionClass;
 
-  std::recursive_mutex RubyVM::m_mutex;
   RubyVM *RubyVM::m_vm = nullptr;
+  std::vector<RubyVM *> RubyVM::m_pool;
+  std::atomic_size_t RubyVM::m_next {0};
+  boost::asio::thread_pool *RubyVM::m_threadPool = nullptr;
+
+  static thread_local RubyVM *HeldVM = nullptr;
+  RubyVM *RubyVM::held() { return HeldVM; }
+  void RubyVM::setHeld(RubyVM *vm) { HeldVM = vm; }
 
   static mrb_value LoadModule(mrb_state *mrb, mrb_value &filename)
   {
@@ -120,12 +126,74 @@ namespace mtconnect::ruby {
     }
   }
 
+  // Define the MTConnect classes in the VM and load the module
+  static void InitializeVM(RubyVM &vm, Agent *agent,
+                           const std::optional<std::filesystem::path> &modulePath)
+  {
+    using namespace std::filesystem;
+
+    lock_guard guard(vm);
+
+    auto mrb = vm.state();
+
+    RubyAgent::initialize(mrb, vm.mtconnect(), agent);
+    RubyPipeline::initialize(mrb, vm.mtconnect());
+    RubyEntity::initialize(mrb, vm.mtconnect());
+    RubyObservation::initialize(mrb, vm.mtconnect());
+    RubyTransform::initialize(mrb, vm.mtconnect());
+    RubyBatchTransform::initialize(mrb, vm.mtconnect());
+
+    if (modulePath)
+    {
+      LOG(info) << "Loading module: " << *modulePath;
+
+      std::error_code ec;
+      path file = canonical(*modulePath, ec);
+      if (ec)
+      {
+        LOG(error) << "Cannot open file: " << ec.message();
+      }
+      else
+      {
+        LOG(info) << "Resolved module path: " << file;
+        FILE *fp = nullptr;
+        try
+        {
+          int save = mrb_gc_arena_save(mrb);
+          mrb_value file = mrb_str_new_cstr(mrb, modulePath->string().c_str());
+          mrb_bool state = false;
+          mrb_value res = mrb_protect(
+              mrb, [](mrb_state *mrb, mrb_value filename) { return LoadModule(mrb, filename); },
+              file, &state);
+          mrb_gc_arena_restore(mrb, save);
+          if (mrb_false_p(res))
+          {
+            LOG(fatal) << "Error loading file " << *modulePath << ": exiting agent";
+            exit(1);
+          }
+        }
+        catch (std::exception ex)
+        {
+          LOG(fatal) << "Failed to load module: " << *modulePath << ": " << ex.what();
+          exit(1);
+        }
+        catch (...)
+        {
+          LOG(fatal) << "Failed to load module: " << *modulePath;
+          exit(1);
+        }
+        if (fp != nullptr)
+        {
+          fclose(fp);
+        }
+      }
+    }
+  }
+
   Embedded::Embedded(mtconnect::configuration::AgentConfiguration *config,
                      const ConfigOptions &options)
     : m_agent(config->getAgent()), m_options(options)
   {
-    using namespace std::filesystem;
-
     NAMED_SCOPE("Ruby::Embedded");
 
     // Load the ruby module in the configuration
@@ -150,64 +218,41 @@ namespace mtconnect::ruby {
     if (!m_rubyVM)
     {
       m_rubyVM = make_unique<RubyVM>();
+      InitializeVM(*m_rubyVM, m_agent, modulePath);
 
-      lock_guard guard(*m_rubyVM);
-
-      auto mrb = m_rubyVM->state();
-
-      RubyAgent::initialize(mrb, m_rubyVM->mtconnect(), m_agent);
-      RubyPipeline::initialize(mrb, m_rubyVM->mtconnect());
-      RubyEntity::initialize(mrb, m_rubyVM->mtconnect());
-      RubyObservation::initialize(mrb, m_rubyVM->mtconnect());
-      RubyTransform::initialize(mrb, m_rubyVM->mtconnect());
-
-      if (modulePath)
+      // The replicas load the module after the primary VM has modified the pipelines
+      auto poolSize = GetOption<int>(m_options, "PoolSize").value_or(1);
+      if (poolSize > 1)
       {
-        LOG(info) << "Loading module: " << *modulePath;
-
-        std::error_code ec;
-        path file = canonical(*modulePath, ec);
-        if (ec)
+        LOG(info) << "Creating a pool of " << poolSize << " ruby VMs";
+        RubyVM::addToPool(m_rubyVM.get());
+        for (int i = 1; i < poolSize; i++)
         {
-          LOG(error) << "Cannot open file: " << ec.message();
-        }
-        else
-        {
-          LOG(info) << "Resolved module path: " << file;
-          FILE *fp = nullptr;
-          try
-          {
-            int save = mrb_gc_arena_save(mrb);
-            mrb_value file = mrb_str_new_cstr(mrb, modulePath->string().c_str());
-            mrb_bool state = false;
-            mrb_value res = mrb_protect(
-                mrb, [](mrb_state *mrb, mrb_value filename) { return LoadModule(mrb, filename); },
-                file, &state);
-            mrb_gc_arena_restore(mrb, save);
-            if (mrb_false_p(res))
-            {
-              LOG(fatal) << "Error loading file " << *modulePath << ": exiting agent";
-              exit(1);
-            }
-          }
-          catch (std::exception ex)
-          {
-            LOG(fatal) << "Failed to load module: " << *modulePath << ": " << ex.what();
-            exit(1);
-          }
-          catch (...)
-          {
-            LOG(fatal) << "Failed to load module: " << *modulePath;
-            exit(1);
-          }
-          if (fp != nullptr)
-          {
-            fclose(fp);
-          }
+          auto &vm = m_pool.emplace_back(make_unique<RubyVM>(true));
+          InitializeVM(*vm, m_agent, modulePath);
+          RubyVM::addToPool(vm.get());
         }
       }
+
+      auto threads = GetOption<int>(m_options, "Threads");
+      if (threads && *threads > 0)
+      {
+        LOG(info) << "Running ruby transforms on " << *threads << " threads";
+        m_threadPool = make_unique<boost::asio::thread_pool>(*threads);
+        RubyVM::setThreadPool(m_threadPool.get());
+      }
     }
   }
 
-  Embedded::~Embedded() { m_rubyVM.reset(); }
+  Embedded::~Embedded()
+  {
+    if (m_threadPool)
+    {
+      m_threadPool->stop();
+      m_threadPool->join();
+      RubyVM::setThreadPool(nullptr);
+    }
+    m_pool.clear();
+    m_rubyVM.reset();
+  }
 }  // namespace mtconnect::ruby
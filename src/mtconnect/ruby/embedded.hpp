@@ -18,7 +18,9 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <boost/asio/thread_pool.hpp>
 
+#include <list>
 #include <memory>
 
 #include "mtconnect/config.hpp"
@@ -45,6 +47,8 @@ namespace mtconnect {
       ConfigOptions m_options;
       boost::asio::io_context *m_context = nullptr;
       std::unique_ptr<RubyVM> m_rubyVM;
+      std::list<std::unique_ptr<RubyVM>> m_pool;
+      std::unique_ptr<boost::asio::thread_pool> m_threadPool;
     };
   }  // namespace ruby
 }  // namespace mtconnect
@@ -65,21 +65,23 @@ namespace mtconnect::ruby {
               ts = toRuby(mrb, time);
             }
 
-            struct RClass *klass;
+            // Look up the class in this state, each VM in the pool has its own classes
+            const char *name = "Event";
             switch (dataItem->getCategory())
             {
               case DataItem::SAMPLE:
-                klass = m_sampleClass;
+                name = "Sample";
                 break;
 
               case DataItem::EVENT:
-                klass = m_eventClass;
+                name = "Event";
                 break;
 
               case DataItem::CONDITION:
-                klass = m_conditionClass;
+                name = "Condition";
                 break;
             }
+            auto klass = mrb_class_get_under(mrb, mrb_module_get(mrb, "MTConnect"), name);
 
             mrb_value args[] = {di, props, ts};
             auto res = mrb_obj_new(mrb, klass, 3, args);
@@ -22,6 +22,7 @@
 #include "mtconnect/device_model/device.hpp"
 #include "mtconnect/entity/entity.hpp"
 #include "ruby_smart_ptr.hpp"
+#include "ruby_vm.hpp"
 
 namespace mtconnect::ruby {
   using namespace mtconnect;
@@ -31,6 +32,10 @@ namespace mtconnect::ruby {
 
   struct RubyPipeline
   {
+    /// @brief Replica VMs load the module to create their transforms, only the primary VM
+    /// changes the pipelines
+    static bool isReplica(mrb_state *mrb) { return RubyVM::vm(mrb).isReplica(); }
+
     static void initialize(mrb_state *mrb, RClass *module)
     {
       auto pipelineClass = mrb_define_class_under(mrb, module, "Pipeline", mrb->object_class);
@@ -68,6 +73,8 @@ namespace mtconnect::ruby {
 
             auto pipeline = MRubyPtr<Pipeline>::unwrap(self);
             mrb_get_args(mrb, "zo", &name, &trans);
+            if (isReplica(mrb))
+              return self;
             transform = MRubySharedPtr<Transform>::unwrap(mrb, trans);
             if (pipeline->spliceBefore(name, transform))
             {
@@ -91,6 +98,8 @@ namespace mtconnect::ruby {
 
             auto pipeline = MRubyPtr<Pipeline>::unwrap(self);
             mrb_get_args(mrb, "zo", &name, &trans);
+            if (isReplica(mrb))
+              return self;
             auto transform = MRubySharedPtr<Transform>::unwrap(mrb, trans);
             if (pipeline->spliceAfter(name, transform))
             {
@@ -114,6 +123,8 @@ namespace mtconnect::ruby {
 
             auto pipeline = MRubyPtr<Pipeline>::unwrap(self);
             mrb_get_args(mrb, "zo", &name, &trans);
+            if (isReplica(mrb))
+              return self;
             auto transform = MRubySharedPtr<Transform>::unwrap(mrb, trans);
             if (pipeline->firstAfter(name, transform))
             {
@@ -137,6 +148,8 @@ namespace mtconnect::ruby {
 
             auto pipeline = MRubyPtr<Pipeline>::unwrap(self);
             mrb_get_args(mrb, "zo", &name, &trans);
+            if (isReplica(mrb))
+              return self;
             auto transform = MRubySharedPtr<Transform>::unwrap(mrb, trans);
             if (pipeline->lastAfter(name, transform))
             {
@@ -159,6 +172,8 @@ namespace mtconnect::ruby {
 
             auto pipeline = MRubyPtr<Pipeline>::unwrap(self);
             mrb_get_args(mrb, "z", &name);
+            if (isReplica(mrb))
+              return self;
             if (!pipeline->remove(name))
             {
               LOG(error) << "Cannot remove " << name;
@@ -175,6 +190,8 @@ namespace mtconnect::ruby {
 
             auto pipeline = MRubyPtr<Pipeline>::unwrap(self);
             mrb_get_args(mrb, "zo", &name, &trans);
+            if (isReplica(mrb))
+              return self;
             auto transform = MRubySharedPtr<Transform>::unwrap(mrb, trans);
             if (pipeline->replace(name, transform))
             {
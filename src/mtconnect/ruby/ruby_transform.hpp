@@ -17,6 +17,18 @@
 
 #pragma once
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <optional>
+
 #include "mtconnect/config.hpp"
 #include "mtconnect/pipeline/guard.hpp"
 #include "mtconnect/pipeline/topic_mapper.hpp"
@@ -73,12 +85,7 @@ namespace mtconnect::ruby {
               guard = stringFromRuby(mrb, gv);
 
             auto trans = make_shared<RubyTransform>(mrb, self, name, guard);
-            if (mrb_block_given_p(mrb))
-            {
-              trans->m_block = block;
-              mrb_gc_register(mrb, block);
-            }
-            MRubySharedPtr<Transform>::replace(mrb, self, trans);
+            attach(mrb, self, trans, block);
 
             return self;
           },
@@ -91,7 +98,7 @@ namespace mtconnect::ruby {
 
             EntityPtr *ent;
             mrb_get_args(mrb, "d", &ent, MRubySharedPtr<Entity>::type());
-            auto nxt = trans->next(std::move(*ent));
+            auto nxt = trans->forward(std::move(*ent));
             return MRubySharedPtr<Entity>::wrap(mrb, "Entity", nxt);
           },
           MRB_ARGS_REQ(1));
@@ -153,6 +160,8 @@ namespace mtconnect::ruby {
 
     RubyTransform(mrb_state *mrb, mrb_value self, const std::string &name, const string &guard)
       : Transform(name),
+        m_vm(&RubyVM::vm(mrb)),
+        m_index(m_vm->nextTransformIndex(name)),
         m_self(self),
         m_method(mrb_intern_lit(mrb, "transform")),
         m_block(mrb_nil_value()),
@@ -164,10 +173,10 @@ namespace mtconnect::ruby {
 
     ~RubyTransform()
     {
-      std::lock_guard guard(RubyVM::rubyVM());
-      if (RubyVM::hasVM())
+      if (RubyVM::hasVM() && m_vm->state())
       {
-        auto mrb = RubyVM::rubyVM().state();
+        std::lock_guard guard(*m_vm);
+        auto mrb = m_vm->state();
 
         mrb_gc_unregister(mrb, m_self);
         m_self = mrb_nil_value();
@@ -180,8 +189,172 @@ namespace mtconnect::ruby {
       }
     }
 
+    /// @brief associate the transform with the ruby object and the optional block
+    static void attach(mrb_state *mrb, mrb_value self, std::shared_ptr<RubyTransform> trans,
+                       mrb_value block)
+    {
+      if (!mrb_nil_p(block))
+      {
+        trans->m_block = block;
+        mrb_gc_register(mrb, block);
+      }
+      MRubySharedPtr<Transform>::replace(mrb, self, trans);
+
+      auto &vm = RubyVM::vm(mrb);
+      if (vm.isReplica())
+        vm.addReplica(trans->getName(), trans->m_index, self);
+    }
+
+    /// @brief wrap the entity in the most specific ruby class
+    static mrb_value wrapEntity(mrb_state *mrb, const EntityPtr &entity)
+    {
+      const char *klass = "Entity";
+      Entity *ptr = entity.get();
+      if (auto obs = dynamic_cast<Observation *>(ptr); obs != nullptr)
+      {
+        switch (obs->getDataItem()->getCategory())
+        {
+          case device_model::data_item::DataItem::SAMPLE:
+            klass = "Sample";
+            break;
+          case device_model::data_item::DataItem::EVENT:
+            klass = "Event";
+            break;
+          case device_model::data_item::DataItem::CONDITION:
+            klass = "Condition";
+            break;
+        }
+      }
+      else if (dynamic_cast<pipeline::Timestamped *>(ptr) != nullptr)
+        klass = "Timestamped";
+      else if (dynamic_cast<pipeline::Tokens *>(ptr) != nullptr)
+        klass = "Tokens";
+
+      return MRubySharedPtr<Entity>::wrap(mrb, klass, entity);
+    }
+
     void setMethod(mrb_sym sym) { m_method = sym; }
 
+    /// @brief forward the entity to the next transforms
+    ///
+    /// A replica forwards to the transforms following the primary VM transform it is running for.
+    /// When the transform runs on the thread pool, the entity is handed back to the pipeline
+    /// strand and returned. The next transforms are never called from the thread pool, if the
+    /// pipeline has stopped the entity is dropped.
+    entity::EntityPtr forward(entity::EntityPtr &&entity)
+    {
+      auto trans = m_owner != nullptr ? m_owner : this;
+      if (trans->m_worker && trans->m_worker->running_in_this_thread())
+      {
+        if (auto strand = trans->m_strand.load())
+        {
+          boost::asio::post(*strand, [ptr = trans->getptr(), entity]() mutable {
+            ptr->next(std::move(entity));
+          });
+        }
+        else
+        {
+          LOG(debug) << "Pipeline stopped, dropping entity forwarded by " << trans->getName();
+        }
+        return entity;
+      }
+      else
+        return trans->next(std::move(entity));
+    }
+
+    /// @brief check if the transform runs on the ruby thread pool
+    bool isAsync() const { return m_worker && m_strand.load() != nullptr; }
+
+    void start(boost::asio::io_context::strand &st) override
+    {
+      if (auto pool = RubyVM::threadPool())
+      {
+        if (!m_worker)
+          m_worker.emplace(boost::asio::make_strand(*pool));
+        m_strand = &st;
+      }
+      Transform::start(st);
+    }
+
+    /// @brief stop running on the thread pool and wait for the scripts already queued
+    void stop() override
+    {
+      m_strand = nullptr;
+      if (m_worker && RubyVM::threadPool() != nullptr && !m_worker->running_in_this_thread())
+      {
+        auto drained = std::make_shared<std::promise<void>>();
+        auto done = drained->get_future();
+        boost::asio::post(*m_worker, [drained]() { drained->set_value(); });
+        if (done.wait_for(StopTimeout) != std::future_status::ready)
+          LOG(warning) << "Timed out waiting for " << getName() << " to finish on the thread pool";
+      }
+      Transform::stop();
+    }
+
+    /// @brief how long `stop()` waits for the scripts queued on the thread pool
+    static constexpr std::chrono::seconds StopTimeout {5};
+
+    /// @brief call `f` with a locked VM and the transform's object in that VM
+    ///
+    /// If there is a pool of VMs, the transform runs in the first idle VM that has a replica of
+    /// this transform, otherwise it runs in the VM that created it. Guard blocks always run in the
+    /// VM that created the transform.
+    ///
+    /// When a script forwards to this transform, the thread already holds a VM. The transform
+    /// runs in that VM if it can and never waits for a pool VM, otherwise it waits for the VM
+    /// that created it. A thread holding that VM runs everything in it, so two threads never
+    /// wait for each other's VM.
+    template <typename F>
+    auto dispatch(F &&f)
+    {
+      if (auto held = RubyVM::held(); held != nullptr)
+      {
+        if (auto target = targetIn(*held))
+        {
+          std::lock_guard guard(*held);
+          RubyVM::Hold hold(*held);
+          return f(held->state(), *target);
+        }
+      }
+      else if (!m_vm->isReplica() && RubyVM::poolSize() > 1)
+      {
+        auto &vm = RubyVM::acquire();
+        if (auto target = targetIn(vm))
+        {
+          std::lock_guard guard(vm, std::adopt_lock);
+          RubyVM::Hold hold(vm);
+          return f(vm.state(), *target);
+        }
+        vm.unlock();
+      }
+
+      std::lock_guard guard(*m_vm);
+      RubyVM::Hold hold(*m_vm);
+      return f(m_vm->state(), *this);
+    }
+
+    /// @brief find the object for this transform in a VM
+    /// @return this transform, its replica in the VM, or `nullptr` if the VM does not have it
+    RubyTransform *targetIn(RubyVM &vm)
+    {
+      if (&vm == m_vm)
+        return this;
+
+      if (!m_vm->isReplica())
+      {
+        if (auto replica = vm.replica(getName(), m_index))
+        {
+          auto target =
+              MRubySharedPtr<Transform>::unwrap<RubyTransform>(vm.state(), *replica).get();
+          if (target != nullptr)
+            target->m_owner = this;
+          return target;
+        }
+      }
+
+      return nullptr;
+    }
+
     void setGuard()
     {
       if (!mrb_nil_p(m_guardBlock))
@@ -189,9 +362,9 @@ namespace mtconnect::ruby {
         m_guard = [this, old = m_guard](const entity::Entity *entity) -> GuardAction {
           using namespace entity;
           using namespace observation;
-          std::lock_guard guard(RubyVM::rubyVM());
+          std::lock_guard guard(*m_vm);
 
-          auto mrb = RubyVM::rubyVM().state();
+          auto mrb = m_vm->state();
           int save = mrb_gc_arena_save(mrb);
 
           entity::EntityPtr ptr = entity->getptr();
@@ -251,109 +424,307 @@ namespace mtconnect::ruby {
 
     using calldata = pair<RubyTransform *, EntityPtr>;
 
+    /// @brief run the transform
+    ///
+    /// If there is a ruby thread pool and the pipeline has started, the script runs on a worker
+    /// and the entities it forwards are handed back to the pipeline strand. The transforms run on
+    /// their own strand in the pool, so entities are transformed in the order they arrive.
+    /// @return the transformed entity or `nullptr` if the transform runs on the thread pool
     entity::EntityPtr operator()(entity::EntityPtr &&entity) override
     {
-      NAMED_SCOPE("RubyTransform::operator()");
+      if (isAsync())
+      {
+        boost::asio::post(*m_worker, [trans = std::static_pointer_cast<RubyTransform>(getptr()),
+                                      entity = std::move(entity)]() mutable {
+          trans->call(std::move(entity));
+        });
+        return nullptr;
+      }
+      else
+        return call(std::move(entity));
+    }
+
+    /// @brief call the script with the entity on this thread
+    entity::EntityPtr call(entity::EntityPtr &&entity)
+    {
+      NAMED_SCOPE("RubyTransform::call");
 
       using namespace entity;
       using namespace observation;
 
-      EntityPtr res;
+      return dispatch([&entity](mrb_state *mrb, RubyTransform &trans) {
+        EntityPtr res;
+        int save = mrb_gc_arena_save(mrb);
 
-      std::lock_guard guard(RubyVM::rubyVM());
-      auto mrb = RubyVM::rubyVM().state();
-      int save = mrb_gc_arena_save(mrb);
-
-      try
-      {
-        mrb_value ev;
-        const char *klass = "Entity";
-        Entity *ptr = entity.get();
-        Observation *obs;
-        if (obs = dynamic_cast<Observation *>(ptr); obs != nullptr)
+        try
         {
-          switch (obs->getDataItem()->getCategory())
+          mrb_value ev = wrapEntity(mrb, entity);
+
+          mrb_bool state = false;
+          mrb_value rv = invoke(mrb, trans, ev, state);
+          if (state)
           {
-            case device_model::data_item::DataItem::SAMPLE:
-              klass = "Sample";
-              break;
-            case device_model::data_item::DataItem::EVENT:
-              klass = "Event";
-              break;
-            case device_model::data_item::DataItem::CONDITION:
-              klass = "Condition";
-              break;
+            // auto str = mrb_any_to_s(mrb, rv);
+            LOG(error) << "Error in transform: " << mrb_str_to_cstr(mrb, mrb_inspect(mrb, rv));
+            rv = mrb_nil_value();
           }
-        }
-        else if (dynamic_cast<pipeline::Timestamped *>(ptr) != nullptr)
-          klass = "Timestamped";
-        else if (dynamic_cast<pipeline::Tokens *>(ptr) != nullptr)
-          klass = "Tokens";
-
-        ev = MRubySharedPtr<Entity>::wrap(mrb, klass, entity);
-        mrb_value rv;
 
-        mrb_bool state = false;
-        if (!mrb_nil_p(m_block))
-        {
-          mrb_value values[] = {m_self, m_block, ev};
-          mrb_value data = mrb_ary_new_from_values(mrb, 3, values);
-          rv = mrb_protect(
-              mrb,
-              [](mrb_state *mrb, mrb_value data) {
-                mrb_value self = mrb_ary_ref(mrb, data, 0);
-                mrb_value block = mrb_ary_ref(mrb, data, 1);
-                mrb_value ev = mrb_ary_ref(mrb, data, 2);
-                return mrb_yield_with_class(mrb, block, 1, &ev, self, mrb_class(mrb, self));
-              },
-              data, &state);
+          if (!mrb_nil_p(rv))
+            res = MRubySharedPtr<Entity>::unwrap(rv);
         }
-        else
+        catch (std::exception e)
         {
-          mrb_value values[] = {m_self, mrb_symbol_value(m_method), ev};
-          mrb_value data = mrb_ary_new_from_values(mrb, 3, values);
-          rv = mrb_protect(
-              mrb,
-              [](mrb_state *mrb, mrb_value data) {
-                mrb_value self = mrb_ary_ref(mrb, data, 0);
-                mrb_sym method = mrb_symbol(mrb_ary_ref(mrb, data, 1));
-                mrb_value ev = mrb_ary_ref(mrb, data, 2);
-                return mrb_funcall_id(mrb, self, method, 1, ev);
-              },
-              data, &state);
+          LOG(error) << "Exception thrown in transform" << e.what();
         }
-        if (state)
+        catch (...)
         {
-          // auto str = mrb_any_to_s(mrb, rv);
-          LOG(error) << "Error in transform: " << mrb_str_to_cstr(mrb, mrb_inspect(mrb, rv));
-          rv = mrb_nil_value();
+          LOG(error) << "Unknown Exception thrown in transform";
         }
 
-        if (!mrb_nil_p(rv))
-          res = MRubySharedPtr<Entity>::unwrap(rv);
-      }
-      catch (std::exception e)
+        mrb_gc_arena_restore(mrb, save);
+        return res;
+      });
+    }
+
+    auto &object() { return m_self; }
+    void setObject(mrb_value obj) { m_self = obj; }
+
+  protected:
+    /// @brief call the block or method of the transform with the argument
+    /// @param[out] state `true` if an exception was raised
+    static mrb_value invoke(mrb_state *mrb, RubyTransform &trans, mrb_value arg, mrb_bool &state)
+    {
+      if (!mrb_nil_p(trans.m_block))
       {
-        LOG(error) << "Exception thrown in transform" << e.what();
+        mrb_value values[] = {trans.m_self, trans.m_block, arg};
+        mrb_value data = mrb_ary_new_from_values(mrb, 3, values);
+        return mrb_protect(
+            mrb,
+            [](mrb_state *mrb, mrb_value data) {
+              mrb_value self = mrb_ary_ref(mrb, data, 0);
+              mrb_value block = mrb_ary_ref(mrb, data, 1);
+              mrb_value ev = mrb_ary_ref(mrb, data, 2);
+              return mrb_yield_with_class(mrb, block, 1, &ev, self, mrb_class(mrb, self));
+            },
+            data, &state);
       }
-      catch (...)
+      else
       {
-        LOG(error) << "Unknown Exception thrown in transform";
+        mrb_value values[] = {trans.m_self, mrb_symbol_value(trans.m_method), arg};
+        mrb_value data = mrb_ary_new_from_values(mrb, 3, values);
+        return mrb_protect(
+            mrb,
+            [](mrb_state *mrb, mrb_value data) {
+              mrb_value self = mrb_ary_ref(mrb, data, 0);
+              mrb_sym method = mrb_symbol(mrb_ary_ref(mrb, data, 1));
+              mrb_value ev = mrb_ary_ref(mrb, data, 2);
+              return mrb_funcall_id(mrb, self, method, 1, ev);
+            },
+            data, &state);
       }
-
-      mrb_gc_arena_restore(mrb, save);
-      return res;
     }
 
-    auto &object() { return m_self; }
-    void setObject(mrb_value obj) { m_self = obj; }
-
   protected:
     PipelineContract *m_contract;
+    std::atomic<boost::asio::io_context::strand *> m_strand {nullptr};
+    std::optional<boost::asio::strand<boost::asio::thread_pool::executor_type>> m_worker;
+    RubyVM *m_vm;
+    size_t m_index;
+    RubyTransform *m_owner = nullptr;
     mrb_value m_self;
     mrb_sym m_method;
     mrb_value m_block;
     std::string m_guardString;
     mrb_value m_guardBlock;
   };
+
+  /// @brief A ruby transform that is called with batches of entities
+  ///
+  /// Entities are collected until the batch is full or the period has passed since the first
+  /// entity was added. The block or `transform_batch` method is then called once with an array of
+  /// the entities, and the entities in the returned array are forwarded. This converts the entities
+  /// and calls into the VM once per batch instead of once per entity.
+  ///
+  /// The period is only used after the pipeline is started, before then batches are only sent when
+  /// they are full.
+  class AGENT_LIB_API RubyBatchTransform : public RubyTransform
+  {
+  public:
+    static void initialize(mrb_state *mrb, RClass *module)
+    {
+      auto rubyTrans = mrb_class_get_under(mrb, module, "RubyTransform");
+      auto batchTrans = mrb_define_class_under(mrb, module, "RubyBatchTransform", rubyTrans);
+      MRB_SET_INSTANCE_TT(batchTrans, MRB_TT_DATA);
+
+      mrb_define_method(
+          mrb, batchTrans, "initialize",
+          [](mrb_state *mrb, mrb_value self) {
+            const char *name;
+            mrb_value gv = mrb_nil_value(), block = mrb_nil_value();
+            mrb_int size = 100, period = 100;
+            string guard;
+
+            auto c = mrb_get_args(mrb, "z|oii&", &name, &gv, &size, &period, &block);
+            if (c == 1 || mrb_nil_p(gv))
+              guard = "Entity";
+            else
+              guard = stringFromRuby(mrb, gv);
+
+            auto trans = make_shared<RubyBatchTransform>(mrb, self, name, guard, size,
+                                                         std::chrono::milliseconds(period));
+            attach(mrb, self, trans, block);
+
+            return self;
+          },
+          MRB_ARGS_ARG(1, 3) | MRB_ARGS_BLOCK());
+    }
+
+    /// @brief Create a batch transform
+    /// @param[in] size the maximum number of entities in a batch
+    /// @param[in] period the longest time an entity waits for the batch to be sent
+    RubyBatchTransform(mrb_state *mrb, mrb_value self, const std::string &name,
+                       const string &guard, size_t size, std::chrono::milliseconds period)
+      : RubyTransform(mrb, self, name, guard), m_size(std::max<size_t>(size, 1)), m_period(period)
+    {
+      setMethod(mrb_intern_lit(mrb, "transform_batch"));
+    }
+
+    ~RubyBatchTransform()
+    {
+      if (m_timer)
+        m_timer->cancel();
+    }
+
+    void start(boost::asio::io_context::strand &st) override
+    {
+      {
+        std::lock_guard lock(m_batchMutex);
+        m_timerStrand = &st;
+      }
+      RubyTransform::start(st);
+    }
+
+    void stop() override
+    {
+      {
+        std::lock_guard lock(m_batchMutex);
+        if (m_timer)
+          m_timer->cancel();
+        m_timerStrand = nullptr;
+      }
+      RubyTransform::stop();
+    }
+
+    entity::EntityPtr operator()(entity::EntityPtr &&entity) override
+    {
+      bool full = false;
+      {
+        std::lock_guard lock(m_batchMutex);
+        m_batch.emplace_back(std::move(entity));
+        if (m_batch.size() >= m_size)
+          full = true;
+        else if (m_batch.size() == 1)
+          schedule();
+      }
+
+      if (full)
+        flush();
+
+      return nullptr;
+    }
+
+    /// @brief send the entities collected so far to the script
+    ///
+    /// The script runs on the thread pool if the transform is asynchronous.
+    void flush()
+    {
+      EntityList batch;
+      {
+        std::lock_guard lock(m_batchMutex);
+        batch.swap(m_batch);
+        if (m_timer)
+          m_timer->cancel();
+      }
+      if (batch.empty())
+        return;
+
+      if (isAsync())
+      {
+        boost::asio::post(*m_worker,
+                          [trans = std::static_pointer_cast<RubyBatchTransform>(getptr()),
+                           batch = std::move(batch)]() mutable { trans->callBatch(batch); });
+      }
+      else
+        callBatch(batch);
+    }
+
+  protected:
+    // Call the script with the batch and forward the results
+    void callBatch(EntityList &batch)
+    {
+      NAMED_SCOPE("RubyBatchTransform::callBatch");
+
+      auto results = dispatch([&batch](mrb_state *mrb, RubyTransform &trans) {
+        EntityList res;
+        int save = mrb_gc_arena_save(mrb);
+
+        mrb_value ary = mrb_ary_new_capa(mrb, batch.size());
+        for (auto &entity : batch)
+          mrb_ary_push(mrb, ary, wrapEntity(mrb, entity));
+
+        mrb_bool state = false;
+        mrb_value rv = invoke(mrb, trans, ary, state);
+        if (state)
+        {
+          LOG(error) << "Error in batch transform: "
+                     << mrb_str_to_cstr(mrb, mrb_inspect(mrb, rv));
+        }
+        else if (mrb_array_p(rv))
+        {
+          for (mrb_int i = 0; i < RARRAY_LEN(rv); i++)
+          {
+            auto value = mrb_ary_ref(mrb, rv, i);
+            if (!mrb_nil_p(value))
+            {
+              if (auto entity = MRubySharedPtr<Entity>::unwrap(mrb, value))
+                res.emplace_back(entity);
+            }
+          }
+        }
+
+        mrb_gc_arena_restore(mrb, save);
+        return res;
+      });
+
+      for (auto &entity : results)
+        forward(std::move(entity));
+    }
+
+    // Send the batch when the period expires, must be called with the batch mutex held
+    void schedule()
+    {
+      if (m_timerStrand == nullptr || m_period.count() <= 0)
+        return;
+
+      if (!m_timer)
+        m_timer.emplace(m_timerStrand->context());
+      m_timer->expires_after(m_period);
+      m_timer->async_wait(boost::asio::bind_executor(
+          *m_timerStrand, [weak = std::weak_ptr<Transform>(getptr())](boost::system::error_code ec) {
+            if (!ec)
+            {
+              if (auto trans = weak.lock())
+                std::static_pointer_cast<RubyBatchTransform>(trans)->flush();
+            }
+          }));
+    }
+
+  protected:
+    size_t m_size;
+    std::chrono::milliseconds m_period;
+    std::mutex m_batchMutex;
+    EntityList m_batch;
+    boost::asio::io_context::strand *m_timerStrand = nullptr;
+    std::optional<boost::asio::steady_timer> m_timer;
+  };
 }  // namespace mtconnect::ruby
@@ -17,13 +17,31 @@
 
 #pragma once
 
+#include <boost/asio/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "mtconnect/config.hpp"
 
 namespace mtconnect::ruby {
+  /// @brief An mruby interpreter
+  ///
+  /// The primary VM loads the module and modifies the pipelines. Additional VMs can be added to a
+  /// pool, they load the same module to create replicas of the transforms so transforms from
+  /// different sources can run at the same time. Each VM has its own lock.
   class AGENT_LIB_API RubyVM
   {
   public:
-    RubyVM()
+    /// @brief Create an mruby VM
+    /// @param[in] replica `true` if this VM only holds replicas of the primary VM's transforms
+    RubyVM(bool replica = false) : m_replica(replica)
     {
       m_mrb = mrb_open();
       if (!m_mrb)
@@ -31,35 +49,136 @@ namespace mtconnect::ruby {
         /* handle error */
         throw std::runtime_error("Cannot start mrb");
       }
+      m_mrb->ud = this;
 
       createModule();
       defineLogger();
 
-      m_vm = this;
+      if (!m_replica)
+        m_vm = this;
     }
 
     ~RubyVM()
     {
-      m_vm = nullptr;
+      if (m_vm == this)
+        m_vm = nullptr;
+      m_pool.erase(std::remove(m_pool.begin(), m_pool.end(), this), m_pool.end());
+
       std::lock_guard guard(m_mutex);
       if (m_mrb)
       {
-        mrb_close(m_mrb);
+        // Clear the state first so objects freed while closing do not reference the VM
+        auto mrb = m_mrb;
+        m_mrb = nullptr;
+        mrb_close(mrb);
       }
     }
 
     auto state() { return m_mrb; }
     auto mtconnect() { return m_module; }
+    bool isReplica() const { return m_replica; }
 
     void lock() { m_mutex.lock(); }
     void unlock() { m_mutex.unlock(); }
-    void try_lock() { m_mutex.try_lock(); }
+    bool try_lock() { return m_mutex.try_lock(); }
 
     static auto &rubyVM() { return *m_vm; }
     static bool hasVM() { return m_vm != nullptr; }
+    /// @brief get the VM that owns the mruby state
+    static auto &vm(mrb_state *mrb) { return *static_cast<RubyVM *>(mrb->ud); }
+
+    /// @name VM Pool
+    ///@{
+
+    /// @brief add a VM to the pool used to run transforms
+    static void addToPool(RubyVM *vm) { m_pool.push_back(vm); }
+    /// @brief get the number of VMs in the pool
+    static size_t poolSize() { return m_pool.size(); }
+    /// @brief lock a VM from the pool
+    ///
+    /// Takes the first VM that is not in use, starting from the next in turn. If all are in use,
+    /// waits for the VM that was next in turn.
+    /// @return the locked VM, the caller must unlock it
+    static RubyVM &acquire()
+    {
+      auto start = m_next++;
+      for (size_t i = 0; i < m_pool.size(); i++)
+      {
+        auto vm = m_pool[(start + i) % m_pool.size()];
+        if (vm->try_lock())
+          return *vm;
+      }
+
+      auto vm = m_pool[start % m_pool.size()];
+      vm->lock();
+      return *vm;
+    }
+    ///@}
+
+    /// @name Held VM
+    ///@{
+
+    /// @brief get the VM the calling thread is running a script in
+    /// @return the VM or `nullptr` if the thread is not running a script
+    static RubyVM *held();
+    /// @brief mark the VM as the one the calling thread is running a script in
+    /// @param[in] vm the locked VM or `nullptr`
+    static void setHeld(RubyVM *vm);
+
+    /// @brief marks a locked VM as held by this thread until it goes out of scope
+    class Hold
+    {
+    public:
+      Hold(RubyVM &vm) : m_previous(held()) { setHeld(&vm); }
+      ~Hold() { setHeld(m_previous); }
+
+    protected:
+      RubyVM *m_previous;
+    };
+    ///@}
+
+    /// @brief set the threads that run the transforms
+    /// @param[in] pool the thread pool or `nullptr` to run transforms on the pipeline strands
+    static void setThreadPool(boost::asio::thread_pool *pool) { m_threadPool = pool; }
+    /// @brief get the threads that run the transforms
+    /// @return the thread pool or `nullptr` if transforms run on the pipeline strands
+    static auto threadPool() { return m_threadPool; }
+
+    /// @name Transform Replicas
+    ///@{
+
+    /// @brief get the ordinal of a new transform with the name
+    ///
+    /// Transforms created in the same order by the module have the same name and ordinal in every
+    /// VM.
+    size_t nextTransformIndex(const std::string &name) { return m_transformCount[name]++; }
+    /// @brief keep a transform created while loading the module in a replica VM
+    void addReplica(const std::string &name, size_t index, mrb_value self)
+    {
+      mrb_gc_register(m_mrb, self);
+      m_replicas.insert_or_assign({name, index}, self);
+    }
+    /// @brief find the replica of a primary VM transform
+    /// @return the replica object or `nullopt` if it was not created in this VM
+    std::optional<mrb_value> replica(const std::string &name, size_t index) const
+    {
+      auto it = m_replicas.find({name, index});
+      if (it != m_replicas.end())
+        return it->second;
+      else
+        return std::nullopt;
+    }
+    ///@}
 
   protected:
-    void createModule() { m_module = mrb_define_module(m_mrb, "MTConnect"); }
+    void createModule()
+    {
+      m_module = mrb_define_module(m_mrb, "MTConnect");
+      mrb_define_module_function(
+          m_mrb, m_module, "replica?",
+          [](mrb_state *mrb, mrb_value self) { return mrb_bool_value(vm(mrb).isReplica()); },
+          MRB_ARGS_NONE());
+    }
 
     template <typename L>
     static inline void log(L level, mrb_state *mrb)
@@ -123,7 +242,14 @@ namespace mtconnect::ruby {
     Agent *m_agent;
     RClass *m_module = nullptr;
     mrb_state *m_mrb = nullptr;
-    static std::recursive_mutex m_mutex;
+    bool m_replica;
+    std::recursive_mutex m_mutex;
+    std::map<std::string, size_t> m_transformCount;
+    std::map<std::pair<std::string, size_t>, mrb_value> m_replicas;
+
     static RubyVM *m_vm;
+    static std::vector<RubyVM *> m_pool;
+    static std::atomic_size_t m_next;
+    static boost::asio::thread_pool *m_threadPool;
   };
 }  // namespace mtconnect::ruby
@@ -54,12 +54,6 @@ namespace mtconnect {
         // Unique id number for agent instance
         m_instanceId = getCurrentTimeInSec();
 
-        auto jsonPrinter = dynamic_cast<printer::JsonPrinter *>(m_sinkContract->getPrinter("json"));
-
-        m_jsonPrinter = make_unique<entity::JsonEntityPrinter>(jsonPrinter->getJsonVersion());
-
-        m_printer = std::make_unique<printer::JsonPrinter>(jsonPrinter->getJsonVersion());
-
         GetOptions(config, m_options, options);
         AddOptions(config, m_options,
                    {{configuration::ProbeTopic, string()},
@@ -68,7 +62,14 @@ namespace mtconnect {
                     {configuration::MqttCert, string()},
                     {configuration::MqttClientId, string()},
                     {configuration::MqttUserName, string()},
-                    {configuration::MqttPassword, string()}});
+                    {configuration::MqttPassword, string()},
+                    {configuration::MqttQueueFile, string()}});
+
+        // Only set when configured, the client keeps the session if there is a client id
+        if (auto clean = config.get_optional<string>(configuration::MqttCleanSession))
+          m_options.insert_or_assign(configuration::MqttCleanSession,
+                                     ConvertOption(*clean, false, m_options));
+
         AddDefaultedOptions(
             config, m_options,
             {{configuration::MqttHost, "127.0.0.1"s},
@@ -77,11 +78,26 @@ namespace mtconnect {
              {configuration::MqttLastWillTopic, "MTConnect/Probe/[device]/Availability"s},
              {configuration::CurrentTopic, "MTConnect/Current/[device]"s},
              {configuration::SampleTopic, "MTConnect/Sample/[device]"s},
+             {configuration::MqttFormat, "json"s},
              {configuration::MqttCurrentInterval, 10000ms},
              {configuration::MqttSampleInterval, 500ms},
              {configuration::MqttSampleCount, 1000},
              {configuration::MqttPort, 1883},
-             {configuration::MqttTls, false}});
+             {configuration::MqttTls, false},
+             {configuration::MqttQueueSize, 1024 * 1024},
+             {configuration::MqttQueueFileSize, 64 * 1024 * 1024},
+             {configuration::MqttMaxInflight, 16}});
+
+        auto format = get<string>(m_options[configuration::MqttFormat]);
+        auto encoding = printer::ParseBinaryEncoding(format);
+        if (!encoding && format != "json")
+          LOG(warning) << "Mqtt2Service: Unknown MqttFormat: " << format << ", using json";
+
+        auto jsonPrinter = dynamic_cast<printer::JsonPrinter *>(m_sinkContract->getPrinter("json"));
+        m_jsonPrinter = make_unique<entity::JsonEntityPrinter>(jsonPrinter->getJsonVersion(),
+                                                               false, false, encoding);
+        m_printer =
+            std::make_unique<printer::JsonPrinter>(jsonPrinter->getJsonVersion(), false, encoding);
 
         int maxTopicDepth {GetOption<int>(options, configuration::MqttMaxTopicDepth).value_or(7)};
 
@@ -186,6 +202,11 @@ namespace mtconnect {
         }
 
         auto seq = m_sinkContract->getCircularBuffer().getSequence();
+        {
+          // Publish the current for every device since the retained documents may be missing
+          std::lock_guard<buffer::CircularBuffer> lock(m_sinkContract->getCircularBuffer());
+          m_publishedSequence.clear();
+        }
         for (auto &dev : m_sinkContract->getDevices())
         {
           FilterSet filterSet = filterForDevice(dev);
@@ -218,12 +239,13 @@ namespace mtconnect {
 
         {
           auto &buffer = m_sinkContract->getCircularBuffer();
-          std::lock_guard<buffer::CircularBuffer> lock(buffer);
+          auto range = buffer.getScanRange(m_sampleCount, sampler->getSequence(), nullopt);
+          firstSeq = range.m_firstSeq;
+          lastSeq = range.m_sequence - 1;
 
-          lastSeq = buffer.getSequence() - 1;
+          // Scan without holding the lock so observations can be added during large scans
           observations =
-              buffer.getObservations(m_sampleCount, sampler->getFilter(), sampler->getSequence(),
-                                     nullopt, end, firstSeq, observer->m_endOfBuffer);
+              buffer.getObservations(range, sampler->getFilter(), end, observer->m_endOfBuffer);
         }
 
         doc = m_printer->printSample(m_instanceId,
@@ -260,23 +282,33 @@ namespace mtconnect {
 
         for (auto &device : m_sinkContract->getDevices())
         {
-          auto topic = formatTopic(m_currentTopic, device);
-          LOG(debug) << "Publishing current for: " << topic;
-
+          const auto &uuid = *(device->getUuid());
           ObservationList observations;
           SequenceNumber_t firstSeq, seq;
-          auto filterSet = filterForDevice(device);
 
           {
             auto &buffer = m_sinkContract->getCircularBuffer();
             std::lock_guard<buffer::CircularBuffer> lock(buffer);
 
+            // Skip the device if nothing has changed since its current was published
+            SequenceNumber_t changed {0};
+            auto last = m_deviceSequence.find(uuid);
+            if (last != m_deviceSequence.end())
+              changed = last->second;
+            auto published = m_publishedSequence.find(uuid);
+            if (published != m_publishedSequence.end() && published->second >= changed)
+              continue;
+            m_publishedSequence[uuid] = changed;
+
             firstSeq = buffer.getFirstSequence();
             seq = buffer.getSequence();
-            m_sinkContract->getCircularBuffer().getLatest().getObservations(observations,
-                                                                            filterSet);
+            m_sinkContract->getCircularBuffer().getLatest().getObservations(
+                observations, filterForDevice(device));
           }
 
+          auto topic = formatTopic(m_currentTopic, device);
+          LOG(debug) << "Publishing current for: " << topic;
+
           auto doc = m_printer->printSample(m_instanceId,
                                             m_sinkContract->getCircularBuffer().getBufferSize(),
                                             seq, firstSeq, seq - 1, observations);
@@ -292,13 +324,30 @@ namespace mtconnect {
 
       bool Mqtt2Service::publish(observation::ObservationPtr &observation)
       {
-        // Since we are doing periodic publishing, there is nothing to do here.
+        // Called with the circular buffer locked. Only note which device changed, the
+        // observations are published periodically.
+        if (observation->isOrphan())
+          return true;
+
+        auto component = observation->getDataItem()->getComponent();
+        if (component)
+        {
+          auto device = component->getDevice();
+          if (device)
+            m_deviceSequence[*(device->getUuid())] = observation->getSequence();
+        }
+
         return true;
       }
 
       bool Mqtt2Service::publish(device_model::DevicePtr device)
       {
         m_filters.clear();
+        {
+          // The device model changed, publish the device's current on the next interval
+          std::lock_guard<buffer::CircularBuffer> lock(m_sinkContract->getCircularBuffer());
+          m_publishedSequence.erase(*(device->getUuid()));
+        }
 
         auto topic = formatTopic(m_deviceTopic, device);
         auto doc = m_jsonPrinter->print(device);
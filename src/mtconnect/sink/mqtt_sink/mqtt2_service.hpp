@@ -21,6 +21,7 @@
 #include <boost/dll/alias.hpp>
 
 #include <nlohmann/json.hpp>
+#include <unordered_map>
 
 #include "mtconnect/buffer/checkpoint.hpp"
 #include "mtconnect/config.hpp"
@@ -76,7 +77,9 @@ namespace mtconnect {
 
         /// @brief Receive an observation
         ///
-        /// This does nothing since we are periodically publishing current and samples
+        /// Records the sequence of the device's latest observation so unchanged devices are not
+        /// published on the next current interval. Samples and currents are published
+        /// periodically.
         ///
         /// @param observation shared pointer to the observation
         /// @return `true` if the publishing was successful
@@ -96,6 +99,9 @@ namespace mtconnect {
         void pubishInitialContent();
 
         /// @brief Publish a current using `CurrentInterval` option.
+        ///
+        /// Only devices that have new observations since their current was last published are
+        /// published. The current documents are retained by the broker.
         void publishCurrent(boost::system::error_code ec);
 
         /// @brief publish sample when observations arrive.
@@ -198,6 +204,12 @@ namespace mtconnect {
         int m_sampleCount;  //! Timer for current requests
 
         std::map<std::string, FilterSet> m_filters;
+
+        // Guarded by the circular buffer lock
+        std::unordered_map<std::string, SequenceNumber_t>
+            m_deviceSequence;  //! Sequence of the latest observation for each device
+        std::unordered_map<std::string, SequenceNumber_t>
+            m_publishedSequence;  //! Device sequence when the current was last published
         std::map<std::string, std::shared_ptr<AsyncSample>> m_samplers;
       };
     }  // namespace mqtt_sink
@@ -17,6 +17,8 @@
 
 #include "mqtt_service.hpp"
 
+#include <boost/asio/bind_executor.hpp>
+
 #include "mtconnect/configuration/config_options.hpp"
 #include "mtconnect/entity/entity.hpp"
 #include "mtconnect/entity/factory.hpp"
@@ -41,11 +43,12 @@ namespace mtconnect {
 
       MqttService::MqttService(boost::asio::io_context &context, sink::SinkContractPtr &&contract,
                                const ConfigOptions &options, const ptree &config)
-        : Sink("MqttService", std::move(contract)), m_context(context), m_options(options)
+        : Sink("MqttService", std::move(contract)),
+          m_context(context),
+          m_options(options),
+          m_batchStrand(context),
+          m_batchTimer(context)
       {
-        auto jsonPrinter = dynamic_cast<printer::JsonPrinter *>(m_sinkContract->getPrinter("json"));
-        m_jsonPrinter = make_unique<entity::JsonEntityPrinter>(jsonPrinter->getJsonVersion());
-
         GetOptions(config, m_options, options);
         AddOptions(config, m_options,
                    {{configuration::ProbeTopic, string()},
@@ -54,14 +57,77 @@ namespace mtconnect {
                     {configuration::MqttCert, string()},
                     {configuration::MqttUserName, string()},
                     {configuration::MqttPassword, string()},
-                    {configuration::MqttClientId, string()}});
+                    {configuration::MqttClientId, string()},
+                    {configuration::MqttQueueFile, string()}});
+
+        // Only set when configured, the client keeps the session if there is a client id
+        if (auto clean = config.get_optional<string>(configuration::MqttCleanSession))
+          m_options.insert_or_assign(configuration::MqttCleanSession,
+                                     ConvertOption(*clean, false, m_options));
+
         AddDefaultedOptions(config, m_options,
                             {{configuration::MqttHost, "127.0.0.1"s},
                              {configuration::DeviceTopic, "MTConnect/Device/"s},
                              {configuration::AssetTopic, "MTConnect/Asset/"s},
                              {configuration::ObservationTopic, "MTConnect/Observation/"s},
                              {configuration::MqttPort, 1883},
-                             {configuration::MqttTls, false}});
+                             {configuration::MqttTls, false},
+                             {configuration::PublishQueueSize, 1024},
+                             {configuration::PublishQueueOverflow, "coalesce"s},
+                             {configuration::MqttFormat, "json"s},
+                             {configuration::MqttBatchInterval, 0ms},
+                             {configuration::MqttBatchHistory, false},
+                             {configuration::MqttSampleQoS, 1},
+                             {configuration::MqttEventQoS, 1},
+                             {configuration::MqttConditionQoS, 1},
+                             {configuration::MqttSampleRetain, true},
+                             {configuration::MqttEventRetain, true},
+                             {configuration::MqttConditionRetain, true},
+                             {configuration::MqttQueueSize, 1024 * 1024},
+                             {configuration::MqttQueueFileSize, 64 * 1024 * 1024},
+                             {configuration::MqttMaxInflight, 16}});
+
+        auto format = get<string>(m_options[configuration::MqttFormat]);
+        auto encoding = printer::ParseBinaryEncoding(format);
+        if (!encoding && format != "json")
+          LOG(warning) << "MqttService: Unknown MqttFormat: " << format << ", using json";
+        auto jsonPrinter = dynamic_cast<printer::JsonPrinter *>(m_sinkContract->getPrinter("json"));
+        m_jsonPrinter = make_unique<entity::JsonEntityPrinter>(jsonPrinter->getJsonVersion(),
+                                                               false, false, encoding);
+
+        auto makeSettings = [this](const std::string &qosOption, const std::string &retainOption) {
+          PublishSettings settings;
+          auto qos = get<int>(m_options[qosOption]);
+          if (qos < 0 || qos > 2)
+          {
+            LOG(warning) << "MqttService: " << qosOption << " must be 0, 1, or 2, using 1";
+            qos = 1;
+          }
+          settings.m_qos = static_cast<MqttQoS>(qos);
+          settings.m_retain = IsOptionSet(m_options, retainOption);
+          return settings;
+        };
+        m_sampleSettings =
+            makeSettings(configuration::MqttSampleQoS, configuration::MqttSampleRetain);
+        m_eventSettings =
+            makeSettings(configuration::MqttEventQoS, configuration::MqttEventRetain);
+        m_conditionSettings =
+            makeSettings(configuration::MqttConditionQoS, configuration::MqttConditionRetain);
+
+        m_batchInterval = get<Milliseconds>(m_options[configuration::MqttBatchInterval]);
+        m_batchHistory = IsOptionSet(m_options, configuration::MqttBatchHistory);
+
+        auto overflowText = get<string>(m_options[configuration::PublishQueueOverflow]);
+        auto overflow = PublishQueue::parseOverflow(overflowText);
+        if (!overflow)
+        {
+          LOG(warning) << "MqttService: Unknown PublishQueueOverflow: " << overflowText
+                       << ", using coalesce";
+          overflow = PublishQueue::Overflow::COALESCE;
+        }
+        m_publishQueue = make_shared<PublishQueue>(
+            m_context, [this](observation::ObservationPtr &obs) { publishObservation(obs); },
+            get<int>(m_options[configuration::PublishQueueSize]), *overflow);
 
         auto clientHandler = make_unique<ClientHandler>();
         clientHandler->m_connected = [this](shared_ptr<MqttClient> client) {
@@ -70,6 +136,14 @@ namespace mtconnect {
           std::lock_guard<buffer::CircularBuffer> lock(circ);
           client->connectComplete();
 
+          // The latest observations replace anything waiting to be published
+          m_publishQueue->clear();
+          {
+            std::lock_guard<std::mutex> batchLock(m_batchMutex);
+            m_batch.clear();
+            m_batchOrder.clear();
+          }
+
           for (auto &dev : m_sinkContract->getDevices())
           {
             publish(dev);
@@ -79,7 +153,7 @@ namespace mtconnect {
           for (auto &obs : obsList)
           {
             observation::ObservationPtr p {obs.second};
-            publish(p);
+            publishObservation(p);
           }
 
           AssetList list;
@@ -116,6 +190,12 @@ namespace mtconnect {
 
       void MqttService::stop()
       {
+        {
+          std::lock_guard<std::mutex> lock(m_batchMutex);
+          m_batchTimer.cancel();
+          m_batchScheduled = false;
+        }
+
         // stop client side
         if (m_client)
           m_client->stop();
@@ -129,26 +209,117 @@ namespace mtconnect {
         if (observation->isOrphan())
           return false;
 
+        // Called with the circular buffer locked, format and send on the queue's strand
+        m_publishQueue->push(observation);
+        return true;
+      }
+
+      void MqttService::publishObservation(observation::ObservationPtr &observation)
+      {
+        if (observation->isOrphan())
+          return;
+
         DataItemPtr dataItem = observation->getDataItem();
 
         auto topic = m_observationPrefix + dataItem->getTopic();  // client asyn topic
-        auto content = dataItem->getTopicName();                  // client asyn content
 
+        if (m_batchInterval.count() > 0)
+        {
+          batchObservation(topic, observation);
+          return;
+        }
+
+        auto doc = formatObservation(observation);
+        auto &settings = getSettings(dataItem);
+        if (m_client)
+          m_client->publish(topic, doc, settings.m_qos, settings.m_retain);
+      }
+
+      std::string MqttService::formatObservation(const observation::ObservationPtr &observation)
+      {
         // We may want to use the observation from the checkpoint.
-        string doc;
         if (observation->getDataItem()->isCondition())
+          return m_jsonPrinter->print(observation);
+        else
+          return m_jsonPrinter->printEntity(observation);
+      }
+
+      const MqttService::PublishSettings &MqttService::getSettings(
+          const DataItemPtr &dataItem) const
+      {
+        if (dataItem->isCondition())
+          return m_conditionSettings;
+        else if (dataItem->isSample())
+          return m_sampleSettings;
+        else
+          return m_eventSettings;
+      }
+
+      void MqttService::batchObservation(const std::string &topic,
+                                         observation::ObservationPtr &observation)
+      {
+        std::lock_guard<std::mutex> lock(m_batchMutex);
+
+        auto &list = m_batch[topic];
+        if (list.empty())
+          m_batchOrder.emplace_back(topic);
+
+        // Only the latest value is needed unless the history was requested. Every condition
+        // observation is kept since each one may refer to a different active condition.
+        if (!m_batchHistory && !observation->getDataItem()->isCondition())
+          list.clear();
+        list.emplace_back(observation);
+
+        if (!m_batchScheduled)
         {
-          doc = m_jsonPrinter->print(observation);
+          m_batchScheduled = true;
+          m_batchTimer.expires_after(m_batchInterval);
+          m_batchTimer.async_wait(
+              asio::bind_executor(m_batchStrand, [this](boost::system::error_code ec) {
+                if (!ec)
+                  flushBatch();
+              }));
         }
-        else
+      }
+
+      void MqttService::flushBatch()
+      {
+        NAMED_SCOPE("MqttService::flushBatch");
+
+        decltype(m_batch) batch;
+        decltype(m_batchOrder) order;
         {
-          doc = m_jsonPrinter->printEntity(observation);
+          std::lock_guard<std::mutex> lock(m_batchMutex);
+          batch.swap(m_batch);
+          order.swap(m_batchOrder);
+          m_batchScheduled = false;
         }
 
-        if (m_client)
-          m_client->publish(topic, doc);
+        if (!m_client)
+          return;
 
-        return true;
+        for (auto &topic : order)
+        {
+          auto &list = batch[topic];
+          if (list.empty())
+            continue;
+
+          auto &settings = getSettings(list.front()->getDataItem());
+          if (m_batchHistory)
+          {
+            std::vector<string> docs;
+            docs.reserve(list.size());
+            for (auto &obs : list)
+              docs.emplace_back(formatObservation(obs));
+            m_client->publish(topic, m_jsonPrinter->printArray(docs), settings.m_qos,
+                              settings.m_retain);
+          }
+          else
+          {
+            for (auto &obs : list)
+              m_client->publish(topic, formatObservation(obs), settings.m_qos, settings.m_retain);
+          }
+        }
       }
 
       bool MqttService::publish(device_model::DevicePtr device)
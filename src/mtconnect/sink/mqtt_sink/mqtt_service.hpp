@@ -18,8 +18,14 @@
 #pragma once
 
 #include "boost/asio/io_context.hpp"
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/dll/alias.hpp>
 
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include "mtconnect/buffer/checkpoint.hpp"
 #include "mtconnect/config.hpp"
 #include "mtconnect/configuration/agent_config.hpp"
@@ -28,6 +34,7 @@
 #include "mtconnect/observation/observation.hpp"
 #include "mtconnect/printer/printer.hpp"
 #include "mtconnect/printer/xml_printer_helper.hpp"
+#include "mtconnect/sink/publish_queue.hpp"
 #include "mtconnect/sink/sink.hpp"
 #include "mtconnect/utilities.hpp"
 
@@ -92,6 +99,40 @@ namespace mtconnect {
         /// @return `true` when the client was connected
         bool isConnected() { return m_client && m_client->isConnected(); }
 
+        /// @brief get the queue of observations waiting to be published
+        /// @return the publish queue
+        auto getPublishQueue() { return m_publishQueue; }
+
+        /// @brief get the number of topics waiting for the batch interval to expire
+        size_t getBatchedTopicCount()
+        {
+          std::lock_guard<std::mutex> lock(m_batchMutex);
+          return m_batch.size();
+        }
+
+      protected:
+        /// @brief How observations of a category are sent to the broker
+        struct PublishSettings
+        {
+          MqttQoS m_qos {MqttQoS::AT_LEAST_ONCE};
+          bool m_retain {true};
+        };
+
+        /// @brief format and send the observation to the broker, or add it to the batch
+        void publishObservation(observation::ObservationPtr &observation);
+
+        /// @brief format an observation as a JSON document
+        std::string formatObservation(const observation::ObservationPtr &observation);
+
+        /// @brief get the publish settings for the data item's category
+        const PublishSettings &getSettings(const DataItemPtr &dataItem) const;
+
+        /// @brief add the observation to the batch for its topic
+        void batchObservation(const std::string &topic, observation::ObservationPtr &observation);
+
+        /// @brief publish all batched topics
+        void flushBatch();
+
       protected:
         std::string m_devicePrefix;
         std::string m_assetPrefix;
@@ -101,6 +142,21 @@ namespace mtconnect {
         ConfigOptions m_options;
         std::unique_ptr<JsonEntityPrinter> m_jsonPrinter;
         std::shared_ptr<MqttClient> m_client;
+        std::shared_ptr<PublishQueue> m_publishQueue;
+
+        PublishSettings m_sampleSettings;
+        PublishSettings m_eventSettings;
+        PublishSettings m_conditionSettings;
+
+        // Observations are gathered per topic and published when the batch interval expires
+        std::chrono::milliseconds m_batchInterval {0};
+        bool m_batchHistory {false};
+        std::mutex m_batchMutex;
+        std::unordered_map<std::string, observation::ObservationList> m_batch;
+        std::vector<std::string> m_batchOrder;
+        boost::asio::io_context::strand m_batchStrand;
+        boost::asio::steady_timer m_batchTimer;
+        bool m_batchScheduled {false};
       };
     }  // namespace mqtt_sink
   }    // namespace sink
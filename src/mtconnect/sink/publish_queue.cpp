@@ -0,0 +1,187 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#include "publish_queue.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/asio/post.hpp>
+
+#include "mtconnect/logging.hpp"
+
+namespace mtconnect::sink {
+  using namespace std;
+  using namespace observation;
+
+  // Maximum number of observations published before yielding the strand
+  static constexpr size_t DrainBatchSize {256};
+
+  std::optional<PublishQueue::Overflow> PublishQueue::parseOverflow(const std::string &text)
+  {
+    auto policy = boost::algorithm::to_lower_copy(text);
+    if (policy == "block")
+      return Overflow::BLOCK;
+    else if (policy == "drop_oldest" || policy == "dropoldest")
+      return Overflow::DROP_OLDEST;
+    else if (policy == "coalesce")
+      return Overflow::COALESCE;
+    else
+      return nullopt;
+  }
+
+  // Only observations that fully replace the previous value can be coalesced. Conditions,
+  // data sets, discrete events, and time series would lose information.
+  static inline bool canCoalesce(const ObservationPtr &observation)
+  {
+    if (observation->isOrphan())
+      return false;
+    auto dataItem = observation->getDataItem();
+    return !dataItem->isCondition() && !dataItem->isDataSet() && !dataItem->isDiscrete() &&
+           !dataItem->isTimeSeries();
+  }
+
+  void PublishQueue::push(const ObservationPtr &observation)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_queue.size() >= m_capacity)
+    {
+      // Apply back pressure by waiting for the strand to publish. Never wait on the strand
+      // itself, it could not drain the queue.
+      if (m_overflow == Overflow::BLOCK && !m_strand.running_in_this_thread())
+      {
+        schedule();
+        m_space.wait_for(lock, BlockTimeout, [this]() { return m_queue.size() < m_capacity; });
+      }
+
+      if (m_queue.size() >= m_capacity)
+      {
+        if (m_overflow == Overflow::COALESCE && coalesce(observation))
+          return;
+        if (m_overflow == Overflow::BLOCK)
+          LOG(warning) << "PublishQueue::push: Timed out waiting for the queue to drain, "
+                          "dropping the oldest observation";
+        dropOldest();
+      }
+    }
+
+    if (m_overflow == Overflow::COALESCE && canCoalesce(observation))
+      m_positions[observation->getDataItem()->getId()] = m_head + m_queue.size();
+    m_queue.emplace_back(observation);
+    schedule();
+  }
+
+  bool PublishQueue::coalesce(const ObservationPtr &observation)
+  {
+    if (!canCoalesce(observation))
+      return false;
+
+    auto pos = m_positions.find(observation->getDataItem()->getId());
+    if (pos == m_positions.end() || pos->second < m_head)
+      return false;
+
+    m_queue[pos->second - m_head] = observation;
+    m_coalesced++;
+    return true;
+  }
+
+  void PublishQueue::dropOldest()
+  {
+    auto &front = m_queue.front();
+    if (m_overflow == Overflow::COALESCE && !front->isOrphan())
+    {
+      auto pos = m_positions.find(front->getDataItem()->getId());
+      if (pos != m_positions.end() && pos->second == m_head)
+        m_positions.erase(pos);
+    }
+
+    m_queue.pop_front();
+    m_head++;
+    m_dropped++;
+  }
+
+  void PublishQueue::schedule()
+  {
+    if (m_scheduled)
+      return;
+
+    m_scheduled = true;
+    boost::asio::post(m_strand, [queue = weak_from_this()]() {
+      auto self = queue.lock();
+      if (!self)
+        return;
+
+      {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        self->m_scheduled = false;
+      }
+
+      self->drain(DrainBatchSize);
+
+      std::lock_guard<std::mutex> lock(self->m_mutex);
+      if (!self->m_queue.empty())
+        self->schedule();
+    });
+  }
+
+  size_t PublishQueue::drain(size_t max)
+  {
+    std::lock_guard<std::mutex> publishLock(m_publishMutex);
+
+    size_t count = 0;
+    while (count < max)
+    {
+      ObservationPtr observation;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.empty())
+          break;
+
+        observation = std::move(m_queue.front());
+        if (m_overflow == Overflow::COALESCE && !observation->isOrphan())
+        {
+          auto pos = m_positions.find(observation->getDataItem()->getId());
+          if (pos != m_positions.end() && pos->second == m_head)
+            m_positions.erase(pos);
+        }
+        m_queue.pop_front();
+        m_head++;
+      }
+      m_space.notify_all();
+
+      try
+      {
+        m_publisher(observation);
+      }
+      catch (std::exception &e)
+      {
+        LOG(error) << "PublishQueue::drain: Failed to publish observation: " << e.what();
+      }
+      count++;
+    }
+
+    return count;
+  }
+
+  void PublishQueue::clear()
+  {
+    std::lock_guard<std::mutex> publishLock(m_publishMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_head += m_queue.size();
+    m_queue.clear();
+    m_positions.clear();
+    m_space.notify_all();
+  }
+}  // namespace mtconnect::sink
@@ -0,0 +1,145 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/io_context_strand.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "mtconnect/config.hpp"
+#include "mtconnect/observation/observation.hpp"
+#include "mtconnect/utilities.hpp"
+
+namespace mtconnect::sink {
+  /// @brief Bounded queue of observations published on a sink's strand
+  ///
+  /// The agent delivers observations to the sinks while holding the circular buffer lock. A sink
+  /// that pushes the observations into a publish queue only pays for the push while the lock is
+  /// held; the observations are formatted and sent when the queue is drained on its own strand.
+  ///
+  /// The publisher is only called on the queue's strand, in the order the observations were
+  /// pushed. The publisher must not lock the circular buffer.
+  class AGENT_LIB_API PublishQueue : public std::enable_shared_from_this<PublishQueue>
+  {
+  public:
+    /// @brief What to do when an observation is pushed and the queue is full
+    enum class Overflow
+    {
+      BLOCK,        ///< Wait for the strand to publish, then discard the oldest
+      DROP_OLDEST,  ///< Discard the oldest queued observation
+      COALESCE      ///< Replace a queued observation for the same data item, else drop oldest
+    };
+
+    /// @brief The function that publishes an observation
+    using Publisher = std::function<void(observation::ObservationPtr &)>;
+
+    /// @brief Create a publish queue
+    /// @param[in] context the context to drain the queue in
+    /// @param[in] publisher the function that publishes an observation
+    /// @param[in] capacity the maximum number of queued observations
+    /// @param[in] overflow the overflow policy
+    PublishQueue(boost::asio::io_context &context, Publisher publisher, size_t capacity = 1024,
+                 Overflow overflow = Overflow::COALESCE)
+      : m_strand(context), m_publisher(publisher), m_capacity(capacity), m_overflow(overflow)
+    {
+      if (m_capacity == 0)
+        m_capacity = 1;
+    }
+    ~PublishQueue() = default;
+
+    /// @brief convert a configuration value to an overflow policy
+    /// @param[in] text `block`, `drop_oldest`, or `coalesce`. Case insensitive.
+    /// @return the policy if the text is valid
+    static std::optional<Overflow> parseOverflow(const std::string &text);
+
+    /// @brief add an observation to the queue and schedule the queue to be drained
+    ///
+    /// With the `BLOCK` policy, waits up to `BlockTimeout` for the strand to make room when the
+    /// queue is full. The pushing thread never publishes.
+    /// @param[in] observation the observation
+    void push(const observation::ObservationPtr &observation);
+
+    /// @brief how long a push waits for room with the `BLOCK` policy before discarding the oldest
+    static constexpr std::chrono::milliseconds BlockTimeout {1000};
+
+    /// @brief discard all queued observations
+    ///
+    /// Used when a sink is about to publish a complete snapshot of the current state
+    void clear();
+
+    /// @name Queue state and statistics
+    ///@{
+
+    /// @brief get the number of queued observations
+    size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_queue.size();
+    }
+    auto getCapacity() const { return m_capacity; }
+    auto getOverflow() const { return m_overflow; }
+    /// @brief get the number of observations discarded because the queue was full
+    uint64_t getDropped() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_dropped;
+    }
+    /// @brief get the number of observations replaced by a newer observation
+    uint64_t getCoalesced() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_coalesced;
+    }
+    ///@}
+
+  protected:
+    bool coalesce(const observation::ObservationPtr &observation);
+    void dropOldest();
+    void schedule();
+    // Publish queued observations, only called on the strand
+    size_t drain(size_t max = std::numeric_limits<size_t>::max());
+
+  protected:
+    boost::asio::io_context::strand m_strand;
+    Publisher m_publisher;
+    size_t m_capacity;
+    Overflow m_overflow;
+
+    mutable std::mutex m_mutex;
+    std::mutex m_publishMutex;
+    std::condition_variable m_space;
+
+    std::deque<observation::ObservationPtr> m_queue;
+    uint64_t m_head {0};  //< Absolute position of the front of the queue
+    std::unordered_map<std::string, uint64_t> m_positions;
+    bool m_scheduled {false};
+
+    uint64_t m_dropped {0};
+    uint64_t m_coalesced {0};
+  };
+}  // namespace mtconnect::sink
@@ -0,0 +1,748 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#include "http2_session.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/status.hpp>
+#include <boost/beast/http/verb.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "mtconnect/logging.hpp"
+
+namespace mtconnect::sink::rest_sink {
+  namespace asio = boost::asio;
+  namespace http = boost::beast::http;
+  namespace algo = boost::algorithm;
+  namespace fs = std::filesystem;
+
+  using namespace std;
+
+  // Shared with the HTTP/1.1 sessions
+  string parseUrl(string url, map<string, string> &queries);
+  void parseQueries(string qp, map<string, string> &queries);
+
+  // Same limit as the HTTP/1.1 request parser
+  static constexpr size_t MaxBodySize {100000};
+  // Frames are collected into writes of about this size
+  static constexpr size_t MaxWriteSize {64 * 1024};
+
+  Http2Stream::Http2Stream(std::shared_ptr<Http2Connection> connection, int32_t id,
+                           Dispatch dispatch, ErrorFunction error)
+    : Session(dispatch, error),
+      m_connection(connection),
+      m_context(connection->getContext()),
+      m_id(id),
+      m_request(make_shared<Request>())
+  {
+    m_remote = connection->m_remote;
+    m_allowPuts = connection->m_allowPuts;
+    m_allowPutsFrom = connection->m_allowPutsFrom;
+  }
+
+  void Http2Stream::requested()
+  {
+    NAMED_SCOPE("Http2Stream::requested");
+
+    m_request->m_verb = http::string_to_verb(m_method);
+    m_request->m_path = parseUrl(m_target, m_request->m_query);
+    if (m_request->m_contentType == "application/x-www-form-urlencoded" &&
+        !m_request->m_body.empty() && m_request->m_body[0] != '<')
+    {
+      parseQueries(m_request->m_body, m_request->m_query);
+    }
+
+    m_request->m_foreignIp = m_remote.address().to_string();
+    m_request->m_foreignPort = m_remote.port();
+
+    LOG(info) << "ReST Request: From [" << m_request->m_foreignIp << ':' << m_remote.port()
+              << "]: HTTP/2 " << m_method << " " << m_target;
+
+    if (m_tooLarge)
+    {
+      fail(http::status::payload_too_large, "Request body is too large");
+      return;
+    }
+
+    // Check for put, post, or delete
+    if (m_request->m_verb != http::verb::get)
+    {
+      if (!m_allowPuts)
+      {
+        fail(http::status::bad_request,
+             "PUT, POST, and DELETE are not allowed. MTConnect Agent is read only and only GET "
+             "is allowed.");
+        return;
+      }
+      else if (!m_allowPutsFrom.empty() &&
+               m_allowPutsFrom.find(m_remote.address()) == m_allowPutsFrom.end())
+      {
+        fail(http::status::bad_request,
+             "PUT, POST, and DELETE are not allowed from " + m_remote.address().to_string());
+        return;
+      }
+    }
+
+    if (!m_dispatch(shared_ptr(), m_request))
+    {
+      LOG(error) << "Failed to find handler for " << m_method << " " << m_target;
+    }
+  }
+
+  void Http2Stream::writeResponse(ResponsePtr &&response, Complete complete)
+  {
+    NAMED_SCOPE("Http2Stream::writeResponse");
+
+    std::shared_ptr<Response> outgoing(std::move(response));
+    if (auto connection = m_connection.lock())
+    {
+      connection->dispatch([connection, self = shared_ptr(), outgoing, complete]() {
+        connection->respond(*self, outgoing, complete);
+      });
+    }
+  }
+
+  void Http2Stream::writeFailureResponse(ResponsePtr &&response, Complete complete)
+  {
+    if (m_streaming)
+    {
+      auto self = shared_ptr();
+      writeChunk(response->m_body, [self] { self->closeStream(); });
+    }
+    else
+    {
+      writeResponse(std::move(response), complete);
+    }
+  }
+
+  void Http2Stream::beginStreaming(const std::string &mimeType, Complete complete)
+  {
+    NAMED_SCOPE("Http2Stream::beginStreaming");
+
+    using namespace boost::uuids;
+    random_generator gen;
+    m_boundary = to_string(gen());
+    m_mimeType = mimeType;
+    m_streaming = true;
+
+    if (auto connection = m_connection.lock())
+    {
+      connection->dispatch([connection, self = shared_ptr(), complete]() {
+        connection->beginStreaming(*self, complete);
+      });
+    }
+  }
+
+  void Http2Stream::writeChunk(const std::string &body, Complete complete)
+  {
+    NAMED_SCOPE("Http2Stream::writeChunk");
+
+    ostringstream str;
+    str << "--" + m_boundary << "\r\n"
+        << to_string(http::field::content_type) << ": " << m_mimeType << "\r\n"
+        << to_string(http::field::content_length) << ": " << to_string(body.length())
+        << "\r\n\r\n"
+        << body << "\r\n";
+
+    auto part = make_shared<const string>(str.str());
+    if (auto connection = m_connection.lock())
+    {
+      connection->dispatch([connection, self = shared_ptr(), part, complete]() {
+        self->append(part, part->data(), part->size(), complete);
+        connection->resume(*self);
+      });
+    }
+  }
+
+  void Http2Stream::closeStream()
+  {
+    NAMED_SCOPE("Http2Stream::closeStream");
+
+    if (auto connection = m_connection.lock())
+    {
+      connection->dispatch([connection, self = shared_ptr()]() {
+        self->m_end = true;
+        connection->resume(*self);
+      });
+    }
+  }
+
+  void Http2Stream::close()
+  {
+    NAMED_SCOPE("Http2Stream::close");
+
+    if (auto connection = m_connection.lock())
+    {
+      connection->dispatch([connection, self = shared_ptr()]() {
+        if (self->m_responded)
+        {
+          self->m_end = true;
+          connection->resume(*self);
+        }
+        else
+        {
+          connection->cancel(*self);
+        }
+      });
+    }
+  }
+
+  void Http2Stream::append(std::shared_ptr<const void> owner, const char *data, size_t size,
+                           Complete complete)
+  {
+    if (m_closed || m_end)
+      return;
+
+    m_data.push_back({owner, data, size, complete});
+  }
+
+  ssize_t Http2Stream::read(uint8_t *buffer, size_t length, uint32_t *flags,
+                            std::vector<Complete> &framed)
+  {
+    size_t copied = 0;
+    while (!m_data.empty() && copied < length)
+    {
+      auto &data = m_data.front();
+      auto count = std::min(length - copied, data.m_size - m_offset);
+      if (count > 0)
+      {
+        std::memcpy(buffer + copied, data.m_data + m_offset, count);
+        copied += count;
+        m_offset += count;
+      }
+
+      if (m_offset == data.m_size)
+      {
+        // The completion is called when the write with the last of the data is sent
+        if (data.m_complete)
+          framed.emplace_back(std::move(data.m_complete));
+        m_data.pop_front();
+        m_offset = 0;
+      }
+    }
+
+    if (m_data.empty() && m_end)
+    {
+      *flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    else if (copied == 0)
+    {
+      // Wait for the next chunk, the stream is resumed when it is appended
+      m_deferred = true;
+      return NGHTTP2_ERR_DEFERRED;
+    }
+
+    return copied;
+  }
+
+  Http2Connection::Http2Connection(const boost::asio::ip::tcp::endpoint &remote,
+                                   const FieldList &list, Dispatch dispatch, ErrorFunction error)
+    : m_remote(remote), m_dispatch(dispatch), m_errorFunction(error)
+  {
+    m_staticFields.emplace_back("server", "MTConnectAgent");
+    for (const auto &f : list)
+    {
+      // HTTP/2 field names are lower case and connection specific fields are not allowed
+      auto name = algo::to_lower_copy(f.first);
+      if (name == "connection" || name == "keep-alive" || name == "transfer-encoding" ||
+          name == "upgrade")
+        continue;
+
+      auto it = std::find_if(m_staticFields.begin(), m_staticFields.end(),
+                             [&name](const auto &field) { return field.first == name; });
+      if (it != m_staticFields.end())
+        it->second = f.second;
+      else
+        m_staticFields.emplace_back(name, f.second);
+    }
+  }
+
+  Http2Connection::~Http2Connection()
+  {
+    if (m_session)
+      nghttp2_session_del(m_session);
+  }
+
+  void Http2Connection::run(const std::string &received)
+  {
+    NAMED_SCOPE("Http2Connection::run");
+
+    dispatch([self = shared_from_this(), received]() {
+      nghttp2_session_callbacks *callbacks;
+      nghttp2_session_callbacks_new(&callbacks);
+      nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks,
+                                                              &Http2Connection::beginHeaders);
+      nghttp2_session_callbacks_set_on_header_callback(callbacks, &Http2Connection::header);
+      nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks,
+                                                                &Http2Connection::dataChunk);
+      nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks,
+                                                           &Http2Connection::frameReceived);
+      nghttp2_session_callbacks_set_on_stream_close_callback(callbacks,
+                                                             &Http2Connection::streamClosed);
+      auto rv = nghttp2_session_server_new(&self->m_session, callbacks, self.get());
+      nghttp2_session_callbacks_del(callbacks);
+      if (rv != 0)
+      {
+        LOG(error) << "Cannot create HTTP/2 session: " << nghttp2_strerror(rv);
+        self->finish();
+        return;
+      }
+
+      nghttp2_settings_entry settings[] = {
+          {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, MaxConcurrentStreams}};
+      nghttp2_submit_settings(self->m_session, NGHTTP2_FLAG_NONE, settings, 1);
+
+      if (!received.empty() &&
+          !self->receive(reinterpret_cast<const uint8_t *>(received.data()), received.size()))
+        return;
+
+      self->flush();
+      self->read();
+    });
+  }
+
+  void Http2Connection::close()
+  {
+    NAMED_SCOPE("Http2Connection::close");
+
+    dispatch([self = shared_from_this()]() {
+      if (self->m_closing || self->m_closed || !self->m_session)
+        return;
+
+      // Send a GOAWAY, the connection is shut down when it has been written
+      self->m_closing = true;
+      nghttp2_session_terminate_session(self->m_session, NGHTTP2_NO_ERROR);
+      self->flush();
+    });
+  }
+
+  void Http2Connection::read()
+  {
+    if (m_closed || m_closing)
+      return;
+
+    idle(m_streams.empty());
+    asyncRead(asio::buffer(m_input),
+              [self = shared_from_this()](boost::system::error_code ec, size_t len) {
+                self->received(ec, len);
+              });
+  }
+
+  void Http2Connection::received(boost::system::error_code ec, size_t len)
+  {
+    NAMED_SCOPE("Http2Connection::received");
+
+    if (m_closed)
+      return;
+
+    if (ec)
+    {
+      LOG(debug) << "HTTP/2 connection from " << m_remote << " closed: " << ec.message();
+      finish();
+      return;
+    }
+
+    if (receive(m_input.data(), len))
+    {
+      flush();
+      read();
+    }
+  }
+
+  bool Http2Connection::receive(const uint8_t *data, size_t len)
+  {
+    m_receiving = true;
+    auto rv = nghttp2_session_mem_recv(m_session, data, len);
+    m_receiving = false;
+
+    if (rv < 0)
+    {
+      LOG(warning) << "HTTP/2 error from " << m_remote << ": " << nghttp2_strerror(int(rv));
+      close();
+      return false;
+    }
+
+    return true;
+  }
+
+  void Http2Connection::flush()
+  {
+    if (m_writing || m_receiving || m_closed || !m_session)
+      return;
+
+    m_output.clear();
+    while (m_output.size() < MaxWriteSize)
+    {
+      const uint8_t *data;
+      auto len = nghttp2_session_mem_send(m_session, &data);
+      if (len < 0)
+      {
+        LOG(warning) << "HTTP/2 error sending to " << m_remote << ": "
+                     << nghttp2_strerror(int(len));
+        finish();
+        return;
+      }
+      else if (len == 0)
+      {
+        break;
+      }
+
+      m_output.append(reinterpret_cast<const char *>(data), len);
+    }
+
+    if (m_output.empty())
+    {
+      // Empty data frames, such as the end of a stream, may not need a write
+      auto completions = std::move(m_framed);
+      m_framed.clear();
+      for (auto &complete : completions)
+        complete();
+
+      if (!m_writing && (m_closing || (!nghttp2_session_want_read(m_session) &&
+                                       !nghttp2_session_want_write(m_session))))
+        finish();
+      return;
+    }
+
+    m_sending = std::move(m_framed);
+    m_framed.clear();
+    m_writing = true;
+    asyncWrite(asio::buffer(m_output),
+               [self = shared_from_this()](boost::system::error_code ec, size_t len) {
+                 self->sent(ec, len);
+               });
+  }
+
+  void Http2Connection::sent(boost::system::error_code ec, size_t len)
+  {
+    NAMED_SCOPE("Http2Connection::sent");
+
+    m_writing = false;
+    if (ec)
+    {
+      LOG(debug) << "HTTP/2 connection to " << m_remote << " closed: " << ec.message();
+      finish();
+      return;
+    }
+
+    auto completions = std::move(m_sending);
+    m_sending.clear();
+    for (auto &complete : completions)
+      complete();
+
+    flush();
+  }
+
+  void Http2Connection::finish()
+  {
+    if (m_closed)
+      return;
+
+    m_closed = true;
+    for (auto &stream : m_streams)
+    {
+      stream.second->m_closed = true;
+      stream.second->m_data.clear();
+    }
+    m_streams.clear();
+    m_framed.clear();
+    m_sending.clear();
+    shutdown();
+  }
+
+  void Http2Connection::addHeaders(Headers &headers, const Response &response) const
+  {
+    auto has = [this](const string &name) {
+      return std::find_if(m_staticFields.begin(), m_staticFields.end(), [&name](const auto &f) {
+               return f.first == name;
+             }) != m_staticFields.end();
+    };
+
+    headers.insert(headers.end(), m_staticFields.begin(), m_staticFields.end());
+    if (response.m_expires == 0s)
+    {
+      if (!has("expires"))
+        headers.emplace_back("expires", "-1");
+      if (!has("cache-control"))
+        headers.emplace_back("cache-control", "no-store, max-age=0");
+    }
+    if (!has("content-type"))
+      headers.emplace_back("content-type", response.m_mimeType);
+    if (response.m_location)
+      headers.emplace_back("location", *response.m_location);
+  }
+
+  void Http2Connection::submit(Http2Stream &stream, const Headers &headers)
+  {
+    vector<nghttp2_nv> nva;
+    nva.reserve(headers.size());
+    for (const auto &h : headers)
+    {
+      nva.push_back({const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(h.first.data())),
+                     const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(h.second.data())),
+                     h.first.size(), h.second.size(), NGHTTP2_NV_FLAG_NONE});
+    }
+
+    nghttp2_data_provider provider;
+    provider.source.ptr = &stream;
+    provider.read_callback = &Http2Connection::readData;
+
+    auto rv = nghttp2_submit_response(m_session, stream.m_id, nva.data(), nva.size(), &provider);
+    if (rv != 0)
+    {
+      LOG(warning) << "Cannot respond on HTTP/2 stream " << stream.m_id << ": "
+                   << nghttp2_strerror(rv);
+      return;
+    }
+
+    flush();
+  }
+
+  void Http2Connection::respond(Http2Stream &stream, std::shared_ptr<Response> response,
+                                Complete complete)
+  {
+    NAMED_SCOPE("Http2Connection::respond");
+
+    if (m_closing || m_closed || stream.m_closed || stream.m_responded)
+      return;
+
+    std::shared_ptr<const void> owner = response;
+    const char *data;
+    size_t size;
+    bool gzip = false;
+    if (response->m_file && !response->m_file->m_cached)
+    {
+      fs::path path = response->m_file->m_path;
+      if (stream.m_request->m_acceptsEncoding.find("gzip") != string::npos &&
+          response->m_file->m_pathGz)
+      {
+        gzip = true;
+        path = *response->m_file->m_pathGz;
+      }
+
+      ifstream file(path, ios::binary);
+      if (!file)
+      {
+        // The not found response is written in place of this one
+        stream.fail(http::status::not_found, "File Not Found");
+        return;
+      }
+
+      auto body =
+          make_shared<string>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+      owner = body;
+      data = body->data();
+      size = body->size();
+    }
+    else if (response->m_file)
+    {
+      data = response->m_file->m_buffer;
+      size = response->m_file->m_size;
+    }
+    else
+    {
+      data = response->m_body.data();
+      size = response->m_body.size();
+    }
+
+    Headers headers;
+    headers.emplace_back(":status", to_string(static_cast<unsigned>(response->m_status)));
+    addHeaders(headers, *response);
+    headers.emplace_back("content-length", to_string(size));
+    if (gzip)
+      headers.emplace_back("content-encoding", "gzip");
+
+    stream.m_responded = true;
+    stream.append(owner, data, size, complete);
+    stream.m_end = true;
+    submit(stream, headers);
+  }
+
+  void Http2Connection::beginStreaming(Http2Stream &stream, Complete complete)
+  {
+    NAMED_SCOPE("Http2Connection::beginStreaming");
+
+    if (m_closing || m_closed || stream.m_closed || stream.m_responded)
+      return;
+
+    Headers headers;
+    headers.emplace_back(":status", "200");
+    for (const auto &f : m_staticFields)
+    {
+      if (f.first != "content-type")
+        headers.push_back(f);
+    }
+    headers.emplace_back("content-type", "multipart/mixed;boundary=" + stream.m_boundary);
+    auto has = [this](const string &name) {
+      return std::find_if(m_staticFields.begin(), m_staticFields.end(), [&name](const auto &f) {
+               return f.first == name;
+             }) != m_staticFields.end();
+    };
+    if (!has("expires"))
+      headers.emplace_back("expires", "-1");
+    if (!has("cache-control"))
+      headers.emplace_back("cache-control", "no-cache, no-store, max-age=0");
+
+    // The completion is called when the headers have been sent
+    stream.m_responded = true;
+    stream.append(nullptr, nullptr, 0, complete);
+    submit(stream, headers);
+  }
+
+  void Http2Connection::resume(Http2Stream &stream)
+  {
+    if (m_closed || stream.m_closed)
+      return;
+
+    if (stream.m_deferred)
+    {
+      stream.m_deferred = false;
+      nghttp2_session_resume_data(m_session, stream.m_id);
+    }
+    flush();
+  }
+
+  void Http2Connection::cancel(Http2Stream &stream)
+  {
+    if (m_closed || stream.m_closed)
+      return;
+
+    nghttp2_submit_rst_stream(m_session, NGHTTP2_FLAG_NONE, stream.m_id, NGHTTP2_CANCEL);
+    flush();
+  }
+
+  int Http2Connection::beginHeaders(nghttp2_session *session, const nghttp2_frame *frame,
+                                    void *data)
+  {
+    auto connection = static_cast<Http2Connection *>(data);
+    if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST)
+      return 0;
+
+    auto stream = make_shared<Http2Stream>(connection->shared_from_this(), frame->hd.stream_id,
+                                           connection->m_dispatch, connection->m_errorFunction);
+    connection->m_streams.emplace(frame->hd.stream_id, stream);
+    nghttp2_session_set_stream_user_data(session, frame->hd.stream_id, stream.get());
+
+    return 0;
+  }
+
+  int Http2Connection::header(nghttp2_session *session, const nghttp2_frame *frame,
+                              const uint8_t *name, size_t namelen, const uint8_t *value,
+                              size_t valuelen, uint8_t flags, void *data)
+  {
+    if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST)
+      return 0;
+
+    auto stream = static_cast<Http2Stream *>(
+        nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
+    if (!stream)
+      return 0;
+
+    // nghttp2 only accepts lower case field names
+    string_view field(reinterpret_cast<const char *>(name), namelen);
+    string text(reinterpret_cast<const char *>(value), valuelen);
+    if (field == ":method")
+      stream->m_method = std::move(text);
+    else if (field == ":path")
+      stream->m_target = std::move(text);
+    else if (field == "accept")
+      stream->m_request->m_accepts = std::move(text);
+    else if (field == "accept-encoding")
+      stream->m_request->m_acceptsEncoding = std::move(text);
+    else if (field == "content-type")
+      stream->m_request->m_contentType = std::move(text);
+
+    return 0;
+  }
+
+  int Http2Connection::dataChunk(nghttp2_session *session, uint8_t flags, int32_t id,
+                                 const uint8_t *chunk, size_t len, void *data)
+  {
+    auto stream = static_cast<Http2Stream *>(nghttp2_session_get_stream_user_data(session, id));
+    if (stream)
+    {
+      auto &body = stream->m_request->m_body;
+      if (stream->m_tooLarge || body.size() + len > MaxBodySize)
+        stream->m_tooLarge = true;
+      else
+        body.append(reinterpret_cast<const char *>(chunk), len);
+    }
+
+    return 0;
+  }
+
+  int Http2Connection::frameReceived(nghttp2_session *session, const nghttp2_frame *frame,
+                                     void *data)
+  {
+    auto connection = static_cast<Http2Connection *>(data);
+    switch (frame->hd.type)
+    {
+      case NGHTTP2_DATA:
+      case NGHTTP2_HEADERS:
+        if (frame->hd.flags & NGHTTP2_FLAG_END_STREAM)
+        {
+          // Hold the stream while the request is dispatched
+          auto it = connection->m_streams.find(frame->hd.stream_id);
+          if (it != connection->m_streams.end())
+          {
+            auto stream = it->second;
+            stream->requested();
+          }
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return 0;
+  }
+
+  int Http2Connection::streamClosed(nghttp2_session *session, int32_t id, uint32_t code,
+                                    void *data)
+  {
+    auto connection = static_cast<Http2Connection *>(data);
+    auto it = connection->m_streams.find(id);
+    if (it != connection->m_streams.end())
+    {
+      // Drop the data that was not sent, releasing the observers waiting on it
+      it->second->m_closed = true;
+      it->second->m_data.clear();
+      connection->m_streams.erase(it);
+    }
+
+    return 0;
+  }
+
+  ssize_t Http2Connection::readData(nghttp2_session *session, int32_t id, uint8_t *buf,
+                                    size_t length, uint32_t *flags, nghttp2_data_source *source,
+                                    void *data)
+  {
+    auto connection = static_cast<Http2Connection *>(data);
+    auto stream = static_cast<Http2Stream *>(source->ptr);
+    return stream->read(buf, length, flags, connection->m_framed);
+  }
+}  // namespace mtconnect::sink::rest_sink
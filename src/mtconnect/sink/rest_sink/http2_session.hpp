@@ -0,0 +1,315 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+// nghttp2 uses the POSIX ssize_t in its interface
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#endif
+#include <nghttp2/nghttp2.h>
+
+#include "mtconnect/config.hpp"
+#include "mtconnect/utilities.hpp"
+#include "request.hpp"
+#include "response.hpp"
+#include "session.hpp"
+
+namespace mtconnect::sink::rest_sink {
+  class Http2Connection;
+
+  /// @brief A request on an HTTP/2 connection
+  ///
+  /// Every stream is a session given to the dispatcher, so one connection services many requests
+  /// and sample or current streams at the same time. The responses are framed on the connection's
+  /// strand and sent as the client's flow control allows.
+  class Http2Stream : public Session
+  {
+  public:
+    /// @brief Create a stream for a request
+    /// @param connection the connection the request was received on
+    /// @param id the HTTP/2 stream id
+    /// @param dispatch dispatch function
+    /// @param error error function
+    Http2Stream(std::shared_ptr<Http2Connection> connection, int32_t id, Dispatch dispatch,
+                ErrorFunction error);
+    ~Http2Stream() override = default;
+
+    /// @brief get a shared pointer to the stream
+    /// @return shared pointer
+    std::shared_ptr<Http2Stream> shared_ptr()
+    {
+      return std::static_pointer_cast<Http2Stream>(shared_from_this());
+    }
+
+    /// @name Session Interface
+    ///@{
+    /// @brief the connection dispatches the request when it has been received
+    void run() override {}
+    void writeResponse(ResponsePtr &&response, Complete complete = nullptr) override;
+    void writeFailureResponse(ResponsePtr &&response, Complete complete = nullptr) override;
+    void beginStreaming(const std::string &mimeType, Complete complete) override;
+    void writeChunk(const std::string &chunk, Complete complete) override;
+    /// @brief finish the response, or cancel the stream if there is none
+    void close() override;
+    void closeStream() override;
+    boost::asio::io_context &getContext() override { return m_context; }
+    ///@}
+
+    /// @brief get the HTTP/2 stream id
+    /// @return the stream id
+    auto getId() const { return m_id; }
+
+  protected:
+    friend class Http2Connection;
+
+    // Body data waiting to be framed
+    struct Data
+    {
+      std::shared_ptr<const void> m_owner;  //< keeps the data alive until it is framed
+      const char *m_data;
+      size_t m_size;
+      Complete m_complete;  //< called when the data has been sent
+    };
+
+    void requested();
+    void append(std::shared_ptr<const void> owner, const char *data, size_t size,
+                Complete complete);
+    ssize_t read(uint8_t *buffer, size_t length, uint32_t *flags, std::vector<Complete> &framed);
+
+  protected:
+    std::weak_ptr<Http2Connection> m_connection;
+    boost::asio::io_context &m_context;
+    int32_t m_id;
+
+    // The request as it is received
+    RequestPtr m_request;
+    std::string m_method;
+    std::string m_target;
+    bool m_tooLarge {false};
+
+    // For Streaming
+    std::string m_boundary;
+    std::string m_mimeType;
+
+    // Response state, only used on the connection strand
+    bool m_responded {false};
+    bool m_streaming {false};
+    bool m_end {false};
+    bool m_deferred {false};
+    bool m_closed {false};
+    std::deque<Data> m_data;
+    size_t m_offset {0};
+  };
+
+  /// @brief An HTTP/2 connection to a client
+  ///
+  /// Uses nghttp2 for framing, header compression and flow control. The nghttp2 session is only
+  /// used on the connection's strand, the streams queue their responses onto the strand. The
+  /// transport is provided by `Http2ConnectionImpl` for plain and TLS streams.
+  class Http2Connection : public std::enable_shared_from_this<Http2Connection>
+  {
+  public:
+    /// @brief Create an HTTP/2 connection
+    /// @param remote the client's endpoint
+    /// @param list the additional header fields
+    /// @param dispatch dispatch function
+    /// @param error error function
+    Http2Connection(const boost::asio::ip::tcp::endpoint &remote, const FieldList &list,
+                    Dispatch dispatch, ErrorFunction error);
+    /// @brief Connections cannot be copied
+    Http2Connection(const Http2Connection &) = delete;
+    virtual ~Http2Connection();
+
+    /// @brief start the connection
+    /// @param received bytes already read from the client, such as the connection preface
+    void run(const std::string &received = "");
+    /// @brief send a GOAWAY and close the connection
+    void close();
+
+    /// @brief allow puts on the streams of this connection
+    /// @param allow `true` if puts are allowed
+    void allowPuts(bool allow = true) { m_allowPuts = allow; }
+    /// @brief allow puts from a set of hosts
+    /// @param hosts set of hosts
+    void allowPutsFrom(const std::set<boost::asio::ip::address> &hosts)
+    {
+      m_allowPuts = true;
+      m_allowPutsFrom = hosts;
+    }
+
+    /// @brief get the io context servicing this connection
+    /// @return the io context
+    virtual boost::asio::io_context &getContext() = 0;
+
+    /// @brief run `f` on the connection strand
+    template <typename F>
+    void dispatch(F &&f)
+    {
+      boost::asio::dispatch(executor(), std::forward<F>(f));
+    }
+
+    /// @brief The maximum number of streams a client can open at the same time
+    static constexpr uint32_t MaxConcurrentStreams {100};
+    /// @brief How long a connection without streams stays open
+    static constexpr std::chrono::seconds IdleTimeout {30};
+
+  protected:
+    friend class Http2Stream;
+    using Handler = std::function<void(boost::system::error_code, size_t)>;
+
+    /// @name Transport
+    ///@{
+    virtual boost::asio::any_io_executor executor() = 0;
+    virtual void asyncRead(boost::asio::mutable_buffer buffer, Handler handler) = 0;
+    virtual void asyncWrite(boost::asio::const_buffer buffer, Handler handler) = 0;
+    /// @brief set the idle timeout when no streams are open, otherwise clear it
+    ///
+    /// Only called before a read is started since the timeout applies to the operations that
+    /// are started after it is set.
+    virtual void idle(bool idle) = 0;
+    virtual void shutdown() = 0;
+    ///@}
+
+    void read();
+    void received(boost::system::error_code ec, size_t len);
+    bool receive(const uint8_t *data, size_t len);
+    void flush();
+    void sent(boost::system::error_code ec, size_t len);
+    void finish();
+
+    using Headers = std::vector<std::pair<std::string, std::string>>;
+    void submit(Http2Stream &stream, const Headers &headers);
+    void respond(Http2Stream &stream, std::shared_ptr<Response> response, Complete complete);
+    void beginStreaming(Http2Stream &stream, Complete complete);
+    void resume(Http2Stream &stream);
+    void cancel(Http2Stream &stream);
+    void addHeaders(Headers &headers, const Response &response) const;
+
+    /// @name nghttp2 callbacks
+    ///@{
+    static int beginHeaders(nghttp2_session *session, const nghttp2_frame *frame, void *data);
+    static int header(nghttp2_session *session, const nghttp2_frame *frame, const uint8_t *name,
+                      size_t namelen, const uint8_t *value, size_t valuelen, uint8_t flags,
+                      void *data);
+    static int dataChunk(nghttp2_session *session, uint8_t flags, int32_t id,
+                         const uint8_t *chunk, size_t len, void *data);
+    static int frameReceived(nghttp2_session *session, const nghttp2_frame *frame, void *data);
+    static int streamClosed(nghttp2_session *session, int32_t id, uint32_t code, void *data);
+    static ssize_t readData(nghttp2_session *session, int32_t id, uint8_t *buf, size_t length,
+                            uint32_t *flags, nghttp2_data_source *source, void *data);
+    ///@}
+
+  protected:
+    nghttp2_session *m_session {nullptr};
+    boost::asio::ip::tcp::endpoint m_remote;
+    Dispatch m_dispatch;
+    ErrorFunction m_errorFunction;
+    // Server and additional fields added to every response, lower case
+    Headers m_staticFields;
+
+    bool m_allowPuts {false};
+    std::set<boost::asio::ip::address> m_allowPutsFrom;
+
+    std::map<int32_t, std::shared_ptr<Http2Stream>> m_streams;
+
+    std::array<uint8_t, 16 * 1024> m_input;
+    std::string m_output;
+    bool m_writing {false};
+    // nghttp2 cannot send from within its receive callbacks
+    bool m_receiving {false};
+    bool m_closing {false};
+    bool m_closed {false};
+    // Completions of the data framed for the next write and the write in progress
+    std::vector<Complete> m_framed;
+    std::vector<Complete> m_sending;
+  };
+
+  /// @brief An HTTP/2 connection over a plain or TLS stream
+  /// @tparam Stream `boost::beast::tcp_stream` or `boost::beast::ssl_stream` of a tcp stream
+  template <class Stream>
+  class Http2ConnectionImpl : public Http2Connection
+  {
+  public:
+    /// @brief Create an HTTP/2 connection
+    /// @param stream the stream (takes ownership)
+    /// @param list the additional header fields
+    /// @param dispatch dispatch function
+    /// @param error error function
+    Http2ConnectionImpl(Stream &&stream, const FieldList &list, Dispatch dispatch,
+                        ErrorFunction error)
+      : Http2Connection(boost::beast::get_lowest_layer(stream).socket().remote_endpoint(), list,
+                        dispatch, error),
+        m_stream(std::move(stream))
+    {
+      // Frames are small and are written as soon as they are ready
+      boost::beast::error_code ec;
+      boost::beast::get_lowest_layer(m_stream).socket().set_option(
+          boost::asio::ip::tcp::no_delay(true), ec);
+    }
+    ~Http2ConnectionImpl() override { shutdown(); }
+
+    boost::asio::io_context &getContext() override
+    {
+      return static_cast<boost::asio::io_context &>(
+          boost::asio::query(m_stream.get_executor(), boost::asio::execution::context));
+    }
+
+  protected:
+    boost::asio::any_io_executor executor() override { return m_stream.get_executor(); }
+    void asyncRead(boost::asio::mutable_buffer buffer, Handler handler) override
+    {
+      m_stream.async_read_some(buffer, std::move(handler));
+    }
+    void asyncWrite(boost::asio::const_buffer buffer, Handler handler) override
+    {
+      boost::asio::async_write(m_stream, buffer, std::move(handler));
+    }
+    void idle(bool idle) override
+    {
+      if (idle)
+        boost::beast::get_lowest_layer(m_stream).expires_after(IdleTimeout);
+      else
+        boost::beast::get_lowest_layer(m_stream).expires_never();
+    }
+    void shutdown() override
+    {
+      boost::beast::error_code ec;
+      boost::beast::get_lowest_layer(m_stream).socket().shutdown(
+          boost::asio::ip::tcp::socket::shutdown_both, ec);
+    }
+
+  protected:
+    Stream m_stream;
+  };
+}  // namespace mtconnect::sink::rest_sink
@@ -68,6 +68,20 @@ namespace mtconnect::sink::rest_sink {
     QueryMap m_query;                 ///< The parsed query parameters
     ParameterMap m_parameters;        ///< The parsed path parameters
 
+    /// @brief Clear the request so it can be reused for the next request on a session
+    void clear()
+    {
+      m_body.clear();
+      m_accepts.clear();
+      m_acceptsEncoding.clear();
+      m_contentType.clear();
+      m_path.clear();
+      m_foreignIp.clear();
+      m_foreignPort = 0;
+      m_query.clear();
+      m_parameters.clear();
+    }
+
     /// @brief Find a parameter by type
     /// @tparam T the type of the parameter
     /// @param s the name of the parameter
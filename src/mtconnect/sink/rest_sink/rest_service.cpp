@@ -948,8 +948,11 @@ namespace mtconnect {
       FilterSet filter;
       checkPath(printer, path, dev, filter, deviceType);
 
+      // Each stream has its own strand on the session's context so a slow client or a large
+      // document only delays its own stream.
+      boost::asio::io_context::strand strand(session->getContext());
       auto asyncResponse = make_shared<AsyncSampleResponse>(
-          m_strand, m_sinkContract->getCircularBuffer(), std::move(filter),
+          strand, m_sinkContract->getCircularBuffer(), std::move(filter),
           std::chrono::milliseconds(interval), std::chrono::milliseconds(heartbeatIn), session);
       asyncResponse->m_count = count;
       asyncResponse->m_printer = printer;
@@ -971,7 +974,7 @@ namespace mtconnect {
 
       session->beginStreaming(
           printer->mimeType(),
-          asio::bind_executor(m_strand,
+          asio::bind_executor(asyncResponse->getStrand(),
                               boost::bind(&AsyncObserver::handlerCompleted, asyncResponse)));
     }
 
@@ -1003,7 +1006,8 @@ namespace mtconnect {
 
         asyncResponse->m_session->writeChunk(
             content, asio::bind_executor(
-                         m_strand, boost::bind(&AsyncObserver::handlerCompleted, asyncResponse)));
+                         asyncResponse->getStrand(),
+                         boost::bind(&AsyncObserver::handlerCompleted, asyncResponse)));
 
         return end;
       }
@@ -1031,11 +1035,12 @@ namespace mtconnect {
     struct AsyncCurrentResponse
     {
       AsyncCurrentResponse(rest_sink::SessionPtr session, asio::io_context &context)
-        : m_session(session), m_timer(context)
+        : m_session(session), m_strand(context), m_timer(context)
       {}
 
       std::weak_ptr<Sink> m_service;
       rest_sink::SessionPtr m_session;
+      asio::io_context::strand m_strand;
       chrono::milliseconds m_interval;
       const Printer *m_printer {nullptr};
       FilterSetOpt m_filter;
@@ -1056,7 +1061,7 @@ namespace mtconnect {
         dev = checkDevice(printer, *device);
       }
 
-      auto asyncResponse = make_shared<AsyncCurrentResponse>(session, m_context);
+      auto asyncResponse = make_shared<AsyncCurrentResponse>(session, session->getContext());
       if (path || device || deviceType)
       {
         asyncResponse->m_filter = make_optional<FilterSet>();
@@ -1068,7 +1073,8 @@ namespace mtconnect {
       asyncResponse->m_pretty = pretty;
 
       asyncResponse->m_session->beginStreaming(
-          printer->mimeType(), boost::asio::bind_executor(m_strand, [this, asyncResponse]() {
+          printer->mimeType(),
+          boost::asio::bind_executor(asyncResponse->m_strand, [this, asyncResponse]() {
             streamNextCurrent(asyncResponse, boost::system::error_code {});
           }));
     }
@@ -1105,10 +1111,11 @@ namespace mtconnect {
         asyncResponse->m_session->writeChunk(
             fetchCurrentData(asyncResponse->m_printer, asyncResponse->m_filter, nullopt,
                              asyncResponse->m_pretty),
-            boost::asio::bind_executor(m_strand, [this, asyncResponse]() {
+            boost::asio::bind_executor(asyncResponse->m_strand, [this, asyncResponse]() {
               asyncResponse->m_timer.expires_from_now(asyncResponse->m_interval);
               asyncResponse->m_timer.async_wait(boost::asio::bind_executor(
-                  m_strand, boost::bind(&RestService::streamNextCurrent, this, asyncResponse, _1)));
+                  asyncResponse->m_strand,
+                  boost::bind(&RestService::streamNextCurrent, this, asyncResponse, _1)));
             }));
       }
       catch (RequestError &re)
@@ -1480,6 +1487,7 @@ namespace mtconnect {
     {
       std::unique_ptr<ObservationList> observations;
       SequenceNumber_t firstSeq, lastSeq;
+      CircularBuffer::ScanRange range;
 
       {
         std::lock_guard<CircularBuffer> lock(m_sinkContract->getCircularBuffer());
@@ -1501,10 +1509,14 @@ namespace mtconnect {
         }
         checkRange(printer, count, lowerCountLimit, upperCountLimit, "count", true);
 
-        observations = m_sinkContract->getCircularBuffer().getObservations(
-            count, filterSet, from, to, end, firstSeq, endOfBuffer);
+        range = m_sinkContract->getCircularBuffer().getScanRange(count, from, to);
+        firstSeq = range.m_firstSeq;
       }
 
+      // Scan without holding the lock so observations can be added during large scans
+      observations =
+          m_sinkContract->getCircularBuffer().getObservations(range, filterSet, end, endOfBuffer);
+
       return printer->printSample(m_instanceId, m_sinkContract->getCircularBuffer().getBufferSize(),
                                   end, firstSeq, lastSeq, *observations, pretty);
     }
@@ -49,6 +49,28 @@ namespace mtconnect::sink::rest_sink {
   using std::placeholders::_1;
   using std::placeholders::_2;
 
+  // Select h2 when the agent is built with HTTP/2 and the client offers it, otherwise HTTP/1.1.
+  // Clients that only prefer h2 use HTTP/1.1 instead of failing the handshake.
+  static int selectAlpnProtocol(SSL *ssl, const unsigned char **out, unsigned char *outlen,
+                                const unsigned char *in, unsigned int inlen, void *arg)
+  {
+#ifdef WITH_HTTP2
+    static const unsigned char protocols[] = {2,   'h', '2', 8,   'h', 't',
+                                              't', 'p', '/', '1', '.', '1'};
+#else
+    static const unsigned char protocols[] = {8, 'h', 't', 't', 'p', '/', '1', '.', '1'};
+#endif
+    unsigned char *selected;
+    if (SSL_select_next_proto(&selected, outlen, protocols, sizeof(protocols), in, inlen) !=
+        OPENSSL_NPN_NEGOTIATED)
+    {
+      return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+  }
+
   void Server::loadTlsCertificate()
   {
     if (HasOption(m_options, configuration::TlsCertificateChain) &&
@@ -71,6 +93,7 @@ namespace mtconnect::sink::rest_sink {
       m_sslContext.use_private_key_file(*GetOption<string>(m_options, configuration::TlsPrivateKey),
                                         asio::ssl::context::file_format::pem);
       m_sslContext.use_tmp_dh_file(*GetOption<string>(m_options, configuration::TlsDHKey));
+      SSL_CTX_set_alpn_select_cb(m_sslContext.native_handle(), selectAlpnProtocol, nullptr);
 
       m_tlsEnabled = true;
 
@@ -95,6 +118,7 @@ namespace mtconnect::sink::rest_sink {
     try
     {
       m_run = true;
+      startThreads();
       listen();
     }
     catch (exception &e)
@@ -104,6 +128,46 @@ namespace mtconnect::sink::rest_sink {
     }
   }
 
+  // Each session thread runs its own io_context so the connections it owns are never contended
+  // by other threads.
+  void Server::startThreads()
+  {
+    if (m_threadCount <= 0 || !m_threads.empty())
+      return;
+
+    LOG(info) << "Starting " << m_threadCount << " HTTP session threads";
+    if (m_contexts.empty())
+    {
+      for (int i = 0; i < m_threadCount; i++)
+        m_contexts.emplace_back(make_unique<asio::io_context>(1));
+    }
+
+    for (auto &context : m_contexts)
+    {
+      context->restart();
+      m_guards.emplace_back(context->get_executor());
+      m_threads.emplace_back([ctx = context.get()]() { ctx->run(); });
+    }
+  }
+
+  // The contexts are retained until the server is destroyed since sessions may still hold sockets
+  // created on them.
+  void Server::stopThreads()
+  {
+    m_guards.clear();
+    for (auto &context : m_contexts)
+      context->stop();
+
+    for (auto &thread : m_threads)
+    {
+      if (thread.get_id() == this_thread::get_id())
+        thread.detach();
+      else if (thread.joinable())
+        thread.join();
+    }
+    m_threads.clear();
+  }
+
   // Listen for an HTTP server connection
   void Server::listen()
   {
@@ -144,7 +208,7 @@ namespace mtconnect::sink::rest_sink {
     }
 
     m_listening = true;
-    m_acceptor.async_accept(net::make_strand(m_context),
+    m_acceptor.async_accept(net::make_strand(nextContext()),
                             beast::bind_front_handler(&Server::accept, this));
   }
 
@@ -216,7 +280,7 @@ namespace mtconnect::sink::rest_sink {
 
         session->run();
       }
-      m_acceptor.async_accept(net::make_strand(m_context),
+      m_acceptor.async_accept(net::make_strand(nextContext()),
                               beast::bind_front_handler(&Server::accept, this));
     }
   }
@@ -18,6 +18,8 @@
 #pragma once
 
 #include <boost/asio/connect.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/beast/http/status.hpp>
@@ -26,6 +28,8 @@
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <regex>
 #include <sstream>
@@ -53,10 +57,12 @@ namespace mtconnect::sink::rest_sink {
     /// - Port, defaults to 5000
     /// - AllowPut, defaults to false
     /// - ServerIp, defaults to 0.0.0.0
+    /// - ServerThreads, defaults to 0 to run sessions on `context`
     /// - HttpHeaders
     Server(boost::asio::io_context &context, const ConfigOptions &options = {})
       : m_context(context),
         m_port(GetOption<int>(options, configuration::Port).value_or(5000)),
+        m_threadCount(GetOption<int>(options, configuration::ServerThreads).value_or(0)),
         m_options(options),
         m_allowPuts(IsOptionSet(options, configuration::AllowPut)),
         m_acceptor(context),
@@ -86,6 +92,9 @@ namespace mtconnect::sink::rest_sink {
       addSwaggerRoutings();
     }
 
+    /// @brief Stops the session threads
+    ~Server() { stopThreads(); }
+
     /// @brief Start the http server
     void start();
 
@@ -94,6 +103,7 @@ namespace mtconnect::sink::rest_sink {
     {
       m_run = false;
       m_acceptor.close();
+      stopThreads();
     };
 
     /// @brief Listen for async connections
@@ -119,6 +129,9 @@ namespace mtconnect::sink::rest_sink {
     /// @brief get the bind port
     /// @return the port being bound
     auto getPort() const { return m_port; }
+    /// @brief get the number of threads dedicated to sessions
+    /// @return the number of session threads, `0` if sessions share the agent context
+    auto getThreadCount() const { return m_threadCount; }
 
     /// @name PUT and POST handling
     ///@{
@@ -210,6 +223,21 @@ namespace mtconnect::sink::rest_sink {
     /// @param[in] what the description why the request failed
     void fail(boost::system::error_code ec, char const *what);
 
+    /// @brief get the context for the next accepted session
+    ///
+    /// Round robins between the session contexts so each connection is serviced by a single
+    /// thread. If there are no session threads, returns the agent context.
+    /// @return an io context
+    boost::asio::io_context &nextContext()
+    {
+      if (m_contexts.empty())
+        return m_context;
+
+      auto &context = *m_contexts[m_nextContext];
+      m_nextContext = (m_nextContext + 1) % m_contexts.size();
+      return context;
+    }
+
     /// @brief Add a routing to the server
     /// @param[in] routing the routing
     Routing &addRouting(const Routing &routing)
@@ -242,6 +270,8 @@ namespace mtconnect::sink::rest_sink {
 
   protected:
     void loadTlsCertificate();
+    void startThreads();
+    void stopThreads();
 
     /// @name Swagger Support
     /// @{
@@ -263,6 +293,14 @@ namespace mtconnect::sink::rest_sink {
     boost::asio::ip::address m_address;
     unsigned short m_port {5000};
 
+    using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+    int m_threadCount {0};
+    std::vector<std::unique_ptr<boost::asio::io_context>> m_contexts;
+    std::list<WorkGuard> m_guards;
+    std::vector<std::thread> m_threads;
+    size_t m_nextContext {0};
+
     bool m_run {false};
     bool m_listening {false};
 
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/address.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/http/status.hpp>
@@ -73,6 +74,9 @@ namespace mtconnect::sink::rest_sink {
     virtual void close() = 0;
     /// @brief close the stream
     virtual void closeStream() = 0;
+    /// @brief get the io context servicing this session
+    /// @return the io context
+    virtual boost::asio::io_context &getContext() = 0;
     /// @brief Log a failure and close the session
     /// @param status the HTTP status
     /// @param message the message
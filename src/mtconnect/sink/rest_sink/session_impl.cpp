@@ -30,11 +30,17 @@
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
+#include <cstring>
+
 #include "mtconnect/logging.hpp"
 #include "request.hpp"
 #include "response.hpp"
 #include "tls_dector.hpp"
 
+#ifdef WITH_HTTP2
+#include "http2_session.hpp"
+#endif
+
 namespace mtconnect::sink::rest_sink {
   namespace beast = boost::beast;  // from <boost/beast.hpp>
   namespace http = beast::http;    // from <boost/beast/http.hpp>
@@ -149,9 +155,6 @@ namespace mtconnect::sink::rest_sink {
   template <class Derived>
   void SessionImpl<Derived>::reset()
   {
-    m_response.reset();
-    m_request.reset();
-    m_serializer.reset();
     m_boundary.clear();
     m_mimeType.clear();
 
@@ -171,6 +174,7 @@ namespace mtconnect::sink::rest_sink {
   {
     NAMED_SCOPE("SessionImpl::read");
     reset();
+    m_reading = true;
     m_parser->body_limit(100000);
     beast::get_lowest_layer(derived().stream()).expires_after(30s);
     http::async_read(derived().stream(), m_buffer, *m_parser,
@@ -182,12 +186,39 @@ namespace mtconnect::sink::rest_sink {
   {
     NAMED_SCOPE("SessionImpl::requested");
 
+    m_reading = false;
+
+    // Clients with prior knowledge start with the `PRI * HTTP/2.0` connection preface, which the
+    // parser rejects as a bad version. Hand the connection over to HTTP/2 when it is built in,
+    // otherwise answer with a 505. h2c upgrade requests are ignored and answered with HTTP/1.1.
+    if (ec == http::error::bad_version && m_requests == 0)
+    {
+      auto received = beast::buffers_to_string(m_buffer.data());
+      if (received.rfind("PRI * HTTP/2.0", 0) == 0)
+      {
+#ifdef WITH_HTTP2
+        m_buffer.consume(m_buffer.size());
+        upgrade(received);
+#else
+        m_close = true;
+        fail(http::status::http_version_not_supported, "Only HTTP/1.1 is supported");
+#endif
+        return;
+      }
+    }
+
     if (ec)
     {
-      fail(status::internal_server_error, "Could not read request", ec);
+      // The client may close its side after sending pipelined requests, finish the responses
+      // before closing the connection.
+      if (ec == http::error::end_of_stream && (m_writing || awaitingResponse()))
+        m_close = true;
+      else
+        fail(status::internal_server_error, "Could not read request", ec);
       return;
     }
 
+    m_requests++;
     if (m_unauthorized)
     {
       fail(status::unauthorized, m_message, ec);
@@ -216,7 +247,11 @@ namespace mtconnect::sink::rest_sink {
       }
     }
 
-    m_request = make_shared<Request>();
+    // Reuse the request unless a handler is still holding on to it
+    if (m_request && m_request.use_count() == 1)
+      m_request->clear();
+    else
+      m_request = make_shared<Request>();
     m_request->m_verb = msg.method();
     m_request->m_path = parseUrl(string(msg.target()), m_request->m_query);
 
@@ -226,7 +261,7 @@ namespace mtconnect::sink::rest_sink {
       m_request->m_contentType = string(a->value());
     if (auto a = msg.find(http::field::accept_encoding); a != msg.end())
       m_request->m_acceptsEncoding = string(a->value());
-    m_request->m_body = msg.body();
+    m_request->m_body = std::move(msg.body());
 
     if (auto f = msg.find(http::field::content_type);
         f != msg.end() && f->value() == "application/x-www-form-urlencoded" &&
@@ -249,6 +284,37 @@ namespace mtconnect::sink::rest_sink {
       txt << "Failed to find handler for " << msg.method() << " " << msg.target();
       LOG(error) << txt.str();
     }
+
+    // Read the next pipelined request while the response is being written. If the handler
+    // will respond later, wait so the responses stay in request order.
+    if (!m_streaming && !m_close && !m_reading && !awaitingResponse() &&
+        m_writes.size() < MaxPipelinedResponses)
+    {
+      read();
+    }
+  }
+
+  template <class Derived>
+  void SessionImpl<Derived>::write(PendingWrite &&pending)
+  {
+    // Responses and chunks can come from request handlers on other threads, queue them on
+    // the session strand so the write queue is only touched by one thread.
+    auto self = shared_ptr();
+    auto queued = make_shared<PendingWrite>(std::move(pending));
+    asio::dispatch(derived().stream().get_executor(), [this, self, queued]() {
+      m_writes.emplace_back(std::move(*queued));
+      writeNext();
+    });
+  }
+
+  template <class Derived>
+  void SessionImpl<Derived>::writeNext()
+  {
+    if (!m_writing && !m_writes.empty())
+    {
+      m_writing = true;
+      m_writes.front().m_start();
+    }
   }
 
   template <class Derived>
@@ -256,25 +322,31 @@ namespace mtconnect::sink::rest_sink {
   {
     NAMED_SCOPE("SessionImpl::sent");
 
-    if (m_outgoing)
+    m_writing = false;
+    Complete complete;
+    if (!m_writes.empty())
     {
-      m_outgoing.reset();
+      complete = std::move(m_writes.front().m_complete);
+      m_writes.pop_front();
     }
 
     if (ec)
     {
       fail(status::internal_server_error, "Error sending message - ", ec);
+      return;
     }
-    else if (m_complete)
+    else if (complete)
     {
-      m_complete();
+      complete();
     }
-    if (!m_streaming)
+
+    writeNext();
+    if (!m_streaming && !m_writing && !awaitingResponse())
     {
-      if (!m_close)
-        read();
-      else
+      if (m_close)
         close();
+      else if (!m_reading)
+        read();
     }
   }
 
@@ -283,33 +355,35 @@ namespace mtconnect::sink::rest_sink {
   {
     NAMED_SCOPE("SessionImpl::beginStreaming");
 
-    beast::get_lowest_layer(derived().stream()).expires_after(30s);
-
     using namespace http;
     using namespace boost::uuids;
     random_generator gen;
     m_boundary = to_string(gen());
-    m_complete = complete;
     m_mimeType = mimeType;
     m_streaming = true;
-
-    auto res = make_shared<http::response<empty_body>>(status::ok, 11);
-    m_response = res;
+    m_responses++;
+
+    response_header<> header(m_staticFields);
+    header.result(status::ok);
+    header.version(11);
+    header.set(field::connection, "close");
+    header.set(field::content_type, "multipart/mixed;boundary=" + m_boundary);
+    if (m_staticFields.find(field::expires) == m_staticFields.end())
+      header.set(field::expires, "-1");
+    if (m_staticFields.find(field::cache_control) == m_staticFields.end())
+      header.set(field::cache_control, "no-cache, no-store, max-age=0");
+
+    auto res = make_shared<http::response<empty_body>>(std::move(header));
     res->chunked(true);
-    res->set(field::server, "MTConnectAgent");
-    res->set(field::connection, "close");
-    res->set(field::content_type, "multipart/mixed;boundary=" + m_boundary);
-    res->set(field::expires, "-1");
-    res->set(field::cache_control, "no-cache, no-store, max-age=0");
-    for (const auto &f : m_fields)
-    {
-      res->set(f.first, f.second);
-    }
 
     auto sr = make_shared<response_serializer<empty_body>>(*res);
-    m_serializer = sr;
-    async_write_header(derived().stream(), *sr,
-                       beast::bind_front_handler(&SessionImpl::sent, shared_ptr()));
+    auto self = shared_ptr();
+    write({[this, self, sr]() {
+             beast::get_lowest_layer(derived().stream()).expires_after(30s);
+             async_write_header(derived().stream(), *sr,
+                                beast::bind_front_handler(&SessionImpl::sent, self));
+           },
+           complete, make_shared<pair<decltype(res), decltype(sr)>>(res, sr)});
   }
 
   template <class Derived>
@@ -319,19 +393,21 @@ namespace mtconnect::sink::rest_sink {
 
     using namespace http;
 
-    beast::get_lowest_layer(derived().stream()).expires_after(30s);
-
-    m_complete = complete;
-    m_streamBuffer.emplace();
-    ostream str(&m_streamBuffer.value());
+    auto buffer = make_shared<asio::streambuf>();
+    ostream str(buffer.get());
 
     str << "--" + m_boundary << "\r\n"
         << to_string(field::content_type) << ": " << m_mimeType << "\r\n"
         << to_string(field::content_length) << ": " << to_string(body.length()) << "\r\n\r\n"
         << body << "\r\n";
 
-    async_write(derived().stream(), http::make_chunk(m_streamBuffer->data()),
-                beast::bind_front_handler(&SessionImpl::sent, shared_ptr()));
+    auto self = shared_ptr();
+    write({[this, self, buffer]() {
+             beast::get_lowest_layer(derived().stream()).expires_after(30s);
+             async_write(derived().stream(), http::make_chunk(buffer->data()),
+                         beast::bind_front_handler(&SessionImpl::sent, self));
+           },
+           complete, buffer});
   }
 
   template <class Derived>
@@ -339,32 +415,35 @@ namespace mtconnect::sink::rest_sink {
   {
     NAMED_SCOPE("SessionImpl::closeStream");
 
-    m_complete = [this]() { close(); };
-    http::fields trailer;
-    async_write(derived().stream(), http::make_chunk_last(trailer),
-                beast::bind_front_handler(&SessionImpl::sent, shared_ptr()));
+    auto self = shared_ptr();
+    write({[this, self]() {
+             http::fields trailer;
+             async_write(derived().stream(), http::make_chunk_last(trailer),
+                         beast::bind_front_handler(&SessionImpl::sent, self));
+           },
+           [this]() { close(); }, nullptr});
   }
 
   template <class Derived>
-  template <typename Message>
-  void SessionImpl<Derived>::addHeaders(const Response &response, Message &res)
+  void SessionImpl<Derived>::addHeaders(const Response &response,
+                                        http::response_header<> &header) const
   {
-    res->set(http::field::server, "MTConnectAgent");
+    header.result(response.m_status);
+    header.version(11);
     if (response.m_close || m_close)
-      res->set(http::field::connection, "close");
+      header.set(http::field::connection, "close");
     if (response.m_expires == 0s)
     {
-      res->set(http::field::expires, "-1");
-      res->set(http::field::cache_control, "no-store, max-age=0");
-    }
-    res->set(http::field::content_type, response.m_mimeType);
-    for (const auto &f : m_fields)
-    {
-      res->set(f.first, f.second);
+      if (m_staticFields.find(http::field::expires) == m_staticFields.end())
+        header.set(http::field::expires, "-1");
+      if (m_staticFields.find(http::field::cache_control) == m_staticFields.end())
+        header.set(http::field::cache_control, "no-store, max-age=0");
     }
+    if (m_staticFields.find(http::field::content_type) == m_staticFields.end())
+      header.set(http::field::content_type, response.m_mimeType);
     if (response.m_location)
     {
-      res->set(http::field::location, *response.m_location);
+      header.set(http::field::location, *response.m_location);
     }
   }
 
@@ -378,73 +457,78 @@ namespace mtconnect::sink::rest_sink {
     namespace fs = std::filesystem;
     using std::move;
 
-    m_complete = complete;
-    m_outgoing = std::move(responsePtr);
+    std::shared_ptr<Response> outgoing(std::move(responsePtr));
+    auto self = shared_ptr();
 
-    if (m_outgoing->m_file && !m_outgoing->m_file->m_cached)
+    // The server and additional header fields are copied from the prebuilt set
+    response_header<> header(m_staticFields);
+    addHeaders(*outgoing, header);
+
+    if (outgoing->m_file && !outgoing->m_file->m_cached)
     {
       beast::error_code ec;
       http::file_body::value_type body;
       fs::path path;
       optional<string> encoding;
-      if (m_request->m_acceptsEncoding.find("gzip") != string::npos && m_outgoing->m_file->m_pathGz)
+      if (m_request && m_request->m_acceptsEncoding.find("gzip") != string::npos &&
+          outgoing->m_file->m_pathGz)
       {
         encoding.emplace("gzip");
-        path = *m_outgoing->m_file->m_pathGz;
+        path = *outgoing->m_file->m_pathGz;
       }
       else
       {
-        path = m_outgoing->m_file->m_path;
+        path = outgoing->m_file->m_path;
       }
 
       body.open(path.string().c_str(), beast::file_mode::scan, ec);
 
-      // Handle the case where the file doesn't exist
+      // Handle the case where the file doesn't exist. The not found response is written in
+      // place of this one and counts as the response to the request.
       if (ec == beast::errc::no_such_file_or_directory)
-        return fail(boost::beast::http::status::not_found, "File Not Found", ec);
+        return fail(boost::beast::http::status::not_found, "File Not Found");
+
+      m_responses++;
 
       auto size = body.size();
-      auto res = make_shared<http::response<http::file_body>>(
-          std::piecewise_construct, std::make_tuple(std::move(body)),
-          std::make_tuple(m_outgoing->m_status, 11));
-      res->set(http::field::content_type, m_outgoing->m_mimeType);
+      auto res = make_shared<http::response<http::file_body>>(std::move(header), std::move(body));
       res->content_length(size);
       if (encoding)
         res->set(http::field::content_encoding, "gzip");
-      addHeaders(*m_outgoing, res);
-
-      m_response = res;
 
-      async_write(derived().stream(), *res,
-                  beast::bind_front_handler(&SessionImpl::sent, shared_ptr()));
+      write({[this, self, res]() {
+               async_write(derived().stream(), *res,
+                           beast::bind_front_handler(&SessionImpl::sent, self));
+             },
+             complete, res});
     }
     else
     {
+      m_responses++;
       const char *bp;
       size_t size;
-      if (m_outgoing->m_file)
+      if (outgoing->m_file)
       {
-        bp = m_outgoing->m_file->m_buffer;
-        size = m_outgoing->m_file->m_size;
+        bp = outgoing->m_file->m_buffer;
+        size = outgoing->m_file->m_size;
       }
       else
       {
-        bp = m_outgoing->m_body.c_str();
-        size = m_outgoing->m_body.size();
+        bp = outgoing->m_body.c_str();
+        size = outgoing->m_body.size();
       }
 
-      auto res = make_shared<http::response<http::span_body<const char>>>(
-          std::piecewise_construct, std::make_tuple(bp, size),
-          std::make_tuple(m_outgoing->m_status, 11));
-
-      addHeaders(*m_outgoing, res);
+      auto res =
+          make_shared<http::response<http::span_body<const char>>>(std::move(header), bp, size);
       res->chunked(false);
       res->content_length(size);
 
-      m_response = res;
-
-      async_write(derived().stream(), *res,
-                  beast::bind_front_handler(&SessionImpl::sent, shared_ptr()));
+      // The span refers to the body of the response, keep both until the write completes
+      write({[this, self, res]() {
+               async_write(derived().stream(), *res,
+                           beast::bind_front_handler(&SessionImpl::sent, self));
+             },
+             complete, make_shared<pair<decltype(res), decltype(outgoing)>>(res, outgoing)});
     }
   }
 
@@ -453,8 +537,7 @@ namespace mtconnect::sink::rest_sink {
   {
     if (m_streaming)
     {
-      m_outgoing = std::move(response);
-      writeChunk(m_outgoing->m_body, [this] { closeStream(); });
+      writeChunk(response->m_body, [this] { closeStream(); });
     }
     else
     {
@@ -462,6 +545,28 @@ namespace mtconnect::sink::rest_sink {
     }
   }
 
+#ifdef WITH_HTTP2
+  template <class Derived>
+  void SessionImpl<Derived>::upgrade(const std::string &received)
+  {
+    NAMED_SCOPE("SessionImpl::upgrade");
+
+    using Stream = std::decay_t<decltype(derived().stream())>;
+
+    LOG(debug) << "Continuing with HTTP/2";
+    auto connection = make_shared<Http2ConnectionImpl<Stream>>(
+        std::move(derived().stream()), m_fields, m_dispatch, m_errorFunction);
+    if (!m_allowPutsFrom.empty())
+      connection->allowPutsFrom(m_allowPutsFrom);
+    else if (m_allowPuts)
+      connection->allowPuts();
+
+    m_upgraded = true;
+    m_request.reset();
+    connection->run(received);
+  }
+#endif
+
   /// @brief A secure https session
   class HttpsSession : public SessionImpl<HttpsSession>
   {
@@ -508,7 +613,7 @@ namespace mtconnect::sink::rest_sink {
     /// @brief shutdown the stream asyncronously closing the secure stream
     void close() override
     {
-      if (!m_closing)
+      if (!m_closing && !m_upgraded)
       {
         m_closing = true;
         // Set the timeout.
@@ -528,6 +633,18 @@ namespace mtconnect::sink::rest_sink {
       // Consume the portion of the buffer used by the handshake
       m_buffer.consume(bytes_used);
 
+#ifdef WITH_HTTP2
+      // Continue with HTTP/2 if it was negotiated with ALPN
+      const unsigned char *protocol = nullptr;
+      unsigned int length = 0;
+      SSL_get0_alpn_selected(m_stream.native_handle(), &protocol, &length);
+      if (length == 2 && std::memcmp(protocol, "h2", 2) == 0)
+      {
+        upgrade();
+        return;
+      }
+#endif
+
       SessionImpl<HttpsSession>::run();
     }
 
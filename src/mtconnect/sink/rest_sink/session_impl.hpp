@@ -20,6 +20,8 @@
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 
+#include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -49,7 +51,11 @@ namespace mtconnect {
       SessionImpl(boost::beast::flat_buffer &&buffer, const FieldList &list, Dispatch dispatch,
                   ErrorFunction error)
         : Session(dispatch, error), m_fields(list), m_buffer(std::move(buffer))
-      {}
+      {
+        m_staticFields.set(boost::beast::http::field::server, "MTConnectAgent");
+        for (const auto &f : m_fields)
+          m_staticFields.set(f.first, f.second);
+      }
       /// @brief Sessions cannot be copied
       SessionImpl(const SessionImpl &) = delete;
       virtual ~SessionImpl() {}
@@ -72,38 +78,71 @@ namespace mtconnect {
       void beginStreaming(const std::string &mimeType, Complete complete) override;
       void writeChunk(const std::string &chunk, Complete complete) override;
       void closeStream() override;
+      boost::asio::io_context &getContext() override
+      {
+        return static_cast<boost::asio::io_context &>(boost::asio::query(
+            derived().stream().get_executor(), boost::asio::execution::context));
+      }
       ///@}
+      /// @brief The maximum number of responses queued before reading more pipelined requests
+      static constexpr size_t MaxPipelinedResponses {8};
+
     protected:
-      template <typename T>
-      void addHeaders(const Response &response, T &res);
+      /// @brief A write waiting for the previous writes to complete
+      struct PendingWrite
+      {
+        std::function<void()> m_start;   ///< starts the async write
+        Complete m_complete;             ///< called when the write completes
+        std::shared_ptr<void> m_message; ///< keeps the message alive until it is sent
+      };
+
+      void addHeaders(const Response &response,
+                      boost::beast::http::response_header<> &header) const;
 
       void requested(boost::system::error_code ec, size_t len);
       void sent(boost::system::error_code ec, size_t len);
       void read();
       void reset();
+      void write(PendingWrite &&pending);
+      void writeNext();
+#ifdef WITH_HTTP2
+      /// @brief hand the stream over to an HTTP/2 connection
+      /// @param received bytes already read from the client
+      void upgrade(const std::string &received = "");
+#endif
+
+      /// @brief `true` if a dispatched request has not queued its response
+      bool awaitingResponse() const { return m_responses < m_requests; }
 
     protected:
       using RequestParser = boost::beast::http::request_parser<boost::beast::http::string_body>;
 
-      Complete m_complete;
       bool m_streaming {false};
 
       // For Streaming
       std::string m_boundary;
       std::string m_mimeType;
       bool m_close {false};
+      // The stream was handed over to HTTP/2
+      bool m_upgraded {false};
 
       // Additional fields
       FieldList m_fields;
+      // Server and additional fields added to every response
+      boost::beast::http::fields m_staticFields;
+
+      // Responses are written in the order the requests were received
+      std::deque<PendingWrite> m_writes;
+      bool m_writing {false};
+      bool m_reading {false};
+      uint64_t m_requests {0};
+      // Handlers can respond from other threads
+      std::atomic<uint64_t> m_responses {0};
 
       // References to retain lifecycle for callbacks.
       RequestPtr m_request;
       boost::beast::flat_buffer m_buffer;
-      std::optional<boost::asio::streambuf> m_streamBuffer;
       std::optional<RequestParser> m_parser;
-      std::shared_ptr<void> m_response;
-      std::shared_ptr<void> m_serializer;
-      ResponsePtr m_outgoing;
     };
 
     /// @brief An HTTP Session for communication without TLS
@@ -141,6 +180,9 @@ namespace mtconnect {
         NAMED_SCOPE("HttpSession::close");
 
         m_request.reset();
+        if (m_upgraded)
+          return;
+
         boost::beast::error_code ec;
         m_stream.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
       }
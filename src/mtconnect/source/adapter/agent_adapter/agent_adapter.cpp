@@ -88,6 +88,8 @@ namespace mtconnect::source::adapter::agent_adapter {
                          {configuration::RelativeTime, false},
                          {configuration::UsePolling, false},
                          {configuration::EnableSourceDeviceModels, false},
+                         {configuration::StreamFormat, "xml"s},
+                         {configuration::EnableCompression, false},
                          {"!CloseConnectionAfterResponse!", false}});
 
     m_handler = m_pipeline.makeHandler();
@@ -114,6 +116,17 @@ namespace mtconnect::source::adapter::agent_adapter {
     m_reconnectInterval = *GetOption<Milliseconds>(m_options, configuration::ReconnectInterval);
     m_pollingInterval = *GetOption<Milliseconds>(m_options, configuration::PollingInterval);
     m_probeAgent = *GetOption<bool>(m_options, configuration::EnableSourceDeviceModels);
+    m_enableCompression = *GetOption<bool>(m_options, configuration::EnableCompression);
+
+    auto format = *GetOption<string>(m_options, configuration::StreamFormat);
+    if (boost::iequals(format, "json"))
+    {
+      m_streamAccept = "application/mtconnect+json";
+    }
+    else if (!boost::iequals(format, "xml"))
+    {
+      LOG(warning) << "Agent Adapter: unknown StreamFormat " << format << ", using xml";
+    }
 
     m_closeConnectionAfterResponse = *GetOption<bool>(m_options, "!CloseConnectionAfterResponse!");
 
@@ -188,11 +201,13 @@ namespace mtconnect::source::adapter::agent_adapter {
     m_session->m_handler = m_handler.get();
     m_session->m_identity = m_identity;
     m_session->m_closeConnectionAfterResponse = m_closeConnectionAfterResponse;
+    m_session->m_enableCompression = m_enableCompression;
     m_session->m_updateAssets = [this]() { updateAssets(); };
 
     m_assetSession->m_handler = m_handler.get();
     m_assetSession->m_identity = m_identity;
     m_assetSession->m_closeConnectionAfterResponse = m_closeConnectionAfterResponse;
+    m_assetSession->m_enableCompression = m_enableCompression;
 
     using namespace std::placeholders;
     m_assetSession->m_failed = std::bind(&AgentAdapter::assetsFailed, this, _1);
@@ -396,6 +411,7 @@ namespace mtconnect::source::adapter::agent_adapter {
 
     m_streamRequest.emplace(m_sourceDevice, "current", UrlQuery(), false,
                             [this]() { return sample(); });
+    m_streamRequest->m_accept = m_streamAccept;
     return m_session->makeRequest(*m_streamRequest);
   }
 
@@ -420,6 +436,7 @@ namespace mtconnect::source::adapter::agent_adapter {
             }));
         return true;
       });
+      m_streamRequest->m_accept = m_streamAccept;
       m_session->makeRequest(*m_streamRequest);
     }
     else
@@ -430,6 +447,7 @@ namespace mtconnect::source::adapter::agent_adapter {
                       {"heartbeat", lexical_cast<string>(m_heartbeat.count())},
                       {"interval", lexical_cast<string>(m_pollingInterval.count())}});
       m_streamRequest.emplace(m_sourceDevice, "sample", query, true, nullptr);
+      m_streamRequest->m_accept = m_streamAccept;
       m_session->makeRequest(*m_streamRequest);
     }
 
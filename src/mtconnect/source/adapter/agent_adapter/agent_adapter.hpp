@@ -135,6 +135,10 @@ namespace mtconnect::source::adapter::agent_adapter {
     bool m_stopped = false;
     bool m_usePolling = false;
     bool m_probeAgent = false;
+    bool m_enableCompression = false;
+
+    // Mime type requested for current and sample, probe and assets are always XML
+    std::optional<std::string> m_streamAccept;
 
     std::chrono::milliseconds m_reconnectInterval;
     std::chrono::milliseconds m_pollingInterval;
@@ -0,0 +1,95 @@
+
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#pragma once
+
+#include <zlib.h>
+
+#include <cstring>
+#include <string_view>
+
+#include "mtconnect/config.hpp"
+
+namespace mtconnect::source::adapter::agent_adapter {
+  /// @brief Incremental decoder for a `Content-Encoding: gzip` response body
+  ///
+  /// The body is decoded as it arrives so each part of a multipart stream is available as soon
+  /// as the upstream agent flushes it. Concatenated gzip members are decoded in sequence.
+  class GzipDecoder
+  {
+  public:
+    GzipDecoder()
+    {
+      memset(&m_stream, 0, sizeof(m_stream));
+      // 16 + MAX_WBITS expects the gzip header and trailer
+      m_valid = inflateInit2(&m_stream, 16 + MAX_WBITS) == Z_OK;
+    }
+    GzipDecoder(const GzipDecoder &) = delete;
+    ~GzipDecoder() { inflateEnd(&m_stream); }
+
+    /// @brief decode the next part of the body
+    /// @param[in] input compressed bytes
+    /// @param[in] out called with each block of decoded bytes: `out(const char *, size_t)`
+    /// @return `false` if the body is not valid gzip data
+    template <typename Out>
+    bool decode(std::string_view input, Out &&out)
+    {
+      if (!m_valid)
+        return false;
+
+      m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+      m_stream.avail_in = static_cast<uInt>(input.size());
+
+      do
+      {
+        m_stream.next_out = reinterpret_cast<Bytef *>(m_buffer);
+        m_stream.avail_out = sizeof(m_buffer);
+
+        auto ret = inflate(&m_stream, Z_SYNC_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+        {
+          m_valid = false;
+          return false;
+        }
+
+        auto produced = sizeof(m_buffer) - m_stream.avail_out;
+        if (produced > 0)
+          out(m_buffer, produced);
+
+        if (ret == Z_STREAM_END)
+        {
+          if (inflateReset(&m_stream) != Z_OK)
+          {
+            m_valid = false;
+            return false;
+          }
+        }
+        else if (ret == Z_BUF_ERROR && produced == 0)
+        {
+          break;
+        }
+      } while (m_stream.avail_in > 0 || m_stream.avail_out == 0);
+
+      return true;
+    }
+
+  protected:
+    z_stream m_stream;
+    bool m_valid {false};
+    char m_buffer[16 * 1024];
+  };
+}  // namespace mtconnect::source::adapter::agent_adapter
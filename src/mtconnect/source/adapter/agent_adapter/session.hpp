@@ -69,6 +69,8 @@ namespace mtconnect::source::adapter::agent_adapter {
       bool m_stream;               ///< `true` if using HTTP long pull
       Next m_next;                 ///< function to call on successful read
       int32_t m_agentVersion = 0;  ///< agent version if required > 0 for asset requests
+      /// Mime type for the Accept header, the agent default if not set
+      std::optional<std::string> m_accept;
 
       /// @brief Given a url, get a formatted target for a given operation
       /// @param url The base url
@@ -106,6 +108,7 @@ namespace mtconnect::source::adapter::agent_adapter {
     bool m_closeConnectionAfterResponse = false;
     std::chrono::milliseconds m_timeout = std::chrono::milliseconds(30000);
     bool m_closeOnRead = false;
+    bool m_enableCompression = false;  ///< request a gzip encoded response
   };
 
 }  // namespace mtconnect::source::adapter::agent_adapter
@@ -28,6 +28,7 @@
 #include "mtconnect/config.hpp"
 #include "mtconnect/pipeline/mtconnect_xml_transform.hpp"
 #include "mtconnect/pipeline/response_document.hpp"
+#include "gzip_decoder.hpp"
 #include "session.hpp"
 
 namespace mtconnect::source::adapter::agent_adapter {
@@ -102,6 +103,7 @@ namespace mtconnect::source::adapter::agent_adapter {
         m_headerParser.reset();
         m_chunkParser.reset();
         m_textParser.reset();
+        m_decoder.reset();
         m_req.reset();
         m_hasHeader = false;
         if (m_chunk.size() > 0)
@@ -238,6 +240,10 @@ namespace mtconnect::source::adapter::agent_adapter {
       m_req->set(http::field::host, m_url.getHost());
       m_req->set(http::field::user_agent, "MTConnect Agent/2.0");
       m_req->set(http::field::connection, "keep-alive");
+      if (m_request->m_accept)
+        m_req->set(http::field::accept, *m_request->m_accept);
+      if (m_enableCompression)
+        m_req->set(http::field::accept_encoding, "gzip");
 
       if (m_closeConnectionAfterResponse)
       {
@@ -322,6 +328,13 @@ namespace mtconnect::source::adapter::agent_adapter {
         m_closeOnRead = a->value() == "close";
       }
 
+      if (auto e = msg.find(http::field::content_encoding);
+          e != msg.end() && beast::iequals(e->value(), "gzip"))
+      {
+        LOG(trace) << "Agent adapter: decoding gzip content";
+        m_decoder.emplace();
+      }
+
       if (m_request->m_stream && m_headerParser->chunked())
       {
         onChunkedContent();
@@ -361,7 +374,21 @@ namespace mtconnect::source::adapter::agent_adapter {
       if (!derived().lowestLayer().socket().is_open())
         derived().disconnect();
 
-      processData(m_textParser->get().body());
+      if (m_decoder)
+      {
+        auto &body = m_textParser->get().body();
+        string data;
+        if (!m_decoder->decode(body, [&data](const char *p, size_t n) { data.append(p, n); }))
+        {
+          LOG(error) << "Agent adapter: cannot decode gzip response";
+          return failed(source::make_error_code(ErrorCode::RETRY_REQUEST), "decode");
+        }
+        processData(data);
+      }
+      else
+      {
+        processData(m_textParser->get().body());
+      }
 
       m_textParser.reset();
       m_req.reset();
@@ -523,26 +550,51 @@ namespace mtconnect::source::adapter::agent_adapter {
           return body.size();
         }
 
+        auto previous = m_chunk.size();
+        if (m_decoder)
+        {
+          // Decode the stream as it arrives, a chunk may hold several parts or part of one
+          std::string_view data(body.data(), body.size());
+          if (!m_decoder->decode(data, [this](const char *p, size_t n) {
+                auto buffer = m_chunk.prepare(n);
+                memcpy(buffer.data(), p, n);
+                m_chunk.commit(n);
+              }))
+          {
+            derived().lowestLayer().close();
+            failed(source::make_error_code(source::ErrorCode::RESTART_STREAM),
+                   "Cannot decode gzip streaming data");
+            return body.size();
+          }
+        }
+        else
         {
           std::ostream cstr(&m_chunk);
           cstr << body;
         }
 
-        LOG(trace) << "Received: -------- " << m_chunk.size() << " " << remain << "\n"
-                   << body << "\n-------------";
+        // Log the data added to the chunk, the body is compressed if the stream is gzip encoded
+        LOG(trace) << "Received: -------- " << m_chunk.size() << " " << remain << " "
+                   << body.size() << "\n"
+                   << string_view(static_cast<const char *>(m_chunk.data().data()) + previous,
+                                  m_chunk.size() - previous)
+                   << "\n-------------";
 
-        if (!m_hasHeader)
+        while (m_request)
         {
-          if (!parseMimeHeader())
+          if (!m_hasHeader)
           {
-            LOG(trace) << "Insufficient data to parse chunk header, wait for more data";
-            return body.size();
+            if (!parseMimeHeader())
+            {
+              LOG(trace) << "Insufficient data to parse chunk header, wait for more data";
+              break;
+            }
           }
-        }
 
-        auto len = m_chunk.size();
-        if (len >= m_chunkLength)
-        {
+          auto len = m_chunk.size();
+          if (len < m_chunkLength)
+            break;
+
           auto start = static_cast<const char *>(m_chunk.data().data());
           string_view sbuf(start, m_chunkLength);
 
@@ -608,6 +660,7 @@ namespace mtconnect::source::adapter::agent_adapter {
     size_t m_chunkLength;
     bool m_hasHeader = false;
     boost::asio::streambuf m_chunk;
+    std::optional<GzipDecoder> m_decoder;
 
     // For request queuing
     std::optional<Request> m_request;
@@ -19,6 +19,10 @@
 #include <gtest/gtest.h>
 // Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
 
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
 #include <chrono>
 #include <iostream>
 #include <map>
@@ -34,6 +38,7 @@
 #include "mtconnect/printer//xml_printer.hpp"
 #include "mtconnect/source/adapter/adapter.hpp"
 #include "mtconnect/source/adapter/agent_adapter/agent_adapter.hpp"
+#include "mtconnect/source/adapter/agent_adapter/gzip_decoder.hpp"
 #include "mtconnect/source/adapter/agent_adapter/url_parser.hpp"
 #include "test_utilities.hpp"
 
@@ -758,3 +763,93 @@ TEST_F(AgentAdapterTest, should_create_device_when_option_supplied)
   }
   ASSERT_GE(2, rc);
 }
+
+TEST_F(AgentAdapterTest, should_receive_json_sample_when_format_is_json)
+{
+  createAgent();
+
+  auto port = m_agentTestHelper->m_restService->getServer()->getPort();
+  auto adapter = createAdapter(port, {{configuration::StreamFormat, "json"s}});
+
+  addAdapter();
+
+  unique_ptr<source::adapter::Handler> handler = make_unique<Handler>();
+
+  int rc = 0, json = 0;
+  ResponseDocument rd;
+  handler->m_processData = [&](const string &d, const string &s) {
+    if (d.find("\"MTConnectStreams\"") != string::npos)
+      json++;
+    ResponseDocument::parse(d, rd, m_context);
+    rc++;
+
+    adapter->getFeedback().m_next = rd.m_next;
+  };
+  handler->m_connecting = [&](const string id) {};
+  handler->m_connected = [&](const string id) {};
+
+  adapter->setHandler(handler);
+  adapter->start();
+
+  boost::asio::steady_timer timeout(m_agentTestHelper->m_ioContext, 2s);
+  timeout.async_wait([](boost::system::error_code ec) {
+    if (!ec)
+    {
+      throw runtime_error("test timed out");
+    }
+  });
+
+  while (rc < 2)
+  {
+    m_agentTestHelper->m_ioContext.run_one();
+  }
+  ASSERT_EQ(2, rc);
+  ASSERT_LE(1, json);
+
+  ASSERT_EQ(32, rd.m_entities.size());
+  rd.m_entities.clear();
+
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:00Z|execution|READY");
+
+  while (rd.m_entities.empty())
+  {
+    m_agentTestHelper->m_ioContext.run_one();
+  }
+  ASSERT_LE(2, json);
+  ASSERT_EQ(1, rd.m_entities.size());
+
+  auto obs = rd.m_entities.front();
+  ASSERT_EQ("p5", get<string>(obs->getProperty("dataItemId")));
+  ASSERT_EQ("READY", obs->getValue<string>());
+
+  timeout.cancel();
+}
+
+TEST_F(AgentAdapterTest, should_decode_gzip_content_as_it_arrives)
+{
+  namespace io = boost::iostreams;
+
+  string document;
+  for (int i = 0; i < 1000; i++)
+    document.append("<Line dataItemId=\"p3\">" + to_string(i) + "</Line>\n");
+
+  string compressed;
+  {
+    io::filtering_ostream out;
+    out.push(io::gzip_compressor());
+    out.push(io::back_inserter(compressed));
+    out << document;
+  }
+
+  GzipDecoder decoder;
+  string decoded;
+  for (size_t i = 0; i < compressed.size(); i += 100)
+  {
+    ASSERT_TRUE(decoder.decode(string_view(compressed).substr(i, 100),
+                               [&decoded](const char *p, size_t n) { decoded.append(p, n); }));
+  }
+  ASSERT_EQ(document, decoded);
+
+  GzipDecoder invalid;
+  ASSERT_FALSE(invalid.decode("not compressed", [](const char *, size_t) {}));
+}
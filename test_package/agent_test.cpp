@@ -23,6 +23,8 @@
 // Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
 
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -33,6 +35,7 @@
 #include "mtconnect/agent.hpp"
 #include "mtconnect/asset/file_asset.hpp"
 #include "mtconnect/device_model/reference.hpp"
+#include "mtconnect/parser/xml_parser.hpp"
 #include "mtconnect/printer//xml_printer.hpp"
 #include "mtconnect/source/adapter/adapter.hpp"
 #include "test_utilities.hpp"
@@ -205,6 +208,120 @@ TEST_F(AgentTest, GoodPath)
   }
 }
 
+TEST_F(AgentTest, should_cache_resolved_paths_until_device_model_changes)
+{
+  auto agent = m_agentTestHelper->getAgent();
+  auto &cache = agent->getPathCache();
+  ASSERT_EQ(0, cache.size());
+
+  {
+    QueryMap query {{"path", "//Power"}};
+    PARSE_XML_RESPONSE_QUERY("/current", query);
+    ASSERT_XML_PATH_COUNT(doc, "//m:ComponentStream", 1);
+  }
+  ASSERT_EQ(1, cache.size());
+
+  {
+    QueryMap query {{"path", "//Power"}};
+    PARSE_XML_RESPONSE_QUERY("/current", query);
+    ASSERT_XML_PATH_EQUAL(doc, "//m:ComponentStream[@component='Power']//m:PowerState",
+                          "UNAVAILABLE");
+    ASSERT_XML_PATH_COUNT(doc, "//m:ComponentStream", 1);
+  }
+  ASSERT_EQ(1, cache.size());
+
+  {
+    QueryMap query {{"path", "//////Linear"}};
+    PARSE_XML_RESPONSE_QUERY("/current", query);
+    ASSERT_XML_PATH_EQUAL(doc, "//m:Error@errorCode", "INVALID_XPATH");
+  }
+  ASSERT_EQ(1, cache.size());
+
+  addAdapter();
+  {
+    QueryMap query {{"path", "//Power"}};
+    PARSE_XML_RESPONSE_QUERY("/current", query);
+    ASSERT_XML_PATH_COUNT(doc, "//m:ComponentStream", 1);
+  }
+  ASSERT_EQ(1, cache.size());
+
+  m_agentTestHelper->m_adapter->parseBuffer("* uuid: MK-1234\n");
+  ASSERT_EQ(0, cache.size());
+}
+
+TEST_F(AgentTest, should_not_cache_paths_resolved_before_the_device_model_changed)
+{
+  parser::PathCache cache(4);
+  FilterSet filter {"a", "b"};
+
+  auto generation = cache.getGeneration();
+  cache.insert("old", filter, generation);
+  ASSERT_EQ(1, cache.size());
+
+  // A path resolved while the model was reloading must not survive the clear
+  generation = cache.getGeneration();
+  cache.clear();
+  cache.insert("stale", filter, generation);
+  ASSERT_EQ(0, cache.size());
+
+  FilterSet found;
+  ASSERT_FALSE(cache.find("stale", found));
+
+  cache.insert("current", filter, cache.getGeneration());
+  ASSERT_EQ(1, cache.size());
+  ASSERT_TRUE(cache.find("current", found));
+  ASSERT_EQ(filter, found);
+}
+
+TEST_F(AgentTest, should_refer_to_updated_data_items_in_the_buffer_and_checkpoints)
+{
+  addAdapter();
+  auto agent = m_agentTestHelper->getAgent();
+  m_agentTestHelper->m_adapter->parseBuffer("2021-02-01T12:00:00Z|line|204\n");
+
+  auto &buffer = agent->getCircularBuffer();
+  auto obs = buffer.getFromBuffer(buffer.getSequence() - 1);
+  ASSERT_TRUE(obs);
+  ASSERT_EQ(agent->getDataItemById("p3"), obs->getDataItem());
+
+  // Load the device again with the line data item renamed
+  string xml;
+  {
+    ifstream in(TEST_RESOURCE_DIR "/samples/test_config.xml");
+    stringstream str;
+    str << in.rdbuf();
+    xml = str.str();
+  }
+  string line {"id=\"p3\" name=\"line\""};
+  auto pos = xml.find(line);
+  ASSERT_NE(string::npos, pos);
+  xml.replace(pos, line.size(), "id=\"p3\" name=\"lineNumber\"");
+
+  auto file = std::filesystem::temp_directory_path() / "agent_test_updated_device.xml";
+  {
+    ofstream out(file);
+    out << xml;
+  }
+
+  printer::XmlPrinter printer;
+  parser::XmlParser parser;
+  auto devices = parser.parseFile(file.string(), &printer);
+  std::filesystem::remove(file);
+  ASSERT_EQ(1, devices.size());
+  ASSERT_TRUE(agent->receiveDevice(devices.front(), false));
+
+  auto replacement = agent->getDataItemById("p3");
+  ASSERT_TRUE(replacement);
+  ASSERT_EQ("lineNumber", *replacement->getName());
+
+  // The observations in the buffer and checkpoints follow the handle to the new data item
+  ASSERT_FALSE(obs->isOrphan());
+  ASSERT_EQ(replacement, obs->getDataItem());
+  ASSERT_EQ(replacement, buffer.getLatest().getObservations().at("p3")->getDataItem());
+  auto checkpoint = buffer.getCheckpointAt(buffer.getSequence() - 1, nullopt);
+  ASSERT_EQ(replacement, checkpoint->getObservations().at("p3")->getDataItem());
+}
+
 TEST_F(AgentTest, BadPath)
 {
   using namespace rest_sink;
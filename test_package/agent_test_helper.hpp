@@ -48,7 +48,9 @@ namespace mtconnect {
       class TestSession : public Session
       {
       public:
-        using Session::Session;
+        TestSession(Dispatch dispatch, ErrorFunction func, boost::asio::io_context &context)
+          : Session(dispatch, func), m_context(context)
+        {}
         ~TestSession() {}
         std::shared_ptr<TestSession> shared_ptr()
         {
@@ -94,7 +96,9 @@ namespace mtconnect {
         }
         void close() override { m_streaming = false; }
         void closeStream() override { m_streaming = false; }
+        boost::asio::io_context &getContext() override { return m_context; }
 
+        boost::asio::io_context &m_context;
         std::string m_body;
         std::string m_mimeType;
         boost::beast::http::status m_code;
@@ -267,7 +271,8 @@ public:
     m_server = m_restService->getServer();
 
     m_session = std::make_shared<mhttp::TestSession>(
-        [](mhttp::SessionPtr, mhttp::RequestPtr) { return true; }, m_server->getErrorFunction());
+        [](mhttp::SessionPtr, mhttp::RequestPtr) { return true; }, m_server->getErrorFunction(),
+        m_ioContext);
     return m_agent.get();
   }
 
@@ -332,3 +332,132 @@ TEST_F(AssetBufferTest, verify_asset_counts_with_removal)
   ASSERT_EQ(6, counts10["Asset2"]);
   ASSERT_EQ(2, counts10["Asset3"]);
 }
+
+TEST_F(AssetBufferTest, should_get_active_assets_by_device_and_type_most_recent_first)
+{
+  m_assetBuffer = make_unique<AssetBuffer>(12);
+  makeTypeAssets();
+
+  m_assetBuffer->removeAsset("A4");
+  m_assetBuffer->removeAsset("A7");
+
+  AssetList list;
+  m_assetBuffer->getAssets(list, 20, true, nullopt, "Asset1"s);
+  ASSERT_EQ(4, list.size());
+  ASSERT_EQ("A5", list.front()->getAssetId());
+  ASSERT_EQ("A1", list.back()->getAssetId());
+
+  list.clear();
+  m_assetBuffer->getAssets(list, 20, false, nullopt, "Asset1"s);
+  ASSERT_EQ(5, list.size());
+  ASSERT_EQ("A1", list.back()->getAssetId());
+
+  list.clear();
+  m_assetBuffer->getAssets(list, 20, true, "D2"s);
+  ASSERT_EQ(6, list.size());
+  ASSERT_EQ("A11", list.front()->getAssetId());
+  ASSERT_EQ("A3", list.back()->getAssetId());
+
+  list.clear();
+  m_assetBuffer->getAssets(list, 2, true, "D2"s, "Asset2"s);
+  ASSERT_EQ(2, list.size());
+  ASSERT_EQ("A11", list.front()->getAssetId());
+  ASSERT_EQ("A10", list.back()->getAssetId());
+
+  // Updating an asset makes it the most recent
+  ErrorList errors;
+  auto asset = makeAsset("Asset2", "A8", "D2", "2020-12-01T12:00:00Z", errors);
+  ASSERT_EQ(0, errors.size());
+  m_assetBuffer->addAsset(asset);
+
+  list.clear();
+  m_assetBuffer->getAssets(list, 1, true, "D2"s, "Asset2"s);
+  ASSERT_EQ(1, list.size());
+  ASSERT_EQ("A8", list.front()->getAssetId());
+
+  ASSERT_EQ(4, m_assetBuffer->getCountForDeviceAndType("D2", "Asset2"));
+  ASSERT_EQ(5, m_assetBuffer->getCountForDeviceAndType("D2", "Asset2", false));
+  ASSERT_EQ(9, m_assetBuffer->getCount());
+}
+
+TEST_F(AssetBufferTest, should_get_assets_in_a_time_range)
+{
+  ErrorList errors;
+  for (int i = 0; i < 6; i++)
+  {
+    auto asset = makeAsset("Asset", "A" + to_string(i), "D1",
+                           "2020-12-01T12:0" + to_string(i) + ":00Z", errors);
+    ASSERT_EQ(0, errors.size());
+    m_assetBuffer->addAsset(asset);
+  }
+
+  auto from = parseTimestamp("2020-12-01T12:01:00Z");
+  auto to = parseTimestamp("2020-12-01T12:04:00Z");
+
+  AssetList list;
+  m_assetBuffer->getAssetsByTime(list, 10, from, to);
+  ASSERT_EQ(4, list.size());
+  ASSERT_EQ("A4", list.front()->getAssetId());
+  ASSERT_EQ("A1", list.back()->getAssetId());
+
+  // Removing an asset changes its timestamp
+  m_assetBuffer->removeAsset("A2", to + 1h);
+
+  list.clear();
+  m_assetBuffer->getAssetsByTime(list, 10, from, to);
+  ASSERT_EQ(3, list.size());
+
+  list.clear();
+  m_assetBuffer->getAssetsByTime(list, 10, to + 1h, to + 1h, false);
+  ASSERT_EQ(1, list.size());
+  ASSERT_EQ("A2", list.front()->getAssetId());
+
+  list.clear();
+  m_assetBuffer->getAssetsByTime(list, 10, to + 1h, to + 1h);
+  ASSERT_EQ(0, list.size());
+}
+
+TEST_F(AssetBufferTest, should_get_assets_in_fifo_order_for_every_filter)
+{
+  m_assetBuffer = make_unique<AssetBuffer>(12);
+  makeTypeAssets();
+
+  m_assetBuffer->removeAsset("A4");
+  m_assetBuffer->removeAsset("A7");
+  m_assetBuffer->removeAsset("A10");
+
+  // Updating an asset moves it to the front
+  ErrorList errors;
+  auto asset = makeAsset("Asset1", "A3", "D2", "2020-12-01T12:00:00Z", errors);
+  ASSERT_EQ(0, errors.size());
+  m_assetBuffer->addAsset(asset);
+
+  auto ids = [this](bool active, optional<string> device, optional<string> type) {
+    AssetList list;
+    m_assetBuffer->getAssets(list, 20, active, device, type);
+    vector<string> res;
+    for (auto &a : list)
+      res.push_back(a->getAssetId());
+    return res;
+  };
+
+  using Ids = vector<string>;
+  ASSERT_EQ((Ids {"A3", "A11", "A10", "A9", "A8", "A7", "A6", "A5", "A4", "A2", "A1"}),
+            ids(false, nullopt, nullopt));
+  ASSERT_EQ((Ids {"A3", "A11", "A9", "A8", "A6", "A5", "A2", "A1"}), ids(true, nullopt, nullopt));
+
+  ASSERT_EQ((Ids {"A3", "A5", "A4", "A2", "A1"}), ids(false, nullopt, "Asset1"s));
+  ASSERT_EQ((Ids {"A3", "A5", "A2", "A1"}), ids(true, nullopt, "Asset1"s));
+
+  ASSERT_EQ((Ids {"A3", "A11", "A10", "A9", "A8", "A7", "A5", "A4"}), ids(false, "D2"s, nullopt));
+  ASSERT_EQ((Ids {"A3", "A11", "A9", "A8", "A5"}), ids(true, "D2"s, nullopt));
+
+  ASSERT_EQ((Ids {"A11", "A10", "A9", "A8", "A7"}), ids(false, "D2"s, "Asset2"s));
+  ASSERT_EQ((Ids {"A11", "A9", "A8"}), ids(true, "D2"s, "Asset2"s));
+
+  // The limit applies after merging the removed assets
+  AssetList list;
+  m_assetBuffer->getAssets(list, 3, false, "D2"s, "Asset2"s);
+  ASSERT_EQ(3, list.size());
+  ASSERT_EQ("A9", list.back()->getAssetId());
+}
@@ -0,0 +1,188 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+// Ensure that gtest is the first header otherwise Windows raises an error
+#include <gtest/gtest.h>
+// Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
+
+#include <filesystem>
+#include <string>
+
+#include "mtconnect/asset/asset_file_storage.hpp"
+#include "mtconnect/entity/entity.hpp"
+
+#ifndef _WINDOWS
+#include <sys/resource.h>
+
+#include <csignal>
+#endif
+
+using namespace std;
+using namespace mtconnect;
+using namespace mtconnect::entity;
+using namespace mtconnect::asset;
+namespace fs = std::filesystem;
+
+// main
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class AssetFileStorageTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_file = fs::temp_directory_path() /
+             ("asset_file_storage_test_" +
+              string(testing::UnitTest::GetInstance()->current_test_info()->name()) + ".log");
+    fs::remove(m_file);
+  }
+
+  void TearDown() override { fs::remove(m_file); }
+
+  AssetPtr makeAsset(const string &type, const string &id, const string &device)
+  {
+    ErrorList errors;
+    Properties props {
+        {"assetId", id}, {"deviceUuid", device}, {"timestamp", "2020-12-01T12:00:00Z"s}};
+    auto asset = dynamic_pointer_cast<Asset>(Asset::getFactory()->make(type, props, errors));
+    EXPECT_EQ(0, errors.size());
+    return asset;
+  }
+
+  static vector<string> ids(AssetStorage &storage, bool active = true)
+  {
+    AssetList list;
+    storage.getAssets(list, 100, active);
+    vector<string> result;
+    for (auto &a : list)
+      result.push_back(a->getAssetId());
+    return result;
+  }
+
+  fs::path m_file;
+};
+
+TEST_F(AssetFileStorageTest, should_restore_assets_when_reopened)
+{
+  {
+    AssetFileStorage storage(10, m_file);
+    storage.addAsset(makeAsset("Asset1", "A1", "D1"));
+    storage.addAsset(makeAsset("Asset1", "A2", "D1"));
+    storage.addAsset(makeAsset("Asset2", "A3", "D2"));
+    ASSERT_TRUE(storage.removeAsset("A2"));
+  }
+
+  AssetFileStorage storage(10, m_file);
+  ASSERT_EQ(3, storage.getCount(false));
+  ASSERT_EQ(2, storage.getCount());
+  ASSERT_EQ(1, storage.getCountForDeviceAndType("D1", "Asset1"));
+  ASSERT_EQ(2, storage.getCountForDeviceAndType("D1", "Asset1", false));
+  ASSERT_EQ(1, storage.getCountForType("Asset2"));
+  ASSERT_EQ(0, storage.getCachedCount());
+
+  ASSERT_EQ((vector<string> {"A3", "A1"}), ids(storage));
+  ASSERT_EQ((vector<string> {"A3", "A2", "A1"}), ids(storage, false));
+
+  auto asset = storage.getAsset("A2");
+  ASSERT_TRUE(asset);
+  ASSERT_TRUE(asset->isRemoved());
+  ASSERT_EQ("D1", *asset->getDeviceUuid());
+  ASSERT_EQ("Asset1", asset->getType());
+
+  // New assets continue after the restored assets
+  storage.addAsset(makeAsset("Asset1", "A4", "D1"));
+  ASSERT_EQ((vector<string> {"A4", "A3", "A1"}), ids(storage));
+}
+
+TEST_F(AssetFileStorageTest, should_only_keep_the_most_recently_used_assets_in_memory)
+{
+  AssetFileStorage storage(10, m_file, 2);
+  for (int i = 1; i <= 5; i++)
+    storage.addAsset(makeAsset("Asset1", "A" + to_string(i), "D1"));
+  ASSERT_EQ(2, storage.getCachedCount());
+  ASSERT_EQ(5, storage.getCount());
+
+  auto asset = storage.getAsset("A1");
+  ASSERT_TRUE(asset);
+  ASSERT_EQ("A1", asset->getAssetId());
+  ASSERT_EQ(2, storage.getCachedCount());
+
+  ASSERT_EQ((vector<string> {"A5", "A4", "A3", "A2", "A1"}), ids(storage));
+  ASSERT_EQ(2, storage.getCachedCount());
+}
+
+TEST_F(AssetFileStorageTest, should_compact_replaced_and_deleted_assets)
+{
+  {
+    AssetFileStorage storage(3, m_file);
+    for (int i = 1; i <= 5; i++)
+      storage.addAsset(makeAsset("Asset1", "A" + to_string(i), "D1"));
+    storage.addAsset(makeAsset("Asset1", "A4", "D2"));
+    ASSERT_EQ((vector<string> {"A4", "A5", "A3"}), ids(storage));
+
+    auto size = storage.getLogSize();
+    ASSERT_LT(0, storage.getGarbageSize());
+
+    storage.compact();
+    ASSERT_EQ(0, storage.getGarbageSize());
+    ASSERT_GT(size, storage.getLogSize());
+    ASSERT_EQ((vector<string> {"A4", "A5", "A3"}), ids(storage));
+  }
+
+  AssetFileStorage storage(3, m_file);
+  ASSERT_EQ(0, storage.getGarbageSize());
+  ASSERT_EQ((vector<string> {"A4", "A5", "A3"}), ids(storage));
+  ASSERT_EQ("D2", *storage.getAsset("A4")->getDeviceUuid());
+  ASSERT_EQ(1, storage.getCountForDevice("D2"));
+}
+
+#ifndef _WINDOWS
+TEST_F(AssetFileStorageTest, should_hold_assets_in_memory_when_the_log_cannot_grow)
+{
+  AssetFileStorage storage(1000, m_file, 2);
+  storage.addAsset(makeAsset("Asset1", "A1", "D1"));
+  storage.addAsset(makeAsset("Asset1", "A2", "D1"));
+  storage.addAsset(makeAsset("Asset1", "A3", "D1"));
+
+  // Limit the file size so the log cannot be resized
+  auto handler = signal(SIGXFSZ, SIG_IGN);
+  rlimit limit;
+  getrlimit(RLIMIT_FSIZE, &limit);
+  rlimit fixed {rlim_t(fs::file_size(m_file)), limit.rlim_max};
+  setrlimit(RLIMIT_FSIZE, &fixed);
+
+  auto size = storage.getLogSize();
+  for (int i = 4; i <= 600; i++)
+    storage.addAsset(makeAsset("Asset1", "A" + to_string(i), "D1"));
+
+  setrlimit(RLIMIT_FSIZE, &limit);
+  signal(SIGXFSZ, handler);
+
+  ASSERT_LT(size, storage.getLogSize());
+  ASSERT_EQ(600, storage.getCount());
+  for (int i = 1; i <= 600; i++)
+  {
+    auto asset = storage.getAsset("A" + to_string(i));
+    ASSERT_TRUE(asset) << "A" << i;
+    ASSERT_EQ("A" + to_string(i), asset->getAssetId());
+  }
+}
+#endif
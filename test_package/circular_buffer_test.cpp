@@ -19,6 +19,9 @@
 #include <gtest/gtest.h>
 // Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
 
+#include <atomic>
+#include <thread>
+
 #include "agent_test_helper.hpp"
 #include "mtconnect/buffer/checkpoint.hpp"
 #include "mtconnect/buffer/circular_buffer.hpp"
@@ -191,3 +194,113 @@ TEST_F(CircularBufferTest, should_skip_orphaned_observations)
   ASSERT_EQ(7, end);
   ASSERT_TRUE(eob);
 }
+
+TEST_F(CircularBufferTest, should_scan_in_parallel_with_the_same_results)
+{
+  m_circularBuffer = make_unique<CircularBuffer>(17, 1000);
+
+  entity::ErrorList errors;
+  Timestamp time = Timestamp(date::sys_days(2021_y / jan / 19_d)) + 10h + 1min;
+  auto normal = entity::Properties {{"level", "NORMAL"s}};
+  for (int i = 0; i < 100000; i++)
+  {
+    ObservationPtr obs;
+    if (i % 3 == 0)
+      obs = Observation::make(m_dataItem2, {{"VALUE", double(i)}}, time, errors);
+    else
+      obs = Observation::make(m_dataItem1, normal, time, errors);
+    m_circularBuffer->addToBuffer(obs);
+  }
+  ASSERT_EQ(0, errors.size());
+
+  FilterSetOpt filter {FilterSet {"3"}};
+  auto scan = [&](size_t threads, int count, std::optional<SequenceNumber_t> start,
+                  std::optional<SequenceNumber_t> to) {
+    m_circularBuffer->setScanThreads(threads);
+    SequenceNumber_t first, end;
+    bool eob = false;
+    auto list = m_circularBuffer->getObservations(count, filter, start, to, end, first, eob);
+    return make_tuple(vector<ObservationPtr>(list->begin(), list->end()), first, end, eob);
+  };
+
+  auto compare = [&](int count, std::optional<SequenceNumber_t> start,
+                     std::optional<SequenceNumber_t> to) {
+    auto serial = scan(0, count, start, to);
+    auto parallel = scan(4, count, start, to);
+    ASSERT_EQ(get<0>(serial).size(), get<0>(parallel).size());
+    ASSERT_TRUE(get<0>(serial) == get<0>(parallel));
+    ASSERT_EQ(get<1>(serial), get<1>(parallel));
+    ASSERT_EQ(get<2>(serial), get<2>(parallel));
+    ASSERT_EQ(get<3>(serial), get<3>(parallel));
+  };
+
+  compare(30000, 1, nullopt);
+  compare(50000, 1, nullopt);
+  compare(20000, 5, nullopt);
+  compare(-30000, nullopt, nullopt);
+  compare(-50000, nullopt, nullopt);
+  compare(30000, 1, 90000);
+
+  auto [list, first, end, eob] = scan(4, 30000, 1, nullopt);
+  ASSERT_EQ(30000, list.size());
+  ASSERT_EQ(1, list.front()->getSequence());
+  ASSERT_EQ(89998, list.back()->getSequence());
+  ASSERT_EQ(89999, end);
+  ASSERT_FALSE(eob);
+}
+
+TEST_F(CircularBufferTest, should_add_observations_while_scanning_in_parallel)
+{
+  m_circularBuffer = make_unique<CircularBuffer>(17, 1000);
+  m_circularBuffer->setScanThreads(4);
+
+  entity::ErrorList errors;
+  Timestamp time = Timestamp(date::sys_days(2021_y / jan / 19_d)) + 10h + 1min;
+  auto normal = entity::Properties {{"level", "NORMAL"s}};
+  auto add = [&](int i, entity::ErrorList &errors) {
+    ObservationPtr obs;
+    if (i % 3 == 0)
+      obs = Observation::make(m_dataItem2, {{"VALUE", double(i)}}, time, errors);
+    else
+      obs = Observation::make(m_dataItem1, normal, time, errors);
+    m_circularBuffer->addToBuffer(obs);
+  };
+  for (int i = 0; i < 100000; i++)
+    add(i, errors);
+  ASSERT_EQ(0, errors.size());
+
+  // Keep adding observations until the buffer has wrapped around
+  atomic_bool done {false};
+  entity::ErrorList writerErrors;
+  thread writer([&]() {
+    for (int i = 100000; i < 250000; i++)
+      add(i, writerErrors);
+    done = true;
+  });
+
+  FilterSetOpt filter {FilterSet {"3"}};
+  int scans = 0;
+  while (!done || scans == 0)
+  {
+    auto range = m_circularBuffer->getScanRange(100000, nullopt, nullopt);
+    SequenceNumber_t end;
+    bool eob = false;
+    auto list = m_circularBuffer->getObservations(range, filter, end, eob);
+    scans++;
+
+    SequenceNumber_t last = range.m_first - 1;
+    for (auto &obs : *list)
+    {
+      ASSERT_EQ("3", obs->getDataItem()->getId());
+      ASSERT_LT(last, obs->getSequence());
+      last = obs->getSequence();
+    }
+    ASSERT_LT(last, end);
+    ASSERT_LE(end, range.m_sequence);
+  }
+
+  writer.join();
+  ASSERT_EQ(0, writerErrors.size());
+  ASSERT_EQ(250001, m_circularBuffer->getSequence());
+  ASSERT_LT(0, scans);
+}
@@ -24,6 +24,7 @@
 #include <chrono>
 #include <date/date.h>
 #include <filesystem>
+#include <future>
 #include <iostream>
 #include <mruby.h>
 #include <mruby/array.h>
@@ -38,6 +39,7 @@
 #include <mruby/string.h>
 #include <mruby/variable.h>
 #include <string>
+#include <thread>
 
 #include "mtconnect/agent.hpp"
 #include "mtconnect/configuration/agent_config.hpp"
@@ -86,7 +88,11 @@ namespace {
       return m_agent->getDataItemForDevice(device, name);
     }
     void eachDataItem(EachDataItem fun) override {}
-    void deliverObservation(observation::ObservationPtr obs) override { m_observation = obs; }
+    void deliverObservation(observation::ObservationPtr obs) override
+    {
+      m_observation = obs;
+      m_observations.emplace_back(obs);
+    }
     void deliverAsset(AssetPtr a) override { m_asset = a; }
     void deliverDevices(std::list<DevicePtr>) override {}
     void deliverAssetCommand(entity::EntityPtr c) override { m_command = c; }
@@ -98,6 +104,7 @@ namespace {
 
     const Agent *m_agent;
     ObservationPtr m_observation;
+    ObservationList m_observations;
     entity::EntityPtr m_command;
     AssetPtr m_asset;
   };
@@ -317,6 +324,141 @@ $source.pipeline.splice_after('Start', FixExecution.new('FixExec', :Event))
     ASSERT_EQ("READY", contract->m_observation->getValue<string>());
   }
 
+  TEST_F(EmbeddedRubyTest, should_transform_observations_in_batches)
+  {
+    load("should_transform_batch.rb");
+
+    auto mrb = RubyVM::rubyVM().state();
+    ASSERT_NE(nullptr, mrb);
+
+    ConfigOptions options;
+    boost::asio::io_context::strand strand(m_config->getContext());
+    auto loopback =
+        std::make_shared<source::LoopbackSource>("RubySource", strand, m_context, options);
+
+    mrb_value source = MRubySharedPtr<mtconnect::source::Source>::wrap(mrb, "Source", loopback);
+    mrb_gv_set(mrb, mrb_intern_lit(mrb, "$source"), source);
+
+    mrb_load_string(mrb, R"(
+$source.pipeline.splice_after('Start', $trans)
+)");
+
+    auto di = m_config->getAgent()->getDataItemForDevice("LinuxCNC", "execution");
+    auto contract = static_cast<MockPipelineContract *>(m_context->m_contract.get());
+
+    loopback->receive(di, "READY"s);
+    loopback->receive(di, "ACTIVE"s);
+    ASSERT_TRUE(contract->m_observations.empty());
+
+    loopback->receive(di, "STOPPED"s);
+    ASSERT_EQ(2, contract->m_observations.size());
+    ASSERT_EQ("READY", contract->m_observations.front()->getValue<string>());
+    ASSERT_EQ("STOPPED", contract->m_observations.back()->getValue<string>());
+
+    mrb_value batches = mrb_gv_get(mrb, mrb_intern_lit(mrb, "$batches"));
+    ASSERT_EQ(1, RARRAY_LEN(batches));
+    ASSERT_EQ(3, mrb_integer(mrb_ary_ref(mrb, batches, 0)));
+  }
+
+  TEST_F(EmbeddedRubyTest, should_run_transform_in_a_replica_when_the_primary_vm_is_busy)
+  {
+    using namespace std::chrono_literals;
+
+    string str("Devices = " TEST_RESOURCE_DIR
+               "/samples/test_config.xml\n"
+               "Ruby {\n"
+               "  module = " TEST_RESOURCE_DIR
+               "/ruby/should_transform.rb\n"
+               "  PoolSize = 3\n"
+               "}\n");
+    m_config->loadConfig(str);
+    ASSERT_EQ(3, RubyVM::poolSize());
+
+    auto mrb = RubyVM::rubyVM().state();
+    ASSERT_NE(nullptr, mrb);
+
+    ConfigOptions options;
+    boost::asio::io_context::strand strand(m_config->getContext());
+    auto loopback =
+        std::make_shared<source::LoopbackSource>("RubySource", strand, m_context, options);
+
+    mrb_value source = MRubySharedPtr<mtconnect::source::Source>::wrap(mrb, "Source", loopback);
+    mrb_gv_set(mrb, mrb_intern_lit(mrb, "$source"), source);
+
+    mrb_load_string(mrb, R"(
+$source.pipeline.splice_after('Start', $trans)
+)");
+
+    // Hold the primary VM in another thread so the transform must run in a replica
+    promise<void> locked, release;
+    thread holder([&]() {
+      lock_guard guard(RubyVM::rubyVM());
+      locked.set_value();
+      release.get_future().wait();
+    });
+    locked.get_future().wait();
+
+    auto di = m_config->getAgent()->getDataItemForDevice("LinuxCNC", "execution");
+    auto result = async(launch::async, [&]() { return loopback->receive(di, "1"s); });
+    auto status = result.wait_for(5s);
+
+    release.set_value();
+    holder.join();
+    ASSERT_EQ(future_status::ready, status);
+
+    auto contract = static_cast<MockPipelineContract *>(m_context->m_contract.get());
+    ASSERT_TRUE(contract->m_observation);
+    ASSERT_EQ("READY", contract->m_observation->getValue<string>());
+  }
+
+  TEST_F(EmbeddedRubyTest, should_run_transform_on_the_thread_pool)
+  {
+    using namespace std::chrono_literals;
+
+    string str("Devices = " TEST_RESOURCE_DIR
+               "/samples/test_config.xml\n"
+               "Ruby {\n"
+               "  module = " TEST_RESOURCE_DIR
+               "/ruby/should_transform.rb\n"
+               "  Threads = 2\n"
+               "}\n");
+    m_config->loadConfig(str);
+    ASSERT_NE(nullptr, RubyVM::threadPool());
+
+    auto mrb = RubyVM::rubyVM().state();
+    ASSERT_NE(nullptr, mrb);
+
+    ConfigOptions options;
+    boost::asio::io_context::strand strand(m_config->getContext());
+    auto loopback =
+        std::make_shared<source::LoopbackSource>("RubySource", strand, m_context, options);
+
+    mrb_value source = MRubySharedPtr<mtconnect::source::Source>::wrap(mrb, "Source", loopback);
+    mrb_gv_set(mrb, mrb_intern_lit(mrb, "$source"), source);
+
+    mrb_load_string(mrb, R"(
+$source.pipeline.splice_after('Start', $trans)
+)");
+    loopback->getPipeline()->start();
+
+    auto di = m_config->getAgent()->getDataItemForDevice("LinuxCNC", "execution");
+    ASSERT_EQ(0, loopback->receive(di, "1"s));
+
+    // The result is delivered on the pipeline strand, which only runs in this thread
+    auto contract = static_cast<MockPipelineContract *>(m_context->m_contract.get());
+    ASSERT_FALSE(contract->m_observation);
+
+    auto &context = m_config->getContext().get();
+    for (int i = 0; i < 200 && !contract->m_observation; i++)
+    {
+      context.restart();
+      context.run_for(10ms);
+    }
+
+    ASSERT_TRUE(contract->m_observation);
+    ASSERT_EQ("READY", contract->m_observation->getValue<string>());
+  }
+
   TEST_F(EmbeddedRubyTest, should_create_sample)
   {
     using namespace std::chrono;
@@ -0,0 +1,365 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+// Ensure that gtest is the first header otherwise Windows raises an error
+#include <gtest/gtest.h>
+// Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
+
+#include <boost/asio/spawn.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <nghttp2/nghttp2.h>
+
+#include "mtconnect/logging.hpp"
+#include "mtconnect/sink/rest_sink/server.hpp"
+
+using namespace std;
+using namespace mtconnect;
+using namespace mtconnect::sink::rest_sink;
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+using tcp = boost::asio::ip::tcp;
+
+// main
+int main(int argc, char* argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+// An HTTP/2 client with prior knowledge
+class Client
+{
+public:
+  struct Stream
+  {
+    map<string, string> m_headers;
+    string m_body;
+    bool m_closed {false};
+    uint32_t m_error {0};
+  };
+
+  Client(asio::io_context& ioc) : m_socket(ioc)
+  {
+    nghttp2_session_callbacks* callbacks;
+    nghttp2_session_callbacks_new(&callbacks);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, &Client::header);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, &Client::dataChunk);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, &Client::streamClosed);
+    nghttp2_session_client_new(&m_session, callbacks, this);
+    nghttp2_session_callbacks_del(callbacks);
+
+    nghttp2_submit_settings(m_session, NGHTTP2_FLAG_NONE, nullptr, 0);
+  }
+
+  ~Client() { nghttp2_session_del(m_session); }
+
+  void connect(unsigned short port, asio::yield_context yield)
+  {
+    beast::error_code ec;
+    tcp::endpoint server(asio::ip::address_v4::from_string("127.0.0.1"), port);
+    m_socket.async_connect(server, yield[ec]);
+    ASSERT_FALSE(ec) << ec.message();
+    m_socket.set_option(tcp::no_delay(true));
+    m_connected = true;
+  }
+
+  int32_t request(const string& method, const string& path)
+  {
+    const string names[] = {":method", ":scheme", ":authority", ":path"};
+    const string values[] = {method, "http", "127.0.0.1", path};
+    nghttp2_nv nva[4];
+    for (int i = 0; i < 4; i++)
+    {
+      nva[i] = {(uint8_t*)names[i].data(), (uint8_t*)values[i].data(), names[i].size(),
+                values[i].size(), NGHTTP2_NV_FLAG_NONE};
+    }
+
+    auto id = nghttp2_submit_request(m_session, nullptr, nva, 4, nullptr, nullptr);
+    m_streams[id];
+    return id;
+  }
+
+  // Exchange frames with the server until done returns true or the connection fails
+  void run(asio::yield_context yield, function<bool()> done)
+  {
+    beast::error_code ec;
+    while (true)
+    {
+      string output;
+      const uint8_t* data;
+      ssize_t len;
+      while ((len = nghttp2_session_mem_send(m_session, &data)) > 0)
+        output.append(reinterpret_cast<const char*>(data), len);
+      if (!output.empty())
+      {
+        asio::async_write(m_socket, asio::buffer(output), yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+      }
+
+      if (done())
+        return;
+
+      auto received = m_socket.async_read_some(asio::buffer(m_input), yield[ec]);
+      if (ec)
+      {
+        m_ec = ec;
+        return;
+      }
+      ASSERT_GE(nghttp2_session_mem_recv(m_session, m_input.data(), received), 0);
+    }
+  }
+
+  static int header(nghttp2_session* session, const nghttp2_frame* frame, const uint8_t* name,
+                    size_t namelen, const uint8_t* value, size_t valuelen, uint8_t flags,
+                    void* data)
+  {
+    auto client = static_cast<Client*>(data);
+    client->m_streams[frame->hd.stream_id].m_headers[string((const char*)name, namelen)] =
+        string((const char*)value, valuelen);
+    return 0;
+  }
+
+  static int dataChunk(nghttp2_session* session, uint8_t flags, int32_t id, const uint8_t* chunk,
+                       size_t len, void* data)
+  {
+    auto client = static_cast<Client*>(data);
+    client->m_streams[id].m_body.append((const char*)chunk, len);
+    return 0;
+  }
+
+  static int streamClosed(nghttp2_session* session, int32_t id, uint32_t code, void* data)
+  {
+    auto client = static_cast<Client*>(data);
+    client->m_streams[id].m_closed = true;
+    client->m_streams[id].m_error = code;
+    return 0;
+  }
+
+  bool m_connected {false};
+  beast::error_code m_ec;
+  tcp::socket m_socket;
+  nghttp2_session* m_session {nullptr};
+  array<uint8_t, 16 * 1024> m_input;
+  map<int32_t, Stream> m_streams;
+};
+
+class Http2ServiceTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    using namespace mtconnect::configuration;
+    m_server = make_unique<Server>(m_context, ConfigOptions {{Port, 0}, {ServerIp, "127.0.0.1"s}});
+  }
+
+  void start()
+  {
+    m_server->start();
+    while (!m_server->isListening())
+      m_context.run_one();
+    m_client = make_unique<Client>(m_context);
+
+    asio::spawn(m_context,
+                std::bind(&Client::connect, m_client.get(),
+                          static_cast<unsigned short>(m_server->getPort()), std::placeholders::_1));
+    while (!m_client->m_connected)
+      m_context.run_one();
+  }
+
+  void TearDown() override
+  {
+    m_server.reset();
+    m_client.reset();
+  }
+
+  asio::io_context m_context;
+  unique_ptr<Server> m_server;
+  unique_ptr<Client> m_client;
+};
+
+TEST_F(Http2ServiceTest, should_multiplex_requests_on_one_connection)
+{
+  auto probe = [&](SessionPtr session, RequestPtr request) -> bool {
+    ResponsePtr resp = make_unique<Response>(status::ok);
+    resp->m_body = "Device given as: " + get<string>(request->m_parameters.find("device")->second);
+    resp->m_mimeType = "text/plain";
+    session->writeResponse(std::move(resp));
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/{device}/probe", probe});
+  start();
+
+  bool done = false;
+  asio::spawn(m_context, [&](asio::yield_context yield) {
+    auto a = m_client->request("GET", "/device1/probe");
+    auto b = m_client->request("GET", "/device2/probe");
+    auto c = m_client->request("GET", "/device3/probe");
+
+    m_client->run(yield, [&]() {
+      return m_client->m_streams[a].m_closed && m_client->m_streams[b].m_closed &&
+             m_client->m_streams[c].m_closed;
+    });
+    ASSERT_FALSE(m_client->m_ec) << m_client->m_ec.message();
+
+    int i = 1;
+    for (auto id : {a, b, c})
+    {
+      auto& stream = m_client->m_streams[id];
+      EXPECT_EQ(0, stream.m_error);
+      EXPECT_EQ("200", stream.m_headers[":status"]);
+      EXPECT_EQ("text/plain", stream.m_headers["content-type"]);
+      EXPECT_EQ("MTConnectAgent", stream.m_headers["server"]);
+      EXPECT_EQ("Device given as: device" + to_string(i++), stream.m_body);
+    }
+    done = true;
+  });
+
+  while (!done && m_context.run_for(20ms) > 0)
+    ;
+  ASSERT_TRUE(done);
+}
+
+TEST_F(Http2ServiceTest, should_answer_requests_while_streaming)
+{
+  SessionPtr streaming;
+  auto sample = [&](SessionPtr session, RequestPtr request) -> bool {
+    streaming = session;
+    session->beginStreaming("text/plain", []() {});
+    return true;
+  };
+  auto probe = [&](SessionPtr session, RequestPtr request) -> bool {
+    session->writeResponse(make_unique<Response>(status::ok, "Probe"));
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/sample", sample});
+  m_server->addRouting({boost::beast::http::verb::get, "/probe", probe});
+  start();
+
+  bool done = false;
+  asio::spawn(m_context, [&](asio::yield_context yield) {
+    auto s = m_client->request("GET", "/sample");
+    m_client->run(yield, [&]() { return m_client->m_streams[s].m_headers.count(":status") > 0; });
+    ASSERT_FALSE(m_client->m_ec) << m_client->m_ec.message();
+    ASSERT_TRUE(streaming);
+
+    auto& type = m_client->m_streams[s].m_headers["content-type"];
+    EXPECT_EQ(0, type.find("multipart/mixed;boundary="));
+
+    // The probe is answered while the sample stream is open
+    auto p = m_client->request("GET", "/probe");
+    m_client->run(yield, [&]() { return m_client->m_streams[p].m_closed; });
+    ASSERT_FALSE(m_client->m_ec) << m_client->m_ec.message();
+    EXPECT_EQ("Probe", m_client->m_streams[p].m_body);
+    EXPECT_FALSE(m_client->m_streams[s].m_closed);
+
+    streaming->writeChunk("Chunk 1", [&]() {
+      streaming->writeChunk("Chunk 2", [&]() { streaming->closeStream(); });
+    });
+    m_client->run(yield, [&]() { return m_client->m_streams[s].m_closed; });
+    ASSERT_FALSE(m_client->m_ec) << m_client->m_ec.message();
+
+    auto& body = m_client->m_streams[s].m_body;
+    auto boundary = type.substr(type.find('=') + 1);
+    EXPECT_EQ(0, m_client->m_streams[s].m_error);
+    EXPECT_EQ(0, body.find("--" + boundary + "\r\n"));
+    auto first = body.find("Chunk 1");
+    ASSERT_NE(string::npos, first);
+    EXPECT_NE(string::npos, body.find("Chunk 2", first));
+    done = true;
+  });
+
+  while (!done && m_context.run_for(20ms) > 0)
+    ;
+  ASSERT_TRUE(done);
+}
+
+TEST_F(Http2ServiceTest, should_reject_puts_when_read_only)
+{
+  auto put = [&](SessionPtr session, RequestPtr request) -> bool {
+    session->writeResponse(make_unique<Response>(status::ok, "Put"));
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::put, "/asset", put});
+  start();
+
+  bool done = false;
+  asio::spawn(m_context, [&](asio::yield_context yield) {
+    auto id = m_client->request("PUT", "/asset");
+    m_client->run(yield, [&]() { return m_client->m_streams[id].m_closed; });
+    ASSERT_FALSE(m_client->m_ec) << m_client->m_ec.message();
+    EXPECT_EQ("400", m_client->m_streams[id].m_headers[":status"]);
+    done = true;
+  });
+
+  while (!done && m_context.run_for(20ms) > 0)
+    ;
+  ASSERT_TRUE(done);
+}
+
+TEST_F(Http2ServiceTest, should_release_the_stream_when_the_client_disconnects)
+{
+  SessionPtr streaming;
+  auto sample = [&](SessionPtr session, RequestPtr request) -> bool {
+    streaming = session;
+    session->beginStreaming("text/plain", []() {});
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/sample", sample});
+  start();
+
+  bool done = false;
+  asio::spawn(m_context, [&](asio::yield_context yield) {
+    auto s = m_client->request("GET", "/sample");
+    m_client->run(yield, [&]() { return m_client->m_streams[s].m_headers.count(":status") > 0; });
+    ASSERT_TRUE(streaming);
+
+    m_client->m_socket.close();
+    asio::steady_timer timer(m_context, 50ms);
+    timer.async_wait(yield);
+
+    // Chunks written after the connection is gone are dropped
+    bool written = false;
+    for (int i = 0; i < 10; i++)
+      streaming->writeChunk(string(10000, 'x'), [&]() { written = true; });
+    timer.expires_after(50ms);
+    timer.async_wait(yield);
+    EXPECT_FALSE(written);
+    done = true;
+  });
+
+  while (!done && m_context.run_for(100ms) > 0)
+    ;
+  ASSERT_TRUE(done);
+
+  weak_ptr<Session> stream = streaming;
+  streaming.reset();
+  EXPECT_TRUE(stream.expired());
+}
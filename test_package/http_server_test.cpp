@@ -25,12 +25,18 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 
+#include <atomic>
 #include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "mtconnect/logging.hpp"
 #include "mtconnect/sink/rest_sink/server.hpp"
@@ -648,6 +654,77 @@ TEST_F(RestServiceTest, streaming_response)
     ;
 }
 
+TEST_F(RestServiceTest, should_stream_chunks_from_multiple_threads)
+{
+  SessionPtr session;
+  bool begun = false;
+  auto begin = [&](SessionPtr s, RequestPtr request) -> bool {
+    session = s;
+    session->beginStreaming("plain/text", [&]() { begun = true; });
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/sample", begin});
+
+  start();
+  startClient();
+
+  m_client->spawnRequest(http::verb::get, "/sample");
+  while (!begun && m_context.run_for(20ms) > 0)
+    ;
+  ASSERT_TRUE(begun);
+
+  // Record every complete part the client reads
+  vector<string> received;
+  auto handler = m_client->m_chunkHandler;
+  m_client->m_chunkHandler = [&, handler](std::uint64_t remain, boost::string_view body,
+                                          boost::system::error_code& ev) -> unsigned long {
+    auto used = handler(remain, body, ev);
+    if (used > 0)
+      received.push_back(m_client->m_result);
+    return used;
+  };
+  m_client->spawnReadChunk();
+
+  const int threadCount = 4, chunkCount = 10;
+  atomic_int written {0};
+  vector<thread> workers;
+  for (int t = 0; t < threadCount; t++)
+  {
+    workers.emplace_back([&, t]() {
+      for (int i = 0; i < chunkCount; i++)
+        session->writeChunk("Thread " + to_string(t) + " Chunk " + to_string(i),
+                            [&]() { written++; });
+    });
+  }
+
+  auto deadline = chrono::steady_clock::now() + 10s;
+  while ((written < threadCount * chunkCount ||
+          received.size() < size_t(threadCount * chunkCount)) &&
+         chrono::steady_clock::now() < deadline)
+    m_context.run_for(20ms);
+
+  for (auto& w : workers)
+    w.join();
+
+  EXPECT_EQ(threadCount * chunkCount, written);
+  ASSERT_EQ(threadCount * chunkCount, received.size());
+
+  // Each thread's chunks arrive whole and in the order that thread wrote them
+  vector<int> next(threadCount, 0);
+  for (const auto& r : received)
+  {
+    int t, i;
+    ASSERT_EQ(2, sscanf(r.c_str(), "Thread %d Chunk %d", &t, &i)) << r;
+    ASSERT_LT(t, threadCount);
+    EXPECT_EQ(next[t]++, i) << r;
+  }
+
+  session->closeStream();
+  while (m_context.run_for(20ms) > 0)
+    ;
+}
+
 TEST_F(RestServiceTest, additional_header_fields)
 {
   m_server->setHttpHeaders({"Access-Control-Allow-Origin:*", "Origin:https://foo.example"});
@@ -677,6 +754,161 @@ TEST_F(RestServiceTest, additional_header_fields)
   ASSERT_EQ("https://foo.example", f2->second);
 }
 
+TEST_F(RestServiceTest, should_respond_to_pipelined_requests_in_order)
+{
+  int count = 0;
+  auto current = [&](SessionPtr session, RequestPtr request) -> bool {
+    count++;
+    ResponsePtr resp = make_unique<Response>(status::ok, "Current " + to_string(count));
+    session->writeResponse(std::move(resp));
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/current", current});
+
+  start();
+  startClient();
+
+  bool done = false;
+  vector<string> bodies;
+  asio::spawn(m_context, [&](asio::yield_context yield) {
+    beast::error_code ec;
+
+    // Send all the requests before reading any of the responses
+    for (int i = 0; i < 3; i++)
+    {
+      http::request<http::empty_body> req {http::verb::get, "/current", 11};
+      req.set(http::field::host, "localhost");
+      http::async_write(m_client->m_stream, req, yield[ec]);
+      ASSERT_FALSE(ec) << ec.message();
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+      http::response<http::string_body> res;
+      http::async_read(m_client->m_stream, m_client->m_b, res, yield[ec]);
+      ASSERT_FALSE(ec) << ec.message();
+      EXPECT_EQ(http::status::ok, res.result());
+      EXPECT_TRUE(res.keep_alive());
+      bodies.emplace_back(res.body());
+    }
+    done = true;
+  });
+
+  while (!done && m_context.run_for(20ms) > 0)
+    ;
+
+  ASSERT_TRUE(done);
+  ASSERT_EQ(3, bodies.size());
+  EXPECT_EQ("Current 1", bodies[0]);
+  EXPECT_EQ("Current 2", bodies[1]);
+  EXPECT_EQ("Current 3", bodies[2]);
+}
+
+TEST_F(RestServiceTest, should_respond_to_pipelined_requests_after_a_missing_file)
+{
+  // Create the file so the cached file can be made, then remove it before it is served
+  auto path = std::filesystem::temp_directory_path() / "missing_pipelined_file.txt";
+  {
+    ofstream out(path);
+    out << "Gone";
+  }
+  auto file = make_shared<CachedFile>(path, "text/plain", false, 4);
+  std::filesystem::remove(path);
+
+  auto missing = [&](SessionPtr session, RequestPtr request) -> bool {
+    ResponsePtr resp = make_unique<Response>(status::ok, file);
+    session->writeResponse(std::move(resp));
+    return true;
+  };
+
+  int count = 0;
+  auto current = [&](SessionPtr session, RequestPtr request) -> bool {
+    count++;
+    ResponsePtr resp = make_unique<Response>(status::ok, "Current " + to_string(count));
+    session->writeResponse(std::move(resp));
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/missing", missing});
+  m_server->addRouting({boost::beast::http::verb::get, "/current", current});
+
+  start();
+  startClient();
+
+  bool done = false;
+  vector<pair<http::status, string>> responses;
+  asio::spawn(m_context, [&](asio::yield_context yield) {
+    beast::error_code ec;
+
+    // Send all the requests before reading any of the responses
+    for (auto target : {"/missing", "/current", "/current"})
+    {
+      http::request<http::empty_body> req {http::verb::get, target, 11};
+      req.set(http::field::host, "localhost");
+      http::async_write(m_client->m_stream, req, yield[ec]);
+      ASSERT_FALSE(ec) << ec.message();
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+      http::response<http::string_body> res;
+      http::async_read(m_client->m_stream, m_client->m_b, res, yield[ec]);
+      ASSERT_FALSE(ec) << ec.message();
+      EXPECT_TRUE(res.keep_alive());
+      responses.emplace_back(res.result(), res.body());
+    }
+    done = true;
+  });
+
+  while (!done && m_context.run_for(20ms) > 0)
+    ;
+
+  ASSERT_TRUE(done);
+  ASSERT_EQ(3, responses.size());
+  EXPECT_EQ(http::status::not_found, responses[0].first);
+  EXPECT_EQ("File Not Found", responses[0].second);
+  EXPECT_EQ(http::status::ok, responses[1].first);
+  EXPECT_EQ("Current 1", responses[1].second);
+  EXPECT_EQ(http::status::ok, responses[2].first);
+  EXPECT_EQ("Current 2", responses[2].second);
+}
+
+#ifndef WITH_HTTP2
+TEST_F(RestServiceTest, should_reject_http2_prior_knowledge)
+{
+  auto probe = [&](SessionPtr session, RequestPtr request) -> bool {
+    ResponsePtr resp = make_unique<Response>(status::ok, "Done");
+    session->writeResponse(std::move(resp));
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/probe", probe});
+
+  start();
+  startClient();
+
+  bool done = false;
+  asio::spawn(m_context, [&](asio::yield_context yield) {
+    beast::error_code ec;
+    string preface("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+    asio::async_write(m_client->m_stream, asio::buffer(preface), yield[ec]);
+    ASSERT_FALSE(ec) << ec.message();
+
+    http::response<http::string_body> res;
+    http::async_read(m_client->m_stream, m_client->m_b, res, yield[ec]);
+    ASSERT_FALSE(ec) << ec.message();
+    EXPECT_EQ(http::status::http_version_not_supported, res.result());
+    EXPECT_FALSE(res.keep_alive());
+    done = true;
+  });
+
+  while (!done && m_context.run_for(20ms) > 0)
+    ;
+  ASSERT_TRUE(done);
+}
+#endif
+
 const string CertFile(TEST_RESOURCE_DIR "/user.crt");
 const string KeyFile {TEST_RESOURCE_DIR "/user.key"};
 const string DhFile {TEST_RESOURCE_DIR "/dh2048.pem"};
@@ -710,3 +942,54 @@ TEST_F(RestServiceTest, failure_when_tls_only)
 
   EXPECT_EQ((unsigned)boost::beast::http::status::unauthorized, m_client->m_status);
 }
+
+TEST_F(RestServiceTest, should_service_sessions_on_server_threads)
+{
+  using namespace mtconnect::configuration;
+  createServer({{ServerThreads, 2}});
+  ASSERT_EQ(2, m_server->getThreadCount());
+
+  std::mutex mutex;
+  set<thread::id> threads;
+  set<asio::io_context*> contexts;
+
+  auto probe = [&](SessionPtr session, RequestPtr request) -> bool {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(this_thread::get_id());
+      contexts.insert(&session->getContext());
+    }
+    ResponsePtr resp = make_unique<Response>(status::ok);
+    resp->m_body = "All Devices";
+    session->writeResponse(std::move(resp));
+    return true;
+  };
+
+  m_server->addRouting({boost::beast::http::verb::get, "/probe", probe});
+
+  start();
+  startClient();
+
+  auto second = make_unique<Client>(m_context);
+  asio::spawn(m_context, std::bind(&Client::connect, second.get(),
+                                   static_cast<unsigned short>(m_server->getPort()),
+                                   std::placeholders::_1));
+  while (!second->m_connected)
+    m_context.run_one();
+
+  m_client->spawnRequest(http::verb::get, "/probe");
+  ASSERT_TRUE(m_client->m_done);
+  EXPECT_EQ(200, m_client->m_status);
+  EXPECT_EQ("All Devices", m_client->m_result);
+
+  second->spawnRequest(http::verb::get, "/probe");
+  ASSERT_TRUE(second->m_done);
+  EXPECT_EQ(200, second->m_status);
+  EXPECT_EQ("All Devices", second->m_result);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(2, contexts.size());
+  EXPECT_EQ(0, contexts.count(&m_context));
+  EXPECT_EQ(2, threads.size());
+  EXPECT_EQ(0, threads.count(this_thread::get_id()));
+}
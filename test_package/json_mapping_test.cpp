@@ -23,6 +23,7 @@
 // Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
 
 #include <chrono>
+#include <sstream>
 
 #include "mtconnect/asset/cutting_tool.hpp"
 #include "mtconnect/device_model/device.hpp"
@@ -66,9 +67,11 @@ public:
   void sourceFailed(const std::string &id) override {}
   const ObservationPtr checkDuplicate(const ObservationPtr &obs) const override { return obs; }
   int32_t getSchemaVersion() const override { return SCHEMA_VERSION(2, 3); };
+  uint64_t getDeviceModelGeneration() const override { return m_generation; }
 
   std::map<string, DataItemPtr> &m_dataItems;
   std::map<string, DevicePtr> &m_devices;
+  uint64_t m_generation {0};
 };
 
 class JsonMappingTest : public testing::Test
@@ -1048,3 +1051,94 @@ TEST_F(JsonMappingTest, should_skip_erroneous_values)
 
 /// @test verify the json mapper can an asset in json
 TEST_F(JsonMappingTest, should_parse_json_asset) { GTEST_SKIP(); }
+
+/// @test verify the json mapper can map a large array of observations in one message
+TEST_F(JsonMappingTest, should_parse_large_arrays_of_observations)
+{
+  auto dev = makeDevice("Device", {{"id", "device"s}, {"name", "device"s}, {"uuid", "device"s}});
+  makeDataItem("device", {{"id", "a"s}, {"type", "PART_COUNT"s}, {"category", "EVENT"s}});
+  makeDataItem("device", {{"id", "b"s}, {"type", "POSITION"s}, {"category", "SAMPLE"s}});
+
+  stringstream json;
+  json << "[";
+  for (int i = 0; i < 1000; i++)
+  {
+    if (i > 0)
+      json << ",";
+    json << R"({"timestamp": "2023-11-09T11:20:00Z", "a": )" << i << R"(, "b": )" << i * 0.5
+         << "}";
+  }
+  json << "]";
+
+  Properties props {{"VALUE", json.str()}};
+  auto msg = std::make_shared<JsonMessage>("JsonMessage", props);
+  msg->m_device = dev;
+
+  auto res = (*m_mapper)(std::move(msg));
+  ASSERT_TRUE(res);
+
+  auto list = get<EntityList>(res->getValue());
+  ASSERT_EQ(2000, list.size());
+
+  auto obs = dynamic_pointer_cast<Observation>(list.back());
+  ASSERT_TRUE(obs);
+  ASSERT_EQ("Position", obs->getName());
+  ASSERT_EQ(999 * 0.5, obs->getValue<double>());
+
+  obs = dynamic_pointer_cast<Observation>(*next(list.rbegin()));
+  ASSERT_EQ("PartCount", obs->getName());
+  ASSERT_EQ("999", obs->getValue<string>());
+}
+
+/// @test verify the cached data items are refreshed when the device model changes
+TEST_F(JsonMappingTest, should_find_new_data_items_when_the_device_model_changes)
+{
+  auto dev = makeDevice("Device", {{"id", "device"s}, {"name", "device"s}, {"uuid", "device"s}});
+  makeDataItem("device", {{"id", "a"s}, {"type", "EXECUTION"s}, {"category", "EVENT"s}});
+
+  auto mapMessage = [this, &dev]() {
+    Properties props {{"VALUE", R"({"a": "ACTIVE", "b": 123.456})"s}};
+    auto msg = std::make_shared<JsonMessage>("JsonMessage", props);
+    msg->m_device = dev;
+    auto res = (*m_mapper)(std::move(msg));
+    EXPECT_TRUE(res);
+    return get<EntityList>(res->getValue()).size();
+  };
+
+  ASSERT_EQ(1, mapMessage());
+  ASSERT_EQ(1, mapMessage());
+
+  makeDataItem("device", {{"id", "b"s}, {"type", "POSITION"s}, {"category", "SAMPLE"s}});
+  auto contract = static_cast<MockPipelineContract *>(m_context->m_contract.get());
+  contract->m_generation++;
+
+  ASSERT_EQ(2, mapMessage());
+}
+
+/// @test verify escaped strings are decoded when the message is parsed in place
+TEST_F(JsonMappingTest, should_decode_escaped_strings)
+{
+  auto dev = makeDevice("Device", {{"id", "device"s}, {"name", "device"s}, {"uuid", "device"s}});
+  makeDataItem("device", {{"id", "a"s}, {"type", "PROGRAM"s}, {"category", "EVENT"s}});
+  makeDataItem("device", {{"id", "b"s}, {"type", "BLOCK"s}, {"category", "EVENT"s}});
+
+  Properties props {{"VALUE", R"({"a": "C:\\programs\\\"main\".nc", "b": "G01 X1\u00b0"})"s}};
+  auto msg = std::make_shared<JsonMessage>("JsonMessage", props);
+  msg->m_device = dev;
+  EntityPtr original = msg;
+
+  auto res = (*m_mapper)(std::move(msg));
+  ASSERT_TRUE(res);
+
+  auto list = get<EntityList>(res->getValue());
+  ASSERT_EQ(2, list.size());
+
+  auto obs = dynamic_pointer_cast<Observation>(list.front());
+  ASSERT_EQ(R"(C:\programs\"main".nc)", obs->getValue<string>());
+  obs = dynamic_pointer_cast<Observation>(list.back());
+  ASSERT_EQ("G01 X1\u00b0", obs->getValue<string>());
+
+  // The message is left unchanged
+  ASSERT_EQ(R"({"a": "C:\\programs\\\"main\".nc", "b": "G01 X1\u00b0"})",
+            original->getValue<string>());
+}
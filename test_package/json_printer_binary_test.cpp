@@ -0,0 +1,188 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+// Ensure that gtest is the first header otherwise Windows raises an error
+#include <gtest/gtest.h>
+// Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
+
+#include <memory>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "agent_test_helper.hpp"
+#include "json_helper.hpp"
+#include "mtconnect/agent.hpp"
+#include "mtconnect/entity/json_printer.hpp"
+#include "mtconnect/observation/observation.hpp"
+#include "mtconnect/printer//json_printer.hpp"
+#include "mtconnect/utilities.hpp"
+#include "test_utilities.hpp"
+
+using namespace std;
+using namespace mtconnect;
+using namespace mtconnect::observation;
+using namespace mtconnect::printer;
+using json = nlohmann::json;
+
+// main
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class JsonPrinterBinaryTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_agentTestHelper = make_unique<AgentTestHelper>();
+    m_agentTestHelper->createAgent("/samples/SimpleDevlce.xml", 8, 4, "2.0", 25);
+    m_devices = m_agentTestHelper->m_agent->getDevices();
+  }
+
+  void TearDown() override
+  {
+    m_agentTestHelper.reset();
+    m_devices.clear();
+  }
+
+  ObservationPtr observe(const char *id, const entity::Value &value, uint64_t sequence)
+  {
+    auto di = m_agentTestHelper->m_agent->getDataItemById(id);
+    EXPECT_TRUE(di) << "Could not find data item " << id;
+    ErrorList errors;
+    auto name = di->isCondition() ? "level" : "VALUE";
+    auto obs = Observation::make(di, {{name, value}}, chrono::system_clock::now(), errors);
+    obs->setSequence(sequence);
+    return obs;
+  }
+
+  json decode(const string &doc, BinaryEncoding encoding)
+  {
+    if (encoding == BinaryEncoding::CBOR)
+      return json::from_cbor(doc);
+    else
+      return json::from_msgpack(doc);
+  }
+
+  // The creation time is the only part of the header that differs between renderings
+  static void removeCreationTime(json &doc)
+  {
+    for (auto &root : doc)
+      root["Header"].erase("creationTime");
+  }
+
+  std::unique_ptr<AgentTestHelper> m_agentTestHelper;
+  std::list<DevicePtr> m_devices;
+};
+
+TEST_F(JsonPrinterBinaryTest, should_encode_the_probe_with_the_same_structure)
+{
+  JsonPrinter text(2);
+  for (auto encoding : {BinaryEncoding::CBOR, BinaryEncoding::MSGPACK})
+  {
+    JsonPrinter binary(2, false, encoding);
+
+    auto expected = json::parse(text.printProbe(123, 9999, 1, 1024, 10, m_devices));
+    auto doc = binary.printProbe(123, 9999, 1, 1024, 10, m_devices);
+    auto actual = decode(doc, encoding);
+
+    removeCreationTime(expected);
+    removeCreationTime(actual);
+    ASSERT_EQ(expected, actual);
+  }
+}
+
+TEST_F(JsonPrinterBinaryTest, should_encode_observations_with_the_same_structure)
+{
+  ObservationList list;
+  list.emplace_back(observe("dcbc0570", 123.5, 10));
+  list.emplace_back(observe("dcbc0570", -0.1, 11));
+  list.emplace_back(observe("f646f730", int64_t(-40000), 12));
+  list.emplace_back(observe("r1841b70", int64_t(70000), 13));
+  list.emplace_back(observe("x7ca94e0", "ARMED"s, 14));
+  list.emplace_back(observe("m17f1750", string(300, 'x'), 15));
+  list.emplace_back(observe("e086dd60", "fault"s, 16));
+
+  JsonPrinter text(2);
+  for (auto encoding : {BinaryEncoding::CBOR, BinaryEncoding::MSGPACK})
+  {
+    JsonPrinter binary(2, false, encoding);
+
+    auto expected = json::parse(text.printSample(123, 131072, 17, 1, 16, list));
+    auto doc = binary.printSample(123, 131072, 17, 1, 16, list);
+    auto actual = decode(doc, encoding);
+
+    removeCreationTime(expected);
+    removeCreationTime(actual);
+    ASSERT_EQ(expected, actual);
+    ASSERT_LT(doc.size(), text.printSample(123, 131072, 17, 1, 16, list).size());
+  }
+}
+
+TEST_F(JsonPrinterBinaryTest, should_use_the_binary_mime_types)
+{
+  ASSERT_EQ("application/cbor", JsonPrinter(2, false, BinaryEncoding::CBOR).mimeType());
+  ASSERT_EQ("application/msgpack", JsonPrinter(2, false, BinaryEncoding::MSGPACK).mimeType());
+  ASSERT_EQ("application/mtconnect+json", JsonPrinter(2).mimeType());
+
+  ASSERT_EQ(BinaryEncoding::CBOR, ParseBinaryEncoding("cbor"));
+  ASSERT_EQ(BinaryEncoding::MSGPACK, ParseBinaryEncoding("msgpack"));
+  ASSERT_FALSE(ParseBinaryEncoding("json"));
+}
+
+TEST_F(JsonPrinterBinaryTest, should_encode_entities_and_arrays_of_entities)
+{
+  auto first = observe("dcbc0570", 1.25, 10);
+  auto second = observe("dcbc0570", 2.5, 11);
+
+  entity::JsonEntityPrinter text(2);
+  for (auto encoding : {BinaryEncoding::CBOR, BinaryEncoding::MSGPACK})
+  {
+    entity::JsonEntityPrinter binary(2, false, false, encoding);
+
+    ASSERT_EQ(json::parse(text.printEntity(first)), decode(binary.printEntity(first), encoding));
+
+    auto expected =
+        json::parse(text.printArray({text.printEntity(first), text.printEntity(second)}));
+    auto actual = decode(
+        binary.printArray({binary.printEntity(first), binary.printEntity(second)}), encoding);
+    ASSERT_EQ(2, actual.size());
+    ASSERT_EQ(expected, actual);
+  }
+}
+
+TEST_F(JsonPrinterBinaryTest, should_select_the_binary_printer_from_the_accept_header)
+{
+  json expected;
+  m_agentTestHelper->responseHelper(__FILE__, __LINE__, {}, expected, "/probe");
+  removeCreationTime(expected);
+
+  for (auto encoding : {BinaryEncoding::CBOR, BinaryEncoding::MSGPACK})
+  {
+    auto mimeType = BinaryEncodingMimeType(encoding);
+    m_agentTestHelper->makeRequest(__FILE__, __LINE__, boost::beast::http::verb::get, "", {},
+                                   "/probe", mimeType.c_str());
+    ASSERT_EQ(mimeType, m_agentTestHelper->m_session->m_mimeType);
+
+    auto actual = decode(m_agentTestHelper->m_session->m_body, encoding);
+    removeCreationTime(actual);
+    ASSERT_EQ(expected, actual);
+  }
+}
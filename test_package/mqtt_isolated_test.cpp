@@ -595,3 +595,68 @@ TEST_F(MqttIsolatedUnitTest, mqtt_client_should_publish_last_will)
   waitFor(5s, [&closed]() { return closed; });
   client.reset();
 }
+
+TEST_F(MqttIsolatedUnitTest, mqtt_client_should_send_queued_messages_when_connected)
+{
+  ConfigOptions options {{ServerIp, "127.0.0.1"s}, {MqttPort, 0},          {MqttTls, false},
+                         {AutoAvailable, false},   {RealTime, false},      {MqttMaxInflight, 2},
+                         {MqttClientId, "queued"s}};
+
+  createServer(options);
+  startServer();
+
+  ASSERT_NE(0, m_port);
+
+  auto client = mqtt::make_async_client(m_agentTestHelper->m_ioContext.get(), "localhost", m_port);
+
+  client->set_client_id("subscriber");
+  client->set_clean_session(true);
+  client->set_keep_alive_sec(30);
+
+  client->set_connack_handler(
+      [&client](bool sp, mqtt::connect_return_code connack_return_code) {
+        EXPECT_EQ(mqtt::connect_return_code::accepted, connack_return_code);
+        client->async_subscribe(client->acquire_unique_packet_id(), "Queued/#",
+                                MQTT_NS::qos::at_least_once,
+                                [](MQTT_NS::error_code ec) { EXPECT_FALSE(ec); });
+        return true;
+      });
+
+  bool subscribed = false;
+  client->set_suback_handler(
+      [&subscribed](std::uint16_t packet_id, std::vector<mqtt::suback_return_code> results) {
+        subscribed = true;
+        return true;
+      });
+
+  vector<string> received;
+  client->set_publish_handler([&received](mqtt::optional<std::uint16_t> packet_id,
+                                          mqtt::publish_options pubopts, mqtt::buffer topic_name,
+                                          mqtt::buffer contents) {
+    received.emplace_back(contents);
+    return true;
+  });
+
+  client->async_connect([](mqtt::error_code ec) { ASSERT_FALSE(ec) << "Cannot connect"; });
+  ASSERT_TRUE(waitFor(5s, [&subscribed]() { return subscribed; }));
+
+  createClient(options, make_unique<ClientHandler>());
+
+  // Messages published before the client connects are held in the outbound queue
+  for (int i = 1; i <= 5; i++)
+    ASSERT_TRUE(m_client->publish("Queued/Message", "message " + to_string(i)));
+  ASSERT_EQ(5, m_client->getQueuedMessages());
+  ASSERT_LT(0, m_client->getQueuedBytes());
+
+  ASSERT_TRUE(startClient());
+  ASSERT_TRUE(waitFor(5s, [&received]() { return received.size() == 5; }));
+  ASSERT_EQ((vector<string> {"message 1", "message 2", "message 3", "message 4", "message 5"}),
+            received);
+
+  ASSERT_TRUE(waitFor(5s, [this]() { return m_client->getInflightMessages() == 0; }));
+  ASSERT_EQ(0, m_client->getQueuedMessages());
+  ASSERT_EQ(0, m_client->getDroppedMessages());
+
+  client->async_disconnect();
+  client.reset();
+}
@@ -0,0 +1,215 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+// Ensure that gtest is the first header otherwise Windows raises an error
+#include <gtest/gtest.h>
+// Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mtconnect/mqtt/mqtt_outbound_queue.hpp"
+
+using namespace std;
+using namespace mtconnect::mqtt_client;
+namespace fs = std::filesystem;
+
+// main
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class MqttOutboundQueueTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_spillFile = fs::temp_directory_path() /
+                  ("mqtt_outbound_queue_test_" +
+                   string(testing::UnitTest::GetInstance()->current_test_info()->name()) + ".dat");
+    fs::remove(m_spillFile);
+  }
+
+  void TearDown() override { fs::remove(m_spillFile); }
+
+  // Messages are 10 bytes, a 4 byte topic and a 6 byte payload
+  static MqttOutboundQueue::Message message(int i)
+  {
+    char payload[16];
+    snprintf(payload, sizeof(payload), "msg%03d", i);
+    return {"test", payload, MqttQoS::AT_LEAST_ONCE, true};
+  }
+
+  static vector<string> drain(MqttOutboundQueue &queue)
+  {
+    vector<string> payloads;
+    while (auto m = queue.pop())
+      payloads.push_back(m->m_payload);
+    return payloads;
+  }
+
+  fs::path m_spillFile;
+};
+
+TEST_F(MqttOutboundQueueTest, should_queue_messages_in_memory_in_order)
+{
+  MqttOutboundQueue queue(100);
+
+  for (int i = 0; i < 3; i++)
+    ASSERT_TRUE(queue.push(message(i)));
+
+  ASSERT_EQ(3, queue.size());
+  ASSERT_EQ(30, queue.getQueuedBytes());
+  ASSERT_EQ(0, queue.getSpilledBytes());
+
+  ASSERT_EQ((vector<string> {"msg000", "msg001", "msg002"}), drain(queue));
+  ASSERT_TRUE(queue.empty());
+  ASSERT_EQ(0, queue.getQueuedBytes());
+}
+
+TEST_F(MqttOutboundQueueTest, should_drop_the_oldest_messages_without_a_spill_file)
+{
+  MqttOutboundQueue queue(30);
+
+  for (int i = 0; i < 5; i++)
+    ASSERT_TRUE(queue.push(message(i)));
+
+  ASSERT_EQ(3, queue.size());
+  ASSERT_EQ(2, queue.getDropped());
+  ASSERT_EQ((vector<string> {"msg002", "msg003", "msg004"}), drain(queue));
+
+  ASSERT_FALSE(queue.push({"test", string(100, 'x')}));
+  ASSERT_EQ(3, queue.getDropped());
+}
+
+TEST_F(MqttOutboundQueueTest, should_spill_to_disk_and_keep_the_order)
+{
+  MqttOutboundQueue queue(30, m_spillFile, 4096);
+  ASSERT_TRUE(queue.hasSpillFile());
+
+  for (int i = 0; i < 10; i++)
+    ASSERT_TRUE(queue.push(message(i)));
+
+  ASSERT_EQ(10, queue.size());
+  ASSERT_EQ(100, queue.getQueuedBytes());
+  ASSERT_EQ(70, queue.getSpilledBytes());
+  ASSERT_EQ(0, queue.getDropped());
+
+  // New messages must follow the spilled messages even when memory is available
+  ASSERT_EQ("msg000", queue.pop()->m_payload);
+  ASSERT_TRUE(queue.push(message(10)));
+
+  vector<string> expected;
+  for (int i = 1; i <= 10; i++)
+    expected.push_back(message(i).m_payload);
+  ASSERT_EQ(expected, drain(queue));
+  ASSERT_EQ(0, queue.getSpilledBytes());
+}
+
+TEST_F(MqttOutboundQueueTest, should_drop_the_oldest_when_the_spill_file_is_full)
+{
+  // Each spilled record has a 12 byte header, so the file holds two messages
+  MqttOutboundQueue queue(20, m_spillFile, 50);
+
+  for (int i = 0; i < 6; i++)
+    ASSERT_TRUE(queue.push(message(i)));
+
+  ASSERT_EQ(4, queue.size());
+  ASSERT_EQ(2, queue.getDropped());
+  ASSERT_EQ((vector<string> {"msg002", "msg003", "msg004", "msg005"}), drain(queue));
+}
+
+TEST_F(MqttOutboundQueueTest, should_recover_spilled_messages_after_a_restart)
+{
+  {
+    MqttOutboundQueue queue(20, m_spillFile, 4096);
+    for (int i = 0; i < 5; i++)
+      ASSERT_TRUE(queue.push(message(i)));
+    ASSERT_EQ(30, queue.getSpilledBytes());
+  }
+
+  MqttOutboundQueue queue(20, m_spillFile, 4096);
+  ASSERT_EQ(3, queue.size());
+  ASSERT_EQ((vector<string> {"msg002", "msg003", "msg004"}), drain(queue));
+}
+
+TEST_F(MqttOutboundQueueTest, should_discard_a_corrupt_spill_file_after_a_restart)
+{
+  {
+    MqttOutboundQueue queue(20, m_spillFile, 4096);
+    for (int i = 0; i < 5; i++)
+      ASSERT_TRUE(queue.push(message(i)));
+    ASSERT_EQ(30, queue.getSpilledBytes());
+  }
+
+  // Overwrite the topic size of the second spilled record so it runs past the written data
+  {
+    fstream file(m_spillFile, ios::binary | ios::in | ios::out);
+    uint32_t topicSize = 1000000;
+    file.seekp(64 + 12 + 10);
+    file.write(reinterpret_cast<const char *>(&topicSize), sizeof(topicSize));
+  }
+
+  MqttOutboundQueue queue(20, m_spillFile, 4096);
+  ASSERT_EQ(3, queue.size());
+  ASSERT_EQ((vector<string> {"msg002"}), drain(queue));
+  ASSERT_EQ(0, queue.size());
+  ASSERT_EQ(0, queue.getSpilledBytes());
+
+  ASSERT_TRUE(queue.push(message(5)));
+  ASSERT_EQ((vector<string> {"msg005"}), drain(queue));
+}
+
+TEST_F(MqttOutboundQueueTest, should_return_inflight_messages_to_the_front)
+{
+  MqttOutboundQueue queue(100);
+  for (int i = 0; i < 4; i++)
+    ASSERT_TRUE(queue.push(message(i)));
+
+  deque<MqttOutboundQueue::Message> inflight;
+  inflight.emplace_back(*queue.pop());
+  inflight.emplace_back(*queue.pop());
+
+  queue.pushFront(std::move(inflight));
+  ASSERT_EQ((vector<string> {"msg000", "msg001", "msg002", "msg003"}), drain(queue));
+}
+
+TEST_F(MqttOutboundQueueTest, should_preserve_qos_and_retain_when_spilled)
+{
+  MqttOutboundQueue queue(0, m_spillFile, 4096);
+
+  ASSERT_TRUE(queue.push({"topic/a", "one", MqttQoS::AT_MOST_ONCE, false}));
+  ASSERT_TRUE(queue.push({"topic/b", "two", MqttQoS::EXACTLY_ONCE, true}));
+  ASSERT_EQ(20, queue.getSpilledBytes());
+
+  auto first = queue.pop();
+  ASSERT_EQ("topic/a", first->m_topic);
+  ASSERT_EQ("one", first->m_payload);
+  ASSERT_EQ(MqttQoS::AT_MOST_ONCE, first->m_qos);
+  ASSERT_FALSE(first->m_retain);
+
+  auto second = queue.pop();
+  ASSERT_EQ("topic/b", second->m_topic);
+  ASSERT_EQ(MqttQoS::EXACTLY_ONCE, second->m_qos);
+  ASSERT_TRUE(second->m_retain);
+
+  ASSERT_FALSE(queue.pop());
+}
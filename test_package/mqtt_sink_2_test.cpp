@@ -308,9 +308,46 @@ TEST_F(MqttSink2Test, mqtt_sink_should_publish_Current)
   ASSERT_TRUE(gotCurrent);
 
   gotCurrent = false;
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:00Z|line|204");
   ASSERT_TRUE(waitFor(1s, [&gotCurrent]() { return gotCurrent; }));
 }
 
+TEST_F(MqttSink2Test, mqtt_sink_should_only_publish_current_when_the_device_changes)
+{
+  ConfigOptions options;
+  createServer(options);
+  startServer();
+  ASSERT_NE(0, m_port);
+
+  auto handler = make_unique<ClientHandler>();
+  int currents = 0;
+  handler->m_receive = [&currents](std::shared_ptr<MqttClient> client, const std::string &topic,
+                                   const std::string &payload) {
+    EXPECT_EQ("MTConnect/Current/000", topic);
+    currents++;
+  };
+
+  createClient(options, std::move(handler));
+  ASSERT_TRUE(startClient());
+  m_client->subscribe("MTConnect/Current/000");
+
+  createAgent();
+
+  auto service = m_agentTestHelper->getMqtt2Service();
+  ASSERT_TRUE(waitFor(60s, [&service]() { return service->isConnected(); }));
+  ASSERT_TRUE(waitFor(1s, [&currents]() { return currents > 0; }));
+
+  // Nothing changed for several current intervals
+  auto published = currents;
+  m_agentTestHelper->m_ioContext.run_for(1s);
+  ASSERT_EQ(published, currents);
+
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:00Z|line|204");
+  ASSERT_TRUE(waitFor(1s, [&currents, published]() { return currents > published; }));
+  m_agentTestHelper->m_ioContext.run_for(500ms);
+  ASSERT_EQ(published + 1, currents);
+}
+
 TEST_F(MqttSink2Test, mqtt_sink_should_publish_Probe_with_uuid_first)
 {
   ConfigOptions options;
@@ -424,3 +461,21 @@ TEST_F(MqttSink2Test, mqtt_sink_should_publish_agent_device)
 
   ASSERT_TRUE(waitFor(1s, [&gotDevice]() { return gotDevice; }));
 }
+
+TEST_F(MqttSink2Test, mqtt_sink_should_use_a_clean_session_without_a_client_id)
+{
+  createAgent();
+  auto service = m_agentTestHelper->getMqtt2Service();
+  ASSERT_TRUE(service->getClient());
+  ASSERT_TRUE(service->getClient()->isCleanSession());
+}
+
+TEST_F(MqttSink2Test, mqtt_sink_should_keep_the_session_with_a_client_id)
+{
+  ConfigOptions options {{MqttClientId, "mtc_sink_2_test"s}};
+  createAgent("", options);
+  auto service = m_agentTestHelper->getMqtt2Service();
+  ASSERT_TRUE(service->getClient());
+  ASSERT_EQ("mtc_sink_2_test", service->getClient()->getIdentity());
+  ASSERT_FALSE(service->getClient()->isCleanSession());
+}
@@ -628,3 +628,94 @@ TEST_F(MqttSinkTest, mqtt_should_publish_conditions_with_the_state_as_the_key)
       "2018-04-27T05:00:26.555666|ctmp|fault|X111|BAD|HIGH|Temperature is too high");
   ASSERT_TRUE(waitFor(5s, [&gotCondition]() { return gotCondition; }));
 }
+
+TEST_F(MqttSinkTest, mqtt_sink_should_publish_the_latest_value_in_a_batch)
+{
+  ConfigOptions options;
+  createServer(options);
+  startServer();
+  ASSERT_NE(0, m_port);
+
+  auto handler = make_unique<ClientHandler>();
+  vector<string> values;
+  handler->m_receive = [&values](std::shared_ptr<MqttClient> client, const std::string &topic,
+                                 const std::string &payload) {
+    EXPECT_EQ("MTConnect/Observation/000/Controller[Controller]/Path/Events/Line[line]", topic);
+    auto jdoc = json::parse(payload);
+    values.push_back(jdoc.at("/value"_json_pointer).get<string>());
+  };
+  createClient(options, std::move(handler));
+  ASSERT_TRUE(startClient());
+
+  createAgent("", {{configuration::MqttBatchInterval, 200ms}});
+  auto service = m_agentTestHelper->getMqttService();
+  ASSERT_TRUE(waitFor(5s, [&service]() { return service->isConnected(); }));
+
+  m_client->subscribe("MTConnect/Observation/000/Controller[Controller]/Path/Events/Line[line]");
+  m_agentTestHelper->m_ioContext.run_for(500ms);
+  values.clear();
+
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:00Z|line|204");
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:01Z|line|205");
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:02Z|line|206");
+
+  ASSERT_TRUE(waitFor(5s, [&values]() { return !values.empty(); }));
+  m_agentTestHelper->m_ioContext.run_for(500ms);
+  ASSERT_EQ(vector<string> {"206"}, values);
+  ASSERT_EQ(0, service->getBatchedTopicCount());
+}
+
+TEST_F(MqttSinkTest, mqtt_sink_should_publish_the_batch_history_as_an_array)
+{
+  ConfigOptions options;
+  createServer(options);
+  startServer();
+  ASSERT_NE(0, m_port);
+
+  auto handler = make_unique<ClientHandler>();
+  vector<string> values;
+  handler->m_receive = [&values](std::shared_ptr<MqttClient> client, const std::string &topic,
+                                 const std::string &payload) {
+    auto jdoc = json::parse(payload);
+    ASSERT_TRUE(jdoc.is_array());
+    values.clear();
+    for (auto &obs : jdoc)
+      values.push_back(obs.at("/value"_json_pointer).get<string>());
+  };
+  createClient(options, std::move(handler));
+  ASSERT_TRUE(startClient());
+
+  createAgent("", {{configuration::MqttBatchInterval, 200ms},
+                   {configuration::MqttBatchHistory, true}});
+  auto service = m_agentTestHelper->getMqttService();
+  ASSERT_TRUE(waitFor(5s, [&service]() { return service->isConnected(); }));
+
+  m_client->subscribe("MTConnect/Observation/000/Controller[Controller]/Path/Events/Line[line]");
+  m_agentTestHelper->m_ioContext.run_for(500ms);
+  values.clear();
+
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:00Z|line|204");
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:01Z|line|205");
+  m_agentTestHelper->m_adapter->processData("2021-02-01T12:00:02Z|line|206");
+
+  ASSERT_TRUE(waitFor(5s, [&values]() { return values.size() == 3; }));
+  ASSERT_EQ((vector<string> {"204", "205", "206"}), values);
+}
+
+TEST_F(MqttSinkTest, mqtt_sink_should_use_a_clean_session_without_a_client_id)
+{
+  createAgent();
+  auto service = m_agentTestHelper->getMqttService();
+  ASSERT_TRUE(service->getClient());
+  ASSERT_TRUE(service->getClient()->isCleanSession());
+}
+
+TEST_F(MqttSinkTest, mqtt_sink_should_keep_the_session_with_a_client_id)
+{
+  ConfigOptions options {{MqttClientId, "mtc_sink_test"s}};
+  createAgent("", options);
+  auto service = m_agentTestHelper->getMqttService();
+  ASSERT_TRUE(service->getClient());
+  ASSERT_EQ("mtc_sink_test", service->getClient()->getIdentity());
+  ASSERT_FALSE(service->getClient()->isCleanSession());
+}
@@ -535,3 +535,25 @@ TEST_F(ObservationTest, should_represent_negative_inf_values_in_json_correctly)
       R"DOC({"Temperature":{"dataItemId":"x","timestamp":"2021-01-19T10:01:00Z","value":"-Infinity"}})DOC",
       buffer.str());
 }
+
+TEST_F(ObservationTest, should_refer_to_the_replacement_data_item)
+{
+  ErrorList errors;
+  auto replacement = DataItem::make(
+      {{"id", "1"s}, {"name", "NewName"s}, {"type", "PROGRAM"s}, {"category", "EVENT"s}}, errors);
+  ASSERT_EQ(0, errors.size());
+
+  replacement->replace(*m_dataItem1);
+  ASSERT_EQ(m_dataItem1->getHandle(), replacement->getHandle());
+  ASSERT_EQ(replacement, m_compEventA->getDataItem());
+
+  // The observation follows the handle after the old data item is gone
+  m_dataItem1.reset();
+  ASSERT_EQ(replacement, m_compEventA->getDataItem());
+  ASSERT_EQ("NewName", *m_compEventA->getDataItem()->getName());
+
+  // When the data item is removed the observation no longer has a data item
+  replacement.reset();
+  ASSERT_FALSE(m_compEventA->getDataItem());
+  ASSERT_TRUE(m_compEventA->isOrphan());
+}
@@ -0,0 +1,141 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+// Ensure that gtest is the first header otherwise Windows raises an error
+#include <gtest/gtest.h>
+// Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
+
+#include <iostream>
+#include <stdexcept>
+
+#include "mtconnect/parser/path_resolver.hpp"
+#include "mtconnect/parser/xml_parser.hpp"
+#include "mtconnect/printer//xml_printer.hpp"
+#include "test_utilities.hpp"
+
+using namespace std;
+using namespace std::literals;
+using namespace mtconnect;
+using namespace device_model;
+
+// main
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class PathResolverTest : public testing::Test
+{
+protected:
+  void SetUp() override { load(TEST_RESOURCE_DIR "/samples/test_config.xml"); }
+
+  void load(const string &file)
+  {
+    printer::XmlPrinter printer;
+    m_xmlParser = make_unique<parser::XmlParser>();
+    m_devices = m_xmlParser->parseFile(file, &printer);
+    m_resolver = make_unique<parser::PathResolver>();
+    m_resolver->load(m_devices);
+  }
+
+  FilterSet resolve(const string &path)
+  {
+    FilterSet filter;
+    EXPECT_TRUE(m_resolver->getDataItems(filter, path)) << "Path not supported: " << path;
+    return filter;
+  }
+
+  FilterSet xpath(const string &path)
+  {
+    FilterSet filter;
+    m_xmlParser->getDataItems(filter, path);
+    return filter;
+  }
+
+  unique_ptr<parser::XmlParser> m_xmlParser;
+  unique_ptr<parser::PathResolver> m_resolver;
+  std::list<DevicePtr> m_devices;
+};
+
+TEST_F(PathResolverTest, should_resolve_the_same_data_items_as_libxml2)
+{
+  for (auto path : {"//Linear"s,
+                    "//Linear//DataItem[@category='CONDITION']"s,
+                    "//Device/DataItems"s,
+                    R"(//Rotary[@name="C"]//DataItem[@type="LOAD"])"s,
+                    R"(//Rotary[@name="C"]//DataItem[@category="CONDITION" or @category="SAMPLE"])"s,
+                    "//Axes//DataItem[@type='POSITION' and @subType='ACTUAL']"s,
+                    "//DataItem[@type='EXECUTION']|//DataItem[@type='CONTROLLER_MODE']"s,
+                    "//Devices/Device[@name=\"LinuxCNC\"]//Power"s,
+                    "//Devices/Device"s,
+                    "Devices/Device/Components/*"s,
+                    "//*[@id='c2']"s,
+                    "//DataItem[@units]"s,
+                    "//DataItem[@type!='POSITION']"s,
+                    "//Axes/Components/Linear[@name='X']/DataItems/DataItem"s})
+  {
+    auto native = resolve(path);
+    auto expected = xpath(path);
+    EXPECT_FALSE(expected.empty()) << path;
+    EXPECT_EQ(expected, native) << path;
+  }
+}
+
+TEST_F(PathResolverTest, should_resolve_paths_relative_to_a_device)
+{
+  auto filter =
+      resolve(R"(//Devices/Device[@uuid="000"]//Rotary[@name="C"]//DataItem[@type="LOAD"])");
+  ASSERT_EQ(2, filter.size());
+
+  filter = resolve(R"(//Devices/Device[@uuid="NOT_A_DEVICE"]//Rotary)");
+  ASSERT_EQ(0, filter.size());
+}
+
+TEST_F(PathResolverTest, should_report_unsupported_paths)
+{
+  FilterSet filter;
+  ASSERT_FALSE(m_resolver->getDataItems(filter, "//////Linear"));
+  ASSERT_FALSE(m_resolver->getDataItems(filter, "//Axes?//Linear"));
+  ASSERT_FALSE(m_resolver->getDataItems(filter, "//Device/DataItems/"));
+  ASSERT_FALSE(m_resolver->getDataItems(filter, "//Devices/Device[@name=\"I_DON'T_EXIST\""));
+  ASSERT_FALSE(m_resolver->getDataItems(filter, "//Linear[1]"));
+  ASSERT_FALSE(m_resolver->getDataItems(filter, "//Linear/../DataItems"));
+  ASSERT_FALSE(m_resolver->getDataItems(filter, "//DataItem[contains(@type, 'POS')]"));
+  ASSERT_TRUE(filter.empty());
+}
+
+TEST_F(PathResolverTest, should_resolve_namespaced_components)
+{
+  load(TEST_RESOURCE_DIR "/samples/extension.xml");
+
+  ASSERT_EQ(0, resolve("//Device//Pump").size());
+  ASSERT_EQ(1, resolve("//Device//x:Pump").size());
+}
+
+TEST_F(PathResolverTest, should_follow_references)
+{
+  load(TEST_RESOURCE_DIR "/samples/reference_example.xml");
+
+  auto filter = resolve("//BarFeederInterface");
+  ASSERT_EQ(5, filter.size());
+  ASSERT_EQ(1, filter.count("mf"));
+  ASSERT_EQ(1, filter.count("c4"));
+  ASSERT_EQ(1, filter.count("bfc"));
+  ASSERT_EQ(1, filter.count("d2"));
+  ASSERT_EQ(1, filter.count("eps"));
+}
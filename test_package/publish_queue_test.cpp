@@ -0,0 +1,230 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+// Ensure that gtest is the first header otherwise Windows raises an error
+#include <gtest/gtest.h>
+// Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
+
+#include <boost/asio/io_context.hpp>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "mtconnect/device_model/component.hpp"
+#include "mtconnect/device_model/data_item/data_item.hpp"
+#include "mtconnect/observation/observation.hpp"
+#include "mtconnect/sink/publish_queue.hpp"
+#include "test_utilities.hpp"
+
+using namespace std;
+using namespace mtconnect;
+using namespace mtconnect::sink;
+using namespace mtconnect::observation;
+using namespace device_model;
+using namespace data_item;
+using namespace entity;
+
+// main
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class PublishQueueTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    ErrorList errors;
+    m_component = Component::make("Linear", {{"id", "x"s}, {"name", "X"s}}, errors);
+    m_position = DataItem::make(
+        {{"id", "xpos"s}, {"type", "POSITION"s}, {"category", "SAMPLE"s}, {"units", "MILLIMETER"s}},
+        errors);
+    m_load = DataItem::make(
+        {{"id", "xload"s}, {"type", "LOAD"s}, {"category", "SAMPLE"s}, {"units", "PERCENT"s}},
+        errors);
+    m_system = DataItem::make({{"id", "xsys"s}, {"type", "SYSTEM"s}, {"category", "CONDITION"s}},
+                              errors);
+    m_component->addDataItem(m_position, errors);
+    m_component->addDataItem(m_load, errors);
+    m_component->addDataItem(m_system, errors);
+    ASSERT_TRUE(errors.empty());
+  }
+
+  void TearDown() override { m_queue.reset(); }
+
+  void makeQueue(size_t capacity, PublishQueue::Overflow overflow)
+  {
+    m_queue = make_shared<PublishQueue>(
+        m_context, [this](ObservationPtr &obs) { m_published.push_back(obs); }, capacity,
+        overflow);
+  }
+
+  ObservationPtr observe(DataItemPtr dataItem, const entity::Value &value)
+  {
+    auto name = dataItem->isCondition() ? "level" : "VALUE";
+    ErrorList errors;
+    auto obs =
+        Observation::make(dataItem, {{name, value}}, std::chrono::system_clock::now(), errors);
+    obs->setSequence(++m_sequence);
+    return obs;
+  }
+
+  vector<uint64_t> sequences() const
+  {
+    vector<uint64_t> seqs;
+    for (auto &o : m_published)
+      seqs.push_back(o->getSequence());
+    return seqs;
+  }
+
+  boost::asio::io_context m_context;
+  ComponentPtr m_component;
+  DataItemPtr m_position;
+  DataItemPtr m_load;
+  DataItemPtr m_system;
+  shared_ptr<PublishQueue> m_queue;
+  vector<ObservationPtr> m_published;
+  uint64_t m_sequence {0};
+};
+
+TEST_F(PublishQueueTest, should_publish_in_order_on_the_strand)
+{
+  makeQueue(16, PublishQueue::Overflow::BLOCK);
+
+  m_queue->push(observe(m_position, 1.0));
+  m_queue->push(observe(m_load, 2.0));
+  m_queue->push(observe(m_position, 3.0));
+
+  ASSERT_TRUE(m_published.empty());
+  ASSERT_EQ(3, m_queue->size());
+
+  m_context.run();
+
+  ASSERT_EQ((vector<uint64_t> {1, 2, 3}), sequences());
+  ASSERT_EQ(0, m_queue->size());
+}
+
+TEST_F(PublishQueueTest, should_wait_for_the_strand_when_blocked)
+{
+  using namespace std::chrono_literals;
+
+  makeQueue(2, PublishQueue::Overflow::BLOCK);
+
+  m_queue->push(observe(m_position, 1.0));
+  m_queue->push(observe(m_load, 2.0));
+  ASSERT_TRUE(m_published.empty());
+
+  // The push waits for room and never publishes in the pushing thread
+  auto third = observe(m_position, 3.0);
+  auto pushed = async(launch::async, [&]() { m_queue->push(third); });
+  ASSERT_EQ(future_status::timeout, pushed.wait_for(50ms));
+  ASSERT_TRUE(m_published.empty());
+
+  m_context.run_one();
+  ASSERT_EQ(future_status::ready, pushed.wait_for(1s));
+  ASSERT_EQ((vector<uint64_t> {1, 2}), sequences());
+
+  m_context.restart();
+  m_context.run();
+  ASSERT_EQ((vector<uint64_t> {1, 2, 3}), sequences());
+  ASSERT_EQ(0, m_queue->getDropped());
+}
+
+TEST_F(PublishQueueTest, should_drop_the_oldest_when_blocked_too_long)
+{
+  makeQueue(1, PublishQueue::Overflow::BLOCK);
+
+  // Nothing runs the strand, so the push gives up waiting
+  m_queue->push(observe(m_position, 1.0));
+  m_queue->push(observe(m_load, 2.0));
+
+  ASSERT_EQ(1, m_queue->getDropped());
+  m_context.run();
+  ASSERT_EQ((vector<uint64_t> {2}), sequences());
+}
+
+TEST_F(PublishQueueTest, should_drop_the_oldest_when_full)
+{
+  makeQueue(2, PublishQueue::Overflow::DROP_OLDEST);
+
+  m_queue->push(observe(m_position, 1.0));
+  m_queue->push(observe(m_load, 2.0));
+  m_queue->push(observe(m_position, 3.0));
+
+  ASSERT_EQ(2, m_queue->size());
+  ASSERT_EQ(1, m_queue->getDropped());
+
+  m_context.run();
+  ASSERT_EQ((vector<uint64_t> {2, 3}), sequences());
+}
+
+TEST_F(PublishQueueTest, should_coalesce_observations_for_the_same_data_item)
+{
+  makeQueue(2, PublishQueue::Overflow::COALESCE);
+
+  m_queue->push(observe(m_position, 1.0));
+  m_queue->push(observe(m_load, 2.0));
+  m_queue->push(observe(m_position, 3.0));
+  m_queue->push(observe(m_load, 4.0));
+
+  ASSERT_EQ(2, m_queue->size());
+  ASSERT_EQ(2, m_queue->getCoalesced());
+  ASSERT_EQ(0, m_queue->getDropped());
+
+  m_context.run();
+  ASSERT_EQ((vector<uint64_t> {3, 4}), sequences());
+}
+
+TEST_F(PublishQueueTest, should_not_coalesce_conditions)
+{
+  makeQueue(2, PublishQueue::Overflow::COALESCE);
+
+  m_queue->push(observe(m_system, "NORMAL"s));
+  m_queue->push(observe(m_position, 1.0));
+  m_queue->push(observe(m_system, "NORMAL"s));
+
+  ASSERT_EQ(0, m_queue->getCoalesced());
+  ASSERT_EQ(1, m_queue->getDropped());
+
+  m_context.run();
+  ASSERT_EQ((vector<uint64_t> {2, 3}), sequences());
+}
+
+TEST_F(PublishQueueTest, should_discard_queued_observations_when_cleared)
+{
+  makeQueue(16, PublishQueue::Overflow::COALESCE);
+
+  m_queue->push(observe(m_position, 1.0));
+  m_queue->push(observe(m_load, 2.0));
+  m_queue->clear();
+  m_queue->push(observe(m_position, 3.0));
+
+  m_context.run();
+  ASSERT_EQ((vector<uint64_t> {3}), sequences());
+}
+
+TEST_F(PublishQueueTest, should_parse_overflow_policies)
+{
+  ASSERT_EQ(PublishQueue::Overflow::BLOCK, PublishQueue::parseOverflow("Block"));
+  ASSERT_EQ(PublishQueue::Overflow::DROP_OLDEST, PublishQueue::parseOverflow("drop_oldest"));
+  ASSERT_EQ(PublishQueue::Overflow::COALESCE, PublishQueue::parseOverflow("COALESCE"));
+  ASSERT_FALSE(PublishQueue::parseOverflow("wait"));
+}
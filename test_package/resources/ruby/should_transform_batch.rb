@@ -0,0 +1,8 @@
+MTConnect::Logger.info "Declaring batch transform"
+
+$batches = []
+
+$trans = MTConnect::RubyBatchTransform.new("BatchTransform", :Event, 3) { |batch|
+  $batches << batch.size
+  batch.select { |obs| obs.value != "ACTIVE" }
+}
@@ -406,3 +406,150 @@ TEST_F(ResponseDocumentTest, should_parse_legacy_error)
   ASSERT_EQ("OUT_OF_RANGE", error.m_code);
   ASSERT_EQ("'at' must be greater than 4871368", error.m_message);
 }
+
+TEST_F(ResponseDocumentTest, should_stream_observations_and_skip_unknown_data_items)
+{
+  string data {R"(<?xml version="1.0" encoding="UTF-8"?>
+<MTConnectStreams xmlns:m="urn:mtconnect.org:MTConnectStreams:1.8"
+    xmlns="urn:mtconnect.org:MTConnectStreams:1.8"
+    xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance"
+    xsi:schemaLocation="urn:mtconnect.org:MTConnectStreams:1.8 https://schemas.mtconnect.org/schemas/MTConnectStreams_1.8.xsd">
+    <Header creationTime="2022-04-22T04:06:21Z" sender="IntelAgent" instanceId="1649989201" version="2.0.0.1" deviceModelChangeTime="2022-04-21T21:32:38.042794Z" bufferSize="131072" nextSequence="5741581" firstSequence="5610509" lastSequence="5741580"/>
+    <Streams>
+        <DeviceStream name="LinuxCNC" uuid="000">
+            <ComponentStream componentId="path1" component="Path">
+                <Events>
+                    <Program name="program" sequence="5741552" timestamp="2022-04-22T04:06:21Z" dataItemId="p4">O1 &amp; <![CDATA[<O2>]]></Program>
+                    <Unknown name="zzz" sequence="5741553" timestamp="2022-04-22T04:06:21Z" dataItemId="zzz" count="1">
+                        <Entry key="X">1</Entry>
+                    </Unknown>
+                    <Line name="line" sequence="5741554" timestamp="2022-04-22T04:06:21Z" dataItemId="p3">204</Line>
+                </Events>
+            </ComponentStream>
+        </DeviceStream>
+    </Streams>
+</MTConnectStreams>
+)"};
+
+  m_doc.emplace();
+  ASSERT_TRUE(ResponseDocument::parse(data, *m_doc, m_context));
+
+  ASSERT_EQ(5741581, m_doc->m_next);
+  ASSERT_EQ(1649989201, m_doc->m_instanceId);
+
+  ASSERT_EQ(2, m_doc->m_entities.size());
+  auto ent = m_doc->m_entities.begin();
+
+  ASSERT_EQ("Program", (*ent)->getName());
+  ASSERT_EQ("O1 & <O2>", (*ent)->getValue<string>());
+
+  ent++;
+  ASSERT_EQ("Line", (*ent)->getName());
+  ASSERT_EQ("204", (*ent)->getValue<string>());
+  ASSERT_EQ("p3", (*ent)->get<string>("dataItemId"));
+}
+
+TEST_F(ResponseDocumentTest, should_parse_json_observations)
+{
+  string data {R"({
+  "MTConnectStreams": {
+    "jsonVersion": 2,
+    "schemaVersion": "2.0",
+    "Header": {"creationTime": "2022-04-22T04:06:21Z", "sender": "IntelAgent", "instanceId": 1649989201,
+               "version": "2.0.0.1", "bufferSize": 131072, "nextSequence": 5741581,
+               "firstSequence": 5610509, "lastSequence": 5741580},
+    "Streams": {
+      "DeviceStream": [{
+        "name": "LinuxCNC", "uuid": "000",
+        "ComponentStream": [
+          {"component": "Device", "componentId": "d",
+           "Events": {
+             "AssetChanged": [{"sequence": 5741550, "assetType": "CuttingTool", "timestamp": "2022-04-22T04:06:21Z",
+                               "dataItemId": "d_asset_chg", "value": "TOOLABC"}],
+             "AssetRemoved": [{"sequence": 5741551, "assetType": "CuttingTool", "timestamp": "2022-04-22T04:06:21Z",
+                               "dataItemId": "d_asset_rem", "value": "TOOLDEF"}]}},
+          {"component": "Path", "componentId": "path1",
+           "Events": {
+             "ControllerMode": [{"name": "mode", "sequence": 5741552, "timestamp": "2022-04-22T04:06:21Z",
+                                 "dataItemId": "px", "value": "AUTOMATIC"}],
+             "VariableDataSet": [{"name": "vars", "sequence": 5741553, "timestamp": "2022-04-22T04:06:21Z",
+                                  "dataItemId": "v1", "count": 3,
+                                  "value": {"X100": 66, "X101": "ABC", "X103": {"removed": true}}}]}},
+          {"component": "Rotary", "componentId": "c",
+           "Samples": {
+             "RotaryVelocity": [{"sequence": 5741554, "timestamp": "2022-04-22T04:06:21Z",
+                                 "dataItemId": "c1", "value": 1556.33}]}}
+        ]
+      }]
+    }
+  }
+})"};
+
+  m_doc.emplace();
+  ASSERT_TRUE(ResponseDocument::parse(data, *m_doc, m_context));
+
+  ASSERT_EQ(ResponseDocument::OBSERVATION, m_doc->m_enityType);
+  ASSERT_EQ(5741581, m_doc->m_next);
+  ASSERT_EQ(1649989201, m_doc->m_instanceId);
+
+  ASSERT_EQ(4, m_doc->m_entities.size());
+  auto ent = m_doc->m_entities.begin();
+
+  ASSERT_EQ("AssetCommand", (*ent)->getName());
+  ASSERT_EQ("RemoveAsset", (*ent)->getValue<string>());
+  ASSERT_EQ("TOOLDEF", (*ent)->get<string>("assetId"));
+
+  ent++;
+  ASSERT_EQ("ControllerMode", (*ent)->getName());
+  ASSERT_EQ("AUTOMATIC", (*ent)->getValue<string>());
+  ASSERT_EQ("p2", (*ent)->get<string>("dataItemId"));
+
+  ent++;
+  ASSERT_EQ("VariableDataSet", (*ent)->getName());
+  ASSERT_EQ(3, (*ent)->get<int64_t>("count"));
+  const auto &ds = (*ent)->getValue<DataSet>();
+  ASSERT_EQ(3, ds.size());
+  auto dse = ds.begin();
+  ASSERT_EQ("X100", dse->m_key);
+  ASSERT_EQ(66, get<int64_t>(dse->m_value));
+  dse++;
+  ASSERT_EQ("X101", dse->m_key);
+  ASSERT_EQ("ABC", get<string>(dse->m_value));
+  dse++;
+  ASSERT_EQ("X103", dse->m_key);
+  ASSERT_TRUE(dse->m_removed);
+
+  ent++;
+  ASSERT_EQ("RotaryVelocity", (*ent)->getName());
+  ASSERT_EQ(1556.33, (*ent)->getValue<double>());
+
+  ASSERT_EQ(1, m_doc->m_assetEvents.size());
+  ASSERT_EQ("TOOLABC", m_doc->m_assetEvents.front()->getValue<string>());
+}
+
+TEST_F(ResponseDocumentTest, should_parse_json_version_1_observations_and_errors)
+{
+  string data {R"({"MTConnectStreams": {"jsonVersion": 1,
+  "Header": {"instanceId": 1649989201, "nextSequence": 100},
+  "Streams": [{"DeviceStream": {"name": "LinuxCNC", "uuid": "000",
+    "ComponentStreams": [{"ComponentStream": {"component": "Path", "componentId": "path1",
+      "Events": [{"ControllerMode": {"name": "mode", "sequence": 99, "timestamp": "2022-04-22T04:06:21Z",
+                                     "dataItemId": "px", "value": "MANUAL"}}]}}]}}]}})"};
+
+  m_doc.emplace();
+  ASSERT_TRUE(ResponseDocument::parse(data, *m_doc, m_context));
+  ASSERT_EQ(100, m_doc->m_next);
+  ASSERT_EQ(1, m_doc->m_entities.size());
+  ASSERT_EQ("MANUAL", m_doc->m_entities.front()->getValue<string>());
+
+  string error {R"({"MTConnectError": {"jsonVersion": 2,
+  "Header": {"instanceId": 1649989201},
+  "Errors": {"Error": [{"errorCode": "OUT_OF_RANGE", "value": "'at' must be greater than 4871368"}]}}})"};
+
+  m_doc.emplace();
+  ASSERT_FALSE(ResponseDocument::parse(error, *m_doc, m_context));
+  ASSERT_EQ(ResponseDocument::ERRORS, m_doc->m_enityType);
+  ASSERT_EQ(1, m_doc->m_errors.size());
+  ASSERT_EQ("OUT_OF_RANGE", m_doc->m_errors.front().m_code);
+  ASSERT_EQ("'at' must be greater than 4871368", m_doc->m_errors.front().m_message);
+}
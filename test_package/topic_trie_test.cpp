@@ -0,0 +1,141 @@
+//
+// Copyright Copyright 2009-2022, AMT – The Association For Manufacturing Technology (“AMT”)
+// All rights reserved.
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+
+// Ensure that gtest is the first header otherwise Windows raises an error
+#include <gtest/gtest.h>
+// Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mtconnect/mqtt/topic_trie.hpp"
+
+using namespace std;
+using namespace mtconnect::mqtt_server;
+
+// main
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class TopicTrieTest : public testing::Test
+{
+protected:
+  vector<string> match(const string &topic)
+  {
+    vector<string> subscribers;
+    m_trie.match(topic, [&subscribers](const string &subscriber, int) {
+      subscribers.push_back(subscriber);
+    });
+    sort(subscribers.begin(), subscribers.end());
+    return subscribers;
+  }
+
+  TopicTrie<string, int> m_trie;
+};
+
+TEST_F(TopicTrieTest, should_match_exact_topics)
+{
+  ASSERT_TRUE(m_trie.insert("MTConnect/Observation/000/Line", "a", 1));
+  ASSERT_TRUE(m_trie.insert("MTConnect/Observation/000/Block", "b", 1));
+
+  ASSERT_EQ((vector<string> {"a"}), match("MTConnect/Observation/000/Line"));
+  ASSERT_EQ((vector<string> {"b"}), match("MTConnect/Observation/000/Block"));
+  ASSERT_TRUE(match("MTConnect/Observation/000").empty());
+  ASSERT_TRUE(match("MTConnect/Observation/000/Line/x").empty());
+}
+
+TEST_F(TopicTrieTest, should_match_wildcards)
+{
+  ASSERT_TRUE(m_trie.insert("MTConnect/#", "hash", 1));
+  ASSERT_TRUE(m_trie.insert("MTConnect/+/000/Line", "plus", 1));
+  ASSERT_TRUE(m_trie.insert("#", "all", 1));
+
+  ASSERT_EQ((vector<string> {"all", "hash", "plus"}), match("MTConnect/Observation/000/Line"));
+  ASSERT_EQ((vector<string> {"all", "hash"}), match("MTConnect/Observation/000/Block"));
+  ASSERT_EQ((vector<string> {"all", "hash"}), match("MTConnect"));
+  ASSERT_EQ((vector<string> {"all"}), match("Other/Topic"));
+}
+
+TEST_F(TopicTrieTest, should_not_match_system_topics_with_leading_wildcards)
+{
+  ASSERT_TRUE(m_trie.insert("#", "all", 1));
+  ASSERT_TRUE(m_trie.insert("+/stats", "plus", 1));
+  ASSERT_TRUE(m_trie.insert("$SYS/#", "sys", 1));
+
+  ASSERT_EQ((vector<string> {"sys"}), match("$SYS/stats"));
+}
+
+TEST_F(TopicTrieTest, should_reject_invalid_filters)
+{
+  ASSERT_FALSE(m_trie.insert("MTConnect/#/Line", "a", 1));
+  ASSERT_FALSE(m_trie.insert("MTConnect/Obs+", "a", 1));
+  ASSERT_FALSE(m_trie.insert("", "a", 1));
+  ASSERT_FALSE(m_trie.insert("$share//MTConnect/#", "a", 1));
+  ASSERT_FALSE(m_trie.insert("$share/group", "a", 1));
+  ASSERT_TRUE(m_trie.empty());
+}
+
+TEST_F(TopicTrieTest, should_deliver_shared_subscriptions_to_one_member)
+{
+  ASSERT_TRUE(m_trie.insert("$share/workers/MTConnect/#", "w1", 1));
+  ASSERT_TRUE(m_trie.insert("$share/workers/MTConnect/#", "w2", 1));
+  ASSERT_TRUE(m_trie.insert("MTConnect/#", "monitor", 1));
+
+  vector<string> delivered;
+  for (int i = 0; i < 4; i++)
+  {
+    auto subscribers = match("MTConnect/Observation/000/Line");
+    ASSERT_EQ(2, subscribers.size());
+    ASSERT_EQ("monitor", subscribers[0]);
+    delivered.push_back(subscribers[1]);
+  }
+
+  ASSERT_EQ((vector<string> {"w1", "w2", "w1", "w2"}), delivered);
+}
+
+TEST_F(TopicTrieTest, should_remove_subscriptions)
+{
+  ASSERT_TRUE(m_trie.insert("MTConnect/#", "a", 1));
+  ASSERT_TRUE(m_trie.insert("MTConnect/+/000/Line", "a", 1));
+  ASSERT_TRUE(m_trie.insert("$share/workers/MTConnect/#", "a", 1));
+  ASSERT_TRUE(m_trie.insert("MTConnect/#", "b", 1));
+  ASSERT_EQ(4, m_trie.size());
+
+  ASSERT_TRUE(m_trie.erase("MTConnect/#", "b"));
+  ASSERT_FALSE(m_trie.erase("MTConnect/#", "b"));
+  ASSERT_EQ(3, m_trie.size());
+  ASSERT_EQ((vector<string> {"a", "a", "a"}), match("MTConnect/Observation/000/Line"));
+
+  m_trie.erase("a");
+  ASSERT_TRUE(m_trie.empty());
+  ASSERT_TRUE(match("MTConnect/Observation/000/Line").empty());
+}
+
+TEST_F(TopicTrieTest, should_replace_the_value_of_an_existing_subscription)
+{
+  ASSERT_TRUE(m_trie.insert("MTConnect/#", "a", 0));
+  ASSERT_TRUE(m_trie.insert("MTConnect/#", "a", 2));
+  ASSERT_EQ(1, m_trie.size());
+
+  int value = -1;
+  m_trie.match("MTConnect/Device", [&value](const string &, int v) { value = v; });
+  ASSERT_EQ(2, value);
+}
@@ -19,6 +19,8 @@
 #include <gtest/gtest.h>
 // Keep this comment to keep gtest.h above. (clang-format off/on is not working here!)
 
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -503,3 +505,123 @@ TEST_F(XmlParserTest, ParseDeviceMTConnectVersion)
 
   ASSERT_EQ(string("1.7"), dev->get<string>("mtconnectVersion"));
 }
+
+TEST_F(XmlParserTest, should_parse_devices_in_parallel_in_document_order)
+{
+  using namespace std::chrono;
+
+  // Generate a large device file to compare the startup time with one and many threads
+  const int deviceCount = 200, componentCount = 20, itemCount = 10;
+  auto file = std::filesystem::temp_directory_path() / "xml_parser_test_many_devices.xml";
+  {
+    ofstream out(file);
+    out << R"(<?xml version="1.0" encoding="UTF-8"?>
+<MTConnectDevices xmlns="urn:mtconnect.org:MTConnectDevices:2.0">
+  <Devices>
+)";
+    for (int d = 0; d < deviceCount; d++)
+    {
+      auto dev = "d"s + to_string(d);
+      out << "<Device uuid=\"" << dev << "-uuid\" name=\"" << dev << "\" id=\"" << dev
+          << "\"><DataItems><DataItem type=\"AVAILABILITY\" category=\"EVENT\" id=\"" << dev
+          << "_avail\"/></DataItems><Components>";
+      for (int c = 0; c < componentCount; c++)
+      {
+        auto comp = dev + "_c" + to_string(c);
+        out << "<Linear id=\"" << comp << "\" name=\"X" << c << "\"><DataItems>";
+        for (int i = 0; i < itemCount; i++)
+          out << "<DataItem type=\"POSITION\" category=\"SAMPLE\" subType=\"ACTUAL\" "
+                 "units=\"MILLIMETER\" id=\""
+              << comp << "_" << i << "\"/>";
+        out << "</DataItems></Linear>";
+      }
+      out << "</Components></Device>\n";
+    }
+    out << "</Devices></MTConnectDevices>\n";
+  }
+
+  auto load = [&](size_t threads, milliseconds &duration) {
+    printer::XmlPrinter printer;
+    parser::XmlParser parser;
+    parser.setThreads(threads);
+    auto start = steady_clock::now();
+    auto devices = parser.parseFile(file.string(), &printer);
+    duration = duration_cast<milliseconds>(steady_clock::now() - start);
+    return devices;
+  };
+
+  milliseconds serialTime, parallelTime;
+  auto serial = load(1, serialTime);
+  auto parallel = load(4, parallelTime);
+  std::filesystem::remove(file);
+
+  ASSERT_EQ(deviceCount, serial.size());
+  ASSERT_EQ(deviceCount, parallel.size());
+
+  int d = 0;
+  for (auto s = serial.begin(), p = parallel.begin(); s != serial.end(); s++, p++, d++)
+  {
+    ASSERT_EQ("d"s + to_string(d) + "-uuid", *(*p)->getUuid());
+    ASSERT_EQ(*(*s)->getUuid(), *(*p)->getUuid());
+    ASSERT_EQ(componentCount * itemCount + 1, (*p)->getDeviceDataItems().size());
+    ASSERT_TRUE((*p)->getDeviceDataItem((*p)->getId() + "_c3_7"));
+  }
+
+  RecordProperty("SerialLoadMs", int(serialTime.count()));
+  RecordProperty("ParallelLoadMs", int(parallelTime.count()));
+}
+
+TEST_F(XmlParserTest, should_restore_devices_from_a_snapshot)
+{
+  auto dir = std::filesystem::temp_directory_path();
+  auto snapshot = dir / "xml_parser_test_devices.snapshot";
+  auto file = dir / "xml_parser_test_devices.xml";
+  std::filesystem::remove(snapshot);
+  std::filesystem::copy_file(TEST_RESOURCE_DIR "/samples/test_config.xml", file,
+                             std::filesystem::copy_options::overwrite_existing);
+
+  printer::XmlPrinter printer;
+  auto load = [&](parser::XmlParser &parser) {
+    parser.setSnapshotFile(snapshot);
+    return parser.parseFile(file.string(), &printer);
+  };
+
+  parser::XmlParser first;
+  auto parsed = load(first);
+  ASSERT_TRUE(first.hasDocument());
+  ASSERT_TRUE(std::filesystem::exists(snapshot));
+
+  // The devices are restored without parsing the XML
+  parser::XmlParser second;
+  auto restored = load(second);
+  ASSERT_FALSE(second.hasDocument());
+  ASSERT_EQ(first.getSchemaVersion(), second.getSchemaVersion());
+
+  ASSERT_EQ(parsed.size(), restored.size());
+  for (auto p = parsed.begin(), r = restored.begin(); p != parsed.end(); p++, r++)
+  {
+    ASSERT_EQ((*p)->hash(), (*r)->hash());
+    ASSERT_EQ((*p)->getDeviceDataItems().size(), (*r)->getDeviceDataItems().size());
+    auto item = (*r)->getDeviceDataItem("c1");
+    ASSERT_TRUE(item);
+    ASSERT_EQ(*r, item->getComponent()->getDevice());
+  }
+
+  // A changed device file is parsed again and the snapshot is replaced
+  {
+    ofstream out(file, ios::app);
+    out << "<!-- changed -->" << endl;
+  }
+
+  parser::XmlParser third;
+  auto reparsed = load(third);
+  ASSERT_TRUE(third.hasDocument());
+  ASSERT_EQ(parsed.size(), reparsed.size());
+
+  parser::XmlParser fourth;
+  load(fourth);
+  ASSERT_FALSE(fourth.hasDocument());
+
+  std::filesystem::remove(snapshot);
+  std::filesystem::remove(file);
+}
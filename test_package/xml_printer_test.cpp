@@ -896,3 +896,36 @@ TEST_F(XmlPrinterTest, PrintDataItemRelationships)
   ASSERT_XML_PATH_EQUAL(
       doc, "//m:DataItem[@id='xlcpl']/m:Relationships/m:DataItemRelationship@idRef", "xlc");
 }
+
+TEST_F(XmlPrinterTest, should_reuse_serialized_assets_in_compact_documents)
+{
+  printer::XmlPrinter printer(false);
+  ErrorList errors;
+  Properties props {
+      {"assetId", "P1"s}, {"deviceUuid", "000"s}, {"timestamp", "2020-12-01T12:00:00Z"s}};
+  auto part = dynamic_pointer_cast<asset::Asset>(
+      asset::Asset::getFactory()->make("Part", props, errors));
+  ASSERT_TRUE(part);
+  asset::AssetList list {part};
+
+  auto assets = [&printer, &list]() {
+    auto doc = printer.printAssets(123, 1024, 1, list);
+    return doc.substr(doc.find("<Assets>"));
+  };
+
+  auto first = assets();
+  ASSERT_EQ(1, printer.getAssetCache().size());
+  ASSERT_EQ(
+      "<Assets><Part assetId=\"P1\" deviceUuid=\"000\" timestamp=\"2020-12-01T12:00:00Z\"/>"
+      "</Assets></MTConnectAssets>\n",
+      first);
+  ASSERT_EQ(first, assets());
+
+  // Removing the asset changes the serialization
+  part->setProperty("removed", true);
+  ASSERT_NE(string::npos, assets().find("removed=\"true\""));
+  ASSERT_EQ(1, printer.getAssetCache().size());
+
+  printer.invalidateAsset("P1");
+  ASSERT_EQ(0, printer.getAssetCache().size());
+}